@@ -93,6 +93,78 @@ static int sound_modulate(FAR fmsynth_sound_t *snd)
   return out * snd->volume / FMSYNTH_MAX_VOLUME;
 }
 
+/****************************************************************************
+ * name: sound_modulate_block
+ ****************************************************************************/
+
+static void sound_modulate_block(FAR fmsynth_sound_t *snd,
+                                 FAR int *mix, int n)
+{
+  int i;
+  int out[FMSYNTH_BLOCKSIZE];
+  int sum[FMSYNTH_BLOCKSIZE];
+  FAR fmsynth_op_t *op;
+
+  if (snd->operators == NULL)
+    {
+      return;
+    }
+
+  fetch_feedback(snd->operators);
+
+  for (i = 0; i < n; i++)
+    {
+      sum[i] = 0;
+    }
+
+  for (op = snd->operators; op != NULL; op = op->parallelop)
+    {
+      fmsynthop_operate_block(op, snd->phase_time, out, n);
+
+      for (i = 0; i < n; i++)
+        {
+          sum[i] += out[i];
+        }
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      mix[i] += sum[i] * snd->volume / FMSYNTH_MAX_VOLUME;
+    }
+
+  snd->phase_time += n;
+  if (snd->phase_time >= max_phase_time)
+    {
+      snd->phase_time = 0;
+    }
+}
+
+/****************************************************************************
+ * name: block_frames
+ *
+ * Description:
+ *   Size of the next block.  A block ends where the phase time of a sound
+ *   wraps round, as the phase is reset only on the first sample.
+ *
+ ****************************************************************************/
+
+static int block_frames(FAR fmsynth_sound_t *snd, int frames)
+{
+  int n = frames < FMSYNTH_BLOCKSIZE ? frames : FMSYNTH_BLOCKSIZE;
+  int left;
+
+  for (; snd != NULL; snd = snd->next_sound)
+    {
+      left = max_phase_time - snd->phase_time;
+      if (left > 0 && left < n)
+        {
+          n = left;
+        }
+    }
+
+  return n;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -266,3 +338,63 @@ int fmsynth_rendering(FAR fmsynth_sound_t *snd,
 
   return i * sizeof(int16_t);
 }
+
+/****************************************************************************
+ * name: fmsynth_rendering_block
+ *
+ * Description:
+ *   Same as fmsynth_rendering(), but each operator renders up to
+ *   FMSYNTH_BLOCKSIZE frames per stage and the envelopes are updated once
+ *   per block.  cb is still called once per frame, but all the calls of a
+ *   block come after it, so a change made from cb takes effect on the next
+ *   block boundary.
+ *
+ ****************************************************************************/
+
+int fmsynth_rendering_block(FAR fmsynth_sound_t *snd,
+                            FAR int16_t *sample, int sample_num, int chnum,
+                            fmsynth_tickcb_t cb, unsigned long cbarg)
+{
+  int i;
+  int n;
+  int ch;
+  int done;
+  int frames = sample_num / chnum;
+  int mix[FMSYNTH_BLOCKSIZE];
+  FAR fmsynth_sound_t *itr;
+
+  for (done = 0; done < frames; done += n)
+    {
+      n = block_frames(snd, frames - done);
+
+      for (i = 0; i < n; i++)
+        {
+          mix[i] = 0;
+        }
+
+      for (itr = snd; itr != NULL; itr = itr->next_sound)
+        {
+          sound_modulate_block(itr, mix, n);
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          for (ch = 0; ch < chnum; ch++)
+            {
+              *sample++ = (int16_t)mix[i];
+            }
+        }
+
+      if (cb != NULL)
+        {
+          for (i = 0; i < n; i++)
+            {
+              cb(cbarg);
+            }
+        }
+    }
+
+  /* Return total bytes stored in the buffer */
+
+  return frames * chnum * sizeof(int16_t);
+}
@@ -60,6 +60,88 @@ static int set_egparams(int fs,
   return 0;
 }
 
+/****************************************************************************
+ * name: next_state
+ ****************************************************************************/
+
+static int next_state(FAR fmsynth_eg_t *eg, int state)
+{
+  do
+    {
+      state++;
+    }
+  while (state < EGSTATE_RELEASED && eg->state_params[state].period == 0);
+
+  return state;
+}
+
+/****************************************************************************
+ * name: peek_level
+ *
+ * Description:
+ *   Return the value the next fmsyntheg_operate() call would return,
+ *   without changing the state.
+ *
+ ****************************************************************************/
+
+static int peek_level(FAR fmsynth_eg_t *eg)
+{
+  FAR fmsynth_egparam_t *param = &eg->state_params[eg->state];
+
+  if (eg->state == EGSTATE_RELEASED)
+    {
+      return param->initval;
+    }
+
+  if (eg->state_counter >= param->period)
+    {
+      return eg->state_params[next_state(eg, eg->state)].initval;
+    }
+
+  return param->initval + param->diff2next * eg->state_counter
+                          / param->period;
+}
+
+/****************************************************************************
+ * name: skip_samples
+ *
+ * Description:
+ *   Advance the state as n fmsyntheg_operate() calls would, in one step
+ *   per state instead of one per sample.
+ *
+ ****************************************************************************/
+
+static void skip_samples(FAR fmsynth_eg_t *eg, int n)
+{
+  int steps;
+  FAR fmsynth_egparam_t *param;
+
+  while (n > 0 && eg->state != EGSTATE_RELEASED)
+    {
+      param = &eg->state_params[eg->state];
+
+      if (eg->state_counter >= param->period)
+        {
+          /* The sample which moves to the next state */
+
+          eg->state_counter = 0;
+          eg->state = next_state(eg, eg->state);
+          n--;
+        }
+      else
+        {
+          steps = param->period - eg->state_counter;
+          if (steps > n)
+            {
+              steps = n;
+            }
+
+          eg->state_counter += steps;
+          n -= steps;
+        }
+    }
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -187,13 +269,7 @@ int fmsyntheg_operate(FAR fmsynth_eg_t *eg)
 
           /* Search next available state */
 
-          do
-            {
-              eg->state++;
-            }
-          while (eg->state < EGSTATE_RELEASED
-               && eg->state_params[eg->state].period == 0);
-
+          eg->state = next_state(eg, eg->state);
           val = eg->state_params[eg->state].initval;
         }
       else
@@ -205,3 +281,32 @@ int fmsyntheg_operate(FAR fmsynth_eg_t *eg)
 
   return val;
 }
+
+/****************************************************************************
+ * name: fmsyntheg_operate_block
+ *
+ * Description:
+ *   Fill out[] with the levels of the next n samples.  The envelope is
+ *   evaluated once at each end of the block and ramped linearly in
+ *   between, so a state change inside the block is smoothed over it.
+ *
+ ****************************************************************************/
+
+void fmsyntheg_operate_block(FAR fmsynth_eg_t *eg, FAR int *out, int n)
+{
+  int i;
+  int start;
+  int step;
+
+  start = peek_level(eg);
+  skip_samples(eg, n);
+
+  /* Slope in 16.16 fixed point */
+
+  step = (peek_level(eg) - start) * 0x10000 / n;
+
+  for (i = 0; i < n; i++)
+    {
+      out[i] = start + ((step * i) >> 16);
+    }
+}
@@ -22,6 +22,7 @@
  * Included Files
  ****************************************************************************/
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <audioutils/fmsynth_op.h>
 
@@ -32,13 +33,21 @@
 #define PHASE_ADJUST(th) \
         (((th) < 0 ? (FMSYNTH_PI) - (th) : (th)) % (FMSYNTH_PI * 2))
 
+/* Fixed point phase of fmsynthop_operate_block(), 2^32 per cycle is
+ * 2^PHASE_SHIFT per FMSYNTH_PI * 2
+ */
+
+#define PHASE_SHIFT (15)
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
-static const short s_sintbl[] =
+/* int rather than short, vector gathers load 32 bit elements */
+
+static const int s_sintbl[] =
 {
-  0xff37, /* Extra data for linear completion */
+  -0x00c9, /* Extra data for linear completion */
 
   /* Actual sin table of half PI [256] */
 
@@ -117,37 +126,51 @@ static int local_fs;
  ****************************************************************************/
 
 /****************************************************************************
- * name: pseudo_sin256
+ * name: sin256_lookup
+ *
+ * Description:
+ *   The quadrant is turned into table indexes and a sign with masks
+ *   instead of branches, so a loop calling this can be vectorized.
+ *
  ****************************************************************************/
 
-static int pseudo_sin256(int theta)
+static inline int sin256_lookup(int theta)
 {
   int short_sin;
   int rest;
-  int phase;
+  int sign;
+  int odd;
   int tblidx;
+  int nextidx;
 
-  theta = PHASE_ADJUST(theta);
+  /* PHASE_ADJUST(), the operand of the modulo is not negative */
 
-  rest   = theta & 0x7f;
-  phase  = theta / (FMSYNTH_PI / 2);
-  tblidx = (theta % (FMSYNTH_PI / 2)) >> 7;
+  sign  = theta >> 31;
+  theta = (((theta ^ sign) - sign) + (FMSYNTH_PI & sign))
+          & (FMSYNTH_PI * 2 - 1);
 
-  if (phase & 0x01)
-    {
-      tblidx = 257 - tblidx;
-      short_sin = s_sintbl[tblidx];
-      short_sin = short_sin
-                + (((s_sintbl[tblidx - 1] - short_sin) * rest) >> 7);
-    }
-  else
-    {
-      short_sin = s_sintbl[tblidx + 1];
-      short_sin = short_sin
-                + (((s_sintbl[tblidx + 2] - short_sin) * rest) >> 7);
-    }
+  /* Odd quadrants read the table backwards, the second half is negated */
+
+  rest    = theta & 0x7f;
+  odd     = (theta >> 15) & 1;
+  sign    = -((theta >> 16) & 1);
+  tblidx  = (theta & (FMSYNTH_PI / 2 - 1)) >> 7;
+  tblidx  = tblidx + 1 + odd * (256 - 2 * tblidx);
+  nextidx = tblidx + 1 - 2 * odd;
+
+  short_sin = s_sintbl[tblidx]
+            + (((s_sintbl[nextidx] - s_sintbl[tblidx]) * rest) >> 7);
 
-  return phase & 0x02 ? -short_sin : short_sin;
+  return (short_sin ^ sign) - sign;
+}
+
+/****************************************************************************
+ * name: pseudo_sin256
+ ****************************************************************************/
+
+static int pseudo_sin256(int theta)
+{
+  return sin256_lookup(theta);
 }
 
 /****************************************************************************
@@ -229,6 +252,44 @@ static void update_parameters(FAR fmsynth_op_t *op)
     }
 }
 
+/****************************************************************************
+ * name: sin256_block
+ ****************************************************************************/
+
+static void sin256_block(FAR const int *restrict theta,
+                         FAR const int *restrict level,
+                         FAR int *restrict out, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      out[i] = level[i] * sin256_lookup(theta[i]) / FMSYNTH_MAX_EGLEVEL;
+    }
+}
+
+/****************************************************************************
+ * name: wave_block
+ ****************************************************************************/
+
+static void wave_block(FAR fmsynth_op_t *op, FAR const int *theta,
+                       FAR const int *level, FAR int *out, int n)
+{
+  int i;
+
+  if (op->wavegen == pseudo_sin256)
+    {
+      sin256_block(theta, level, out, n);
+    }
+  else
+    {
+      for (i = 0; i < n; i++)
+        {
+          out[i] = level[i] * op->wavegen(theta[i]) / FMSYNTH_MAX_EGLEVEL;
+        }
+    }
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -544,3 +605,84 @@ int fmsynthop_operate(FAR fmsynth_op_t *op, int phase_time)
 
   return op->last_sigval;
 }
+
+/****************************************************************************
+ * name: fmsynthop_operate_block
+ *
+ * Description:
+ *   Render n (up to FMSYNTH_BLOCKSIZE) samples of the operator into out[],
+ *   one stage at a time: the phase of the whole block, then each cascaded
+ *   operator added to it, then the waveform.  phase_time is the time of
+ *   the first sample, the phase is only reset there.
+ *
+ *   A feedback from the operator itself is applied per sample, any other
+ *   feedback uses the value fetched before the block.
+ *
+ ****************************************************************************/
+
+void fmsynthop_operate_block(FAR fmsynth_op_t *op, int phase_time,
+                             FAR int *out, int n)
+{
+  int i;
+  int val;
+  int last;
+  int phase[FMSYNTH_BLOCKSIZE];
+  int level[FMSYNTH_BLOCKSIZE];
+  uint32_t delta;
+  uint32_t acc;
+  FAR fmsynth_op_t *subop;
+
+  /* The phase is accumulated in a word where 2^32 is 2 * FMSYNTH_PI, it
+   * wraps round by itself and each sample is computed independently.
+   */
+
+  delta = (uint32_t)(op->delta_phase * (1 << PHASE_SHIFT));
+  acc   = phase_time ?
+          (uint32_t)(op->current_phase * (1 << PHASE_SHIFT)) : -delta;
+
+  for (i = 0; i < n; i++)
+    {
+      phase[i] = (acc + delta * (i + 1)) >> PHASE_SHIFT;
+    }
+
+  op->current_phase = (float)(acc + delta * n) / (1 << PHASE_SHIFT);
+
+  /* out[] is free until the last stage, use it for the modulators */
+
+  for (subop = op->cascadeop; subop != NULL; subop = subop->parallelop)
+    {
+      fmsynthop_operate_block(subop, phase_time, out, n);
+
+      for (i = 0; i < n; i++)
+        {
+          phase[i] += out[i];
+        }
+    }
+
+  fmsyntheg_operate_block(op->eg, level, n);
+
+  if (op->feedback_ref == &op->last_sigval)
+    {
+      last = op->last_sigval;
+
+      for (i = 0; i < n; i++)
+        {
+          val  = phase[i] + last * op->feedbackrate / FMSYNTH_MAX_EGLEVEL;
+          val  = op->wavegen == pseudo_sin256 ?
+                 sin256_lookup(val) : op->wavegen(val);
+          last = level[i] * val / FMSYNTH_MAX_EGLEVEL;
+          out[i] = last;
+        }
+    }
+  else
+    {
+      for (i = 0; i < n; i++)
+        {
+          phase[i] += op->feedback_val;
+        }
+
+      wave_block(op, phase, level, out, n);
+    }
+
+  op->last_sigval = out[n - 1];
+}
@@ -0,0 +1,364 @@
+/****************************************************************************
+ * apps/audioutils/fmsynth/test/fmsynth_bench.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <audioutils/fmsynth.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define FS          (48000)
+#define PERIOD      (FS / 100)  /* Frames per call, as an audio driver */
+#define MAX_OPS     (3)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+typedef CODE int (*render_t)(FAR fmsynth_sound_t *snd,
+                             FAR int16_t *sample, int sample_num, int chnum,
+                             fmsynth_tickcb_t cb, unsigned long cbarg);
+
+struct voice_s
+{
+  FAR fmsynth_sound_t *snd;
+  FAR fmsynth_op_t *ops[MAX_OPS];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * name: set_levels
+ ****************************************************************************/
+
+static void set_levels(FAR fmsynth_op_t *op)
+{
+  fmsynth_eglevels_t level;
+
+  level.attack.level       = 1.0f;
+  level.attack.period_ms   = 40;
+  level.decaybrk.level     = 0.3f;
+  level.decaybrk.period_ms = 200;
+  level.decay.level        = 0.2f;
+  level.decay.period_ms    = 100;
+  level.sustain.level      = 0.2f;
+  level.sustain.period_ms  = 1000;
+  level.release.level      = 0.2f;
+  level.release.period_ms  = 0;
+
+  fmsynthop_set_envelope(op, &level);
+}
+
+/****************************************************************************
+ * name: create_voice
+ *
+ * Description:
+ *   The voices cycle through the algorithms of examples/fmsynth: a
+ *   carrier with feedback, a modulated carrier and a chain of three.
+ *
+ ****************************************************************************/
+
+static int create_voice(FAR struct voice_s *voice, int type, int nvoices)
+{
+  int i;
+  int nops = type + 1;
+
+  for (i = 0; i < MAX_OPS; i++)
+    {
+      voice->ops[i] = i < nops ? fmsynthop_create() : NULL;
+      if (i < nops && voice->ops[i] == NULL)
+        {
+          return ERROR;
+        }
+
+      if (voice->ops[i] != NULL)
+        {
+          fmsynthop_select_opfunc(voice->ops[i], FMSYNTH_OPFUNC_SIN);
+          set_levels(voice->ops[i]);
+        }
+    }
+
+  switch (type)
+    {
+      case 0:
+        fmsynthop_bind_feedback(voice->ops[0], voice->ops[0], 0.6f);
+        break;
+
+      case 1:
+        fmsynthop_set_soundfreqrate(voice->ops[1], 3.7f);
+        fmsynthop_cascade_subop(voice->ops[0], voice->ops[1]);
+        break;
+
+      default:
+        fmsynthop_set_soundfreqrate(voice->ops[1], 2.f);
+        fmsynthop_set_soundfreqrate(voice->ops[2], 0.5f);
+        fmsynthop_cascade_subop(voice->ops[1], voice->ops[2]);
+        fmsynthop_cascade_subop(voice->ops[0], voice->ops[1]);
+        break;
+    }
+
+  voice->snd = fmsynthsnd_create();
+  if (voice->snd == NULL)
+    {
+      return ERROR;
+    }
+
+  fmsynthsnd_set_operator(voice->snd, voice->ops[0]);
+  fmsynthsnd_set_volume(voice->snd, 1.f / nvoices);
+
+  return OK;
+}
+
+/****************************************************************************
+ * name: delete_voices
+ ****************************************************************************/
+
+static void delete_voices(FAR struct voice_s *voices, int nvoices)
+{
+  int i;
+  int j;
+
+  for (i = 0; i < nvoices; i++)
+    {
+      for (j = 0; j < MAX_OPS; j++)
+        {
+          fmsynthop_delete(voices[i].ops[j]);
+        }
+
+      fmsynthsnd_delete(voices[i].snd);
+    }
+
+  free(voices);
+}
+
+/****************************************************************************
+ * name: create_voices
+ ****************************************************************************/
+
+static FAR struct voice_s *create_voices(int nvoices)
+{
+  FAR struct voice_s *voices;
+  int i;
+
+  voices = calloc(nvoices, sizeof(struct voice_s));
+  if (voices == NULL)
+    {
+      return NULL;
+    }
+
+  for (i = 0; i < nvoices; i++)
+    {
+      if (create_voice(&voices[i], i % 3, nvoices) != OK)
+        {
+          delete_voices(voices, nvoices);
+          return NULL;
+        }
+
+      if (i > 0)
+        {
+          fmsynthsnd_add_subsound(voices[0].snd, voices[i].snd);
+        }
+
+      /* Spread the notes over three octaves from A3 */
+
+      fmsynthsnd_set_soundfreq(voices[i].snd,
+                               220.f * powf(2.f, (i % 36) / 12.f));
+    }
+
+  return voices;
+}
+
+/****************************************************************************
+ * name: cputime
+ ****************************************************************************/
+
+static double cputime(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/****************************************************************************
+ * name: run
+ *
+ * Description:
+ *   Render the whole buffer in driver sized periods and return the CPU
+ *   time it took in seconds, or a negative value on failure.
+ *
+ ****************************************************************************/
+
+static double run(render_t render, FAR int16_t *buf, int frames,
+                  int nvoices)
+{
+  FAR struct voice_s *voices;
+  double start;
+  double end;
+  int n;
+  int i;
+
+  voices = create_voices(nvoices);
+  if (voices == NULL)
+    {
+      return -1.;
+    }
+
+  start = cputime();
+
+  for (i = 0; i < frames; i += n)
+    {
+      n = frames - i < PERIOD ? frames - i : PERIOD;
+      render(voices[0].snd, buf + i, n, 1, NULL, 0);
+    }
+
+  end = cputime();
+
+  delete_voices(voices, nvoices);
+  return end - start;
+}
+
+/****************************************************************************
+ * name: report
+ ****************************************************************************/
+
+static void report(FAR const char *name, double cpu, double seconds,
+                   int nvoices)
+{
+  printf("%-8s %8.3f s CPU  %8.2fx real time  %8.1f voices at %d Hz\n",
+         name, cpu, seconds / cpu, nvoices * seconds / cpu, FS);
+}
+
+/****************************************************************************
+ * name: show_usage
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname)
+{
+  printf("Usage: %s [-n voices] [-s seconds]\n", progname);
+  printf("  -n  Number of voices rendered together, default 32\n");
+  printf("  -s  Seconds of audio rendered by each renderer, default 4\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * name: main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR int16_t *ref;
+  FAR int16_t *blk;
+  double seconds = 4.;
+  double cpuref;
+  double cpublk;
+  double sig = 0.;
+  double err = 0.;
+  int nvoices = 32;
+  int maxerr = 0;
+  int frames;
+  int opt;
+  int i;
+
+  while ((opt = getopt(argc, argv, "n:s:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'n':
+            nvoices = atoi(optarg);
+            break;
+
+          case 's':
+            seconds = atof(optarg);
+            break;
+
+          default:
+            show_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+  frames = seconds * FS;
+  if (nvoices <= 0 || frames <= 0)
+    {
+      show_usage(argv[0]);
+      return 1;
+    }
+
+  ref = malloc(frames * sizeof(int16_t));
+  blk = malloc(frames * sizeof(int16_t));
+  if (ref == NULL || blk == NULL)
+    {
+      printf("No memory for %d frames\n", frames);
+      return 1;
+    }
+
+  fmsynth_initialize(FS);
+
+  cpuref = run(fmsynth_rendering, ref, frames, nvoices);
+  cpublk = run(fmsynth_rendering_block, blk, frames, nvoices);
+  if (cpuref < 0. || cpublk < 0.)
+    {
+      printf("No memory for %d voices\n", nvoices);
+      return 1;
+    }
+
+  /* The block renderer only differs by the envelope ramps */
+
+  for (i = 0; i < frames; i++)
+    {
+      int diff = blk[i] - ref[i];
+
+      sig += (double)ref[i] * ref[i];
+      err += (double)diff * diff;
+      if (abs(diff) > maxerr)
+        {
+          maxerr = abs(diff);
+        }
+    }
+
+  printf("%d voices, %.1f s of audio, block size %d\n",
+         nvoices, seconds, FMSYNTH_BLOCKSIZE);
+  report("sample", cpuref, seconds, nvoices);
+  report("block", cpublk, seconds, nvoices);
+  printf("speedup %.2fx, max difference %d, SNR %.1f dB\n",
+         cpuref / cpublk, maxerr,
+         err > 0. ? 10. * log10(sig / err) : INFINITY);
+
+  free(ref);
+  free(blk);
+  return 0;
+}
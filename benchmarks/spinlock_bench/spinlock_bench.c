@@ -22,89 +22,762 @@
  * Included Files
  ****************************************************************************/
 
-#include <stdio.h>
-#include <assert.h>
-#include <errno.h>
+#include <nuttx/config.h>
+#include <nuttx/clock.h>
 #include <nuttx/spinlock.h>
+
+#include <sys/param.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define TEST_NUM CONFIG_SPINLOCK_MULTITHREAD
-#define THREAD_NUM CONFIG_SPINLOCK_MULTITHREAD
+#ifdef CONFIG_SMP
+#  define BENCH_NCPUS       CONFIG_SMP_NCPUS
+#else
+#  define BENCH_NCPUS       1
+#endif
+
+#if CONFIG_RR_INTERVAL > 0
+#  define BENCH_POLICY      SCHED_RR
+#else
+#  define BENCH_POLICY      SCHED_FIFO
+#endif
+
+/* Keeps the locks and the per-thread counters of different threads off
+ * each other's cache lines, so that only the contention under test is
+ * measured.
+ */
+
+#define BENCH_CACHELINE     64
+
+#define BENCH_WRITE_PERIOD  10  /* One write in this many rwlock ops */
+
+/* Cases, indexes into g_cases */
+
+#define BENCH_UNCONTENDED   0   /* One instance per thread */
+#define BENCH_CONTENDED     1   /* One instance shared by all threads */
+#define BENCH_OVERSUBSCRIBED 2  /* Shared, more threads than CPUs */
+#define BENCH_NCASES        3
 
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
-struct thread_parmeter_s
+/* One instance of the primitive under test and the data it protects */
+
+struct bench_lock_s
+{
+  union
+  {
+    spinlock_t spin;
+    pthread_mutex_t mutex;
+    sem_t sem;
+    pthread_rwlock_t rwlock;
+    pthread_barrier_t barrier;
+  } u;
+
+  atomic_ulong atomic;
+  unsigned long counter;
+  bool barrier_stop;                /* Written by the barrier serial thread */
+} aligned_data(BENCH_CACHELINE);
+
+struct bench_run_s;
+
+struct bench_thread_s
+{
+  FAR struct bench_run_s *run;
+  FAR struct bench_lock_s *lock;
+  pthread_t tid;
+  unsigned long count;              /* Acquisitions */
+  unsigned long updates;            /* Of the protected data */
+  unsigned long reads;
+} aligned_data(BENCH_CACHELINE);
+
+struct bench_prim_s
+{
+  FAR const char *name;
+  CODE int (*init)(FAR struct bench_lock_s *lock, int nthreads);
+  CODE bool (*op)(FAR struct bench_thread_s *thread);
+  CODE void (*destroy)(FAR struct bench_lock_s *lock);
+};
+
+struct bench_run_s
+{
+  FAR const struct bench_prim_s *prim;
+  FAR struct bench_lock_s *locks;
+  FAR struct bench_thread_s *threads;
+  pthread_barrier_t start;
+  atomic_bool stop;
+  int nthreads;
+  int nlocks;
+};
+
+struct bench_opts_s
+{
+  int maxthreads;
+  int oversubscribed;
+  int duration;
+  int cases;                        /* Bit set of the cases to run */
+  bool csv;
+  bool verbose;
+  FAR const struct bench_prim_s *prim;
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int bench_spin_init(FAR struct bench_lock_s *lock, int nthreads);
+static bool bench_spin_op(FAR struct bench_thread_s *thread);
+static int bench_mutex_init(FAR struct bench_lock_s *lock, int nthreads);
+static bool bench_mutex_op(FAR struct bench_thread_s *thread);
+static void bench_mutex_destroy(FAR struct bench_lock_s *lock);
+static int bench_sem_init(FAR struct bench_lock_s *lock, int nthreads);
+static bool bench_sem_op(FAR struct bench_thread_s *thread);
+static void bench_sem_destroy(FAR struct bench_lock_s *lock);
+static int bench_rwlock_init(FAR struct bench_lock_s *lock, int nthreads);
+static bool bench_rdlock_op(FAR struct bench_thread_s *thread);
+static bool bench_rwlock_op(FAR struct bench_thread_s *thread);
+static void bench_rwlock_destroy(FAR struct bench_lock_s *lock);
+static int bench_atomic_init(FAR struct bench_lock_s *lock, int nthreads);
+static bool bench_atomic_op(FAR struct bench_thread_s *thread);
+static int bench_barrier_init(FAR struct bench_lock_s *lock, int nthreads);
+static bool bench_barrier_op(FAR struct bench_thread_s *thread);
+static void bench_barrier_destroy(FAR struct bench_lock_s *lock);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct bench_prim_s g_prims[] =
 {
-  FAR int *result;
-  FAR spinlock_t *lock;
+  {"spinlock", bench_spin_init, bench_spin_op, NULL},
+  {"mutex", bench_mutex_init, bench_mutex_op, bench_mutex_destroy},
+  {"sem", bench_sem_init, bench_sem_op, bench_sem_destroy},
+  {"rdlock", bench_rwlock_init, bench_rdlock_op, bench_rwlock_destroy},
+  {"rwlock", bench_rwlock_init, bench_rwlock_op, bench_rwlock_destroy},
+  {"atomic", bench_atomic_init, bench_atomic_op, NULL},
+  {"barrier", bench_barrier_init, bench_barrier_op,
+   bench_barrier_destroy},
+};
+
+static FAR const char * const g_cases[BENCH_NCASES] =
+{
+  "uncontended", "contended", "oversubscribed"
 };
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
-static FAR void *thread_spinlock(FAR void *parameter)
+/****************************************************************************
+ * Name: bench_running
+ ****************************************************************************/
+
+static inline bool bench_running(FAR struct bench_thread_s *thread)
 {
-  FAR int *result = ((FAR struct thread_parmeter_s *)parameter)->result;
-  FAR spinlock_t *lock = ((FAR struct thread_parmeter_s *)parameter)->lock;
+  return !atomic_load_explicit(&thread->run->stop, memory_order_relaxed);
+}
 
-  int i;
+/****************************************************************************
+ * Spinlock
+ ****************************************************************************/
+
+static int bench_spin_init(FAR struct bench_lock_s *lock, int nthreads)
+{
+  lock->u.spin = SP_UNLOCKED;
+  return OK;
+}
+
+static bool bench_spin_op(FAR struct bench_thread_s *thread)
+{
+  FAR struct bench_lock_s *lock = thread->lock;
+
+  spin_lock(&lock->u.spin);
+  lock->counter++;
+  spin_unlock(&lock->u.spin);
+
+  thread->updates++;
+  return bench_running(thread);
+}
+
+/****************************************************************************
+ * Mutex
+ ****************************************************************************/
+
+static int bench_mutex_init(FAR struct bench_lock_s *lock, int nthreads)
+{
+  return pthread_mutex_init(&lock->u.mutex, NULL);
+}
+
+static bool bench_mutex_op(FAR struct bench_thread_s *thread)
+{
+  FAR struct bench_lock_s *lock = thread->lock;
+
+  pthread_mutex_lock(&lock->u.mutex);
+  lock->counter++;
+  pthread_mutex_unlock(&lock->u.mutex);
+
+  thread->updates++;
+  return bench_running(thread);
+}
+
+static void bench_mutex_destroy(FAR struct bench_lock_s *lock)
+{
+  pthread_mutex_destroy(&lock->u.mutex);
+}
+
+/****************************************************************************
+ * Semaphore used as a lock
+ ****************************************************************************/
+
+static int bench_sem_init(FAR struct bench_lock_s *lock, int nthreads)
+{
+  return sem_init(&lock->u.sem, 0, 1) < 0 ? errno : OK;
+}
+
+static bool bench_sem_op(FAR struct bench_thread_s *thread)
+{
+  FAR struct bench_lock_s *lock = thread->lock;
+
+  while (sem_wait(&lock->u.sem) < 0)
+    {
+    }
+
+  lock->counter++;
+  sem_post(&lock->u.sem);
+
+  thread->updates++;
+  return bench_running(thread);
+}
+
+static void bench_sem_destroy(FAR struct bench_lock_s *lock)
+{
+  sem_destroy(&lock->u.sem);
+}
+
+/****************************************************************************
+ * Read-write lock, readers only or with one write in BENCH_WRITE_PERIOD
+ ****************************************************************************/
+
+static int bench_rwlock_init(FAR struct bench_lock_s *lock, int nthreads)
+{
+  return pthread_rwlock_init(&lock->u.rwlock, NULL);
+}
+
+static bool bench_rdlock_op(FAR struct bench_thread_s *thread)
+{
+  FAR struct bench_lock_s *lock = thread->lock;
+
+  pthread_rwlock_rdlock(&lock->u.rwlock);
+  thread->reads += lock->counter;
+  pthread_rwlock_unlock(&lock->u.rwlock);
+
+  return bench_running(thread);
+}
+
+static bool bench_rwlock_op(FAR struct bench_thread_s *thread)
+{
+  FAR struct bench_lock_s *lock = thread->lock;
+
+  if (thread->count % BENCH_WRITE_PERIOD == 0)
+    {
+      pthread_rwlock_wrlock(&lock->u.rwlock);
+      lock->counter++;
+      pthread_rwlock_unlock(&lock->u.rwlock);
+      thread->updates++;
+    }
+  else
+    {
+      pthread_rwlock_rdlock(&lock->u.rwlock);
+      thread->reads += lock->counter;
+      pthread_rwlock_unlock(&lock->u.rwlock);
+    }
+
+  return bench_running(thread);
+}
+
+static void bench_rwlock_destroy(FAR struct bench_lock_s *lock)
+{
+  pthread_rwlock_destroy(&lock->u.rwlock);
+}
+
+/****************************************************************************
+ * Atomic increment
+ ****************************************************************************/
+
+static int bench_atomic_init(FAR struct bench_lock_s *lock, int nthreads)
+{
+  return OK;
+}
+
+static bool bench_atomic_op(FAR struct bench_thread_s *thread)
+{
+  atomic_fetch_add_explicit(&thread->lock->atomic, 1, memory_order_relaxed);
+  thread->updates++;
+  return bench_running(thread);
+}
+
+/****************************************************************************
+ * Barrier
+ *
+ * The threads of a barrier can only stop together, so the serial thread of
+ * one crossing samples the stop flag for all of them, and the next crossing
+ * publishes it.  Each op is thus two crossings.
+ *
+ ****************************************************************************/
+
+static int bench_barrier_init(FAR struct bench_lock_s *lock, int nthreads)
+{
+  return pthread_barrier_init(&lock->u.barrier, NULL, nthreads);
+}
+
+static bool bench_barrier_op(FAR struct bench_thread_s *thread)
+{
+  FAR struct bench_lock_s *lock = thread->lock;
+
+  if (pthread_barrier_wait(&lock->u.barrier) ==
+      PTHREAD_BARRIER_SERIAL_THREAD)
+    {
+      lock->barrier_stop = !bench_running(thread);
+    }
+
+  pthread_barrier_wait(&lock->u.barrier);
+  return !lock->barrier_stop;
+}
+
+static void bench_barrier_destroy(FAR struct bench_lock_s *lock)
+{
+  pthread_barrier_destroy(&lock->u.barrier);
+}
+
+/****************************************************************************
+ * Name: bench_thread
+ ****************************************************************************/
+
+static FAR void *bench_thread(FAR void *arg)
+{
+  FAR struct bench_thread_s *thread = arg;
+  FAR const struct bench_prim_s *prim = thread->run->prim;
+  bool more;
+
+  pthread_barrier_wait(&thread->run->start);
 
-  for (i = 0; i < TEST_NUM; i++)
+  do
     {
-      spin_lock(lock);
-      (*result)++;
-      spin_unlock(lock);
+      more = prim->op(thread);
+      thread->count++;
     }
+  while (more);
 
   return NULL;
 }
 
 /****************************************************************************
- * Public Functions
+ * Name: bench_elapsed_ns
+ ****************************************************************************/
+
+static uint64_t bench_elapsed_ns(clock_t start, clock_t end)
+{
+  struct timespec ts;
+
+  perf_convert(end - start, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: bench_report
+ ****************************************************************************/
+
+static void bench_report(FAR const struct bench_opts_s *opts,
+                         FAR struct bench_run_s *run, int kind,
+                         uint64_t ns)
+{
+  FAR struct bench_thread_s *thread;
+  unsigned long min = ULONG_MAX;
+  unsigned long max = 0;
+  uint64_t total = 0;
+  double sumsq = 0;
+  unsigned int fairness;
+  int i;
+
+  for (i = 0; i < run->nthreads; i++)
+    {
+      thread = &run->threads[i];
+      total += thread->count;
+      sumsq += (double)thread->count * thread->count;
+      min    = MIN(min, thread->count);
+      max    = MAX(max, thread->count);
+    }
+
+  /* Jain's fairness index, 1 when all threads got the same share and
+   * 1/nthreads when one got everything.
+   */
+
+  fairness = sumsq > 0 ? (unsigned int)((double)total * total * 1000 /
+                                        (sumsq * run->nthreads) + 0.5) : 0;
+
+  if (ns == 0)
+    {
+      ns = 1;
+    }
+
+  printf(opts->csv ? "%s,%s,%d,%llu,%llu,%llu,%llu,%lu,%lu,%u.%03u," :
+         "%-8s %-14s %7d %6llu %10llu %10llu %8llu %10lu %10lu %2u.%03u\n",
+         run->prim->name, g_cases[kind], run->nthreads,
+         (unsigned long long)(ns / 1000000),
+         (unsigned long long)total,
+         (unsigned long long)(total * NSEC_PER_SEC / ns),
+         (unsigned long long)(total > 0 ? ns / total : 0),
+         min, max, fairness / 1000, fairness % 1000);
+
+  if (opts->csv || opts->verbose)
+    {
+      if (!opts->csv)
+        {
+          printf("  per thread:");
+        }
+
+      for (i = 0; i < run->nthreads; i++)
+        {
+          printf(opts->csv ? "%s%lu" : "%s %lu",
+                 opts->csv && i > 0 ? ";" : "", run->threads[i].count);
+        }
+
+      printf("\n");
+    }
+}
+
+/****************************************************************************
+ * Name: bench_run
+ *
+ * Description:
+ *   Run nthreads threads on one primitive for the given case, with one
+ *   instance per thread when uncontended and one shared by all otherwise.
+ *
  ****************************************************************************/
 
-void main(void)
+static int bench_run(FAR const struct bench_opts_s *opts,
+                     FAR const struct bench_prim_s *prim, int kind,
+                     int nthreads)
 {
-  spinlock_t lock = SP_UNLOCKED;
-  int result = 0;
-  pthread_t thread[THREAD_NUM];
-  struct thread_parmeter_s para;
+  FAR struct bench_thread_s *thread;
+  struct sched_param param;
+  struct bench_run_s run;
+  pthread_attr_t attr;
+  unsigned long expected = 0;
+  unsigned long updates = 0;
   clock_t start;
   clock_t end;
-
-  int status;
+  int ninit;
+  int ret;
   int i;
+#ifdef CONFIG_SMP
+  cpu_set_t cpuset;
+#endif
 
-  para.result = &result;
-  para.lock = &lock;
+  memset(&run, 0, sizeof(run));
+  run.prim     = prim;
+  run.nthreads = nthreads;
+  run.nlocks   = kind == BENCH_UNCONTENDED ? nthreads : 1;
+  atomic_init(&run.stop, false);
 
-  start = perf_gettime();
-  for (i = 0; i < THREAD_NUM; ++i)
+  run.locks   = memalign(BENCH_CACHELINE, run.nlocks * sizeof(*run.locks));
+  run.threads = memalign(BENCH_CACHELINE, nthreads * sizeof(*run.threads));
+  if (run.locks == NULL || run.threads == NULL)
     {
-      status = pthread_create(&thread[i], NULL,
-                              thread_spinlock, &para);
-      if (status != 0)
+      printf("No memory for %d threads\n", nthreads);
+      ret = ENOMEM;
+      goto errout_with_mem;
+    }
+
+  memset(run.locks, 0, run.nlocks * sizeof(*run.locks));
+  memset(run.threads, 0, nthreads * sizeof(*run.threads));
+
+  for (ninit = 0; ninit < run.nlocks; ninit++)
+    {
+      ret = prim->init(&run.locks[ninit], nthreads / run.nlocks);
+      if (ret != OK)
         {
-          printf("spinlock_test: ERROR pthread_create failed, status=%d\n",
-                 status);
-          ASSERT(false);
+          printf("%s init failed: %d\n", prim->name, ret);
+          goto errout_with_locks;
         }
+
+      atomic_init(&run.locks[ninit].atomic, 0);
+    }
+
+  ret = pthread_barrier_init(&run.start, NULL, nthreads + 1);
+  if (ret != OK)
+    {
+      printf("pthread_barrier_init failed: %d\n", ret);
+      goto errout_with_locks;
     }
 
-  for (i = 0; i < THREAD_NUM; ++i)
+  /* The workers run below this thread so that it can always stop them on
+   * time, and are spread evenly over the CPUs.
+   */
+
+  sched_getparam(0, &param);
+  param.sched_priority--;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, BENCH_POLICY);
+  pthread_attr_setschedparam(&attr, &param);
+
+  for (i = 0; i < nthreads; i++)
     {
-      pthread_join(thread[i], NULL);
+      thread       = &run.threads[i];
+      thread->run  = &run;
+      thread->lock = &run.locks[i % run.nlocks];
+
+#ifdef CONFIG_SMP
+      CPU_ZERO(&cpuset);
+      CPU_SET(i % BENCH_NCPUS, &cpuset);
+      pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+#endif
+
+      ret = pthread_create(&thread->tid, &attr, bench_thread, thread);
+      if (ret != OK)
+        {
+          /* The threads already waiting at the start barrier could not be
+           * released without the missing ones.
+           */
+
+          printf("pthread_create failed: %d\n", ret);
+          exit(EXIT_FAILURE);
+        }
     }
 
+  pthread_attr_destroy(&attr);
+
+  pthread_barrier_wait(&run.start);
+  start = perf_gettime();
+  usleep(opts->duration * USEC_PER_MSEC);
+  atomic_store(&run.stop, true);
   end = perf_gettime();
-  assert(result == THREAD_NUM * TEST_NUM);
 
-  printf("total_time: %lu\n", end - start);
+  for (i = 0; i < nthreads; i++)
+    {
+      pthread_join(run.threads[i].tid, NULL);
+      updates += run.threads[i].updates;
+    }
+
+  pthread_barrier_destroy(&run.start);
+
+  bench_report(opts, &run, kind, bench_elapsed_ns(start, end));
+
+  /* Every update of the protected data must have been seen */
+
+  for (i = 0; i < run.nlocks; i++)
+    {
+      expected += run.locks[i].counter + atomic_load(&run.locks[i].atomic);
+    }
+
+  if (expected != updates)
+    {
+      printf("ERROR: %s lost updates: %lu of %lu\n", prim->name, expected,
+             updates);
+      ret = EINVAL;
+    }
+
+errout_with_locks:
+  if (prim->destroy != NULL)
+    {
+      while (ninit-- > 0)
+        {
+          prim->destroy(&run.locks[ninit]);
+        }
+    }
+
+errout_with_mem:
+  free(run.threads);
+  free(run.locks);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bench_prim
+ ****************************************************************************/
+
+static int bench_prim(FAR const struct bench_opts_s *opts,
+                      FAR const struct bench_prim_s *prim)
+{
+  int ret = OK;
+  int n;
+
+  if (opts->cases & (1 << BENCH_UNCONTENDED))
+    {
+      for (n = 1; ret == OK && n <= opts->maxthreads; n++)
+        {
+          ret = bench_run(opts, prim, BENCH_UNCONTENDED, n);
+        }
+    }
+
+  if (opts->cases & (1 << BENCH_CONTENDED))
+    {
+      for (n = 1; ret == OK && n <= opts->maxthreads; n++)
+        {
+          ret = bench_run(opts, prim, BENCH_CONTENDED, n);
+        }
+    }
+
+  if (ret == OK && (opts->cases & (1 << BENCH_OVERSUBSCRIBED)))
+    {
+      ret = bench_run(opts, prim, BENCH_OVERSUBSCRIBED,
+                      opts->oversubscribed);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bench_usage
+ ****************************************************************************/
+
+static void bench_usage(FAR const char *progname)
+{
+  int i;
+
+  printf("Usage: %s [-p primitive] [-m case] [-t threads] [-o threads] "
+         "[-d ms] [-c] [-v]\n", progname);
+  printf("  -p  Only this primitive:");
+  for (i = 0; i < nitems(g_prims); i++)
+    {
+      printf(" %s", g_prims[i].name);
+    }
+
+  printf("\n  -m  Only this case: uncontended, contended or "
+         "oversubscribed\n");
+  printf("  -t  Sweep 1 to this many threads, default %d\n", BENCH_NCPUS);
+  printf("  -o  Threads when oversubscribed, default %d\n",
+         CONFIG_SPINLOCK_MULTITHREAD);
+  printf("  -d  Length of each run in milliseconds, default %d\n",
+         CONFIG_SPINLOCK_DURATION);
+  printf("  -c  CSV output\n");
+  printf("  -v  Show the acquisitions of each thread\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct bench_opts_s opts;
+  int ret = OK;
+  int opt;
+  int i;
+
+  memset(&opts, 0, sizeof(opts));
+  opts.maxthreads     = BENCH_NCPUS;
+  opts.oversubscribed = CONFIG_SPINLOCK_MULTITHREAD;
+  opts.duration       = CONFIG_SPINLOCK_DURATION;
+  opts.cases          = (1 << BENCH_NCASES) - 1;
+
+  while ((opt = getopt(argc, argv, "p:m:t:o:d:cvh")) != -1)
+    {
+      switch (opt)
+        {
+          case 'p':
+            for (i = 0; i < nitems(g_prims); i++)
+              {
+                if (strcmp(optarg, g_prims[i].name) == 0)
+                  {
+                    opts.prim = &g_prims[i];
+                  }
+              }
+
+            if (opts.prim == NULL)
+              {
+                printf("Unknown primitive: %s\n", optarg);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 'm':
+            for (opts.cases = 0, i = 0; i < BENCH_NCASES; i++)
+              {
+                if (strcmp(optarg, g_cases[i]) == 0)
+                  {
+                    opts.cases = 1 << i;
+                  }
+              }
+
+            if (opts.cases == 0)
+              {
+                printf("Unknown case: %s\n", optarg);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 't':
+            opts.maxthreads = atoi(optarg);
+            break;
+
+          case 'o':
+            opts.oversubscribed = atoi(optarg);
+            break;
+
+          case 'd':
+            opts.duration = atoi(optarg);
+            break;
+
+          case 'c':
+            opts.csv = true;
+            break;
+
+          case 'v':
+            opts.verbose = true;
+            break;
+
+          default:
+            bench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (opts.maxthreads <= 0 || opts.oversubscribed <= 0 ||
+      opts.duration <= 0)
+    {
+      bench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (opts.csv)
+    {
+      printf("primitive,case,threads,ms,ops,ops_per_sec,ns_per_op,"
+             "min,max,fairness,per_thread\n");
+    }
+  else
+    {
+      printf("%-8s %-14s %7s %6s %10s %10s %8s %10s %10s %6s\n",
+             "PRIM", "CASE", "THREADS", "MS", "OPS", "OPS/S", "NS/OP",
+             "MIN", "MAX", "FAIR");
+    }
+
+  for (i = 0; ret == OK && i < nitems(g_prims); i++)
+    {
+      if (opts.prim == NULL || opts.prim == &g_prims[i])
+        {
+          ret = bench_prim(&opts, &g_prims[i]);
+        }
+    }
+
+  return ret == OK ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,51 @@
+dim a(20,17),b(17,23),c(20,23),d(20,23),a%(20,17)
+for i=1 to 20
+  for j=1 to 17
+    a%(i,j)=(i*7+j*3) mod 11
+    a(i,j)=a%(i,j)/4-1
+  next j
+next i
+for i=1 to 17
+  for j=1 to 23
+    b(i,j)=((i+j*5) mod 13)/8-0.5
+  next j
+next i
+mat c=a*b
+mat d=a%*b
+e=0
+f=0
+for i=1 to 20
+  for j=1 to 23
+    s=0
+    t=0
+    for k=1 to 17
+      s=s+a(i,k)*b(k,j)
+      t=t+a%(i,k)*b(k,j)
+    next k
+    if s<>c(i,j) then e=e+1
+    if t<>d(i,j) then f=f+1
+  next j
+next i
+print "real product mismatches:";e
+print "mixed product mismatches:";f
+mat d=c+c
+mat d=d-c
+e=0
+for i=1 to 20
+  for j=1 to 23
+    if d(i,j)<>c(i,j) then e=e+1
+  next j
+next i
+print "add/sub mismatches:";e
+dim x(2,3),y(3,2),z(2,2),v(3),w(3)
+mat read x
+mat read y
+mat z=x*y
+mat print z
+mat read v
+mat read w
+mat v=v-w
+mat print v
+data 0.5,1.5,-2,3,0.25,1
+data 2,-1,0.5,4,1,0.5
+data 1.5,2.5,3.5,0.5,0.5,0.5
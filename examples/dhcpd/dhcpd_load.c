@@ -0,0 +1,698 @@
+/****************************************************************************
+ * apps/examples/dhcpd/dhcpd_load.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* A DHCP client generator for load testing a DHCP server.  It plays many
+ * clients with made up MAC addresses, which all boot at once: each one
+ * sends a DISCOVER, a REQUEST for the address offered and waits for the
+ * ACK.  It reports the rate of completed leases, the latency of the
+ * exchanges and any address handed out twice.
+ *
+ * It builds for NuttX and with Makefile.host for the host.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#ifdef CONFIG_NETUTILS_DHCPD_HOST
+#  define FAR
+#else
+#  include <nuttx/config.h>
+#endif
+
+#include <sys/socket.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define DHCP_SERVER_PORT         67
+#define DHCP_CLIENT_PORT         68
+
+#define DHCP_OPTION_REQ_IPADDR   50
+#define DHCP_OPTION_MSG_TYPE     53
+#define DHCP_OPTION_SERVER_ID    54
+#define DHCP_OPTION_END         255
+
+#define DHCP_REQUEST              1
+#define DHCP_REPLY                2
+
+#define DHCPDISCOVER              1
+#define DHCPOFFER                 2
+#define DHCPREQUEST               3
+#define DHCPACK                   5
+#define DHCPNAK                   6
+#define DHCPRELEASE               7
+
+#define DHCP_HTYPE_ETHERNET       1
+#define DHCP_HLEN_ETHERNET        6
+#define BOOTP_BROADCAST           0x8000
+
+#define LOAD_RETRIES              3
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct dhcpmsg_s
+{
+  uint8_t  op;
+  uint8_t  htype;
+  uint8_t  hlen;
+  uint8_t  hops;
+  uint8_t  xid[4];
+  uint16_t secs;
+  uint16_t flags;
+  uint8_t  ciaddr[4];
+  uint8_t  yiaddr[4];
+  uint8_t  siaddr[4];
+  uint8_t  giaddr[4];
+  uint8_t  chaddr[16];
+  uint8_t  sname[64];
+  uint8_t  file[128];
+  uint8_t  options[312];
+};
+
+enum load_state_e
+{
+  LOAD_IDLE = 0,
+  LOAD_SELECTING,                   /* DISCOVER sent, waiting for an offer */
+  LOAD_REQUESTING,                  /* REQUEST sent, waiting for the ACK */
+  LOAD_BOUND,
+  LOAD_FAILED
+};
+
+struct load_client_s
+{
+  uint64_t start;                   /* Time of the first DISCOVER (us) */
+  uint64_t sent;                    /* Time of the last message or ACK */
+  uint32_t ipaddr;                  /* Offered address (network order) */
+  uint32_t serverid;                /* Server identifier (network order) */
+  uint8_t  state;                   /* See enum load_state_e */
+  uint8_t  retries;
+};
+
+struct load_s
+{
+  FAR struct load_client_s *clients;
+  struct sockaddr_in server;        /* Where the requests go */
+  int      sockfd;
+  int      nclients;
+  int      window;                  /* Clients in progress at once */
+  int      timeout;                 /* Retransmission timeout (ms) */
+  uint32_t seed;                    /* Makes the MAC addresses and xids */
+  int      nnak;
+  int      nretries;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const uint8_t g_magiccookie[4] =
+{
+  99, 130, 83, 99
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: load_time
+ ****************************************************************************/
+
+static uint64_t load_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: load_mac
+ ****************************************************************************/
+
+static void load_mac(FAR struct load_s *load, int ndx, FAR uint8_t *mac)
+{
+  /* Locally administered unicast addresses */
+
+  mac[0] = 0x02;
+  mac[1] = load->seed >> 16;
+  mac[2] = load->seed >> 8;
+  mac[3] = load->seed;
+  mac[4] = ndx >> 8;
+  mac[5] = ndx;
+}
+
+/****************************************************************************
+ * Name: load_send
+ ****************************************************************************/
+
+static int load_send(FAR struct load_s *load, int ndx, uint8_t msgtype)
+{
+  FAR struct load_client_s *client = &load->clients[ndx];
+  struct dhcpmsg_s msg;
+  FAR uint8_t *opt;
+  uint32_t xid;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.op    = DHCP_REQUEST;
+  msg.htype = DHCP_HTYPE_ETHERNET;
+  msg.hlen  = DHCP_HLEN_ETHERNET;
+  msg.flags = htons(BOOTP_BROADCAST);
+
+  xid = htonl((load->seed << 16) + ndx);
+  memcpy(msg.xid, &xid, 4);
+  load_mac(load, ndx, msg.chaddr);
+
+  opt = msg.options;
+  memcpy(opt, g_magiccookie, 4);
+  opt += 4;
+
+  *opt++ = DHCP_OPTION_MSG_TYPE;
+  *opt++ = 1;
+  *opt++ = msgtype;
+
+  if (msgtype == DHCPREQUEST)
+    {
+      *opt++ = DHCP_OPTION_REQ_IPADDR;
+      *opt++ = 4;
+      memcpy(opt, &client->ipaddr, 4);
+      opt += 4;
+    }
+  else if (msgtype == DHCPRELEASE)
+    {
+      memcpy(msg.ciaddr, &client->ipaddr, 4);
+    }
+
+  if (msgtype != DHCPDISCOVER)
+    {
+      *opt++ = DHCP_OPTION_SERVER_ID;
+      *opt++ = 4;
+      memcpy(opt, &client->serverid, 4);
+      opt += 4;
+    }
+
+  *opt = DHCP_OPTION_END;
+
+  client->sent = load_time();
+  if (sendto(load->sockfd, &msg, sizeof(msg), 0,
+             (FAR struct sockaddr *)&load->server,
+             sizeof(load->server)) < 0)
+    {
+      fprintf(stderr, "ERROR: sendto failed: %d\n", errno);
+      return -errno;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: load_option
+ ****************************************************************************/
+
+static FAR const uint8_t *load_option(FAR const struct dhcpmsg_s *msg,
+                                      int len, uint8_t code)
+{
+  FAR const uint8_t *opt = msg->options + 4;
+  FAR const uint8_t *end = (FAR const uint8_t *)msg + len;
+
+  while (opt + 2 <= end && *opt != DHCP_OPTION_END)
+    {
+      if (*opt == 0)
+        {
+          opt++;
+          continue;
+        }
+
+      if (opt + 2 + opt[1] > end)
+        {
+          break;
+        }
+
+      if (*opt == code)
+        {
+          return opt;
+        }
+
+      opt += 2 + opt[1];
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: load_receive
+ *
+ * Description:
+ *   Handle one reply from the server.  Returns 1 if it completed a client,
+ *   0 if not.
+ *
+ ****************************************************************************/
+
+static int load_receive(FAR struct load_s *load,
+                        FAR const struct dhcpmsg_s *msg, int len)
+{
+  FAR struct load_client_s *client;
+  FAR const uint8_t *opt;
+  uint8_t mac[DHCP_HLEN_ETHERNET];
+  uint32_t ndx;
+
+  if (len < (int)(sizeof(*msg) - sizeof(msg->options) + 4) ||
+      msg->op != DHCP_REPLY ||
+      memcmp(msg->options, g_magiccookie, 4) != 0)
+    {
+      return 0;
+    }
+
+  memcpy(&ndx, msg->xid, 4);
+  ndx = ntohl(ndx) - (load->seed << 16);
+  if (ndx >= (uint32_t)load->nclients)
+    {
+      return 0;
+    }
+
+  load_mac(load, ndx, mac);
+  if (memcmp(msg->chaddr, mac, DHCP_HLEN_ETHERNET) != 0)
+    {
+      return 0;
+    }
+
+  opt = load_option(msg, len, DHCP_OPTION_MSG_TYPE);
+  if (opt == NULL || opt[1] != 1)
+    {
+      return 0;
+    }
+
+  client = &load->clients[ndx];
+  switch (opt[2])
+    {
+      case DHCPOFFER:
+        if (client->state != LOAD_SELECTING)
+          {
+            return 0;
+          }
+
+        memcpy(&client->ipaddr, msg->yiaddr, 4);
+        opt = load_option(msg, len, DHCP_OPTION_SERVER_ID);
+        if (opt != NULL && opt[1] == 4)
+          {
+            memcpy(&client->serverid, &opt[2], 4);
+          }
+
+        client->state   = LOAD_REQUESTING;
+        client->retries = 0;
+        load_send(load, ndx, DHCPREQUEST);
+        return 0;
+
+      case DHCPACK:
+        if (client->state != LOAD_REQUESTING)
+          {
+            return 0;
+          }
+
+        client->state = LOAD_BOUND;
+        client->sent  = load_time();
+        return 1;
+
+      case DHCPNAK:
+        if (client->state != LOAD_SELECTING &&
+            client->state != LOAD_REQUESTING)
+          {
+            return 0;
+          }
+
+        load->nnak++;
+        client->state = LOAD_FAILED;
+        return 1;
+
+      default:
+        return 0;
+    }
+}
+
+/****************************************************************************
+ * Name: load_timeouts
+ *
+ * Description:
+ *   Retransmit the messages of the clients waiting for too long, and give
+ *   up on a client after LOAD_RETRIES retransmissions.  Returns the number
+ *   of clients given up.
+ *
+ ****************************************************************************/
+
+static int load_timeouts(FAR struct load_s *load, int first, int last)
+{
+  FAR struct load_client_s *client;
+  uint64_t now = load_time();
+  int nfailed = 0;
+  int i;
+
+  for (i = first; i < last; i++)
+    {
+      client = &load->clients[i];
+      if ((client->state != LOAD_SELECTING &&
+           client->state != LOAD_REQUESTING) ||
+          now - client->sent < (uint64_t)load->timeout * 1000)
+        {
+          continue;
+        }
+
+      if (client->retries++ < LOAD_RETRIES)
+        {
+          load->nretries++;
+          load_send(load, i, client->state == LOAD_SELECTING ?
+                    DHCPDISCOVER : DHCPREQUEST);
+        }
+      else
+        {
+          client->state = LOAD_FAILED;
+          nfailed++;
+        }
+    }
+
+  return nfailed;
+}
+
+/****************************************************************************
+ * Name: load_cmp32 and load_cmp64
+ ****************************************************************************/
+
+static int load_cmp32(FAR const void *a, FAR const void *b)
+{
+  uint32_t x = *(FAR const uint32_t *)a;
+  uint32_t y = *(FAR const uint32_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static int load_cmp64(FAR const void *a, FAR const void *b)
+{
+  uint64_t x = *(FAR const uint64_t *)a;
+  uint64_t y = *(FAR const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/****************************************************************************
+ * Name: load_report
+ ****************************************************************************/
+
+static void load_report(FAR struct load_s *load, uint64_t elapsed)
+{
+  FAR uint64_t *latency;
+  FAR uint32_t *addrs;
+  int nbound = 0;
+  int ndup = 0;
+  int i;
+
+  latency = malloc(load->nclients * sizeof(uint64_t));
+  addrs   = malloc(load->nclients * sizeof(uint32_t));
+  if (latency == NULL || addrs == NULL)
+    {
+      fprintf(stderr, "ERROR: Out of memory\n");
+      free(latency);
+      free(addrs);
+      return;
+    }
+
+  for (i = 0; i < load->nclients; i++)
+    {
+      if (load->clients[i].state == LOAD_BOUND)
+        {
+          latency[nbound] = load->clients[i].sent -
+                            load->clients[i].start;
+          addrs[nbound++] = ntohl(load->clients[i].ipaddr);
+        }
+    }
+
+  qsort(latency, nbound, sizeof(uint64_t), load_cmp64);
+  qsort(addrs, nbound, sizeof(uint32_t), load_cmp32);
+
+  for (i = 1; i < nbound; i++)
+    {
+      if (addrs[i] == addrs[i - 1])
+        {
+          ndup++;
+        }
+    }
+
+  printf("Clients: %d bound, %d failed (%d NAK), %d retransmissions\n",
+         nbound, load->nclients - nbound, load->nnak, load->nretries);
+  printf("Elapsed: %" PRIu64 " ms, %" PRIu64 " leases/s\n",
+         elapsed / 1000, elapsed ? (uint64_t)nbound * 1000000 / elapsed : 0);
+
+  if (nbound > 0)
+    {
+      printf("Latency (us): p50 %" PRIu64 " p90 %" PRIu64 " p99 %" PRIu64
+             " max %" PRIu64 "\n",
+             latency[(nbound - 1) * 50 / 100],
+             latency[(nbound - 1) * 90 / 100],
+             latency[(nbound - 1) * 99 / 100],
+             latency[nbound - 1]);
+    }
+
+  if (ndup > 0)
+    {
+      printf("ERROR: %d addresses leased more than once\n", ndup);
+    }
+
+  free(latency);
+  free(addrs);
+}
+
+/****************************************************************************
+ * Name: load_socket
+ ****************************************************************************/
+
+static int load_socket(void)
+{
+  struct sockaddr_in addr;
+  int optval = 1;
+  int sockfd;
+
+  sockfd = socket(PF_INET, SOCK_DGRAM, 0);
+  if (sockfd < 0)
+    {
+      fprintf(stderr, "ERROR: socket failed: %d\n", errno);
+      return -1;
+    }
+
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &optval, sizeof(optval));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(DHCP_CLIENT_PORT);
+  addr.sin_addr.s_addr = INADDR_ANY;
+
+  if (bind(sockfd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      fprintf(stderr, "ERROR: bind failed: %d\n", errno);
+      close(sockfd);
+      return -1;
+    }
+
+  return sockfd;
+}
+
+/****************************************************************************
+ * Name: show_usage
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-n clients] [-w window] [-t timeout]"
+          " [-s server] [-S seed] [-r]\n", progname);
+  fprintf(stderr, "  -n  Number of clients, default 100\n");
+  fprintf(stderr, "  -w  Clients in progress at once, default 16\n");
+  fprintf(stderr, "  -t  Retransmission timeout in ms, default 1000\n");
+  fprintf(stderr, "  -s  Server address, default broadcast\n");
+  fprintf(stderr, "  -S  Seed of the MAC addresses, the same seed plays\n"
+                  "      the same clients again, default random\n");
+  fprintf(stderr, "  -r  Release the leases at the end\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct dhcpmsg_s msg;
+  struct pollfd pfd;
+  struct load_s load;
+  uint64_t start;
+  bool release = false;
+  int started = 0;
+  int first = 0;
+  int active = 0;
+  int done = 0;
+  int ret;
+  int opt;
+  int i;
+
+  memset(&load, 0, sizeof(load));
+  load.nclients = 100;
+  load.window   = 16;
+  load.timeout  = 1000;
+  load.seed     = (uint32_t)time(NULL) & 0xffff;
+
+  load.server.sin_family      = AF_INET;
+  load.server.sin_port        = htons(DHCP_SERVER_PORT);
+  load.server.sin_addr.s_addr = INADDR_BROADCAST;
+
+  while ((opt = getopt(argc, argv, "n:w:t:s:S:rh")) != -1)
+    {
+      switch (opt)
+        {
+          case 'n':
+            load.nclients = atoi(optarg);
+            break;
+
+          case 'w':
+            load.window = atoi(optarg);
+            break;
+
+          case 't':
+            load.timeout = atoi(optarg);
+            break;
+
+          case 's':
+            load.server.sin_addr.s_addr = inet_addr(optarg);
+            break;
+
+          case 'S':
+            load.seed = strtoul(optarg, NULL, 0) & 0xffff;
+            break;
+
+          case 'r':
+            release = true;
+            break;
+
+          default:
+            show_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (load.nclients <= 0 || load.nclients > 65536 || load.window <= 0 ||
+      load.timeout <= 0)
+    {
+      show_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  load.clients = calloc(load.nclients, sizeof(struct load_client_s));
+  if (load.clients == NULL)
+    {
+      fprintf(stderr, "ERROR: Out of memory\n");
+      return EXIT_FAILURE;
+    }
+
+  load.sockfd = load_socket();
+  if (load.sockfd < 0)
+    {
+      free(load.clients);
+      return EXIT_FAILURE;
+    }
+
+  printf("%d clients, %d at once, seed %" PRIu32 "\n",
+         load.nclients, load.window, load.seed);
+
+  pfd.fd     = load.sockfd;
+  pfd.events = POLLIN;
+  start      = load_time();
+
+  while (done < load.nclients)
+    {
+      /* Boot new clients while there is room in the window */
+
+      while (active < load.window && started < load.nclients)
+        {
+          load.clients[started].state = LOAD_SELECTING;
+          load.clients[started].start = load_time();
+          load_send(&load, started++, DHCPDISCOVER);
+          active++;
+        }
+
+      ret = poll(&pfd, 1, 10);
+      if (ret > 0)
+        {
+          ret = recv(load.sockfd, &msg, sizeof(msg), 0);
+          if (ret > 0)
+            {
+              ret = load_receive(&load, &msg, ret);
+              active -= ret;
+              done   += ret;
+            }
+        }
+
+      /* Only the clients from the oldest one in progress can time out */
+
+      while (first < started &&
+             (load.clients[first].state == LOAD_BOUND ||
+              load.clients[first].state == LOAD_FAILED))
+        {
+          first++;
+        }
+
+      ret     = load_timeouts(&load, first, started);
+      active -= ret;
+      done   += ret;
+    }
+
+  load_report(&load, load_time() - start);
+
+  if (release)
+    {
+      for (i = 0; i < load.nclients; i++)
+        {
+          if (load.clients[i].state == LOAD_BOUND)
+            {
+              load_send(&load, i, DHCPRELEASE);
+            }
+        }
+    }
+
+  close(load.sockfd);
+  free(load.clients);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# apps/examples/ftpd/ftpdbench.py
+#
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.  The
+# ASF licenses this file to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance with the
+# License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+# Measure the throughput of the FTP server from a host FTP client.
+#
+# A test file is uploaded with STOR, then downloaded with RETR by one or
+# more concurrent clients.  Every download is compared with the uploaded
+# data and the aggregate rate of each phase is reported, e.g.:
+#
+#   ./ftpdbench.py 10.0.0.2 --size 16M --clients 4 --dir /tmp
+#
+import argparse
+import ftplib
+import hashlib
+import os
+import sys
+import threading
+import time
+
+
+def parse_size(text):
+    units = {"K": 1024, "M": 1024 * 1024, "G": 1024 * 1024 * 1024}
+    if text[-1].upper() in units:
+        return int(text[:-1]) * units[text[-1].upper()]
+    return int(text)
+
+
+def connect(args):
+    ftp = ftplib.FTP()
+    ftp.connect(args.host, args.port, timeout=args.timeout)
+    ftp.login(args.user, args.password)
+    ftp.voidcmd("TYPE I")
+    if args.dir:
+        ftp.cwd(args.dir)
+    return ftp
+
+
+def upload(args, name, data):
+    ftp = connect(args)
+    pos = 0
+
+    def reader(blocksize):
+        nonlocal pos
+        chunk = data[pos:pos + blocksize]
+        pos += len(chunk)
+        return chunk
+
+    class Source:
+        read = staticmethod(reader)
+
+    start = time.monotonic()
+    ftp.storbinary("STOR " + name, Source, blocksize=args.block)
+    elapsed = time.monotonic() - start
+    ftp.quit()
+    return elapsed
+
+
+def download(args, name, digest, results, index):
+    try:
+        ftp = connect(args)
+        md5 = hashlib.md5()
+        count = 0
+
+        def sink(chunk):
+            nonlocal count
+            md5.update(chunk)
+            count += len(chunk)
+
+        ftp.retrbinary("RETR " + name, sink, blocksize=args.block)
+        ftp.quit()
+        results[index] = count == args.size and md5.digest() == digest
+    except (ftplib.Error, OSError) as e:
+        print("client %d: %s" % (index, e), file=sys.stderr)
+        results[index] = False
+
+
+def report(phase, nbytes, elapsed, ok):
+    print("%-5s %10d bytes %8.2f s %10.1f KiB/s %s"
+          % (phase, nbytes, elapsed, nbytes / elapsed / 1024,
+             "PASS" if ok else "FAIL"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="FTP server benchmark")
+    parser.add_argument("host", help="address of the FTP server")
+    parser.add_argument("--port", type=int, default=21)
+    parser.add_argument("--user", default="anonymous")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--dir", help="remote directory for the test file")
+    parser.add_argument("--size", type=parse_size, default="4M",
+                        help="test file size, K/M/G suffixes allowed")
+    parser.add_argument("--clients", type=int, default=1,
+                        help="number of concurrent RETR clients")
+    parser.add_argument("--block", type=int, default=64 * 1024,
+                        help="client socket I/O size")
+    parser.add_argument("--timeout", type=float, default=60.0)
+    parser.add_argument("--keep", action="store_true",
+                        help="do not delete the test file")
+    args = parser.parse_args()
+
+    name = "ftpdbench.bin"
+    data = os.urandom(args.size)
+    digest = hashlib.md5(data).digest()
+
+    elapsed = upload(args, name, data)
+    ftp = connect(args)
+    ok = ftp.size(name) == args.size
+    ftp.quit()
+    report("STOR", args.size, elapsed, ok)
+
+    results = [False] * args.clients
+    threads = [threading.Thread(target=download,
+                                args=(args, name, digest, results, i))
+               for i in range(args.clients)]
+
+    start = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+
+    report("RETR", args.size * args.clients, elapsed, all(results))
+    ok = ok and all(results)
+
+    if not args.keep:
+        ftp = connect(args)
+        ftp.delete(name)
+        ftp.quit()
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
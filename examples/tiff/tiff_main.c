@@ -22,10 +22,15 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
 #include <errno.h>
 
 #include "graphics/tiff.h"
@@ -41,6 +46,9 @@
  * It is configured to work in the Linux user-mode simulation and
  * has not been tested in any other environment.
  *
+ * With -b it instead times writing an RGB565 screenshot through the
+ * temporary files and in a single pass, see usage().
+ *
  * Other configuration options:
  *
  *  CONFIG_EXAMPLES_TIFF_OUTFILE - Name of the resulting TIFF file
@@ -76,6 +84,149 @@
  * Private Functions
  ****************************************************************************/
 
+static void usage(FAR const char *progname)
+{
+  printf("Usage: %s [-b] [-w width] [-h height] [-r rows per strip]\n"
+         "          [-c none|packbits|lzw] [-i iosize]\n"
+         "Without -b, write a 256x256 RGB24 test image.\n"
+         "With -b, time writing an RGB565 image with temporary files and\n"
+         "in a single pass (default 320x240, 1 row per strip, no\n"
+         "compression, 1024 byte I/O buffer).\n", progname);
+  exit(1);
+}
+
+static uint32_t tiff_msec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/****************************************************************************
+ * Name: tiff_bench_write
+ *
+ * Description:
+ *   Write the image with a fresh copy of the parameters and return the
+ *   elapsed time in milliseconds, or a negated errno value.
+ *
+ ****************************************************************************/
+
+static int tiff_bench_write(FAR const struct tiff_info_s *params,
+                            FAR const uint8_t *image)
+{
+  struct tiff_info_s info;
+  uint32_t start;
+  int ret;
+  int y;
+
+  info  = *params;
+  start = tiff_msec();
+
+  ret = tiff_initialize(&info);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (y = 0; y < info.imgheight; y += info.rps)
+    {
+      ret = tiff_addstrip(&info, image + (size_t)y * info.imgwidth * 2);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  ret = tiff_finalize(&info);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  return tiff_msec() - start;
+}
+
+/****************************************************************************
+ * Name: tiff_bench_report
+ ****************************************************************************/
+
+static void tiff_bench_report(FAR const char *name, FAR const char *path,
+                              int msec)
+{
+  struct stat buf;
+
+  if (msec < 0)
+    {
+      printf("%s: failed: %d\n", name, msec);
+    }
+  else if (stat(path, &buf) == 0)
+    {
+      printf("%s: %d ms, %lu bytes\n", name, msec,
+             (unsigned long)buf.st_size);
+    }
+}
+
+/****************************************************************************
+ * Name: tiff_bench
+ *
+ * Description:
+ *   Time the temporary file path against the single pass path.  The image
+ *   looks like a screenshot: flat bands next to a gradient panel.
+ *
+ ****************************************************************************/
+
+static int tiff_bench(FAR const struct tiff_info_s *params)
+{
+  struct tiff_info_s info;
+  FAR uint16_t *image;
+  size_t size;
+  int legacy;
+  int single;
+  int x;
+  int y;
+
+  /* Allocate whole strips, the last one may be partial */
+
+  size  = (size_t)(params->imgheight + params->rps - 1) / params->rps;
+  size *= (size_t)params->rps * params->imgwidth * 2;
+  image = malloc(size);
+  if (image == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memset(image, 0, size);
+  for (y = 0; y < params->imgheight; y++)
+    {
+      for (x = 0; x < params->imgwidth; x++)
+        {
+          if (x > params->imgwidth * 2 / 3)
+            {
+              image[y * params->imgwidth + x] =
+                ((x & 0x1f) << 11) | ((y & 0x3f) << 5) | ((x + y) & 0x1f);
+            }
+          else
+            {
+              image[y * params->imgwidth + x] = (y >> 4) * 0x0861;
+            }
+        }
+    }
+
+  info          = *params;
+  info.tmpfile1 = CONFIG_EXAMPLES_TIFF_TMPFILE1;
+  info.tmpfile2 = CONFIG_EXAMPLES_TIFF_TMPFILE2;
+  info.compress = 0;
+  legacy = tiff_bench_write(&info, (FAR const uint8_t *)image);
+  tiff_bench_report("temporary files", info.outfile, legacy);
+
+  single = tiff_bench_write(params, (FAR const uint8_t *)image);
+  tiff_bench_report("single pass    ", params->outfile, single);
+
+  free(image);
+  return legacy < 0 ? legacy : single;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -93,10 +244,85 @@ int main(int argc, FAR char *argv[])
   struct tiff_info_s info;
   uint8_t strip[3 * 256];
   uint8_t *ptr;
+  bool bench = false;
   int green;
   int blue;
   int ret;
 
+  /* Benchmark parameters */
+
+  memset(&info, 0, sizeof(struct tiff_info_s));
+  info.outfile   = CONFIG_EXAMPLES_TIFF_OUTFILE;
+  info.colorfmt  = FB_FMT_RGB16_565;
+  info.rps       = 1;
+  info.imgwidth  = 320;
+  info.imgheight = 240;
+  info.iosize    = 1024;
+
+  while ((ret = getopt(argc, argv, "bw:h:r:c:i:")) != ERROR)
+    {
+      switch (ret)
+        {
+          case 'b':
+            bench = true;
+            break;
+
+          case 'w':
+            info.imgwidth = atoi(optarg);
+            break;
+
+          case 'h':
+            info.imgheight = atoi(optarg);
+            break;
+
+          case 'r':
+            info.rps = atoi(optarg);
+            break;
+
+          case 'c':
+            if (strcasecmp(optarg, "packbits") == 0)
+              {
+                info.compress = TAG_COMP_PACKBITS;
+              }
+            else if (strcasecmp(optarg, "lzw") == 0)
+              {
+                info.compress = TAG_COMP_LZW;
+              }
+            else if (strcasecmp(optarg, "none") != 0)
+              {
+                usage(argv[0]);
+              }
+            break;
+
+          case 'i':
+            info.iosize = atoi(optarg);
+            break;
+
+          default:
+            usage(argv[0]);
+            break;
+        }
+    }
+
+  if (bench)
+    {
+      if (info.rps <= 0 || info.imgwidth <= 0 || info.imgheight <= 0 ||
+          info.iosize < 4)
+        {
+          usage(argv[0]);
+        }
+
+      info.iobuffer = malloc(info.iosize);
+      if (info.iobuffer == NULL)
+        {
+          return 1;
+        }
+
+      ret = tiff_bench(&info);
+      free(info.iobuffer);
+      return ret < 0 ? 1 : 0;
+    }
+
   /* Configure the interface structure */
 
   memset(&info, 0, sizeof(struct tiff_info_s));
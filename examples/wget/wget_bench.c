@@ -0,0 +1,448 @@
+/****************************************************************************
+ * apps/examples/wget/wget_bench.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "netutils/webclient.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BENCH_BUFSIZE   1024
+#define BENCH_REQUESTS  100
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct bench_result_s
+{
+  unsigned int nok;
+  unsigned int nfailed;
+  uint64_t     total_us;
+  uint64_t     max_us;
+  uint64_t     bytes;
+};
+
+struct bench_param_s
+{
+  FAR const char *url;
+  FAR const char *body;
+  size_t bodylen;
+  int nreq;
+  int nconc;
+  FAR void *pool;
+};
+
+#ifdef CONFIG_WEBCLIENT_MULTI
+struct bench_multi_s;
+
+struct bench_slot_s
+{
+  struct webclient_context ctx;
+  char buffer[BENCH_BUFSIZE];
+  uint64_t start;
+  FAR struct bench_multi_s *bench;
+};
+
+struct bench_multi_s
+{
+  struct webclient_multi_s multi;
+  FAR const struct bench_param_s *param;
+  FAR struct bench_result_s *result;
+  int left;
+};
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static char g_buffer[BENCH_BUFSIZE];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: gettime_us
+ ****************************************************************************/
+
+static uint64_t gettime_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: sink
+ ****************************************************************************/
+
+static int sink(FAR char **buffer, int offset, int datend,
+                FAR int *buflen, FAR void *arg)
+{
+  FAR struct bench_result_s *result = arg;
+
+  result->bytes += datend - offset;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: setup
+ ****************************************************************************/
+
+static void setup(FAR struct webclient_context *ctx,
+                  FAR const struct bench_param_s *param,
+                  FAR char *buffer, FAR struct bench_result_s *result)
+{
+  webclient_set_defaults(ctx);
+  ctx->protocol_version  = WEBCLIENT_PROTOCOL_VERSION_HTTP_1_1;
+  ctx->method            = param->body != NULL ? "POST" : "GET";
+  ctx->url               = param->url;
+  ctx->buffer            = buffer;
+  ctx->buflen            = BENCH_BUFSIZE;
+  ctx->sink_callback     = sink;
+  ctx->sink_callback_arg = result;
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+  ctx->pool              = param->pool;
+#endif
+  if (param->body != NULL)
+    {
+      webclient_set_static_body(ctx, param->body, param->bodylen);
+    }
+}
+
+/****************************************************************************
+ * Name: account
+ ****************************************************************************/
+
+static void account(FAR struct webclient_context *ctx, int ret,
+                    uint64_t us, FAR struct bench_result_s *result)
+{
+  if (ret == 0 && ctx->http_status / 100 == 2)
+    {
+      result->nok++;
+    }
+  else
+    {
+      result->nfailed++;
+      if (result->nfailed == 1)
+        {
+          printf("Request failed: %d, HTTP status %u\n", ret,
+                 ctx->http_status);
+        }
+    }
+
+  result->total_us += us;
+  if (us > result->max_us)
+    {
+      result->max_us = us;
+    }
+}
+
+/****************************************************************************
+ * Name: run
+ *
+ * Description:
+ *   Send the requests one after the other and return the time taken in
+ *   microseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t run(FAR const struct bench_param_s *param,
+                    FAR struct bench_result_s *result)
+{
+  struct webclient_context ctx;
+  uint64_t start;
+  uint64_t t0;
+  int ret;
+  int i;
+
+  memset(result, 0, sizeof(*result));
+  start = gettime_us();
+
+  for (i = 0; i < param->nreq; i++)
+    {
+      setup(&ctx, param, g_buffer, result);
+
+      t0  = gettime_us();
+      ret = webclient_perform(&ctx);
+      account(&ctx, ret, gettime_us() - t0, result);
+    }
+
+  return gettime_us() - start;
+}
+
+#ifdef CONFIG_WEBCLIENT_MULTI
+/****************************************************************************
+ * Name: multi_done
+ *
+ * Description:
+ *   Account for a finished request and send the next one in its slot.
+ *
+ ****************************************************************************/
+
+static void multi_done(FAR struct webclient_context *ctx, int ret,
+                       FAR void *arg)
+{
+  FAR struct bench_slot_s *slot = arg;
+  FAR struct bench_multi_s *bench = slot->bench;
+
+  account(ctx, ret, gettime_us() - slot->start, bench->result);
+
+  if (bench->left > 0)
+    {
+      bench->left--;
+      setup(ctx, bench->param, slot->buffer, bench->result);
+      slot->start = gettime_us();
+      webclient_multi_add(&bench->multi, ctx, multi_done, slot);
+    }
+}
+
+/****************************************************************************
+ * Name: run_multi
+ *
+ * Description:
+ *   Keep param->nconc requests running at once through a multi handle and
+ *   return the time taken in microseconds, or 0 on failure.
+ *
+ ****************************************************************************/
+
+static uint64_t run_multi(FAR const struct bench_param_s *param,
+                          FAR struct bench_result_s *result)
+{
+  FAR struct bench_slot_s *slots;
+  struct bench_multi_s bench;
+  uint64_t start;
+  int nslots;
+  int ret;
+  int i;
+
+  memset(result, 0, sizeof(*result));
+
+  nslots = param->nconc < param->nreq ? param->nconc : param->nreq;
+  slots  = calloc(nslots, sizeof(struct bench_slot_s));
+  if (slots == NULL)
+    {
+      printf("No memory for %d requests\n", nslots);
+      return 0;
+    }
+
+  webclient_multi_init(&bench.multi);
+  bench.multi.max_running  = nslots;
+  bench.multi.max_per_host = nslots;
+  bench.param              = param;
+  bench.result             = result;
+  bench.left               = param->nreq - nslots;
+
+  start = gettime_us();
+
+  for (i = 0; i < nslots; i++)
+    {
+      slots[i].bench = &bench;
+      setup(&slots[i].ctx, param, slots[i].buffer, result);
+      slots[i].start = gettime_us();
+      webclient_multi_add(&bench.multi, &slots[i].ctx, multi_done,
+                          &slots[i]);
+    }
+
+  ret = webclient_multi_run(&bench.multi);
+  if (ret < 0)
+    {
+      printf("webclient_multi_run failed: %d\n", ret);
+    }
+
+  start = gettime_us() - start;
+
+  webclient_multi_deinit(&bench.multi);
+  free(slots);
+  return start;
+}
+#endif
+
+/****************************************************************************
+ * Name: report
+ ****************************************************************************/
+
+static void report(FAR const char *name, int nreq, uint64_t us,
+                   FAR const struct bench_result_s *result)
+{
+  if (us == 0)
+    {
+      us = 1;
+    }
+
+  printf("%-10s %6u ok %4u failed %8lu req/s  latency avg %6lu us "
+         "max %6lu us  %llu bytes\n",
+         name, result->nok, result->nfailed,
+         (unsigned long)((uint64_t)nreq * 1000000 / us),
+         (unsigned long)(result->total_us / nreq),
+         (unsigned long)result->max_us,
+         (unsigned long long)result->bytes);
+}
+
+/****************************************************************************
+ * Name: bench
+ ****************************************************************************/
+
+static uint64_t bench(FAR const struct bench_param_s *param,
+                      FAR struct bench_result_s *result)
+{
+#ifdef CONFIG_WEBCLIENT_MULTI
+  if (param->nconc > 1)
+    {
+      return run_multi(param, result);
+    }
+#endif
+
+  return run(param, result);
+}
+
+/****************************************************************************
+ * Name: show_usage
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname)
+{
+  printf("Usage: %s [-n requests] [-c concurrency] [-p bytes] url\n",
+         progname);
+  printf("  -n  Requests per run, default %d\n", BENCH_REQUESTS);
+  printf("  -c  Requests running at once through webclient_multi, "
+         "default 1\n");
+  printf("  -p  POST a body of this size instead of a GET\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct bench_param_s param;
+  struct bench_result_s result;
+  FAR char *body = NULL;
+  size_t bodylen = 0;
+  uint64_t us;
+  int opt;
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+  struct webclient_pool_s pool;
+#endif
+
+  memset(&param, 0, sizeof(param));
+  param.nreq  = BENCH_REQUESTS;
+  param.nconc = 1;
+
+  while ((opt = getopt(argc, argv, "c:n:p:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'c':
+            param.nconc = atoi(optarg);
+            break;
+
+          case 'n':
+            param.nreq = atoi(optarg);
+            break;
+
+          case 'p':
+            bodylen = strtoul(optarg, NULL, 0);
+            break;
+
+          default:
+            show_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (optind != argc - 1 || param.nreq <= 0 || param.nconc <= 0)
+    {
+      show_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+#ifndef CONFIG_WEBCLIENT_MULTI
+  if (param.nconc > 1)
+    {
+      printf("Enable CONFIG_WEBCLIENT_MULTI to run requests at once\n");
+      return EXIT_FAILURE;
+    }
+#endif
+
+  if (bodylen > 0)
+    {
+      /* Something shaped like a small JSON document */
+
+      body = malloc(bodylen);
+      if (body == NULL)
+        {
+          printf("No memory for a %zu byte body\n", bodylen);
+          return EXIT_FAILURE;
+        }
+
+      memset(body, ' ', bodylen);
+      body[0] = '{';
+      body[bodylen - 1] = '}';
+    }
+
+  param.url     = argv[optind];
+  param.body    = body;
+  param.bodylen = bodylen;
+
+  printf("%d %s requests to %s, %d at once\n", param.nreq,
+         body ? "POST" : "GET", param.url, param.nconc);
+
+  /* One connection per request, as without a pool */
+
+  us = bench(&param, &result);
+  report("new conn", param.nreq, us, &result);
+
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+  webclient_pool_init(&pool);
+  param.pool = &pool;
+  us = bench(&param, &result);
+  report("pooled", param.nreq, us, &result);
+  printf("pool: %u reused, %u connected, %u cached addresses\n",
+         pool.nreused, pool.nconnected, pool.ndnshits);
+  webclient_pool_deinit(&pool);
+#else
+  printf("Enable CONFIG_WEBCLIENT_KEEPALIVE to compare with a pool\n");
+#endif
+
+  free(body);
+  return EXIT_SUCCESS;
+}
@@ -135,6 +135,155 @@ int tiff_convstrip(FAR struct tiff_info_s *info, FAR const uint8_t *strip)
   return ret;
 }
 
+/****************************************************************************
+ * Name: tiff_putstrip
+ *
+ * Description:
+ *   Write a strip directly to its final place in a single pass file.
+ *   RGB565 data is converted straight into the I/O buffer, other formats
+ *   are written from the caller's buffer.  Compressed strips are encoded
+ *   row by row.  Each strip is padded to word alignment.
+ *
+ * Input Parameters:
+ *   info    - A pointer to the caller allocated parameter passing/TIFF state
+ *             instance.
+ *   strip   - A buffer containing the strip data.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int tiff_putstrip(FAR struct tiff_info_s *info,
+                         FAR const uint8_t *strip)
+{
+  static const uint8_t zeros[4];
+  FAR const uint8_t *src;
+  size_t npixels;
+  size_t nbytes;
+  size_t srcrow;
+  size_t n;
+  int rows;
+  int ret = OK;
+  int i;
+
+  if (info->nstrips >= info->maxstrips)
+    {
+      return -E2BIG;
+    }
+
+  rows = info->imgheight - info->nstrips * info->rps;
+  if (rows > info->rps)
+    {
+      rows = info->rps;
+    }
+
+  npixels         = (size_t)rows * info->imgwidth;
+  info->stripsize = 0;
+
+  if (!TIFF_COMPRESSED(info))
+    {
+      if (info->colorfmt != FB_FMT_RGB16_565)
+        {
+          ret = tiff_emit(info, strip,
+                          tiff_stripbytes(info, info->nstrips));
+        }
+
+      /* Convert as many pixels as fit in the I/O buffer at a time */
+
+      else
+        {
+          while (npixels > 0)
+            {
+              if (info->iosize - info->iolen < 3)
+                {
+                  ret = tiff_flush(info);
+                  if (ret < 0)
+                    {
+                      return ret;
+                    }
+                }
+
+              n = (info->iosize - info->iolen) / 3;
+              if (n > npixels)
+                {
+                  n = npixels;
+                }
+
+              tiff_convert565(info->iobuffer + info->iolen, strip, n);
+              info->iolen     += 3 * n;
+              info->stripsize += 3 * n;
+              strip           += 2 * n;
+              npixels         -= n;
+            }
+        }
+    }
+  else
+    {
+      /* Encode row by row if the rows are byte aligned, else at once */
+
+      if (info->rowbytes > 0)
+        {
+          nbytes = info->rowbytes;
+          srcrow = info->colorfmt == FB_FMT_RGB16_565 ?
+                   2 * info->imgwidth : info->rowbytes;
+        }
+      else
+        {
+          nbytes = tiff_stripbytes(info, info->nstrips);
+          srcrow = nbytes;
+          rows   = 1;
+        }
+
+      for (i = 0; i < rows && ret == OK; i++, strip += srcrow)
+        {
+          src = strip;
+          if (info->colorfmt == FB_FMT_RGB16_565)
+            {
+              tiff_convert565(info->rowbuffer, strip, info->imgwidth);
+              src = info->rowbuffer;
+            }
+
+#ifdef CONFIG_TIFF_LZW
+          if (info->compress == TAG_COMP_LZW)
+            {
+              ret = tiff_lzw_encode(info, src, nbytes, i == 0);
+              continue;
+            }
+#endif
+
+#ifdef CONFIG_TIFF_PACKBITS
+          ret = tiff_packbits(info, src, nbytes);
+#endif
+        }
+
+#ifdef CONFIG_TIFF_LZW
+      if (ret == OK && info->compress == TAG_COMP_LZW)
+        {
+          ret = tiff_lzw_finish(info);
+        }
+#endif
+
+      info->counts[info->nstrips] = info->stripsize;
+      info->counts[info->maxstrips + info->nstrips] = info->outsize;
+    }
+
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  DEBUGASSERT(TIFF_COMPRESSED(info) ||
+              info->stripsize == tiff_stripbytes(info, info->nstrips));
+
+  /* Pad to word alignment */
+
+  nbytes = info->stripsize;
+  ret = tiff_emit(info, zeros, (4 - (nbytes & 3)) & 3);
+  info->outsize += info->stripsize;
+  return ret;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -161,6 +310,18 @@ int tiff_addstrip(FAR struct tiff_info_s *info, FAR const uint8_t *strip)
   ssize_t newsize;
   int ret;
 
+  if (TIFF_SINGLEPASS(info))
+    {
+      ret = tiff_putstrip(info, strip);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+
+      info->nstrips++;
+      return OK;
+    }
+
   /* Add the new strip based on the color format.  For FB_FMT_RGB16_565,
    * will have to perform a conversion to RGB888.
    */
@@ -0,0 +1,424 @@
+/****************************************************************************
+ * apps/graphics/tiff/tiff_compress.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Reference:
+ *   "TIFF, Revision 6.0, Final," June 3, 1992, Adobe Developers Association.
+ *   Section 9: PackBits Compression, Section 13: LZW Compression.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include "graphics/tiff.h"
+
+#include "tiff_internal.h"
+
+/****************************************************************************
+ * Pre-Processor Definitions
+ ****************************************************************************/
+
+/* LZW codes are 9 to 12 bits wide.  The code width grows one code early
+ * and the table is cleared before its last code is used, as TIFF 6.0
+ * readers expect.
+ */
+
+#define LZW_BITS_MIN    9
+#define LZW_BITS_MAX    12
+#define LZW_MAXCODE(n)  ((1 << (n)) - 1)
+#define LZW_CODE_CLEAR  256
+#define LZW_CODE_EOI    257
+#define LZW_CODE_FIRST  258
+#define LZW_CODE_MAX    LZW_MAXCODE(LZW_BITS_MAX)
+
+/* The string table is a hash of (prefix code, next byte) -> code.  Each
+ * entry packs the 20-bit key above the 12-bit code; code 4095 is never
+ * assigned, so all ones marks an empty entry.
+ */
+
+#define LZW_HSIZE       5003
+#define LZW_HSHIFT      4
+#define LZW_EMPTY       0xffffffff
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct tiff_lzw_s
+{
+  uint32_t hash[LZW_HSIZE]; /* String table */
+  uint32_t bitbuf;          /* Bits not yet written */
+  int      nbitbuf;         /* Number of bits in bitbuf */
+  int      nbits;           /* Current code width */
+  int      maxcode;         /* Largest code for the current width */
+  int      freeent;         /* Next code to be assigned */
+  int      ent;             /* Code of the current prefix, -1 if none */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_TIFF_LZW
+/****************************************************************************
+ * Name: tiff_putbyte
+ *
+ * Description:
+ *   Append one byte of compressed data to the I/O buffer.
+ *
+ ****************************************************************************/
+
+static inline int tiff_putbyte(FAR struct tiff_info_s *info, uint8_t value)
+{
+  int ret;
+
+  if (info->iolen == info->iosize)
+    {
+      ret = tiff_flush(info);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  info->iobuffer[info->iolen++] = value;
+  info->stripsize++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tiff_lzw_putcode
+ *
+ * Description:
+ *   Append one code, most significant bit first.
+ *
+ ****************************************************************************/
+
+static int tiff_lzw_putcode(FAR struct tiff_info_s *info,
+                            FAR struct tiff_lzw_s *lzw, int code)
+{
+  int ret;
+
+  lzw->bitbuf   = (lzw->bitbuf << lzw->nbits) | code;
+  lzw->nbitbuf += lzw->nbits;
+
+  while (lzw->nbitbuf >= 8)
+    {
+      lzw->nbitbuf -= 8;
+      ret = tiff_putbyte(info, (uint8_t)(lzw->bitbuf >> lzw->nbitbuf));
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return OK;
+}
+
+static void tiff_lzw_reset(FAR struct tiff_lzw_s *lzw)
+{
+  memset(lzw->hash, 0xff, sizeof(lzw->hash));
+  lzw->nbits   = LZW_BITS_MIN;
+  lzw->maxcode = LZW_MAXCODE(LZW_BITS_MIN);
+  lzw->freeent = LZW_CODE_FIRST;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_TIFF_PACKBITS
+/****************************************************************************
+ * Name: tiff_packbits
+ *
+ * Description:
+ *   PackBits encode one row.  Runs of two or more identical bytes are
+ *   replicated, anything else is copied literally in groups of at most
+ *   128 bytes.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   src - The row data
+ *   len - The number of bytes in the row
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_packbits(FAR struct tiff_info_s *info, FAR const uint8_t *src,
+                  size_t len)
+{
+  uint8_t hdr[2];
+  size_t start;
+  size_t run;
+  size_t i;
+  int ret;
+
+  for (i = 0; i < len; )
+    {
+      run = 1;
+      while (i + run < len && run < 128 && src[i + run] == src[i])
+        {
+          run++;
+        }
+
+      if (run >= 2)
+        {
+          hdr[0] = (uint8_t)(257 - run);
+          hdr[1] = src[i];
+          ret    = tiff_emit(info, hdr, 2);
+          i     += run;
+        }
+      else
+        {
+          /* Extend the literal until a run of three starts */
+
+          for (start = i; i < len && i - start < 128; i++)
+            {
+              if (i + 2 < len && src[i] == src[i + 1] &&
+                  src[i] == src[i + 2])
+                {
+                  break;
+                }
+            }
+
+          hdr[0] = (uint8_t)(i - start - 1);
+          ret    = tiff_emit(info, hdr, 1);
+          if (ret == OK)
+            {
+              ret = tiff_emit(info, src + start, i - start);
+            }
+        }
+
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return OK;
+}
+#endif
+
+#ifdef CONFIG_TIFF_LZW
+/****************************************************************************
+ * Name: tiff_lzw_initialize
+ *
+ * Description:
+ *   Allocate the LZW encoder state.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_lzw_initialize(FAR struct tiff_info_s *info)
+{
+  info->lzw = malloc(sizeof(struct tiff_lzw_s));
+  return info->lzw != NULL ? OK : -ENOMEM;
+}
+
+/****************************************************************************
+ * Name: tiff_lzw_encode
+ *
+ * Description:
+ *   LZW encode the next part of a strip.  The first call for a strip
+ *   starts with a Clear code and an empty table.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   src - The strip data
+ *   len - The number of bytes in src
+ *   first - True for the first data of the strip
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_lzw_encode(FAR struct tiff_info_s *info, FAR const uint8_t *src,
+                    size_t len, bool first)
+{
+  FAR struct tiff_lzw_s *lzw = info->lzw;
+  uint32_t fcode;
+  uint32_t entry;
+  int disp;
+  int ret;
+  int h;
+  int c;
+
+  DEBUGASSERT(lzw != NULL);
+
+  if (first)
+    {
+      tiff_lzw_reset(lzw);
+      lzw->bitbuf  = 0;
+      lzw->nbitbuf = 0;
+      lzw->ent     = -1;
+
+      ret = tiff_lzw_putcode(info, lzw, LZW_CODE_CLEAR);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  if (lzw->ent < 0 && len > 0)
+    {
+      lzw->ent = *src++;
+      len--;
+    }
+
+  for (; len > 0; len--)
+    {
+      c     = *src++;
+      fcode = ((uint32_t)c << LZW_BITS_MAX) | lzw->ent;
+      h     = (int)((((uint32_t)c << LZW_HSHIFT) ^ lzw->ent) % LZW_HSIZE);
+      disp  = h != 0 ? LZW_HSIZE - h : 1;
+
+      /* Look the string up, probing with a secondary hash */
+
+      while ((entry = lzw->hash[h]) != LZW_EMPTY &&
+             (entry >> LZW_BITS_MAX) != fcode)
+        {
+          h -= disp;
+          if (h < 0)
+            {
+              h += LZW_HSIZE;
+            }
+        }
+
+      if (entry != LZW_EMPTY)
+        {
+          lzw->ent = entry & LZW_CODE_MAX;
+          continue;
+        }
+
+      /* New string: output the prefix and add the string to the table */
+
+      ret = tiff_lzw_putcode(info, lzw, lzw->ent);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      lzw->ent     = c;
+      lzw->hash[h] = (fcode << LZW_BITS_MAX) | lzw->freeent++;
+
+      if (lzw->freeent == LZW_CODE_MAX - 1)
+        {
+          /* The table is full, clear it */
+
+          ret = tiff_lzw_putcode(info, lzw, LZW_CODE_CLEAR);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          tiff_lzw_reset(lzw);
+        }
+      else if (lzw->freeent > lzw->maxcode)
+        {
+          lzw->nbits++;
+          lzw->maxcode = LZW_MAXCODE(lzw->nbits);
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tiff_lzw_finish
+ *
+ * Description:
+ *   Terminate the LZW encoded strip with the pending prefix and an EOI
+ *   code, and pad the last byte.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_lzw_finish(FAR struct tiff_info_s *info)
+{
+  FAR struct tiff_lzw_s *lzw = info->lzw;
+  int ret;
+
+  if (lzw->ent >= 0)
+    {
+      ret = tiff_lzw_putcode(info, lzw, lzw->ent);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      /* The decoder adds a table entry for this code as well */
+
+      if (++lzw->freeent == LZW_CODE_MAX - 1)
+        {
+          ret = tiff_lzw_putcode(info, lzw, LZW_CODE_CLEAR);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          lzw->nbits = LZW_BITS_MIN;
+        }
+      else if (lzw->freeent > lzw->maxcode)
+        {
+          lzw->nbits++;
+        }
+    }
+
+  ret = tiff_lzw_putcode(info, lzw, LZW_CODE_EOI);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (lzw->nbitbuf > 0)
+    {
+      ret = tiff_putbyte(info,
+                         (uint8_t)(lzw->bitbuf << (8 - lzw->nbitbuf)));
+    }
+
+  return ret;
+}
+#endif
@@ -24,6 +24,7 @@
 
 #include <nuttx/config.h>
 
+#include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
@@ -165,10 +166,91 @@ static void tiff_cleanup(FAR struct tiff_info_s *info)
 
   info->tmp2fd = -1;
 
+  /* Free what a single pass file allocated */
+
+  free(info->counts);
+  info->counts = NULL;
+  free(info->rowbuffer);
+  info->rowbuffer = NULL;
+  free(info->lzw);
+  info->lzw = NULL;
+
   /* And remove the temporary files */
 
-  unlink(info->tmpfile1);
-  unlink(info->tmpfile2);
+  if (!TIFF_SINGLEPASS(info))
+    {
+      unlink(info->tmpfile1);
+      unlink(info->tmpfile2);
+    }
+}
+
+/****************************************************************************
+ * Name: tiff_finalize_singlepass
+ *
+ * Description:
+ *   Complete a single pass file.  Only the strip tables of a compressed
+ *   file are still missing; they go to the space reserved for them after
+ *   the IFD values, or into the StripByteCounts IFD entry if there is only
+ *   one strip.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF
+ *          state instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int tiff_finalize_singlepass(FAR struct tiff_info_s *info)
+{
+  struct tiff_ifdentry_s ifdentry;
+  off_t offset;
+  int ret;
+  int i;
+
+  if (info->nstrips != info->maxstrips)
+    {
+      gerr("ERROR: %d of %d strips added\n", info->nstrips,
+           info->maxstrips);
+      return -EINVAL;
+    }
+
+  ret = tiff_flush(info);
+  if (ret < 0 || !TIFF_COMPRESSED(info))
+    {
+      return ret;
+    }
+
+  if (info->maxstrips == 1)
+    {
+      ret = tiff_readifdentry(info->outfd, info->filefmt->sbcifdoffset,
+                              &ifdentry);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      tiff_put32(ifdentry.offset, info->counts[0]);
+      return tiff_writeifdentry(info->outfd, info->filefmt->sbcifdoffset,
+                                &ifdentry);
+    }
+
+  offset = lseek(info->outfd, info->filefmt->sbcoffset, SEEK_SET);
+  if (offset == (off_t)-1)
+    {
+      return -errno;
+    }
+
+  /* Counts are followed by offsets, both in file byte order */
+
+  for (i = 0; i < 2 * info->maxstrips; i++)
+    {
+      tiff_put32((FAR uint8_t *)&info->counts[i], info->counts[i]);
+    }
+
+  return tiff_write(info->outfd, info->counts,
+                    8 * (size_t)info->maxstrips);
 }
 
 /****************************************************************************
@@ -203,6 +285,20 @@ int tiff_finalize(FAR struct tiff_info_s *info)
   int i;
   int j;
 
+  if (TIFF_SINGLEPASS(info))
+    {
+      DEBUGASSERT(info && info->outfd >= 0);
+
+      ret = tiff_finalize_singlepass(info);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+
+      tiff_cleanup(info);
+      return OK;
+    }
+
   /* Put all of the pieces together to create the final output file.
    * There are three pieces:
    *
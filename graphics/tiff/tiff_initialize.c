@@ -24,6 +24,7 @@
 
 #include <nuttx/config.h>
 
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -414,6 +415,161 @@ static int tiff_datetime(FAR char *timbuf, unsigned int buflen)
   return OK;
 }
 
+/****************************************************************************
+ * Name: tiff_singlepass
+ *
+ * Description:
+ *   Prepare a single pass file:  Validate the compression, derive the
+ *   number of strips and allocate what the compression needs.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int tiff_singlepass(FAR struct tiff_info_s *info)
+{
+  DEBUGASSERT(info->rps > 0);
+
+  info->maxstrips = (info->imgheight + info->rps - 1) / info->rps;
+
+  switch (info->compress)
+    {
+      case TAG_COMP_NONE:
+        return OK;
+
+#ifdef CONFIG_TIFF_PACKBITS
+      case TAG_COMP_PACKBITS:
+        break;
+#endif
+
+#ifdef CONFIG_TIFF_LZW
+      case TAG_COMP_LZW:
+        if (tiff_lzw_initialize(info) < 0)
+          {
+            return -ENOMEM;
+          }
+        break;
+#endif
+
+      default:
+        gerr("ERROR: Unsupported compression: %d\n", info->compress);
+        return -EINVAL;
+    }
+
+  /* Compressed rows are encoded one at a time when they start on a byte
+   * boundary, otherwise the whole strip is encoded at once.  PackBits
+   * works on rows, so it needs them byte aligned.
+   */
+
+  if (IMGFLAGS_ISRGB(info->imgflags))
+    {
+      info->rowbytes = 3 * info->imgwidth;
+    }
+  else if (IMGFLAGS_ISGREY8(info->imgflags))
+    {
+      info->rowbytes = info->imgwidth;
+    }
+  else if (IMGFLAGS_ISGREY4(info->imgflags) && (info->imgwidth & 1) == 0)
+    {
+      info->rowbytes = info->imgwidth >> 1;
+    }
+  else if (IMGFLAGS_ISBILEV(info->imgflags) && (info->imgwidth & 7) == 0)
+    {
+      info->rowbytes = info->imgwidth >> 3;
+    }
+
+  if (info->rowbytes == 0 && info->compress == TAG_COMP_PACKBITS)
+    {
+      gerr("ERROR: PackBits rows must start on a byte boundary\n");
+      return -EINVAL;
+    }
+
+  if (info->colorfmt == FB_FMT_RGB16_565)
+    {
+      info->rowbuffer = malloc(info->rowbytes);
+      if (info->rowbuffer == NULL)
+        {
+          return -ENOMEM;
+        }
+    }
+
+  /* Byte counts and offsets are only known as the strips are added */
+
+  info->counts = malloc(2 * sizeof(uint32_t) * info->maxstrips);
+  return info->counts != NULL ? OK : -ENOMEM;
+}
+
+/****************************************************************************
+ * Name: tiff_putstriptables
+ *
+ * Description:
+ *   Write the StripByteCounts and StripOffsets values of a single pass
+ *   file.  Without compression both are known now, otherwise the space is
+ *   reserved and filled by tiff_finalize().
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int tiff_putstriptables(FAR struct tiff_info_s *info)
+{
+  uint8_t value[4];
+  uint32_t offset;
+  int ret;
+  int i;
+
+  /* A single strip has its values in the IFD entries */
+
+  if (info->maxstrips == 1)
+    {
+      return OK;
+    }
+
+  memset(value, 0, sizeof(value));
+  for (i = 0; i < info->maxstrips; i++)
+    {
+      if (!TIFF_COMPRESSED(info))
+        {
+          tiff_put32(value, tiff_stripbytes(info, i));
+        }
+
+      ret = tiff_emit(info, value, 4);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  offset = info->filefmt->sbcoffset + 8 * info->maxstrips;
+  for (i = 0; i < info->maxstrips; i++)
+    {
+      if (!TIFF_COMPRESSED(info))
+        {
+          tiff_put32(value, offset);
+          offset += (tiff_stripbytes(info, i) + 3) & ~3;
+        }
+
+      ret = tiff_emit(info, value, 4);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  info->outsize += 8 * info->maxstrips;
+  return tiff_flush(info);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -441,9 +597,18 @@ int tiff_initialize(FAR struct tiff_info_s *info)
   char timbuf[TIFF_DATETIME_STRLEN + 8];
   int ret = -EINVAL;
 
-  DEBUGASSERT(info && info->outfile && info->tmpfile1 && info->tmpfile2);
+  DEBUGASSERT(info && info->outfile && info->iosize >= 4 &&
+              (info->tmpfile1 == NULL) == (info->tmpfile2 == NULL));
+
+  info->tmp1fd = -1;
+  info->tmp2fd = -1;
 
-  /* Open all output files */
+  if (info->compress == 0)
+    {
+      info->compress = TAG_COMP_NONE;
+    }
+
+  /* Open all output files.  A single pass file has no temporary files. */
 
   info->outfd = open(info->outfile, O_RDWR|O_CREAT|O_TRUNC, 0666);
   if (info->outfd < 0)
@@ -453,6 +618,11 @@ int tiff_initialize(FAR struct tiff_info_s *info)
       goto errout;
     }
 
+  if (TIFF_SINGLEPASS(info))
+    {
+      goto openend;
+    }
+
   info->tmp1fd = open(info->tmpfile1, O_RDWR|O_CREAT|O_TRUNC, 0666);
   if (info->tmp1fd < 0)
     {
@@ -469,6 +639,15 @@ int tiff_initialize(FAR struct tiff_info_s *info)
       goto errout;
     }
 
+  if (TIFF_COMPRESSED(info))
+    {
+      gerr("ERROR: Compression requires a single pass file\n");
+      ret = -EINVAL;
+      goto errout;
+    }
+
+openend:
+
   /* Make some decisions using the color format.  Only the following are
    * supported:
    */
@@ -508,7 +687,17 @@ int tiff_initialize(FAR struct tiff_info_s *info)
 
       default:
         gerr("ERROR: Unsupported color format: %d\n", info->colorfmt);
-        return -EINVAL;
+        ret = -EINVAL;
+        goto errout;
+    }
+
+  if (TIFF_SINGLEPASS(info))
+    {
+      ret = tiff_singlepass(info);
+      if (ret < 0)
+        {
+          goto errout;
+        }
     }
 
   /* Write the TIFF header data to the outfile:
@@ -606,12 +795,12 @@ int tiff_initialize(FAR struct tiff_info_s *info)
 
   /* Write Compression:
    *
-   * Bi-level Images: Offset 48 Hard-coded no compression (for now)
+   * Bi-level Images: Offset 48 None unless compressed in a single pass
    * Greyscale:       Offset 60  "  " "   " "" "          " " " " "
    * RGB:             Offset 60 "  " "   " "" "          " " " " "
    */
 
-  ret = tiff_putifdentry16(info, IFD_TAG_COMPRESSION, IFD_FIELD_SHORT, 1, TAG_COMP_NONE);
+  ret = tiff_putifdentry16(info, IFD_TAG_COMPRESSION, IFD_FIELD_SHORT, 1, info->compress);
   if (ret < 0)
     {
       goto errout;
@@ -649,7 +838,23 @@ int tiff_initialize(FAR struct tiff_info_s *info)
    */
 
   tiff_checkoffs(offset, info->filefmt->soifdoffset);
-  ret = tiff_putifdentry(info, IFD_TAG_STRIPOFFSETS, IFD_FIELD_LONG, 0, 0);
+  if (!TIFF_SINGLEPASS(info))
+    {
+      ret = tiff_putifdentry(info, IFD_TAG_STRIPOFFSETS, IFD_FIELD_LONG,
+                             0, 0);
+    }
+  else if (info->maxstrips == 1)
+    {
+      ret = tiff_putifdentry(info, IFD_TAG_STRIPOFFSETS, IFD_FIELD_LONG,
+                             1, info->filefmt->sbcoffset);
+    }
+  else
+    {
+      ret = tiff_putifdentry(info, IFD_TAG_STRIPOFFSETS, IFD_FIELD_LONG,
+                             info->maxstrips, info->filefmt->sbcoffset +
+                             4 * info->maxstrips);
+    }
+
   if (ret < 0)
     {
       goto errout;
@@ -695,7 +900,22 @@ int tiff_initialize(FAR struct tiff_info_s *info)
    */
 
   tiff_checkoffs(offset, info->filefmt->sbcifdoffset);
-  ret = tiff_putifdentry(info, IFD_TAG_STRIPCOUNTS, IFD_FIELD_LONG, 0, info->filefmt->sbcoffset);
+  if (!TIFF_SINGLEPASS(info))
+    {
+      ret = tiff_putifdentry(info, IFD_TAG_STRIPCOUNTS, IFD_FIELD_LONG,
+                             0, info->filefmt->sbcoffset);
+    }
+  else if (info->maxstrips == 1)
+    {
+      ret = tiff_putifdentry(info, IFD_TAG_STRIPCOUNTS, IFD_FIELD_LONG,
+                             1, tiff_stripbytes(info, 0));
+    }
+  else
+    {
+      ret = tiff_putifdentry(info, IFD_TAG_STRIPCOUNTS, IFD_FIELD_LONG,
+                             info->maxstrips, info->filefmt->sbcoffset);
+    }
+
   if (ret < 0)
     {
       goto errout;
@@ -889,6 +1109,18 @@ int tiff_initialize(FAR struct tiff_info_s *info)
 
   tiff_checkoffs(offset, info->filefmt->sbcoffset);
   info->outsize = info->filefmt->sbcoffset;
+
+  /* A single pass file continues with the strip tables */
+
+  if (TIFF_SINGLEPASS(info))
+    {
+      ret = tiff_putstriptables(info);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+    }
+
   return OK;
 
 errout:
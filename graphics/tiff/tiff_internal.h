@@ -28,6 +28,7 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <nuttx/nx/nxglib.h>
@@ -62,6 +63,11 @@
 #define IMGFLAGS_ISRGB(f) \
   (((f) & IMGFLAGS_FMT_RGB24) != 0)
 
+/* Single Pass **************************************************************/
+
+#define TIFF_SINGLEPASS(i)     ((i)->tmpfile1 == NULL)
+#define TIFF_COMPRESSED(i)     ((i)->compress != TAG_COMP_NONE)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -189,6 +195,129 @@ int tiff_putstring(int fd, FAR const char *string, int len);
 
 ssize_t tiff_wordalign(int fd, size_t size);
 
+/****************************************************************************
+ * Name: tiff_convert565
+ *
+ * Description:
+ *   Convert RGB565 pixels to RGB888.
+ *
+ * Input Parameters:
+ *   dest - Location to store 3 * npixels bytes of RGB888 data
+ *   src - RGB565 pixels in host byte order
+ *   npixels - The number of pixels to convert
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void tiff_convert565(FAR uint8_t *dest, FAR const uint8_t *src,
+                     size_t npixels);
+
+/****************************************************************************
+ * Name: tiff_stripbytes
+ *
+ * Description:
+ *   Return the number of bytes of uncompressed data in a strip.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   strip - The strip number
+ *
+ * Returned Value:
+ *   The size of the strip in bytes.
+ *
+ ****************************************************************************/
+
+size_t tiff_stripbytes(FAR struct tiff_info_s *info, int strip);
+
+/****************************************************************************
+ * Name: tiff_emit
+ *
+ * Description:
+ *   Append strip data to the I/O buffer, writing it to the outfile as the
+ *   buffer fills (single pass only).
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   data - The data to append
+ *   len - The number of bytes to append
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_emit(FAR struct tiff_info_s *info, FAR const void *data,
+              size_t len);
+
+/****************************************************************************
+ * Name: tiff_flush
+ *
+ * Description:
+ *   Write the data buffered in the I/O buffer to the outfile.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_flush(FAR struct tiff_info_s *info);
+
+/****************************************************************************
+ * Name: tiff_packbits
+ *
+ * Description:
+ *   PackBits encode one row of strip data.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   src - The row data
+ *   len - The number of bytes in the row
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_TIFF_PACKBITS
+int tiff_packbits(FAR struct tiff_info_s *info, FAR const uint8_t *src,
+                  size_t len);
+#endif
+
+/****************************************************************************
+ * Name: tiff_lzw_initialize, tiff_lzw_encode, tiff_lzw_finish
+ *
+ * Description:
+ *   Allocate the LZW encoder state, encode the next part of a strip
+ *   (first is true for the first part) and terminate the strip.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   src - The strip data
+ *   len - The number of bytes in src
+ *   first - True for the first data of the strip
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_TIFF_LZW
+int tiff_lzw_initialize(FAR struct tiff_info_s *info);
+int tiff_lzw_encode(FAR struct tiff_info_s *info, FAR const uint8_t *src,
+                    size_t len, bool first);
+int tiff_lzw_finish(FAR struct tiff_info_s *info);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
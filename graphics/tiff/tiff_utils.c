@@ -364,3 +364,189 @@ ssize_t tiff_wordalign(int fd, size_t size)
     }
   return size;
 }
+
+/****************************************************************************
+ * Name: tiff_convert565
+ *
+ * Description:
+ *   Convert RGB565 pixels to RGB888.  Once the source is word aligned, two
+ *   pixels are fetched with each 32-bit load.
+ *
+ * Input Parameters:
+ *   dest - Location to store 3 * npixels bytes of RGB888 data
+ *   src - RGB565 pixels in host byte order
+ *   npixels - The number of pixels to convert
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#define TIFF_PUT888(d,p) \
+  do \
+    { \
+      (d)[0] = ((p) >> (11-3)) & 0xf8; /* Move bits 11-15 to 3-7 */ \
+      (d)[1] = ((p) >> ( 5-2)) & 0xfc; /* Move bits  5-10 to 2-7 */ \
+      (d)[2] = ((p) << (   3)) & 0xf8; /* Move bits  0- 4 to 3-7 */ \
+    } \
+  while (0)
+
+void tiff_convert565(FAR uint8_t *dest, FAR const uint8_t *src,
+                     size_t npixels)
+{
+  FAR const uint16_t *src16 = (FAR const uint16_t *)src;
+  FAR const uint32_t *src32;
+  uint32_t two;
+
+  if (((uintptr_t)src16 & 2) != 0 && npixels > 0)
+    {
+      TIFF_PUT888(dest, *src16);
+      dest += 3;
+      src16++;
+      npixels--;
+    }
+
+  for (src32 = (FAR const uint32_t *)src16; npixels >= 2; npixels -= 2)
+    {
+      two = *src32++;
+#ifdef CONFIG_ENDIAN_BIG
+      TIFF_PUT888(dest, two >> 16);
+      TIFF_PUT888(dest + 3, two);
+#else
+      TIFF_PUT888(dest, two);
+      TIFF_PUT888(dest + 3, two >> 16);
+#endif
+      dest += 6;
+    }
+
+  if (npixels > 0)
+    {
+      TIFF_PUT888(dest, *(FAR const uint16_t *)src32);
+    }
+}
+
+/****************************************************************************
+ * Name: tiff_stripbytes
+ *
+ * Description:
+ *   Return the number of bytes of uncompressed data in strip number
+ *   'strip'.  Only the last strip may hold fewer than RowsPerStrip rows.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   strip - The strip number
+ *
+ * Returned Value:
+ *   The size of the strip in bytes.
+ *
+ ****************************************************************************/
+
+size_t tiff_stripbytes(FAR struct tiff_info_s *info, int strip)
+{
+  size_t npixels;
+  int rows;
+
+  rows = info->imgheight - strip * info->rps;
+  if (rows >= info->rps)
+    {
+      return info->bps;
+    }
+
+  npixels = (size_t)rows * info->imgwidth;
+  if (IMGFLAGS_ISBILEV(info->imgflags))
+    {
+      return (npixels + 7) >> 3;
+    }
+  else if (IMGFLAGS_ISGREY4(info->imgflags))
+    {
+      return (npixels + 1) >> 1;
+    }
+  else if (IMGFLAGS_ISGREY8(info->imgflags))
+    {
+      return npixels;
+    }
+
+  return 3 * npixels;
+}
+
+/****************************************************************************
+ * Name: tiff_flush
+ *
+ * Description:
+ *   Write the data buffered in the I/O buffer to the outfile.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_flush(FAR struct tiff_info_s *info)
+{
+  int ret;
+
+  ret = tiff_write(info->outfd, info->iobuffer, info->iolen);
+  info->iolen = 0;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: tiff_emit
+ *
+ * Description:
+ *   Append strip data to the I/O buffer, writing it to the outfile as the
+ *   buffer fills.  Data that is larger than the buffer bypasses it.
+ *
+ * Input Parameters:
+ *   info - A pointer to the caller allocated parameter passing/TIFF state
+ *          instance.
+ *   data - The data to append
+ *   len - The number of bytes to append
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int tiff_emit(FAR struct tiff_info_s *info, FAR const void *data,
+              size_t len)
+{
+  size_t nbytes;
+  int ret;
+
+  info->stripsize += len;
+
+  if (info->iolen == 0 && len >= info->iosize)
+    {
+      return tiff_write(info->outfd, data, len);
+    }
+
+  while (len > 0)
+    {
+      nbytes = info->iosize - info->iolen;
+      if (nbytes > len)
+        {
+          nbytes = len;
+        }
+
+      memcpy(info->iobuffer + info->iolen, data, nbytes);
+      info->iolen += nbytes;
+      data        += nbytes;
+      len         -= nbytes;
+
+      if (info->iolen == info->iosize)
+        {
+          ret = tiff_flush(info);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  return OK;
+}
@@ -39,6 +39,14 @@
 #define FMSYNTH_OPFUNC_SQUARE   (3)
 #define FMSYNTH_OPFUNC_NUM      (4)
 
+/* Samples per stage of fmsynthop_operate_block() */
+
+#ifdef CONFIG_AUDIOUTILS_FMSYNTH_BLOCKSIZE
+#  define FMSYNTH_BLOCKSIZE CONFIG_AUDIOUTILS_FMSYNTH_BLOCKSIZE
+#else
+#  define FMSYNTH_BLOCKSIZE (32)
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -94,6 +102,8 @@ void fmsynthop_set_soundfreqrate(FAR fmsynth_op_t *op, float rate);
 void fmsynthop_start(FAR fmsynth_op_t *op);
 void fmsynthop_stop(FAR fmsynth_op_t *op);
 int fmsynthop_operate(FAR fmsynth_op_t *op, int phase_time);
+void fmsynthop_operate_block(FAR fmsynth_op_t *op, int phase_time,
+                             FAR int *out, int n);
 
 #ifdef __cplusplus
 }
@@ -283,10 +283,13 @@ struct tiff_info_s
   /* The first fields are used to pass information to the TIFF file creation
    * logic via tiff_initialize().
    *
-   * Filenames.  Three file names are required.  (1) path to the final
-   * output file and (2) two paths to temporary files.  One temporary file
-   * (tmpfile1) will be used to hold the strip image data and the other
-   * (tmpfile2) will be used to hold strip offset and count information.
+   * Filenames.  (1) path to the final output file and (2) two optional
+   * paths to temporary files.  One temporary file (tmpfile1) will be used
+   * to hold the strip offset information and the other (tmpfile2) will be
+   * used to hold strip image data.  If both are NULL, the file is written
+   * in a single pass:  The number of strips is derived from imgheight and
+   * rps, the strip tables are reserved up front and each strip is written
+   * directly to its final place in the output file.
    *
    * colorfmt  - Specifies the form of the color data that will be provided
    *             in the strip data.  These are the FB_FMT_* definitions
@@ -302,6 +305,10 @@ struct tiff_info_s
    * rps       - TIFF RowsPerStrip
    * imgwidth  - TIFF ImageWidth, Number of columns in the image
    * imgheight - TIFF ImageLength, Number of rows in the image
+   * compress  - TIFF Compression, single pass only.  Zero or TAG_COMP_NONE
+   *             for uncompressed data, TAG_COMP_PACKBITS (requires
+   *             CONFIG_TIFF_PACKBITS) or TAG_COMP_LZW (requires
+   *             CONFIG_TIFF_LZW).
    */
 
   FAR const char *outfile;  /* Full path to the final output file name */
@@ -312,10 +319,12 @@ struct tiff_info_s
   nxgl_coord_t rps;         /* TIFF RowsPerStrip */
   nxgl_coord_t imgwidth;    /* TIFF ImageWidth, Number of columns in the image */
   nxgl_coord_t imgheight;   /* TIFF ImageLength, Number of rows in the image */
+  uint16_t     compress;    /* TIFF Compression (single pass only) */
 
   /* The caller must provide an I/O buffer as well.  This I/O buffer will
    * used for color conversions and as the intermediate buffer for copying
-   * files.  The larger the buffer, the better the performance.
+   * files.  The larger the buffer, the better the performance.  It must
+   * hold at least one 32-bit strip offset (4 bytes).
    */
 
   FAR uint8_t *iobuffer;    /* IO buffer allocated by the caller */
@@ -340,6 +349,16 @@ struct tiff_info_s
   off_t        tmp1size;    /* Current size of tmpfile1 */
   off_t        tmp2size;    /* Current size of tmpfile2 */
 
+  /* Single pass only */
+
+  nxgl_coord_t maxstrips;   /* Number of strips in the image */
+  size_t       rowbytes;    /* Bytes per row of the strip data */
+  size_t       iolen;       /* Bytes buffered in iobuffer */
+  uint32_t     stripsize;   /* Bytes written for the current strip */
+  FAR uint32_t *counts;     /* StripByteCounts of compressed strips */
+  FAR uint8_t  *rowbuffer;  /* RGB565 row converted for compression */
+  FAR void     *lzw;        /* LZW encoder state */
+
   /* Points to an internal constant structure of file offsets */
 
   FAR const struct tiff_filefmt_s *filefmt;
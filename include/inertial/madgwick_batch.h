@@ -0,0 +1,160 @@
+/****************************************************************************
+ * apps/include/inertial/madgwick_batch.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_INERTIAL_MADGWICK_BATCH_H
+#define __INCLUDE_INERTIAL_MADGWICK_BATCH_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stddef.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Largest relative error of madgwick_invsqrt() for normal, positive
+ * inputs.  The error repeats every two binary exponents, so it was found
+ * by trying every float in [1, 4).
+ */
+
+#define MADGWICK_INVSQRT_MAX_ERROR 6.51e-4f
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* A set of gyroscope/accelerometer Madgwick filters, with the state kept
+ * as a structure of arrays so one call updates all of them with the same
+ * instruction stream.
+ */
+
+struct madgwick_batch_s
+{
+  size_t     n;        /* Number of filter instances */
+  float      beta;     /* Gain of the accelerometer correction */
+  FAR float *q0;       /* Orientation quaternion of each instance, w */
+  FAR float *q1;       /* x */
+  FAR float *q2;       /* y */
+  FAR float *q3;       /* z */
+};
+
+/* Samples as a structure of arrays: either one sample of each instance,
+ * or consecutive samples of one instance.
+ */
+
+struct madgwick_samples_s
+{
+  FAR const float *gx; /* Angular rate, rad/s */
+  FAR const float *gy;
+  FAR const float *gz;
+  FAR const float *ax; /* Acceleration, any unit, all zero if unknown */
+  FAR const float *ay;
+  FAR const float *az;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * Name: madgwick_invsqrt
+ *
+ * Description:
+ *   Approximate 1 / sqrt(x) within MADGWICK_INVSQRT_MAX_ERROR, with a
+ *   tuned magic constant and one Newton step.
+ *
+ ****************************************************************************/
+
+float madgwick_invsqrt(float x);
+
+/****************************************************************************
+ * Name: madgwick_batch_initialize
+ *
+ * Description:
+ *   Allocate n filter instances with the identity orientation.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  A negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int madgwick_batch_initialize(FAR struct madgwick_batch_s *mb, size_t n,
+                              float beta);
+
+/****************************************************************************
+ * Name: madgwick_batch_uninitialize
+ *
+ * Description:
+ *   Free the filter instances.
+ *
+ ****************************************************************************/
+
+void madgwick_batch_uninitialize(FAR struct madgwick_batch_s *mb);
+
+/****************************************************************************
+ * Name: madgwick_batch_update
+ *
+ * Description:
+ *   Update every instance with one sample, element i of the sample arrays
+ *   belongs to instance i.
+ *
+ * Input Parameters:
+ *   mb      - The filter instances
+ *   samples - mb->n samples
+ *   dt      - The sample period in seconds
+ *
+ ****************************************************************************/
+
+void madgwick_batch_update(FAR struct madgwick_batch_s *mb,
+                           FAR const struct madgwick_samples_s *samples,
+                           float dt);
+
+/****************************************************************************
+ * Name: madgwick_batch_update_samples
+ *
+ * Description:
+ *   Update one instance with consecutive samples, oldest first.
+ *
+ * Input Parameters:
+ *   mb       - The filter instances
+ *   index    - The instance to update
+ *   samples  - The samples
+ *   nsamples - The number of samples
+ *   dt       - The sample period in seconds
+ *
+ ****************************************************************************/
+
+void madgwick_batch_update_samples(FAR struct madgwick_batch_s *mb,
+                                   size_t index,
+                                   FAR const struct madgwick_samples_s
+                                   *samples, size_t nsamples, float dt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_INERTIAL_MADGWICK_BATCH_H */
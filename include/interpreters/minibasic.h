@@ -46,6 +46,14 @@
 
 #include <stdio.h>
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* basic_exec() flags */
+
+#define BASIC_NOCOMPILE (1 << 0) /* Lex the source text on every statement */
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -69,4 +77,28 @@
 
 int basic(FAR const char *script, FILE *in, FILE *out, FILE *err);
 
+/****************************************************************************
+ * Name: basic_exec
+ *
+ * Description:
+ *   Interpret a BASIC script.  Unless BASIC_NOCOMPILE is set, every line
+ *   is converted to tokens once before the script runs, which needs some
+ *   memory for the token stream but avoids lexing the source text every
+ *   time a statement is executed.
+ *
+ * Input Parameters:
+ *   script - the script to run
+ *   in     - input stream
+ *   out    - output stream
+ *   err    - error stream
+ *   flags  - BASIC_NOCOMPILE or 0
+ *
+ * Returned Value:
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+int basic_exec(FAR const char *script, FILE *in, FILE *out, FILE *err,
+               int flags);
+
 #endif
@@ -58,6 +58,29 @@
 
 #include <nuttx/config.h>
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifdef CONFIG_CODECS_BASE64
+
+/* State of a streaming encoder, the input is encoded in groups of 3 bytes
+ * and up to 2 bytes are kept between calls.
+ */
+
+struct base64_encoder_s
+{
+  uint8_t left[3];  /* Bytes not encoded yet, one group */
+  uint8_t nleft;    /* Number of bytes in left[] */
+  bool    websafe;  /* Use the web safe alphabet */
+};
+
+#endif /* CONFIG_CODECS_BASE64 */
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -78,6 +101,25 @@ FAR void *base64w_encode(FAR const void *src, size_t len, FAR void *dst,
                          FAR size_t *out_len);
 FAR void *base64w_decode(FAR const void *src, size_t len, FAR void *dst,
                          FAR size_t *out_len);
+
+/* Decode buf over itself and return the decoded length.  base64_decode()
+ * and base64w_decode() also accept dst == src.
+ */
+
+size_t base64_decode_inplace(FAR void *buf, size_t len);
+size_t base64w_decode_inplace(FAR void *buf, size_t len);
+
+/* Streaming encoder.  base64_encoder_update() writes at most
+ * base64_encode_length(len) characters and base64_encoder_final() at most
+ * 4, both return the number written and neither adds a NUL terminator.
+ */
+
+void   base64_encoder_init(FAR struct base64_encoder_s *enc, bool websafe);
+size_t base64_encoder_update(FAR struct base64_encoder_s *enc,
+                             FAR const void *src, size_t len,
+                             FAR void *dst);
+size_t base64_encoder_final(FAR struct base64_encoder_s *enc,
+                            FAR void *dst);
 #endif /* CONFIG_CODECS_BASE64 */
 
 #ifdef __cplusplus
@@ -52,6 +52,11 @@
  *     128 bytes.
  *   CONFIG_FTPD_DATABUFFERSIZE - The size of the I/O buffer for data
  *     transfers.  Default: 512 bytes.
+ *   CONFIG_FTPD_SENDFILE - Use sendfile() for binary RETR transfers.
+ *   CONFIG_FTPD_WORKERS - Serve sessions from a pool of this many worker
+ *     threads instead of one thread per session.  Default: 0 (no pool).
+ *   CONFIG_FTPD_WORKERQUEUE - Number of sessions that may wait for a free
+ *     pool worker.
  *   CONFIG_FTPD_WORKERSTACKSIZE - The stacksize to allocate for each
  *     FTP daemon worker thread.  Default:  2048 bytes.
  */
@@ -175,7 +180,8 @@ int ftpd_adduser(FTPD_SESSION handle, uint8_t accountflags,
  *   Zero is returned if the FTP worker was started.  On failure, a negated
  *   errno value is returned to indicate why the server terminated.
  *   -ETIMEDOUT indicates that the user-provided timeout elapsed with no
- *   connection.
+ *   connection.  -EBUSY indicates that a connection was refused because
+ *   the worker pool was full (CONFIG_FTPD_WORKERS).
  *
  ****************************************************************************/
 
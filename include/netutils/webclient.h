@@ -50,6 +50,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 #include <sys/types.h>
 
 /****************************************************************************
@@ -72,6 +73,34 @@
 #  define CONFIG_WEBCLIENT_MAXFILENAME 100
 #endif
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+#  ifndef CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN
+#    define CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN 2
+#  endif
+
+#  ifndef CONFIG_WEBCLIENT_KEEPALIVE_IDLE_TIMEOUT
+#    define CONFIG_WEBCLIENT_KEEPALIVE_IDLE_TIMEOUT 4
+#  endif
+
+#  ifndef CONFIG_WEBCLIENT_DNSCACHE_ENTRIES
+#    define CONFIG_WEBCLIENT_DNSCACHE_ENTRIES 2
+#  endif
+
+#  ifndef CONFIG_WEBCLIENT_DNSCACHE_TTL
+#    define CONFIG_WEBCLIENT_DNSCACHE_TTL 60
+#  endif
+#endif
+
+#ifdef CONFIG_WEBCLIENT_MULTI
+#  ifndef CONFIG_WEBCLIENT_MULTI_MAXRUNNING
+#    define CONFIG_WEBCLIENT_MULTI_MAXRUNNING 4
+#  endif
+
+#  ifndef CONFIG_WEBCLIENT_MULTI_MAXPERHOST
+#    define CONFIG_WEBCLIENT_MULTI_MAXPERHOST 2
+#  endif
+#endif
+
 #if defined(CONFIG_NETUTILS_CODECS)
 #  if defined(CONFIG_CODECS_URLCODE)
 #    define WGET_USE_URLENCODE 1
@@ -237,6 +266,54 @@ struct webclient_tls_connection;
 struct webclient_poll_info;
 struct webclient_conn_s;
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+/* A keep-alive connection pool
+ *
+ * webclient_perform() takes a connection from the pool when the context
+ * points to the pool, asks for HTTP/1.1 and goes neither through a proxy
+ * nor through an AF_LOCAL socket.  The connection goes back to the pool
+ * when the response ends before the server closes it, that is when the
+ * server neither said "Connection: close" nor answered with HTTP/1.0,
+ * and the body has a Content-Length or is chunked.
+ *
+ * A request that fails on a reused connection before any byte of the
+ * response arrived is sent again on a new connection, unless its body
+ * comes from a body_callback other than webclient_set_static_body().
+ *
+ * The pool is not locked, it must only be used by one thread at a time.
+ */
+
+struct webclient_pool_conn_s
+{
+  FAR struct webclient_conn_s *conn;     /* NULL if the entry is free */
+  char scheme[sizeof("https") + 1];
+  char hostname[CONFIG_WEBCLIENT_MAXHOSTNAME];
+  uint16_t port;
+  unsigned int flags;                    /* WEBCLIENT_FLAG_NON_BLOCKING */
+  unsigned int timeout_sec;
+  time_t idle_since;
+};
+
+struct webclient_pool_dns_s
+{
+  char hostname[CONFIG_WEBCLIENT_MAXHOSTNAME];
+  uint32_t addr;                         /* IPv4 address, network order */
+  time_t expires;                        /* Zero if the entry is free */
+};
+
+struct webclient_pool_s
+{
+  struct webclient_pool_conn_s conns[CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN];
+  struct webclient_pool_dns_s dns[CONFIG_WEBCLIENT_DNSCACHE_ENTRIES];
+
+  /* Statistics */
+
+  unsigned int nreused;                  /* Requests on a pooled conn */
+  unsigned int nconnected;               /* Requests on a new conn */
+  unsigned int ndnshits;                 /* Addresses from the cache */
+};
+#endif
+
 struct webclient_tls_ops
 {
   CODE int (*connect)(FAR void *ctx,
@@ -390,6 +467,9 @@ struct webclient_context
    *                      specified amount of time, the operation will fail.
    *                      The default is CONFIG_WEBCLIENT_TIMEOUT, which is
    *                      10 seconds by default.
+   *   pool             - A keep-alive connection pool, or NULL to open
+   *                      and close a connection for this request only.
+   *                      NULL is the default.
    */
 
   enum webclient_protocol_version_e
@@ -412,6 +492,9 @@ struct webclient_context
 
   size_t bodylen;
   unsigned int timeout_sec;
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+  FAR struct webclient_pool_s *pool;
+#endif
 
   /* Parameters for WEBCLIENT_FLAG_TUNNEL */
 
@@ -489,6 +572,43 @@ struct webclient_poll_info
   unsigned int flags; /* OR'ed WEBCLIENT_POLL_INFO_xxx flags */
 };
 
+#ifdef CONFIG_WEBCLIENT_MULTI
+/* A multi handle runs many transfers from one thread
+ *
+ * The application sets up each webclient_context as for
+ * webclient_perform() and gives it to webclient_multi_add(), which makes
+ * it non-blocking.  webclient_multi_perform() starts the transfers in the
+ * order they were added, as long as fewer than max_running transfers run
+ * and fewer than max_per_host run to the same host and port, and waits
+ * for all of them with one poll().
+ *
+ * When a transfer ends, the done callback gets the value
+ * webclient_perform() returned, or -ETIMEDOUT if nothing happened on the
+ * connection for timeout_sec seconds.  The context is then in the DONE
+ * state, or ABORTED after a timeout, and no longer belongs to the multi
+ * handle: the callback may free it, or set it up again with
+ * webclient_set_defaults() and add it back.  The callback may also add
+ * and remove other transfers.
+ *
+ * Like the non-blocking mode itself, the name resolution blocks.
+ */
+
+struct webclient_multi_xfer_s;
+
+typedef CODE void (*webclient_multi_done_t)(
+    FAR struct webclient_context *ctx,
+    int result,
+    FAR void *arg);
+
+struct webclient_multi_s
+{
+  FAR struct webclient_multi_xfer_s *xfers;  /* In the order added */
+  unsigned int max_running;                 /* Up to ..._MULTI_MAXRUNNING */
+  unsigned int max_per_host;
+  unsigned int nrunning;
+};
+#endif
+
 struct webclient_conn_s
 {
   bool tls;
@@ -576,6 +696,25 @@ ssize_t webclient_conn_recv(FAR struct webclient_conn_s *conn,
 void webclient_conn_close(FAR struct webclient_conn_s *conn);
 void webclient_conn_free(FAR struct webclient_conn_s *conn);
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+void webclient_pool_init(FAR struct webclient_pool_s *pool);
+void webclient_pool_expire(FAR struct webclient_pool_s *pool);
+void webclient_pool_deinit(FAR struct webclient_pool_s *pool);
+#endif
+
+#ifdef CONFIG_WEBCLIENT_MULTI
+void webclient_multi_init(FAR struct webclient_multi_s *multi);
+int webclient_multi_add(FAR struct webclient_multi_s *multi,
+                        FAR struct webclient_context *ctx,
+                        webclient_multi_done_t done, FAR void *arg);
+int webclient_multi_remove(FAR struct webclient_multi_s *multi,
+                           FAR struct webclient_context *ctx);
+int webclient_multi_perform(FAR struct webclient_multi_s *multi,
+                            int timeout_ms);
+int webclient_multi_run(FAR struct webclient_multi_s *multi);
+void webclient_multi_deinit(FAR struct webclient_multi_s *multi);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -41,10 +41,39 @@
 #define VIDEO_MSG_NONE              0
 #define VIDEO_MSG_STOP              1
 
+/* Stages of a stream, see struct nxcamera_stats_s */
+
+#define NXCAMERA_STAGE_CAPTURE      0
+#define NXCAMERA_STAGE_CONVERT      1
+#define NXCAMERA_STAGE_DISPLAY      2
+#define NXCAMERA_NSTAGES            3
+
 /****************************************************************************
  * Public Type Declarations
  ****************************************************************************/
 
+/* Counters of one stage of a stream */
+
+struct nxcamera_stage_stats_s
+{
+  uint32_t frames;      /* Frames through the stage */
+  uint32_t fps;         /* Frames per second, measured every second */
+  uint32_t avgtime;     /* Mean time spent on a frame, in microseconds */
+  uint32_t maxtime;     /* Longest time spent on a frame, in microseconds */
+};
+
+/* Stream statistics, see nxcamera_getstats() */
+
+struct nxcamera_stats_s
+{
+  struct nxcamera_stage_stats_s stage[NXCAMERA_NSTAGES];
+  uint32_t avglatency;  /* Mean capture to display time, in microseconds */
+  uint32_t maxlatency;  /* Longest capture to display time, in microseconds */
+  bool     streaming;   /* A stream is in progress */
+};
+
+struct nxcamera_pipeline_s;
+
 /* This structure describes the internal state of the nxcamera */
 
 struct nxcamera_s
@@ -53,6 +82,8 @@ struct nxcamera_s
   int                   capture_fd;                  /* File descriptor of active
                                                       * capture device */
   char                  capturedev[CONFIG_NAME_MAX]; /* Preferred capture device */
+  bool                  capture_file;                /* capturedev is a raw
+                                                      * frame file */
   int                   display_fd;                  /* File descriptor of active
                                                       * display device */
   char                  displaydev[CONFIG_NAME_MAX]; /* Display framebuffer device */
@@ -70,6 +101,9 @@ struct nxcamera_s
   size_t                nbuffers;                    /* Number of buffers */
   FAR size_t            *buf_sizes;                  /* Buffer lengths */
   FAR uint8_t           **bufs;                      /* Buffer pointers */
+  FAR struct nxcamera_pipeline_s *pipeline;          /* Per-stream state */
+  struct nxcamera_stats_s stats;                     /* Statistics of the
+                                                      * last stream */
 };
 
 struct video_msg_s
@@ -247,6 +281,25 @@ int nxcamera_setfb(FAR struct nxcamera_s *pcam, FAR const char *device);
 int nxcamera_setfile(FAR struct nxcamera_s *pcam, FAR const char *pfile,
                      bool isimage);
 
+/****************************************************************************
+ * Name: nxcamera_getstats
+ *
+ *   Returns the frame rate, time per frame and latency counters of the
+ *   capture, conversion and display stages of the current stream, or of
+ *   the last one if the camera is idle.
+ *
+ * Input Parameters:
+ *   pcam      - Pointer to the context
+ *   stats     - Location to return the statistics
+ *
+ * Returned Value:
+ *   OK
+ *
+ ****************************************************************************/
+
+int nxcamera_getstats(FAR struct nxcamera_s *pcam,
+                      FAR struct nxcamera_stats_s *stats);
+
 #undef EXTERN
 #ifdef __cplusplus
 }
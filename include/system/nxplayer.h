@@ -38,6 +38,20 @@
  * Public Type Declarations
  ****************************************************************************/
 
+/* Playback statistics, see nxplayer_getstats() */
+
+struct nxplayer_stats_s
+{
+  uint32_t underruns;  /* Times the device ran out of queued buffers */
+  uint32_t starved;    /* Device buffers returned with no data prefetched */
+  uint16_t level;      /* Read-ahead buffers filled right now */
+  uint16_t minlevel;   /* Lowest read-ahead level since playback started */
+  uint16_t nbuffers;   /* Size of the read-ahead ring */
+  bool     playing;    /* A playback is in progress */
+};
+
+struct nxplayer_prefetch_s;
+
 struct nxplayer_dec_ops_s
 {
   int format;
@@ -81,6 +95,11 @@ struct nxplayer_s
 #endif
 
   FAR const struct nxplayer_dec_ops_s *ops;
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  FAR struct nxplayer_prefetch_s *prefetch;    /* Read-ahead ring, if playing */
+  struct nxplayer_stats_s stats;               /* Statistics of the last playback */
+#endif
 };
 
 typedef int (*nxplayer_func)(FAR struct nxplayer_s *pplayer, char *pargs);
@@ -489,6 +508,26 @@ int nxplayer_settreble(FAR struct nxplayer_s *pplayer, uint8_t treble);
 int nxplayer_systemreset(FAR struct nxplayer_s *pplayer);
 #endif
 
+/****************************************************************************
+ * Name: nxplayer_getstats
+ *
+ *   Returns the read-ahead statistics of the current playback, or of the
+ *   last one if the player is idle.
+ *
+ * Input Parameters:
+ *   pplayer   - Pointer to the context
+ *   stats     - Location to return the statistics
+ *
+ * Returned Value:
+ *   OK
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+int nxplayer_getstats(FAR struct nxplayer_s *pplayer,
+                      FAR struct nxplayer_stats_s *stats);
+#endif
+
 /****************************************************************************
  * Name: nxplayer_parse_mp3
  *
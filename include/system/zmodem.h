@@ -95,15 +95,10 @@
  * notification is needed to support interruption of the file transfer by
  * the remote receiver.
  *
- * This capapability is not yet supported.  There are only incomplete hooks
- * in the code now!
+ * The reverse channel is sampled with poll() between data subpackets, which
+ * allows full streaming with ZCRCG (see CONFIG_SYSTEM_ZMODEM_SNDWINDOW).
  */
 
-#ifdef CONFIG_SYSTEM_ZMODEM_RCVSAMPLE
-#  warning CONFIG_SYSTEM_ZMODEM_RCVSAMPLE not yet supported
-#  undef CONFIG_SYSTEM_ZMODEM_RCVSAMPLE
-#endif
-
 /* CONFIG_SYSTEM_ZMODEM_SENDATTN indicates that the local sender retains
  * an attention string that will be sent to the remote receiver
  *
@@ -0,0 +1,603 @@
+/****************************************************************************
+ * apps/inertial/madgwick/bench/madgwick_bench.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Accuracy and throughput of the batched Madgwick filter.
+ *
+ * Several IMUs on one rotating body are simulated with noisy gyroscope
+ * and accelerometer samples.  Every sample is fed to:
+ *
+ *   scalar   - the filter with exact math, one sample per call
+ *   fusion   - the Fusion AHRS of this library, one sample per call
+ *   instance - madgwick_batch_update(), all IMUs per call
+ *   samples  - madgwick_batch_update_samples(), a queue of one IMU per call
+ *
+ * and the tilt error against the true gravity direction is reported with
+ * the filter updates per second.  On the host, build it with:
+ *
+ *   cc -O2 -I../../../include bench/madgwick_bench.c madgwick_batch.c -lm
+ *
+ * and add -DMADGWICK_BENCH_FUSION, -Ifusion and the sources in
+ * fusion/Fusion to include Fusion.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#ifdef __NuttX__
+#  include <nuttx/config.h>
+#  define MADGWICK_BENCH_FUSION
+#else
+#  define FAR
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <inertial/madgwick_batch.h>
+
+#ifdef MADGWICK_BENCH_FUSION
+#  include <Fusion/Fusion.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BENCH_RATE      1000      /* Samples per second */
+#define BENCH_CHUNK     32        /* Samples per queue read */
+#define BENCH_SUBSTEPS  10        /* Truth integration steps per sample */
+#define BENCH_WARMUP    2000      /* Samples before errors are counted */
+#define BENCH_BETA      0.1f
+#define BENCH_GYRO_NOISE  0.01f   /* rad/s */
+#define BENCH_ACCEL_NOISE 0.02f   /* g */
+
+#define BENCH_DEG(r)    ((r) * 57.29577951f)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+enum bench_mode_e
+{
+  BENCH_SCALAR = 0,
+  BENCH_FUSION,
+  BENCH_INSTANCE,
+  BENCH_SAMPLES,
+  BENCH_NMODES
+};
+
+struct bench_error_s
+{
+  double sum;                   /* Sum of squared tilt errors */
+  float  max;                   /* Largest tilt error, rad */
+  size_t count;
+  double time;                  /* Time spent in the filter, s */
+};
+
+struct bench_quat_s
+{
+  float q0;
+  float q1;
+  float q2;
+  float q3;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static FAR const char *g_mode_name[BENCH_NMODES] =
+{
+  "scalar", "fusion", "instance", "samples"
+};
+
+static uint32_t g_seed = 1;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static double bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Roughly gaussian noise with unit deviation */
+
+static float bench_noise(void)
+{
+  float sum = 0.0f;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      g_seed ^= g_seed << 13;
+      g_seed ^= g_seed >> 17;
+      g_seed ^= g_seed << 5;
+      sum += (float)g_seed / 4294967296.0f - 0.5f;
+    }
+
+  return sum * 1.7320508f;
+}
+
+static void bench_rate(double t, FAR double *w)
+{
+  w[0] = 1.0 * sin(0.7 * t);
+  w[1] = 0.8 * sin(1.1 * t + 1.0);
+  w[2] = 0.5 * sin(0.3 * t);
+}
+
+/* Direction of gravity in the sensor frame */
+
+static void bench_gravity(float q0, float q1, float q2, float q3,
+                          FAR float *g)
+{
+  g[0] = 2.0f * (q1 * q3 - q0 * q2);
+  g[1] = 2.0f * (q0 * q1 + q2 * q3);
+  g[2] = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+}
+
+static void bench_account(FAR struct bench_error_s *err, FAR const float *g,
+                          float q0, float q1, float q2, float q3)
+{
+  float e[3];
+  float dot;
+  float angle;
+
+  bench_gravity(q0, q1, q2, q3, e);
+  dot = (e[0] * g[0] + e[1] * g[1] + e[2] * g[2]) /
+        sqrtf(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+  angle = acosf(dot > 1.0f ? 1.0f : dot < -1.0f ? -1.0f : dot);
+
+  err->sum += (double)angle * angle;
+  err->count++;
+  if (angle > err->max)
+    {
+      err->max = angle;
+    }
+}
+
+/* The filter with exact math and branches, one sample per call */
+
+static void bench_scalar(FAR struct bench_quat_s *q, float gx, float gy,
+                         float gz, float ax, float ay, float az, float dt)
+{
+  float dq0 = 0.5f * (-q->q1 * gx - q->q2 * gy - q->q3 * gz);
+  float dq1 = 0.5f * (q->q0 * gx + q->q2 * gz - q->q3 * gy);
+  float dq2 = 0.5f * (q->q0 * gy - q->q1 * gz + q->q3 * gx);
+  float dq3 = 0.5f * (q->q0 * gz + q->q1 * gy - q->q2 * gx);
+  float norm;
+
+  if (ax != 0.0f || ay != 0.0f || az != 0.0f)
+    {
+      float q0 = q->q0;
+      float q1 = q->q1;
+      float q2 = q->q2;
+      float q3 = q->q3;
+      float s0;
+      float s1;
+      float s2;
+      float s3;
+
+      norm = 1.0f / sqrtf(ax * ax + ay * ay + az * az);
+      ax *= norm;
+      ay *= norm;
+      az *= norm;
+
+      s0 = 4.0f * q0 * q2 * q2 + 2.0f * q2 * ax + 4.0f * q0 * q1 * q1 -
+           2.0f * q1 * ay;
+      s1 = 4.0f * q1 * q3 * q3 - 2.0f * q3 * ax + 4.0f * q0 * q0 * q1 -
+           2.0f * q0 * ay - 4.0f * q1 + 8.0f * q1 * q1 * q1 +
+           8.0f * q1 * q2 * q2 + 4.0f * q1 * az;
+      s2 = 4.0f * q0 * q0 * q2 + 2.0f * q0 * ax + 4.0f * q2 * q3 * q3 -
+           2.0f * q3 * ay - 4.0f * q2 + 8.0f * q2 * q1 * q1 +
+           8.0f * q2 * q2 * q2 + 4.0f * q2 * az;
+      s3 = 4.0f * q1 * q1 * q3 - 2.0f * q1 * ax + 4.0f * q2 * q2 * q3 -
+           2.0f * q2 * ay;
+
+      norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+      if (norm > 0.0f)
+        {
+          norm = BENCH_BETA / sqrtf(norm);
+          dq0 -= norm * s0;
+          dq1 -= norm * s1;
+          dq2 -= norm * s2;
+          dq3 -= norm * s3;
+        }
+    }
+
+  q->q0 += dq0 * dt;
+  q->q1 += dq1 * dt;
+  q->q2 += dq2 * dt;
+  q->q3 += dq3 * dt;
+
+  norm = 1.0f / sqrtf(q->q0 * q->q0 + q->q1 * q->q1 +
+                      q->q2 * q->q2 + q->q3 * q->q3);
+  q->q0 *= norm;
+  q->q1 *= norm;
+  q->q2 *= norm;
+  q->q3 *= norm;
+}
+
+static void bench_invsqrt(void)
+{
+  float max = 0.0f;
+  float x;
+  float e;
+
+  for (x = 1.0f; x < 4.0f; x = nextafterf(x, 4.0f))
+    {
+      e = fabsf(madgwick_invsqrt(x) * sqrtf(x) - 1.0f);
+      if (e > max)
+        {
+          max = e;
+        }
+    }
+
+  printf("invsqrt max relative error %.3e, bound %.3e: %s\n",
+         max, MADGWICK_INVSQRT_MAX_ERROR,
+         max <= MADGWICK_INVSQRT_MAX_ERROR ? "ok" : "FAIL");
+}
+
+static void usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-n imus] [-s seconds] [-i]\n"
+                  "  -i  also check the invsqrt error bound\n",
+          progname);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct bench_error_s err[BENCH_NMODES];
+  struct madgwick_batch_s inst;
+  struct madgwick_batch_s samp;
+  struct madgwick_samples_s s;
+  FAR struct bench_quat_s *scalar = NULL;
+#ifdef MADGWICK_BENCH_FUSION
+  FAR FusionAhrs *fusion = NULL;
+#endif
+  FAR float *chunk = NULL;
+  FAR float *step = NULL;
+  FAR float *truth = NULL;
+  float dt = 1.0f / BENCH_RATE;
+  float maxdiff = 0.0f;
+  double quat[4] =
+    {
+      1.0, 0.0, 0.0, 0.0
+    };
+
+  double t = 0.0;
+  double start;
+  size_t nimus = 8;
+  size_t nsamples;
+  size_t total;
+  size_t i;
+  size_t j;
+  size_t k;
+  int seconds = 20;
+  int check = 0;
+  int ret = 1;
+  int ch;
+
+  while ((ch = getopt(argc, argv, "n:s:ih")) != -1)
+    {
+      switch (ch)
+        {
+          case 'n':
+            nimus = strtoul(optarg, NULL, 0);
+            break;
+
+          case 's':
+            seconds = atoi(optarg);
+            break;
+
+          case 'i':
+            check = 1;
+            break;
+
+          default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+  if (nimus == 0 || seconds <= 0)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+
+  if (check)
+    {
+      bench_invsqrt();
+    }
+
+  memset(err, 0, sizeof(err));
+  memset(&inst, 0, sizeof(inst));
+  memset(&samp, 0, sizeof(samp));
+
+  /* chunk holds BENCH_CHUNK samples of each IMU, axis after axis, step
+   * the same samples with the IMUs next to each other, truth the gravity
+   * of each sample.
+   */
+
+  chunk  = malloc(nimus * 6 * BENCH_CHUNK * sizeof(float));
+  step   = malloc(BENCH_CHUNK * 6 * nimus * sizeof(float));
+  truth  = malloc(3 * BENCH_CHUNK * sizeof(float));
+  scalar = malloc(nimus * sizeof(*scalar));
+#ifdef MADGWICK_BENCH_FUSION
+  fusion = malloc(nimus * sizeof(*fusion));
+  if (fusion == NULL)
+    {
+      goto out;
+    }
+#endif
+
+  if (chunk == NULL || step == NULL || truth == NULL || scalar == NULL ||
+      madgwick_batch_initialize(&inst, nimus, BENCH_BETA) < 0 ||
+      madgwick_batch_initialize(&samp, nimus, BENCH_BETA) < 0)
+    {
+      fprintf(stderr, "Out of memory\n");
+      goto out;
+    }
+
+  for (i = 0; i < nimus; i++)
+    {
+      scalar[i].q0 = 1.0f;
+      scalar[i].q1 = 0.0f;
+      scalar[i].q2 = 0.0f;
+      scalar[i].q3 = 0.0f;
+#ifdef MADGWICK_BENCH_FUSION
+      FusionAhrsInitialise(&fusion[i]);
+#endif
+    }
+
+  nsamples = (size_t)seconds * BENCH_RATE;
+  for (total = 0; total < nsamples; total += BENCH_CHUNK)
+    {
+      /* Integrate the true attitude and sample the sensors */
+
+      for (k = 0; k < BENCH_CHUNK; k++)
+        {
+          double w[3];
+          double n;
+
+          for (j = 0; j < BENCH_SUBSTEPS; j++)
+            {
+              double h = 1.0 / BENCH_RATE / BENCH_SUBSTEPS;
+              double d0;
+              double d1;
+              double d2;
+              double d3;
+
+              bench_rate(t + h / 2, w);
+              d0 = 0.5 * (-quat[1] * w[0] - quat[2] * w[1] - quat[3] * w[2]);
+              d1 = 0.5 * (quat[0] * w[0] + quat[2] * w[2] - quat[3] * w[1]);
+              d2 = 0.5 * (quat[0] * w[1] - quat[1] * w[2] + quat[3] * w[0]);
+              d3 = 0.5 * (quat[0] * w[2] + quat[1] * w[1] - quat[2] * w[0]);
+              quat[0] += d0 * h;
+              quat[1] += d1 * h;
+              quat[2] += d2 * h;
+              quat[3] += d3 * h;
+              t += h;
+            }
+
+          n = sqrt(quat[0] * quat[0] + quat[1] * quat[1] +
+                   quat[2] * quat[2] + quat[3] * quat[3]);
+          for (j = 0; j < 4; j++)
+            {
+              quat[j] /= n;
+            }
+
+          bench_gravity(quat[0], quat[1], quat[2], quat[3],
+                        &truth[3 * k]);
+          bench_rate(t - 0.5 / BENCH_RATE, w);
+
+          for (i = 0; i < nimus; i++)
+            {
+              FAR float *imu = &chunk[i * 6 * BENCH_CHUNK];
+
+              for (j = 0; j < 3; j++)
+                {
+                  imu[j * BENCH_CHUNK + k] =
+                    w[j] + BENCH_GYRO_NOISE * bench_noise();
+                  imu[(j + 3) * BENCH_CHUNK + k] =
+                    truth[3 * k + j] + BENCH_ACCEL_NOISE * bench_noise();
+                }
+            }
+        }
+
+      /* The same samples laid out for one call per sample of all IMUs */
+
+      for (k = 0; k < BENCH_CHUNK; k++)
+        {
+          for (i = 0; i < nimus; i++)
+            {
+              for (j = 0; j < 6; j++)
+                {
+                  step[(k * 6 + j) * nimus + i] =
+                    chunk[(i * 6 + j) * BENCH_CHUNK + k];
+                }
+            }
+        }
+
+      /* One sample per call */
+
+      start = bench_now();
+      for (k = 0; k < BENCH_CHUNK; k++)
+        {
+          for (i = 0; i < nimus; i++)
+            {
+              FAR float *imu = &chunk[i * 6 * BENCH_CHUNK + k];
+
+              bench_scalar(&scalar[i], imu[0], imu[BENCH_CHUNK],
+                           imu[2 * BENCH_CHUNK], imu[3 * BENCH_CHUNK],
+                           imu[4 * BENCH_CHUNK], imu[5 * BENCH_CHUNK], dt);
+            }
+        }
+
+      err[BENCH_SCALAR].time += bench_now() - start;
+
+#ifdef MADGWICK_BENCH_FUSION
+      start = bench_now();
+      for (k = 0; k < BENCH_CHUNK; k++)
+        {
+          for (i = 0; i < nimus; i++)
+            {
+              FAR float *imu = &chunk[i * 6 * BENCH_CHUNK + k];
+              FusionVector gyro;
+              FusionVector accel;
+
+              gyro.axis.x  = BENCH_DEG(imu[0]);
+              gyro.axis.y  = BENCH_DEG(imu[BENCH_CHUNK]);
+              gyro.axis.z  = BENCH_DEG(imu[2 * BENCH_CHUNK]);
+              accel.axis.x = imu[3 * BENCH_CHUNK];
+              accel.axis.y = imu[4 * BENCH_CHUNK];
+              accel.axis.z = imu[5 * BENCH_CHUNK];
+              FusionAhrsUpdateNoMagnetometer(&fusion[i], gyro, accel, dt);
+            }
+        }
+
+      err[BENCH_FUSION].time += bench_now() - start;
+#endif
+
+      /* All IMUs per call, sample after sample */
+
+      start = bench_now();
+      for (k = 0; k < BENCH_CHUNK; k++)
+        {
+          FAR float *imus = &step[k * 6 * nimus];
+
+          s.gx = &imus[0];
+          s.gy = &imus[nimus];
+          s.gz = &imus[2 * nimus];
+          s.ax = &imus[3 * nimus];
+          s.ay = &imus[4 * nimus];
+          s.az = &imus[5 * nimus];
+          madgwick_batch_update(&inst, &s, dt);
+        }
+
+      err[BENCH_INSTANCE].time += bench_now() - start;
+
+      /* The whole queue of an IMU per call */
+
+      start = bench_now();
+      for (i = 0; i < nimus; i++)
+        {
+          FAR float *imu = &chunk[i * 6 * BENCH_CHUNK];
+
+          s.gx = &imu[0];
+          s.gy = &imu[BENCH_CHUNK];
+          s.gz = &imu[2 * BENCH_CHUNK];
+          s.ax = &imu[3 * BENCH_CHUNK];
+          s.ay = &imu[4 * BENCH_CHUNK];
+          s.az = &imu[5 * BENCH_CHUNK];
+          madgwick_batch_update_samples(&samp, i, &s, BENCH_CHUNK, dt);
+        }
+
+      err[BENCH_SAMPLES].time += bench_now() - start;
+
+      /* Errors are sampled at the end of each chunk */
+
+      if (total + BENCH_CHUNK > BENCH_WARMUP)
+        {
+          FAR const float *g = &truth[3 * (BENCH_CHUNK - 1)];
+
+          for (i = 0; i < nimus; i++)
+            {
+              bench_account(&err[BENCH_SCALAR], g, scalar[i].q0,
+                            scalar[i].q1, scalar[i].q2, scalar[i].q3);
+              bench_account(&err[BENCH_INSTANCE], g, inst.q0[i],
+                            inst.q1[i], inst.q2[i], inst.q3[i]);
+              bench_account(&err[BENCH_SAMPLES], g, samp.q0[i],
+                            samp.q1[i], samp.q2[i], samp.q3[i]);
+#ifdef MADGWICK_BENCH_FUSION
+              {
+                FusionQuaternion fq = FusionAhrsGetQuaternion(&fusion[i]);
+
+                bench_account(&err[BENCH_FUSION], g, fq.element.w,
+                              fq.element.x, fq.element.y, fq.element.z);
+              }
+#endif
+            }
+        }
+
+      /* The batched filter only differs by its inverse square root */
+
+      for (i = 0; i < nimus; i++)
+        {
+          float d = fabsf(inst.q0[i] - scalar[i].q0) +
+                    fabsf(inst.q1[i] - scalar[i].q1) +
+                    fabsf(inst.q2[i] - scalar[i].q2) +
+                    fabsf(inst.q3[i] - scalar[i].q3);
+
+          if (d > maxdiff)
+            {
+              maxdiff = d;
+            }
+        }
+    }
+
+  printf("%zu IMUs, %zu samples each at %d Hz\n\n",
+         nimus, total, BENCH_RATE);
+  printf("%-10s %12s %10s %10s\n", "mode", "updates/s", "rms deg",
+         "max deg");
+
+  for (j = 0; j < BENCH_NMODES; j++)
+    {
+      if (err[j].count == 0)
+        {
+          continue;
+        }
+
+      printf("%-10s %12.0f %10.3f %10.3f\n", g_mode_name[j],
+             err[j].time > 0 ? nimus * total / err[j].time : 0.0,
+             BENCH_DEG(sqrt(err[j].sum / err[j].count)),
+             BENCH_DEG(err[j].max));
+    }
+
+  printf("\nmax |q(instance) - q(scalar)| %.3e\n", maxdiff);
+  ret = 0;
+
+out:
+  madgwick_batch_uninitialize(&inst);
+  madgwick_batch_uninitialize(&samp);
+#ifdef MADGWICK_BENCH_FUSION
+  free(fusion);
+#endif
+  free(scalar);
+  free(truth);
+  free(step);
+  free(chunk);
+  return ret;
+}
@@ -0,0 +1,262 @@
+/****************************************************************************
+ * apps/inertial/madgwick/madgwick_batch.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Reference:
+ *   S. Madgwick, "An efficient orientation filter for inertial and
+ *   inertial/magnetic sensor arrays", 2010.
+ *   L. Moroz et al., "Fast calculation of inverse square root with the use
+ *   of magic constant - analytical approach", 2018.
+ *
+ * This file builds on the host as well, for bench/madgwick_bench.c.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#ifdef __NuttX__
+#  include <nuttx/config.h>
+#else
+#  define FAR
+#  define inline_function __attribute__ ((always_inline))
+#endif
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <inertial/madgwick_batch.h>
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline inline_function float madgwick_rsqrt(float x)
+{
+  uint32_t i;
+  float y;
+
+  memcpy(&i, &x, sizeof(i));
+  i = 0x5f1ffff9 - (i >> 1);
+  memcpy(&y, &i, sizeof(y));
+
+  return y * 0.703952253f * (2.38924456f - x * y * y);
+}
+
+/****************************************************************************
+ * Name: madgwick_step
+ *
+ * Description:
+ *   One gradient descent step of the gyroscope/accelerometer filter.  It
+ *   has no branch, so the loop over the instances can be vectorized; an
+ *   all zero acceleration just disables the correction.
+ *
+ *   madgwick_rsqrt(0) is finite, so a zero gradient at convergence does
+ *   not turn the quaternion into NaNs.
+ *
+ ****************************************************************************/
+
+static inline inline_function
+void madgwick_step(FAR float *pq0, FAR float *pq1,
+                   FAR float *pq2, FAR float *pq3,
+                   float gx, float gy, float gz,
+                   float ax, float ay, float az,
+                   float beta, float dt)
+{
+  float q0 = *pq0;
+  float q1 = *pq1;
+  float q2 = *pq2;
+  float q3 = *pq3;
+  float q0q0;
+  float q1q1;
+  float q2q2;
+  float q3q3;
+  float dq0;
+  float dq1;
+  float dq2;
+  float dq3;
+  float norm;
+  float gain;
+  float s0;
+  float s1;
+  float s2;
+  float s3;
+
+  /* Rate of change of the quaternion from the gyroscope */
+
+  dq0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  dq1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  dq2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  dq3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  /* Gradient of the error between the measured and estimated direction of
+   * gravity
+   */
+
+  norm = ax * ax + ay * ay + az * az;
+  gain = norm > 0.0f ? beta : 0.0f;
+  norm = madgwick_rsqrt(norm);
+  ax  *= norm;
+  ay  *= norm;
+  az  *= norm;
+
+  q0q0 = q0 * q0;
+  q1q1 = q1 * q1;
+  q2q2 = q2 * q2;
+  q3q3 = q3 * q3;
+
+  s0 = 4.0f * q0 * (q1q1 + q2q2) + 2.0f * (q2 * ax - q1 * ay);
+  s1 = 4.0f * q1 * (q3q3 + q0q0 - 1.0f + 2.0f * (q1q1 + q2q2) + az) -
+       2.0f * (q3 * ax + q0 * ay);
+  s2 = 4.0f * q2 * (q3q3 + q0q0 - 1.0f + 2.0f * (q1q1 + q2q2) + az) +
+       2.0f * (q0 * ax - q3 * ay);
+  s3 = 4.0f * q3 * (q1q1 + q2q2) - 2.0f * (q1 * ax + q2 * ay);
+
+  norm = gain * madgwick_rsqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+  dq0 -= norm * s0;
+  dq1 -= norm * s1;
+  dq2 -= norm * s2;
+  dq3 -= norm * s3;
+
+  /* Integrate and normalize */
+
+  q0 += dq0 * dt;
+  q1 += dq1 * dt;
+  q2 += dq2 * dt;
+  q3 += dq3 * dt;
+
+  norm = madgwick_rsqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  *pq0 = q0 * norm;
+  *pq1 = q1 * norm;
+  *pq2 = q2 * norm;
+  *pq3 = q3 * norm;
+}
+
+/****************************************************************************
+ * Name: madgwick_update
+ *
+ * Description:
+ *   One step of n instances.  The restrict parameters tell the compiler
+ *   that the state and the samples do not overlap, so it may vectorize
+ *   the loop.
+ *
+ ****************************************************************************/
+
+static void madgwick_update(size_t n, FAR float *restrict q0,
+                            FAR float *restrict q1, FAR float *restrict q2,
+                            FAR float *restrict q3,
+                            FAR const float *restrict gx,
+                            FAR const float *restrict gy,
+                            FAR const float *restrict gz,
+                            FAR const float *restrict ax,
+                            FAR const float *restrict ay,
+                            FAR const float *restrict az,
+                            float beta, float dt)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      madgwick_step(&q0[i], &q1[i], &q2[i], &q3[i],
+                    gx[i], gy[i], gz[i], ax[i], ay[i], az[i], beta, dt);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+float madgwick_invsqrt(float x)
+{
+  return madgwick_rsqrt(x);
+}
+
+int madgwick_batch_initialize(FAR struct madgwick_batch_s *mb, size_t n,
+                              float beta)
+{
+  size_t i;
+
+  /* One block, q0 to q3 follow each other */
+
+  mb->q0 = malloc(4 * n * sizeof(float));
+  if (mb->q0 == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  mb->n    = n;
+  mb->beta = beta;
+  mb->q1   = mb->q0 + n;
+  mb->q2   = mb->q1 + n;
+  mb->q3   = mb->q2 + n;
+
+  for (i = 0; i < n; i++)
+    {
+      mb->q0[i] = 1.0f;
+      mb->q1[i] = 0.0f;
+      mb->q2[i] = 0.0f;
+      mb->q3[i] = 0.0f;
+    }
+
+  return 0;
+}
+
+void madgwick_batch_uninitialize(FAR struct madgwick_batch_s *mb)
+{
+  free(mb->q0);
+  memset(mb, 0, sizeof(*mb));
+}
+
+void madgwick_batch_update(FAR struct madgwick_batch_s *mb,
+                           FAR const struct madgwick_samples_s *samples,
+                           float dt)
+{
+  madgwick_update(mb->n, mb->q0, mb->q1, mb->q2, mb->q3,
+                  samples->gx, samples->gy, samples->gz,
+                  samples->ax, samples->ay, samples->az, mb->beta, dt);
+}
+
+void madgwick_batch_update_samples(FAR struct madgwick_batch_s *mb,
+                                   size_t index,
+                                   FAR const struct madgwick_samples_s
+                                   *samples, size_t nsamples, float dt)
+{
+  float q0 = mb->q0[index];
+  float q1 = mb->q1[index];
+  float q2 = mb->q2[index];
+  float q3 = mb->q3[index];
+  size_t i;
+
+  /* The samples depend on each other, keep the state in registers */
+
+  for (i = 0; i < nsamples; i++)
+    {
+      madgwick_step(&q0, &q1, &q2, &q3,
+                    samples->gx[i], samples->gy[i], samples->gz[i],
+                    samples->ax[i], samples->ay[i], samples->az[i],
+                    mb->beta, dt);
+    }
+
+  mb->q0[index] = q0;
+  mb->q1[index] = q1;
+  mb->q2[index] = q2;
+  mb->q3[index] = q3;
+}
@@ -210,6 +210,119 @@ static void printName(const void *k, struct Program *p, int chn)
     }
 }
 
+/* Make room for one more line in code[] and in the line index */
+
+static void Program_grow(struct Program *self)
+{
+  if ((self->size + 1) >= self->capacity)
+    {
+      self->capacity = self->capacity ? self->capacity * 2 : 256;
+      self->code = realloc(self->code,
+                           sizeof(struct Token *) * self->capacity);
+      self->index = realloc(self->index,
+                            sizeof(struct LineIndex) * self->capacity);
+    }
+}
+
+/* Return the position of the first index entry with a line number not less
+ * than number.
+ */
+
+static int Program_indexFind(const struct Program *self, long int number)
+{
+  int lo = 0;
+  int hi = self->indexLength;
+
+  while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2;
+
+      if (self->index[mid].number < number)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  return lo;
+}
+
+/* Rebuild the line index from code[].  The index is only used if the
+ * numbered lines are in ascending order, which is what the linear searches
+ * in Program_goLine() and friends rely on to return the same line.
+ */
+
+static void Program_reindex(struct Program *self)
+{
+  int i;
+
+  self->indexLength = 0;
+  self->indexed = 1;
+  for (i = 0; i < self->size; ++i)
+    {
+      if (self->code[i]->type != T_INTEGER)
+        {
+          continue;
+        }
+
+      if (self->indexLength > 0 &&
+          self->index[self->indexLength - 1].number >=
+          self->code[i]->u.integer)
+        {
+          self->indexed = 0;
+          return;
+        }
+
+      self->index[self->indexLength].number = self->code[i]->u.integer;
+      self->index[self->indexLength].line = i;
+      ++self->indexLength;
+    }
+}
+
+/* Account for a line inserted at code[line] */
+
+static void Program_indexInsert(struct Program *self, int line)
+{
+  struct Token *token = self->code[line];
+  int pos;
+  int i;
+
+  for (i = 0; i < self->indexLength; ++i)
+    {
+      if (self->index[i].line >= line)
+        {
+          ++self->index[i].line;
+        }
+    }
+
+  if (!self->indexed || token->type != T_INTEGER)
+    {
+      return;
+    }
+
+  pos = Program_indexFind(self, token->u.integer);
+
+  /* The line must also be in order in code[] */
+
+  if ((pos < self->indexLength &&
+       (self->index[pos].number == token->u.integer ||
+        self->index[pos].line < line)) ||
+      (pos > 0 && self->index[pos - 1].line > line))
+    {
+      Program_reindex(self);
+      return;
+    }
+
+  memmove(&self->index[pos + 1], &self->index[pos],
+          (self->indexLength - pos) * sizeof(struct LineIndex));
+  self->index[pos].number = token->u.integer;
+  self->index[pos].line = line;
+  ++self->indexLength;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -224,6 +337,9 @@ struct Program *Program_new(struct Program *self)
   self->unsaved = 0;
   self->code = (struct Token **)0;
   self->scope = (struct Scope *)0;
+  self->index = (struct LineIndex *)0;
+  self->indexLength = 0;
+  self->indexed = 1;
   String_new(&self->name);
   return self;
 }
@@ -238,10 +354,14 @@ void Program_destroy(struct Program *self)
   if (self->capacity)
     {
       free(self->code);
+      free(self->index);
     }
 
   self->code = (struct Token **)0;
   self->scope = (struct Scope *)0;
+  self->index = (struct LineIndex *)0;
+  self->indexLength = 0;
+  self->indexed = 1;
   String_destroy(&self->name);
 }
 
@@ -263,7 +383,23 @@ void Program_store(struct Program *self, struct Token *line, long int where)
       self->numbered = 0;
     }
 
-  if (where)
+  if (where && self->indexed && self->numbered)
+    {
+      /* All lines are numbered and in order: binary search the index */
+
+      int pos = Program_indexFind(self, where);
+
+      if (pos < self->indexLength && self->index[pos].number == where)
+        {
+          i = self->index[pos].line;
+          Token_destroy(self->code[i]);
+          self->code[i] = line;
+          return;
+        }
+
+      i = pos < self->indexLength ? self->index[pos].line : self->size;
+    }
+  else if (where)
     {
       int last = -1;
 
@@ -273,25 +409,13 @@ void Program_store(struct Program *self, struct Token *line, long int where)
                  self->code[i]->type == T_UNNUMBERED);
           if (where > last && where < self->code[i]->u.integer)
             {
-              if ((self->size + 1) >= self->capacity)
-                {
-                  self->code =
-                    realloc(self->code,
-                            sizeof(struct Token *) *
-                            (self->capacity ? (self->capacity *=
-                                               2) : (self->capacity = 256)));
-                }
-
-              memmove(&self->code[i + 1], &self->code[i],
-                      (self->size - i) * sizeof(struct Token *));
-              self->code[i] = line;
-              ++self->size;
-              return;
+              break;
             }
           else if (where == self->code[i]->u.integer)
             {
               Token_destroy(self->code[i]);
               self->code[i] = line;
+              Program_reindex(self);
               return;
             }
 
@@ -303,23 +427,19 @@ void Program_store(struct Program *self, struct Token *line, long int where)
       i = self->size;
     }
 
-  if ((self->size + 1) >= self->capacity)
-    {
-      self->code =
-        realloc(self->code,
-                sizeof(struct Token *) *
-                (self->capacity ? (self->capacity *= 2)
-                 : (self->capacity = 256)));
-    }
-
+  Program_grow(self);
+  memmove(&self->code[i + 1], &self->code[i],
+          (self->size - i) * sizeof(struct Token *));
   self->code[i] = line;
   ++self->size;
+  Program_indexInsert(self, i);
 }
 
 void Program_delete(struct Program *self, const struct Pc *from,
                     const struct Pc *to)
 {
   int i;
+  int j;
   int first;
   int last;
 
@@ -335,10 +455,33 @@ void Program_delete(struct Program *self, const struct Pc *from,
   if ((last + 1) != self->size)
     {
       memmove(&self->code[first], &self->code[last + 1],
-              (self->size - last + 1) * sizeof(struct Token *));
+              (self->size - last - 1) * sizeof(struct Token *));
     }
 
   self->size -= (last - first + 1);
+
+  /* Drop the deleted lines from the index and renumber the rest */
+
+  if (!self->indexed)
+    {
+      Program_reindex(self);
+      return;
+    }
+
+  for (i = j = 0; i < self->indexLength; ++i)
+    {
+      if (self->index[i].line < first)
+        {
+          self->index[j++] = self->index[i];
+        }
+      else if (self->index[i].line > last)
+        {
+          self->index[j] = self->index[i];
+          self->index[j++].line -= last - first + 1;
+        }
+    }
+
+  self->indexLength = j;
 }
 
 void Program_addScope(struct Program *self, struct Scope *scope)
@@ -354,6 +497,19 @@ struct Pc *Program_goLine(struct Program *self, long int line, struct Pc *pc)
 {
   int i;
 
+  if (self->indexed)
+    {
+      i = Program_indexFind(self, line);
+      if (i == self->indexLength || self->index[i].number != line)
+        {
+          return (struct Pc *)0;
+        }
+
+      pc->line = self->index[i].line;
+      pc->token = self->code[pc->line] + 1;
+      return pc;
+    }
+
   for (i = 0; i < self->size; ++i)
     {
       if (self->code[i]->type == T_INTEGER &&
@@ -373,6 +529,19 @@ struct Pc *Program_fromLine(struct Program *self, long int line,
 {
   int i;
 
+  if (self->indexed)
+    {
+      i = Program_indexFind(self, line);
+      if (i == self->indexLength)
+        {
+          return (struct Pc *)0;
+        }
+
+      pc->line = self->index[i].line;
+      pc->token = self->code[pc->line] + 1;
+      return pc;
+    }
+
   for (i = 0; i < self->size; ++i)
     {
       if (self->code[i]->type == T_INTEGER &&
@@ -391,6 +560,19 @@ struct Pc *Program_toLine(struct Program *self, long int line, struct Pc *pc)
 {
   int i;
 
+  if (self->indexed)
+    {
+      i = Program_indexFind(self, line + 1) - 1;
+      if (i < 0)
+        {
+          return (struct Pc *)0;
+        }
+
+      pc->line = self->index[i].line;
+      pc->token = self->code[pc->line] + 1;
+      return pc;
+    }
+
   for (i = self->size - 1; i >= 0; --i)
     {
       if (self->code[i]->type == T_INTEGER &&
@@ -868,6 +1050,7 @@ void Program_renum(struct Program *self, int first, int inc)
       self->code[i]->u.integer = first + i * inc;
     }
 
+  Program_reindex(self);
   self->numbered = 1;
   self->runnable = 0;
   self->unsaved = 1;
@@ -924,6 +1107,7 @@ void Program_unnum(struct Program *self)
     }
 
   free(ref);
+  Program_reindex(self);
   self->runnable = 0;
   self->unsaved = 1;
 }
@@ -50,6 +50,14 @@ struct Scope
   struct Scope *next;
 };
 
+/* Index of the numbered lines in code[], sorted by line number */
+
+struct LineIndex
+{
+  long int number;
+  int line;
+};
+
 struct Program
 {
   int trace;
@@ -61,6 +69,9 @@ struct Program
   struct String name;
   struct Token **code;
   struct Scope *scope;
+  struct LineIndex *index;
+  int indexLength;
+  int indexed;          /* index is valid, else lines are searched */
 };
 
 #endif /* __APPS_EXAMPLES_BAS_BAS_PROGRAMTYPES_H */
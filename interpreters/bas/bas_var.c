@@ -42,6 +42,124 @@
 
 #define _(String) String
 
+/* Tile size of the real matrix multiplication, in elements */
+
+#ifndef CONFIG_INTERPRETER_BAS_MATBLOCK
+#  define CONFIG_INTERPRETER_BAS_MATBLOCK 16
+#endif
+
+#define MATBLOCK CONFIG_INTERPRETER_BAS_MATBLOCK
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Copy the used part of a real matrix to a row major array of doubles */
+
+static double *matGet(const struct Var *x, int unused, int rows, int cols)
+{
+  unsigned int g1 = x->dim == 1 ? 1 : x->geometry[1];
+  double *a;
+  int i, j;
+
+  if ((a = malloc(sizeof(double) * rows * cols + 1)) == (double *)0)
+    {
+      return (double *)0;
+    }
+
+  for (i = 0; i < rows; ++i)
+    {
+      const struct Value *v = &x->value[(i + unused) * g1 + unused];
+
+      for (j = 0; j < cols; ++j)
+        {
+          a[i * cols + j] = v[j].u.real;
+        }
+    }
+
+  return a;
+}
+
+/* c += a * b for row major a (m x n), b (n x p) and c (m x p).  The loops
+ * are tiled so that the rows of b and c being worked on stay in the cache,
+ * and every element of c still sums its products in increasing k order.
+ */
+
+static void matMult(const double *a, const double *b, double *c, int m,
+                    int n, int p)
+{
+  int i0, k0, j0, i, k, j, i1, k1, j1;
+
+  for (i0 = 0; i0 < m; i0 += MATBLOCK)
+    {
+      i1 = i0 + MATBLOCK < m ? i0 + MATBLOCK : m;
+      for (k0 = 0; k0 < n; k0 += MATBLOCK)
+        {
+          k1 = k0 + MATBLOCK < n ? k0 + MATBLOCK : n;
+          for (j0 = 0; j0 < p; j0 += MATBLOCK)
+            {
+              j1 = j0 + MATBLOCK < p ? j0 + MATBLOCK : p;
+              for (i = i0; i < i1; ++i)
+                {
+                  double *ci = &c[i * p];
+
+                  for (k = k0; k < k1; ++k)
+                    {
+                      const double *bk = &b[k * p];
+                      double aik = a[i * n + k];
+
+                      for (j = j0; j < j1; ++j)
+                        {
+                          ci[j] += aik * bk[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Multiply the real matrices x and y into the real matrix foo, which has
+ * the result geometry.  Returns -1 if there is not enough memory for the
+ * double copies, leaving foo untouched.
+ */
+
+static int multReal(struct Var *foo, const struct Var *x,
+                    const struct Var *y, int unused)
+{
+  int m = x->geometry[0] - unused;
+  int n = x->geometry[1] - unused;
+  int p = y->geometry[1] - unused;
+  double *a, *b, *c;
+  int i, j;
+
+  a = matGet(x, unused, m, n);
+  b = matGet(y, unused, n, p);
+  c = calloc(m * p + 1, sizeof(double));
+  if (a == (double *)0 || b == (double *)0 || c == (double *)0)
+    {
+      free(a);
+      free(b);
+      free(c);
+      return -1;
+    }
+
+  matMult(a, b, c, m, n, p);
+  for (i = 0; i < m; ++i)
+    {
+      for (j = 0; j < p; ++j)
+        {
+          foo->value[(i + unused) * foo->geometry[1] + j + unused].u.real =
+            c[i * p + j];
+        }
+    }
+
+  free(a);
+  free(b);
+  free(c);
+  return 0;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -251,6 +369,26 @@ struct Value *Var_mat_addsub(struct Var *self, struct Var *x, struct Var *y,
 
       g0 = x->geometry[0];
       g1 = x->dim == 1 ? unused + 1 : x->geometry[1];
+
+      /* Real matrices need no conversions and cannot fail */
+
+      if (thisType == V_REAL && x->type == V_REAL && y->type == V_REAL)
+        {
+          for (i = unused; i < g0; ++i)
+            {
+              for (j = unused; j < g1; ++j)
+                {
+                  unsigned int element = x->dim == 1 ? i : i * g1 + j;
+
+                  self->value[element].u.real = add ?
+                    x->value[element].u.real + y->value[element].u.real :
+                    x->value[element].u.real - y->value[element].u.real;
+                }
+            }
+
+          return (struct Value *)0;
+        }
+
       for (i = unused; i < g0; ++i)
         {
           for (j = unused; j < g1; ++j)
@@ -326,6 +464,19 @@ struct Value *Var_mat_mult(struct Var *self, struct Var *x, struct Var *y,
       newdim[0] = x->geometry[0];
       newdim[1] = y->geometry[1];
       Var_new(&foo, thisType, 2, newdim, 0);
+
+      /* Real matrices are multiplied as plain doubles, which gives the
+       * same sums as the generic loop below.
+       */
+
+      if (thisType == V_REAL && x->type == V_REAL && y->type == V_REAL &&
+          multReal(&foo, x, y, unused) == 0)
+        {
+          Var_destroy(self);
+          *self = foo;
+          return (struct Value *)0;
+        }
+
       for (i = unused; i < newdim[0]; ++i)
         {
           for (j = unused; j < newdim[1]; ++j)
@@ -471,8 +622,15 @@ struct Value *Var_mat_invert(struct Var *self, struct Var *x, struct Value *det,
 
   n = x->geometry[0] - unused;
 
-  a = malloc(sizeof(double) * n * n);
-  u = malloc(sizeof(double) * n * n);
+  a = malloc(sizeof(double) * n * n + 1);
+  u = malloc(sizeof(double) * n * n + 1);
+  if (a == (double *)0 || u == (double *)0)
+    {
+      free(a);
+      free(u);
+      return Value_new_ERROR(err, OUTOFMEMORY);
+    }
+
   for (i = 0; i < n; ++i)
     {
       for (j = 0; j < n; ++j)
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+# apps/interpreters/bas/bench/basbench.py
+#
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.  The
+# ASF licenses this file to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance with the
+# License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+# Generate a set of classic BASIC benchmark programs and run them with bas.
+#
+# Every program measures its main loop with TIME (1/100 s of CPU time) and
+# prints the number of statements executed per second.  The "large"
+# programs have a few thousand lines with GOSUB/GOTO targets spread over
+# the whole program, so their load and RUN time depends on how fast line
+# numbers are looked up; the runner reports that as the wall time.  The
+# "mat" programs time MAT multiplication and inversion of real matrices and
+# print multiply-adds per second instead.
+#
+#   ./basbench.py --bas ./bas              run all programs on the host
+#   ./basbench.py --out /tmp/bench         only write the .bas files, e.g.
+#                                          to copy them to the target
+#
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+REPORT = """\
+{t} T=TIME-T
+{r} IF T<1 THEN T=1
+{p} PRINT "{name}";:PRINT USING " ########## statements ########## statements/s";N*{k},N*{k}*100/T
+"""
+
+
+def loop(n):
+    # 2 statements per iteration
+    return (
+        "10 N={n}:A=0:T=TIME\n"
+        "20 FOR I=1 TO N\n"
+        "30 A=A+I*2\n"
+        "40 NEXT I\n"
+        + REPORT.format(t=50, r=60, p=70, name="loop", k=2)
+    ).format(n=n)
+
+
+def gotoloop(n):
+    # 3 statements per iteration
+    return (
+        "10 N={n}:A=0:I=0:T=TIME\n"
+        "20 I=I+1\n"
+        "30 A=A+I\n"
+        "40 IF I<N THEN GOTO 20\n"
+        + REPORT.format(t=50, r=60, p=70, name="goto", k=3)
+    ).format(n=n)
+
+
+def gosub(n):
+    # 4 statements per iteration: FOR/NEXT, GOSUB, assignment, RETURN
+    return (
+        "10 N={n}:A=0:T=TIME\n"
+        "20 FOR I=1 TO N\n"
+        "30 GOSUB 1000\n"
+        "40 NEXT I\n"
+        + REPORT.format(t=50, r=60, p=70, name="gosub", k=4)
+        + "80 END\n"
+        "1000 A=A+1\n"
+        "1010 RETURN\n"
+    ).format(n=n)
+
+
+def large(n, nsubs, filler):
+    # A dispatcher calls nsubs subroutines spread over the program with
+    # ON GOSUB and every subroutine jumps back with GOTO; 6 statements per
+    # iteration.
+    lines = [
+        "10 N={n}:A=0:T=TIME".format(n=n),
+        "20 FOR I=1 TO N",
+        "30 J=I MOD {m}+1".format(m=min(nsubs, 16)),
+        "40 ON J GOSUB " + ",".join(str(1000 + s * (filler + 3) * 10)
+                                     for s in range(min(nsubs, 16))),
+        "50 NEXT I",
+    ]
+    lines += REPORT.format(t=60, r=70, p=80, name="large%d" % nsubs,
+                           k=6).splitlines()
+    lines.append("90 END")
+    for s in range(nsubs):
+        base = 1000 + s * (filler + 3) * 10
+        lines.append("%d GOTO %d" % (base, base + (filler + 1) * 10))
+        for f in range(filler):
+            lines.append("%d A=A-%d" % (base + (f + 1) * 10, f))
+        lines.append("%d A=A+1" % (base + (filler + 1) * 10))
+        lines.append("%d RETURN" % (base + (filler + 2) * 10))
+    return "\n".join(lines) + "\n"
+
+
+def mat(n, reps, op, name):
+    # About n^3 multiply-adds per MAT statement
+    return (
+        "10 N={n}:R={r}:DIM A(N,N),B(N,N),C(N,N)\n"
+        "20 FOR I=1 TO N:FOR J=1 TO N\n"
+        "30 A(I,J)=((I*7+J*3) MOD 11)/4-1:B(I,J)=((I+J*5) MOD 13)/8-0.5\n"
+        "40 NEXT J:A(I,I)=A(I,I)+N:NEXT I\n"
+        "50 T=TIME\n"
+        "60 FOR L=1 TO R\n"
+        "70 MAT C={op}\n"
+        "80 NEXT L\n"
+        "90 T=TIME-T\n"
+        "100 IF T<1 THEN T=1\n"
+        "110 PRINT \"{name}\";:PRINT USING \" ########## multiply-adds/s\";"
+        "R*N^3*100/T\n"
+    ).format(n=n, r=reps, op=op, name=name)
+
+
+def programs(scale):
+    return {
+        "loop.bas": loop(1000000 * scale),
+        "goto.bas": gotoloop(500000 * scale),
+        "gosub.bas": gosub(500000 * scale),
+        "large1k.bas": large(200000 * scale, 100, 7),
+        "large5k.bas": large(200000 * scale, 500, 7),
+        "large20k.bas": large(200000 * scale, 2000, 7),
+        "matmul.bas": mat(64, 500 * scale, "A*B", "matmul"),
+        "matinv.bas": mat(64, 100 * scale, "INV(A)", "matinv"),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="BASIC interpreter benchmark")
+    parser.add_argument("--bas", default="bas", help="bas executable")
+    parser.add_argument("--out", help="write the programs to this directory")
+    parser.add_argument("--scale", type=int, default=1,
+                        help="multiply the iteration counts")
+    args = parser.parse_args()
+
+    progs = programs(args.scale)
+    outdir = args.out or tempfile.mkdtemp(prefix="basbench")
+    os.makedirs(outdir, exist_ok=True)
+    for name, text in progs.items():
+        with open(os.path.join(outdir, name), "w") as f:
+            f.write(text)
+
+    if args.out:
+        print("%d programs written to %s" % (len(progs), outdir))
+        return 0
+
+    ok = True
+    for name in progs:
+        start = time.monotonic()
+        proc = subprocess.run([args.bas, os.path.join(outdir, name)],
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT,
+                              universal_newlines=True)
+        elapsed = time.monotonic() - start
+        lines = progs[name].count("\n")
+        out = proc.stdout.strip()
+        if proc.returncode != 0 or "/s" not in out:
+            ok = False
+        print("%-12s %5d lines %7.2f s  %s" % (name, lines, elapsed, out))
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -50,6 +50,8 @@
 #include <ctype.h>
 #include <assert.h>
 
+#include "interpreters/minibasic.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -175,6 +177,27 @@ struct mb_line_s
 {
   int no;                       /* Line number */
   FAR const char *str;          /* Points to start of line */
+  int tok;                      /* Index of its first token in g_tokens */
+};
+
+struct mb_token_s
+{
+  int tok;                      /* Token id */
+  FAR const char *end;          /* Points just past the token in the script */
+  union
+  {
+    double value;               /* VALUE: the number */
+    int slot;                   /* Identifiers: index into g_names */
+    FAR char *str;              /* QUOTE: the literal (malloced), or NULL */
+    int error;                  /* SYNTAX_ERROR: the error to raise */
+  } u;
+};
+
+struct mb_name_s
+{
+  char id[32];                  /* Interned identifier */
+  int index;                    /* Its entry in g_variables or
+                                 * g_dimvariables, or -1 if not known yet */
 };
 
 struct mb_variable_s
@@ -235,11 +258,17 @@ static int g_ndimvariables;                     /* Number of dimensioned arrays
 static FAR struct mb_line_s *g_lines;           /* List of line starts */
 static int nlines;                              /* Number of BASIC g_lines in program */
 
+static FAR struct mb_token_s *g_tokens;         /* Compiled lines, or NULL */
+static int g_ntokens;                           /* Number of tokens */
+static FAR struct mb_name_s *g_names;           /* Interned identifiers */
+static int g_nnames;                            /* Number of identifiers */
+
 static FILE *g_fpin;                            /* Input stream */
 static FILE *g_fpout;                           /* Output stream */
 static FILE *g_fperr;                           /* Error stream */
 
 static FAR const char *g_string;                /* String we are parsing */
+static FAR const struct mb_token_s *g_tokp;     /* Current compiled token */
 static int g_token;                             /* Current token (lookahead) */
 static int g_errorflag;                         /* Set when error in input encountered */
 static char g_iobuffer[IOBUFSIZE];              /* I/O buffer */
@@ -248,7 +277,9 @@ static char g_iobuffer[IOBUFSIZE];              /* I/O buffer */
  * Private Function Prototypes
  ****************************************************************************/
 
-static int setup(FAR const char *script);
+static int setup(FAR const char *script, int flags);
+static int compile(void);
+static int intern(FAR const char *id);
 static void cleanup(void);
 
 static void reporterror(int lineno);
@@ -278,6 +309,9 @@ static double instr(void);
 static double variable(void);
 static double dimvariable(void);
 
+static FAR const char *tokenid(FAR char *id);
+static FAR struct mb_variable_s *tokenvariable(int create);
+static FAR struct mb_dimvar_s *tokendimvar(void);
 static FAR struct mb_variable_s *findvariable(FAR const char *id);
 static FAR struct mb_dimvar_s *finddimvar(FAR const char *id);
 static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...);
@@ -326,12 +360,13 @@ static double factorial(double x);
  * Description:
  *   Sets up all our globals, including the list of lines.
  *   Params: script - the script passed by the user
+ *           flags - BASIC_NOCOMPILE to interpret the source text
  *   Returns: 0 on success, -1 on failure
  *
  *
  ****************************************************************************/
 
-static int setup(FAR const char *script)
+static int setup(FAR const char *script, int flags)
 {
   int i;
 
@@ -396,9 +431,197 @@ static int setup(FAR const char *script)
   g_dimvariables = 0;
   g_ndimvariables = 0;
 
+  nfors = 0;
+
+  if ((flags & BASIC_NOCOMPILE) == 0 && compile() < 0)
+    {
+      if (g_fperr)
+        {
+          fprintf(g_fperr, "Out of memory\n");
+        }
+
+      cleanup();
+      return -1;
+    }
+
   return 0;
 }
 
+/****************************************************************************
+ * Name: compile
+ *
+ * Description:
+ *   Convert every line to a stream of tokens, so that the script is only
+ *   lexed once.  Numbers are converted, string literals unquoted and
+ *   identifiers interned so that variables are not looked up by name.
+ *   Each line ends with EOL, or with EOS at the end of the script; lexical
+ *   errors end the line with a SYNTAX_ERROR token that raises the error
+ *   when it is reached, like the source interpreter would.
+ *   Returns: 0 on success, -1 if out of memory
+ *
+ ****************************************************************************/
+
+static int compile(void)
+{
+  FAR struct mb_token_s *tokens;
+  FAR struct mb_token_s *tp;
+  FAR const char *str;
+  FAR const char *limit;
+  FAR char *end;
+  char id[32];
+  int size = 0;
+  int error;
+  int len;
+  int i;
+
+  for (i = 0; i < nlines; i++)
+    {
+      g_lines[i].tok = g_ntokens;
+      str   = g_lines[i].str;
+      limit = i + 1 < nlines ? g_lines[i + 1].str : NULL;
+      error = 0;
+
+      do
+        {
+          if (g_ntokens == size)
+            {
+              size = size ? 2 * size : 64;
+              tokens = realloc(g_tokens, size * sizeof(struct mb_token_s));
+              if (!tokens)
+                {
+                  return -1;
+                }
+
+              g_tokens = tokens;
+            }
+
+          tp = &g_tokens[g_ntokens++];
+          while (isspace(*str))
+            {
+              str++;
+            }
+
+          if (error)
+            {
+              tp->tok = SYNTAX_ERROR;
+              tp->u.error = error;
+            }
+          else if (limit && str >= limit)
+            {
+              tp->tok = EOL;
+            }
+          else
+            {
+              tp->tok = gettoken(str);
+            }
+
+          switch (tp->tok)
+            {
+            case VALUE:
+              tp->u.value = getvalue(str, &len);
+              str += len;
+              break;
+
+            case FLTID:
+            case STRID:
+            case DIMFLTID:
+            case DIMSTRID:
+              g_errorflag = 0;
+              getid(str, id, &len);
+              if (g_errorflag)
+                {
+                  tp->tok = SYNTAX_ERROR;
+                  tp->u.error = g_errorflag;
+                  break;
+                }
+
+              tp->u.slot = intern(id);
+              if (tp->u.slot < 0)
+                {
+                  return -1;
+                }
+
+              str += len;
+              break;
+
+            case QUOTE:
+              tp->u.str = NULL;
+              end = mystrend(str, '"');
+              if (!end)
+                {
+                  error = ERR_SYNTAX;
+                  break;
+                }
+
+              tp->u.str = malloc(end - str);
+              if (!tp->u.str)
+                {
+                  return -1;
+                }
+
+              mystrgrablit(tp->u.str, str);
+              str = end + 1;
+              break;
+
+            case SYNTAX_ERROR:
+              if (!error)
+                {
+                  tp->u.error = ERR_SYNTAX;
+                }
+              break;
+
+            case EOL:
+            case EOS:
+              break;
+
+            default:
+              str += tokenlen(str, tp->tok);
+              break;
+            }
+
+          tp->end = str;
+        }
+      while (tp->tok != EOL && tp->tok != EOS && tp->tok != SYNTAX_ERROR);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: intern
+ *
+ * Description:
+ *   Get the slot of an identifier in g_names, adding it if it is new.
+ *   Params: id - the identifier
+ *   Returns: index of the slot, -1 if out of memory
+ *
+ ****************************************************************************/
+
+static int intern(FAR const char *id)
+{
+  FAR struct mb_name_s *names;
+  int i;
+
+  for (i = 0; i < g_nnames; i++)
+    {
+      if (!strcmp(g_names[i].id, id))
+        {
+          return i;
+        }
+    }
+
+  names = realloc(g_names, (g_nnames + 1) * sizeof(struct mb_name_s));
+  if (!names)
+    {
+      return -1;
+    }
+
+  g_names = names;
+  strlcpy(g_names[g_nnames].id, id, sizeof(g_names[g_nnames].id));
+  g_names[g_nnames].index = -1;
+  return g_nnames++;
+}
+
 /****************************************************************************
  * Name: cleanup
  *
@@ -473,6 +696,31 @@ static void cleanup(void)
 
   g_lines = 0;
   nlines = 0;
+
+  for (i = 0; i < g_ntokens; i++)
+    {
+      if (g_tokens[i].tok == QUOTE && g_tokens[i].u.str)
+        {
+          free(g_tokens[i].u.str);
+        }
+    }
+
+  if (g_tokens)
+    {
+      free(g_tokens);
+    }
+
+  g_tokens = 0;
+  g_ntokens = 0;
+  g_tokp = NULL;
+
+  if (g_names)
+    {
+      free(g_names);
+    }
+
+  g_names = 0;
+  g_nnames = 0;
 }
 
 /****************************************************************************
@@ -830,7 +1078,7 @@ static void dodim(void)
   int ndims = 0;
   double dims[6];
   char name[32];
-  int len;
+  FAR const char *id;
   FAR struct mb_dimvar_s *dimvar;
   int i;
   int size = 1;
@@ -841,7 +1089,7 @@ static void dodim(void)
     {
     case DIMFLTID:
     case DIMSTRID:
-      getid(g_string, name, &len);
+      id = tokenid(name);
       match(g_token);
       dims[ndims++] = expr();
       while (g_token == COMMA)
@@ -869,27 +1117,27 @@ static void dodim(void)
       switch (ndims)
         {
         case 1:
-          dimvar = dimension(name, 1, (int)dims[0]);
+          dimvar = dimension(id, 1, (int)dims[0]);
           break;
 
         case 2:
-          dimvar = dimension(name, 2, (int)dims[0], (int)dims[1]);
+          dimvar = dimension(id, 2, (int)dims[0], (int)dims[1]);
           break;
 
         case 3:
-          dimvar = dimension(name, 3, (int)dims[0],
+          dimvar = dimension(id, 3, (int)dims[0],
                              (int)dims[1], (int)dims[2]);
           break;
 
         case 4:
           dimvar =
-            dimension(name, 4, (int)dims[0], (int)dims[1], (int)dims[2],
+            dimension(id, 4, (int)dims[0], (int)dims[1], (int)dims[2],
                       (int)dims[3]);
           break;
 
         case 5:
           dimvar =
-            dimension(name, 5, (int)dims[0], (int)dims[1], (int)dims[2],
+            dimension(id, 5, (int)dims[0], (int)dims[1], (int)dims[2],
                       (int)dims[3], (int)dims[4]);
           break;
         }
@@ -1022,6 +1270,7 @@ static int dogoto(void)
 
 static int dofor(void)
 {
+  FAR const struct mb_token_s *tp;
   struct mb_lvalue_s lv;
   char id[32];
   char nextid[32];
@@ -1030,10 +1279,14 @@ static int dofor(void)
   double toval;
   double stepval;
   FAR const char *savestring;
+  FAR const char *name;
   int answer;
+  int slot;
+  int i;
 
   match(FOR);
-  getid(g_string, id, &len);
+  name = tokenid(id);
+  slot = g_tokp ? g_tokp->u.slot : -1;
 
   lvalue(&lv);
   if (lv.type != FLTID)
@@ -1068,9 +1321,30 @@ static int dofor(void)
   if ((stepval < 0 && initval < toval) ||
       (stepval > 0 && initval > toval))
     {
+      if (g_tokp != NULL)
+        {
+          /* Look for the matching NEXT at the start of a later line */
+
+          for (i = 0; i < nlines; i++)
+            {
+              tp = &g_tokens[g_lines[i].tok];
+              if (tp > g_tokp && tp[1].tok == NEXT &&
+                  (tp[2].tok == FLTID || tp[2].tok == DIMFLTID) &&
+                  tp[2].u.slot == slot)
+                {
+                  answer = getnextline(tp[1].end);
+                  return answer ? answer : -1;
+                }
+            }
+
+          seterror(ERR_NONEXT);
+          return -1;
+        }
+
       savestring = g_string;
       while ((g_string = strchr(g_string, '\n')) != NULL)
         {
+          g_string++;
           g_errorflag = 0;
           g_token = gettoken(g_string);
           match(VALUE);
@@ -1080,7 +1354,7 @@ static int dofor(void)
               if (g_token == FLTID || g_token == DIMFLTID)
                 {
                   getid(g_string, nextid, &len);
-                  if (!strcmp(id, nextid))
+                  if (!strcmp(name, nextid))
                     {
                       answer = getnextline(g_string);
                       g_string = savestring;
@@ -1091,12 +1365,18 @@ static int dofor(void)
             }
         }
 
+      /* Scanning past the last line left a syntax error behind, report
+       * the missing NEXT as the compiled path does.
+       */
+
+      g_string    = savestring;
+      g_errorflag = 0;
       seterror(ERR_NONEXT);
       return -1;
     }
   else
     {
-      strlcpy(g_forstack[nfors].id, id, sizeof(g_forstack[nfors].id));
+      strlcpy(g_forstack[nfors].id, name, sizeof(g_forstack[nfors].id));
       g_forstack[nfors].nextline = getnextline(g_string);
       g_forstack[nfors].step = stepval;
       g_forstack[nfors].toval = toval;
@@ -1116,15 +1396,12 @@ static int dofor(void)
 
 static int donext(void)
 {
-  char id[32];
-  int len;
   struct mb_lvalue_s lv;
 
   match(NEXT);
 
   if (nfors)
     {
-      getid(g_string, id, &len);
       lvalue(&lv);
       if (lv.type != FLTID)
         {
@@ -1275,8 +1552,6 @@ static void dorem(void)
 
 static void lvalue(FAR struct mb_lvalue_s *lv)
 {
-  char name[32];
-  int len;
   FAR struct mb_variable_s *var;
   FAR struct mb_dimvar_s *dimvar;
   int index[5];
@@ -1291,14 +1566,8 @@ static void lvalue(FAR struct mb_lvalue_s *lv)
     {
     case FLTID:
       {
-        getid(g_string, name, &len);
+        var = tokenvariable(1);
         match(FLTID);
-        var = findvariable(name);
-        if (!var)
-          {
-            var = addfloat(name);
-          }
-
         if (!var)
           {
             seterror(ERR_OUTOFMEMORY);
@@ -1313,14 +1582,8 @@ static void lvalue(FAR struct mb_lvalue_s *lv)
 
     case STRID:
       {
-        getid(g_string, name, &len);
+        var = tokenvariable(1);
         match(STRID);
-        var = findvariable(name);
-        if (!var)
-          {
-            var = addstring(name);
-          }
-
         if (!var)
           {
             seterror(ERR_OUTOFMEMORY);
@@ -1337,9 +1600,8 @@ static void lvalue(FAR struct mb_lvalue_s *lv)
     case DIMSTRID:
       {
         type = (g_token == DIMFLTID) ? FLTID : STRID;
-        getid(g_string, name, &len);
+        dimvar = tokendimvar();
         match(g_token);
-        dimvar = finddimvar(name);
         if (dimvar)
           {
             switch (dimvar->ndims)
@@ -1769,7 +2031,7 @@ static double factor(void)
       break;
 
     case VALUE:
-      answer = getvalue(g_string, &len);
+      answer = g_tokp ? g_tokp->u.value : getvalue(g_string, &len);
       match(VALUE);
       break;
 
@@ -2096,12 +2358,9 @@ static double instr(void)
 static double variable(void)
 {
   FAR struct mb_variable_s *var;
-  char id[32];
-  int len;
 
-  getid(g_string, id, &len);
+  var = tokenvariable(0);
   match(FLTID);
-  var = findvariable(id);
   if (var)
     {
       return var->dval;
@@ -2125,14 +2384,11 @@ static double variable(void)
 static double dimvariable(void)
 {
   FAR struct mb_dimvar_s *dimvar;
-  char id[32];
-  int len;
   int index[5];
   FAR double *answer = NULL;
 
-  getid(g_string, id, &len);
+  dimvar = tokendimvar();
   match(DIMFLTID);
-  dimvar = finddimvar(id);
   if (!dimvar)
     {
       seterror(ERR_NOSUCHVARIABLE);
@@ -2201,6 +2457,114 @@ static double dimvariable(void)
   return 0.0;
 }
 
+/****************************************************************************
+ * Name: tokenid
+ *
+ * Description:
+ *   Get the id of the current token
+ *   Params: id - buffer for the id [32 chars]
+ *   Returns: the id, which may or may not be stored in the buffer
+ *
+ ****************************************************************************/
+
+static FAR const char *tokenid(FAR char *id)
+{
+  int len;
+
+  if (g_tokp == NULL)
+    {
+      getid(g_string, id, &len);
+      return id;
+    }
+
+  switch (g_token)
+    {
+    case FLTID:
+    case STRID:
+    case DIMFLTID:
+    case DIMSTRID:
+      return g_names[g_tokp->u.slot].id;
+
+    default:
+      return "";
+    }
+}
+
+/****************************************************************************
+ * Name: tokenvariable
+ *
+ * Description:
+ *   Find the scalar variable named by the current token.  In a compiled
+ *   script, the variable is looked up by name only once per identifier.
+ *   Params: create - add the variable if it does not exist
+ *   Returns: pointer to the variable, 0 on fail
+ *
+ ****************************************************************************/
+
+static FAR struct mb_variable_s *tokenvariable(int create)
+{
+  FAR struct mb_name_s *name = NULL;
+  FAR struct mb_variable_s *var;
+  FAR const char *id;
+  char buf[32];
+
+  if (g_tokp != NULL)
+    {
+      name = &g_names[g_tokp->u.slot];
+      if (name->index >= 0)
+        {
+          return &g_variables[name->index];
+        }
+    }
+
+  id = tokenid(buf);
+  var = findvariable(id);
+  if (!var && create)
+    {
+      var = g_token == STRID ? addstring(id) : addfloat(id);
+    }
+
+  if (var && g_tokp != NULL)
+    {
+      name->index = var - g_variables;
+    }
+
+  return var;
+}
+
+/****************************************************************************
+ * Name: tokendimvar
+ *
+ * Description:
+ *   Find the dimensioned array named by the current token
+ *   Returns: pointer to array entry or 0 on fail
+ *
+ ****************************************************************************/
+
+static FAR struct mb_dimvar_s *tokendimvar(void)
+{
+  FAR struct mb_name_s *name = NULL;
+  FAR struct mb_dimvar_s *dimvar;
+  char buf[32];
+
+  if (g_tokp != NULL)
+    {
+      name = &g_names[g_tokp->u.slot];
+      if (name->index >= 0)
+        {
+          return &g_dimvariables[name->index];
+        }
+    }
+
+  dimvar = finddimvar(tokenid(buf));
+  if (dimvar && g_tokp != NULL)
+    {
+      name->index = dimvar - g_dimvariables;
+    }
+
+  return dimvar;
+}
+
 /****************************************************************************
  * Name: findvariable
  *
@@ -2990,15 +3354,12 @@ static FAR char *stringstring(void)
 
 static FAR char *stringdimvar(void)
 {
-  char id[32];
-  int len;
   FAR struct mb_dimvar_s *dimvar;
   FAR char **answer = NULL;
   int index[5];
 
-  getid(g_string, id, &len);
+  dimvar = tokendimvar();
   match(DIMSTRID);
-  dimvar = finddimvar(id);
 
   if (dimvar)
     {
@@ -3081,13 +3442,10 @@ static FAR char *stringdimvar(void)
 
 static FAR char *stringvar(void)
 {
-  char id[32];
-  int len;
   FAR struct mb_variable_s *var;
 
-  getid(g_string, id, &len);
+  var = tokenvariable(0);
   match(STRID);
-  var = findvariable(id);
   if (var)
     {
       if (var->sval)
@@ -3123,23 +3481,41 @@ static FAR char *stringliteral(void)
 
   while (g_token == QUOTE)
     {
-      while (isspace(*g_string))
-        {
-          g_string++;
-        }
-
-      end = mystrend(g_string, '"');
-      if (end)
+      if (g_tokp != NULL)
         {
-          len = end - g_string;
-          substr = malloc(len);
-          if (!substr)
+          end = g_tokp->u.str;
+          substr = end ? mystrdup(end) : NULL;
+          if (end && !substr)
             {
               seterror(ERR_OUTOFMEMORY);
               return answer;
             }
+        }
+      else
+        {
+          while (isspace(*g_string))
+            {
+              g_string++;
+            }
+
+          end = mystrend(g_string, '"');
+          if (end)
+            {
+              len = end - g_string;
+              substr = malloc(len);
+              if (!substr)
+                {
+                  seterror(ERR_OUTOFMEMORY);
+                  return answer;
+                }
+
+              mystrgrablit(substr, g_string);
+              g_string = end;
+            }
+        }
 
-          mystrgrablit(substr, g_string);
+      if (end)
+        {
           if (answer)
             {
               temp = mystrconcat(answer, substr);
@@ -3156,8 +3532,6 @@ static FAR char *stringliteral(void)
             {
               answer = substr;
             }
-
-          g_string = end;
         }
       else
         {
@@ -3211,6 +3585,18 @@ static void match(int tok)
       return;
     }
 
+  if (g_tokp != NULL)
+    {
+      g_string = g_tokp->end;
+      g_token = (++g_tokp)->tok;
+      if (g_token == SYNTAX_ERROR)
+        {
+          seterror(g_tokp->u.error);
+        }
+
+      return;
+    }
+
   while (isspace(*g_string))
     {
       g_string++;
@@ -4072,7 +4458,7 @@ static double factorial(double x)
  ****************************************************************************/
 
 /****************************************************************************
- * Name: basic
+ * Name: basic_exec
  *
  * Description:
  *   Interpret a BASIC script
@@ -4082,13 +4468,16 @@ static double factorial(double x)
  *   in     - input stream
  *   out    - output stream
  *   err    - error stream
+ *   flags  - BASIC_NOCOMPILE to lex the source text on every statement
+ *            instead of compiling the script first
  *
  * Returned Value:
  *   Returns: 0 on success, 1 on error condition.
  *
  ****************************************************************************/
 
-int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
+int basic_exec(FAR const char *script, FILE *in, FILE *out, FILE *err,
+               int flags)
 {
   int curline = 0;
   int nextline;
@@ -4098,7 +4487,7 @@ int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
   g_fpout = out;
   g_fperr = err;
 
-  if (setup(script) == -1)
+  if (setup(script, flags) == -1)
     {
       return 1;
     }
@@ -4106,7 +4495,16 @@ int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
   while (curline != -1)
     {
       g_string = g_lines[curline].str;
-      g_token = gettoken(g_string);
+      if (g_tokens)
+        {
+          g_tokp = &g_tokens[g_lines[curline].tok];
+          g_token = g_tokp->tok;
+        }
+      else
+        {
+          g_token = gettoken(g_string);
+        }
+
       g_errorflag = 0;
 
       nextline = line();
@@ -4147,3 +4545,25 @@ int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
   cleanup();
   return answer;
 }
+
+/****************************************************************************
+ * Name: basic
+ *
+ * Description:
+ *   Compile and interpret a BASIC script
+ *
+ * Input Parameters:
+ *   script - the script to run
+ *   in     - input stream
+ *   out    - output stream
+ *   err    - error stream
+ *
+ * Returned Value:
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+int basic(FAR const char *script, FILE *in, FILE *out, FILE *err)
+{
+  return basic_exec(script, in, out, err, 0);
+}
@@ -44,9 +44,12 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "interpreters/minibasic.h"
 
@@ -67,10 +70,58 @@ static FAR char *script =
   "60 LET x = SQRT(3.0) * SQRT(3.0)\n"
   "65 LET x = INT(x + 0.5)\n"
   "70 PRINT MID$(\"1234567890\", x, -1)\n";
+
+/* Loop-heavy scripts for timing the interpreter (-t) */
+
+static FAR const char *g_timescripts[][2] =
+{
+  {
+    "loops",
+    "10 REM Nested loops\n"
+    "20 LET s = 0\n"
+    "30 FOR i = 1 TO 100\n"
+    "40 FOR j = 1 TO 100\n"
+    "50 LET s = s + (i * j) MOD 7\n"
+    "60 NEXT j\n"
+    "70 NEXT i\n"
+    "80 PRINT s\n"
+  },
+  {
+    "sieve",
+    "10 REM Sieve of Eratosthenes\n"
+    "20 DIM f(2000)\n"
+    "30 FOR i = 1 TO 2000\n"
+    "40 LET f(i) = 0\n"
+    "50 NEXT i\n"
+    "60 LET n = 0\n"
+    "70 FOR i = 2 TO 2000\n"
+    "80 IF f(i) = 1 THEN 130\n"
+    "90 LET n = n + 1\n"
+    "100 FOR j = i + i TO 2000 STEP i\n"
+    "110 LET f(j) = 1\n"
+    "120 NEXT j\n"
+    "130 NEXT i\n"
+    "140 PRINT n\n"
+  },
+  {
+    "strings",
+    "10 REM String handling\n"
+    "20 LET a$ = \"\"\n"
+    "30 FOR i = 1 TO 200\n"
+    "40 LET a$ = a$ + CHR$(65 + i MOD 26)\n"
+    "50 NEXT i\n"
+    "60 LET n = 0\n"
+    "70 FOR i = 1 TO LEN(a$)\n"
+    "80 IF MID$(a$, i, 1) <> \"A\" THEN 100\n"
+    "90 LET n = n + 1\n"
+    "100 NEXT i\n"
+    "110 PRINT LEN(a$), n\n"
+  },
+};
 #endif
 
 /****************************************************************************
- * Public Functions
+ * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
@@ -133,11 +184,80 @@ static void usage(void)
 {
   fprintf(stderr, "MiniBasic: a BASIC interpreter\n");
   fprintf(stderr, "usage:\n");
-  fprintf(stderr, "Basic <script>\n");
+  fprintf(stderr, "Basic [-t] [-n <runs>] <script>\n");
+  fprintf(stderr, "  -t  Time the script interpreted from source and "
+                  "compiled\n");
+  fprintf(stderr, "  -n  Number of runs for -t (default 10)\n");
   fprintf(stderr, "See documentation for BASIC syntax.\n");
   exit(EXIT_FAILURE);
 }
 
+/****************************************************************************
+ * Name: timescript
+ *
+ * Description:
+ *   Run a script a number of times with the output discarded and return
+ *   the average time per run in microseconds, or -1 if the script fails.
+ *
+ ****************************************************************************/
+
+static long timescript(FAR const char *scr, FILE *out, int runs, int flags)
+{
+  struct timespec start;
+  struct timespec end;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < runs; i++)
+    {
+      if (basic_exec(scr, stdin, out, stderr, flags) != 0)
+        {
+          return -1;
+        }
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec - start.tv_sec) * 1000000 +
+          (end.tv_nsec - start.tv_nsec) / 1000) / runs;
+}
+
+/****************************************************************************
+ * Name: timing
+ *
+ * Description:
+ *   Compare the time taken by a script when every statement is lexed from
+ *   the source text and when the script is compiled first.
+ *
+ ****************************************************************************/
+
+static void timing(FAR const char *name, FAR const char *scr, int runs)
+{
+  long source;
+  long compiled;
+  FILE *out;
+
+  out = fopen("/dev/null", "w");
+  if (!out)
+    {
+      fprintf(stderr, "ERROR: Failed to open /dev/null: %d\n", errno);
+      return;
+    }
+
+  source   = timescript(scr, out, runs, BASIC_NOCOMPILE);
+  compiled = timescript(scr, out, runs, 0);
+  fclose(out);
+
+  if (source < 0 || compiled < 0)
+    {
+      fprintf(stderr, "%s: script failed\n", name);
+      return;
+    }
+
+  printf("%-12s source %8ld us  compiled %8ld us  speedup %ld.%02ld\n",
+         name, source, compiled, source / MAX(compiled, 1),
+         source * 100 / MAX(compiled, 1) % 100);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -153,22 +273,69 @@ static void usage(void)
 int main(int argc, FAR char *argv[])
 {
   FAR char *scr;
+  int runs = 10;
+  int timeit = 0;
+  int option;
+#ifdef CONFIG_INTERPRETER_MINIBASIC_TESTSCRIPT
+  int i;
+#endif
 
-  if (argc == 1)
+  while ((option = getopt(argc, argv, "tn:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 't':
+            timeit = 1;
+            break;
+
+          case 'n':
+            runs = atoi(optarg);
+            if (runs < 1)
+              {
+                usage();
+              }
+            break;
+
+          default:
+            usage();
+            break;
+        }
+    }
+
+  if (optind == argc)
     {
 #ifdef CONFIG_INTERPRETER_MINIBASIC_TESTSCRIPT
-      basic(script, stdin, stdout, stderr);
+      if (timeit)
+        {
+          timing("test", script, runs);
+          for (i = 0; i < nitems(g_timescripts); i++)
+            {
+              timing(g_timescripts[i][0], g_timescripts[i][1], runs);
+            }
+        }
+      else
+        {
+          basic(script, stdin, stdout, stderr);
+        }
 #else
       fprintf(stderr, "ERROR: Missing argument.\n");
       usage();
 #endif
     }
-  else if (argc == 2)
+  else if (optind == argc - 1)
     {
-      scr = loadfile(argv[1]);
+      scr = loadfile(argv[optind]);
       if (scr)
         {
-          basic(scr, stdin, stdout, stderr);
+          if (timeit)
+            {
+              timing(argv[optind], scr, runs);
+            }
+          else
+            {
+              basic(scr, stdin, stdout, stderr);
+            }
+
           free(scr);
         }
     }
@@ -55,28 +55,119 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "netutils/base64.h"
 
 #ifdef CONFIG_CODECS_BASE64
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Reverse alphabet entries shared by both variants, bytes that are not in
+ * the alphabet decode as zero.
+ */
+
+#define BASE64_DEC_ALNUM \
+  ['A'] = 0,  ['B'] = 1,  ['C'] = 2,  ['D'] = 3,  ['E'] = 4,  ['F'] = 5, \
+  ['G'] = 6,  ['H'] = 7,  ['I'] = 8,  ['J'] = 9,  ['K'] = 10, ['L'] = 11, \
+  ['M'] = 12, ['N'] = 13, ['O'] = 14, ['P'] = 15, ['Q'] = 16, ['R'] = 17, \
+  ['S'] = 18, ['T'] = 19, ['U'] = 20, ['V'] = 21, ['W'] = 22, ['X'] = 23, \
+  ['Y'] = 24, ['Z'] = 25, ['a'] = 26, ['b'] = 27, ['c'] = 28, ['d'] = 29, \
+  ['e'] = 30, ['f'] = 31, ['g'] = 32, ['h'] = 33, ['i'] = 34, ['j'] = 35, \
+  ['k'] = 36, ['l'] = 37, ['m'] = 38, ['n'] = 39, ['o'] = 40, ['p'] = 41, \
+  ['q'] = 42, ['r'] = 43, ['s'] = 44, ['t'] = 45, ['u'] = 46, ['v'] = 47, \
+  ['w'] = 48, ['x'] = 49, ['y'] = 50, ['z'] = 51, ['0'] = 52, ['1'] = 53, \
+  ['2'] = 54, ['3'] = 55, ['4'] = 56, ['5'] = 57, ['6'] = 58, ['7'] = 59, \
+  ['8'] = 60, ['9'] = 61
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_base64_tab[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const char g_base64w_tab[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__";
+
+static const uint8_t g_base64_dec[256] =
+{
+  BASE64_DEC_ALNUM, ['+'] = 62, ['/'] = 63
+};
+
+/* '_' stands for both 62 and 63 in the web safe alphabet, and has always
+ * decoded as 62.
+ */
+
+static const uint8_t g_base64w_dec[256] =
+{
+  BASE64_DEC_ALNUM, ['_'] = 62
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: base64_tab
+ * Name: base64_encode_blocks
+ *
+ * Description:
+ *   Encode nblocks groups of 3 bytes into groups of 4 characters, one
+ *   24-bit word at a time.
+ *
  ****************************************************************************/
 
-static FAR const char *base64_tab(bool websafe)
+static FAR unsigned char *base64_encode_blocks(FAR const char *tab,
+                                               FAR const unsigned char *in,
+                                               size_t nblocks,
+                                               FAR unsigned char *pos)
 {
-  static FAR const char *_tab =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  static FAR const char *_tab_w =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__";
+  uint32_t word;
 
-  return websafe ? _tab_w : _tab;
+  while (nblocks-- > 0)
+    {
+      word   = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+      pos[0] = tab[word >> 18];
+      pos[1] = tab[(word >> 12) & 0x3f];
+      pos[2] = tab[(word >> 6) & 0x3f];
+      pos[3] = tab[word & 0x3f];
+      in    += 3;
+      pos   += 4;
+    }
+
+  return pos;
+}
+
+/****************************************************************************
+ * Name: base64_encode_tail
+ *
+ * Description:
+ *   Encode the last 1 or 2 bytes of the data into 4 padded characters.
+ *
+ ****************************************************************************/
+
+static FAR unsigned char *base64_encode_tail(FAR const char *tab, char ch,
+                                             FAR const unsigned char *in,
+                                             size_t len,
+                                             FAR unsigned char *pos)
+{
+  *pos++ = tab[in[0] >> 2];
+  if (len == 1)
+    {
+      *pos++ = tab[(in[0] & 0x03) << 4];
+      *pos++ = ch;              /* *pos++ = '='; */
+    }
+  else
+    {
+      *pos++ = tab[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+      *pos++ = tab[(in[1] & 0x0f) << 2];
+    }
+
+  *pos++ = ch;                  /* *pos++ = '='; */
+  return pos;
 }
 
 /****************************************************************************
@@ -108,8 +199,6 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
 {
   FAR unsigned char *out;
   FAR unsigned char *pos;
-  FAR const unsigned char *end;
-  FAR const unsigned char *in;
   FAR const char *base64_table;
   char ch = '=';
   size_t olen;
@@ -119,49 +208,27 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
       ch = '.';
     }
 
-  base64_table = base64_tab(websafe);
+  base64_table = websafe ? g_base64w_tab : g_base64_tab;
   olen = (len + 2) / 3 * 4 + 1; /* 3-byte blocks to 4-byte */
 
-  end = src + len;
-  in = src;
-
   if (dst)
     {
-      pos = out = dst;
+      out = dst;
     }
   else
     {
-      pos = out = malloc(olen);
+      out = malloc(olen);
       if (out == NULL)
         {
           return NULL;
         }
     }
 
-  while (end - in >= 3)
-    {
-      *pos++ = base64_table[in[0] >> 2];
-      *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-      *pos++ = base64_table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
-      *pos++ = base64_table[in[2] & 0x3f];
-      in += 3;
-    }
-
-  if (end - in != 0)
+  pos = base64_encode_blocks(base64_table, src, len / 3, out);
+  if (len % 3 != 0)
     {
-      *pos++ = base64_table[in[0] >> 2];
-      if (end - in == 1)
-        {
-          *pos++ = base64_table[(in[0] & 0x03) << 4];
-          *pos++ = ch;          /* *pos++ = '='; */
-        }
-      else
-        {
-          *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-          *pos++ = base64_table[(in[1] & 0x0f) << 2];
-        }
-
-      *pos++ = ch;              /* *pos++ = '='; */
+      pos = base64_encode_tail(base64_table, ch, src + len / 3 * 3,
+                               len % 3, pos);
     }
 
   *pos = '\0';
@@ -179,7 +246,9 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
  * Description:
  *   Base64 decode
  *
- * Caller is responsible for freeing the returned buffer.
+ *   Caller is responsible for freeing the returned buffer.  Each group of
+ *   4 characters is read before its 3 bytes are written, so dst may be the
+ *   same buffer as src.
  *
  * Input Parameters:
  *   src:     Data to be decoded
@@ -198,19 +267,17 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
 {
   FAR unsigned char *out;
   FAR unsigned char *pos;
-  FAR unsigned char block[4];
-  FAR const char *base64_table;
+  FAR const uint8_t *dec;
+  FAR const unsigned char *end;
+  uint32_t word;
   char ch = '=';
-  FAR char *tmp;
-  size_t count;
-  size_t i;
 
   if (websafe)
     {
       ch = '.';
     }
 
-  base64_table = base64_tab(websafe);
+  dec = websafe ? g_base64w_dec : g_base64_dec;
 
   if (dst)
     {
@@ -225,30 +292,31 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
         }
     }
 
-  count = 0;
-  for (i = 0; i < len; i++)
+  /* A trailing partial group is ignored, decoding stops at the first group
+   * with padding.
+   */
+
+  end = src + len / 4 * 4;
+  for (; src < end; src += 4)
     {
-      tmp = strchr(base64_table, src[i]);
-      block[count] = tmp ? tmp - base64_table : 0;
-      count++;
+      word = (uint32_t)dec[src[0]] << 18 | (uint32_t)dec[src[1]] << 12 |
+             (uint32_t)dec[src[2]] << 6 | dec[src[3]];
 
-      if (count == 4)
+      if (src[2] == ch || src[3] == ch)
         {
-          *pos++ = (block[0] << 2) | (block[1] >> 4);
-          if (src[i - 1] == ch)
-            {
-              break;
-            }
-
-          *pos++ = (block[1] << 4) | (block[2] >> 2);
-          if (src[i] == ch)
+          *pos++ = word >> 16;
+          if (src[2] != ch)
             {
-              break;
+              *pos++ = word >> 8;
             }
 
-          *pos++ = (block[2] << 6) | block[3];
-          count = 0;
+          break;
         }
+
+      pos[0] = word >> 16;
+      pos[1] = word >> 8;
+      pos[2] = word;
+      pos   += 3;
     }
 
   *out_len = pos - out;
@@ -317,4 +385,103 @@ FAR void *base64w_decode(FAR const void *src, size_t len, FAR void *dst,
   return _base64_decode(src, len, dst, out_len, true);
 }
 
+/****************************************************************************
+ * Name: base64_decode_inplace
+ ****************************************************************************/
+
+size_t base64_decode_inplace(FAR void *buf, size_t len)
+{
+  size_t out_len;
+
+  _base64_decode(buf, len, buf, &out_len, false);
+  return out_len;
+}
+
+/****************************************************************************
+ * Name: base64w_decode_inplace
+ ****************************************************************************/
+
+size_t base64w_decode_inplace(FAR void *buf, size_t len)
+{
+  size_t out_len;
+
+  _base64_decode(buf, len, buf, &out_len, true);
+  return out_len;
+}
+
+/****************************************************************************
+ * Name: base64_encoder_init
+ ****************************************************************************/
+
+void base64_encoder_init(FAR struct base64_encoder_s *enc, bool websafe)
+{
+  enc->nleft   = 0;
+  enc->websafe = websafe;
+}
+
+/****************************************************************************
+ * Name: base64_encoder_update
+ ****************************************************************************/
+
+size_t base64_encoder_update(FAR struct base64_encoder_s *enc,
+                             FAR const void *src, size_t len,
+                             FAR void *dst)
+{
+  FAR const unsigned char *in = src;
+  FAR unsigned char *pos = dst;
+  FAR const char *base64_table;
+  size_t n;
+
+  base64_table = enc->websafe ? g_base64w_tab : g_base64_tab;
+
+  /* Complete the group left over from the previous call first */
+
+  if (enc->nleft > 0)
+    {
+      while (enc->nleft < 3 && len > 0)
+        {
+          enc->left[enc->nleft++] = *in++;
+          len--;
+        }
+
+      if (enc->nleft < 3)
+        {
+          return 0;
+        }
+
+      pos = base64_encode_blocks(base64_table, enc->left, 1, pos);
+      enc->nleft = 0;
+    }
+
+  n   = len / 3;
+  pos = base64_encode_blocks(base64_table, in, n, pos);
+  in += n * 3;
+  len -= n * 3;
+
+  memcpy(enc->left, in, len);
+  enc->nleft = len;
+
+  return pos - (FAR unsigned char *)dst;
+}
+
+/****************************************************************************
+ * Name: base64_encoder_final
+ ****************************************************************************/
+
+size_t base64_encoder_final(FAR struct base64_encoder_s *enc,
+                            FAR void *dst)
+{
+  FAR unsigned char *pos = dst;
+
+  if (enc->nleft > 0)
+    {
+      pos = base64_encode_tail(enc->websafe ? g_base64w_tab : g_base64_tab,
+                               enc->websafe ? '.' : '=', enc->left,
+                               enc->nleft, pos);
+      enc->nleft = 0;
+    }
+
+  return pos - (FAR unsigned char *)dst;
+}
+
 #endif /* CONFIG_CODECS_BASE64 */
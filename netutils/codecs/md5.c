@@ -119,6 +119,46 @@ static void byte_reverse(FAR unsigned char *buf, unsigned longs)
 }
 #endif
 
+/****************************************************************************
+ * Name: md5_block
+ *
+ * Description:
+ *   Transform one 64-byte block of the caller's data.  The words are read
+ *   straight from the data when its byte order and alignment allow it,
+ *   otherwise they are assembled in one pass instead of a copy followed by
+ *   byte_reverse().
+ *
+ ****************************************************************************/
+
+static void md5_block(FAR struct md5_context_s *ctx,
+                      FAR const unsigned char *buf)
+{
+#ifdef CONFIG_ENDIAN_BIG
+  uint32_t in[16];
+  int i;
+
+  for (i = 0; i < 16; i++, buf += 4)
+    {
+      in[i] = ((uint32_t)buf[3] << 24) |
+              ((uint32_t)buf[2] << 16) |
+              ((uint32_t)buf[1] << 8)  |
+               (uint32_t)buf[0];
+    }
+
+  md5_transform(ctx->buf, in);
+#else
+  if (((uintptr_t)buf & 3) == 0)
+    {
+      md5_transform(ctx->buf, (FAR const uint32_t *)buf);
+    }
+  else
+    {
+      memcpy(ctx->in, buf, 64);
+      md5_transform(ctx->buf, (FAR uint32_t *)ctx->in);
+    }
+#endif
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -197,9 +237,7 @@ void md5_update(struct md5_context_s *ctx, unsigned char const *buf,
 
   while (len >= 64)
     {
-      memcpy(ctx->in, buf, 64);
-      byte_reverse(ctx->in, 16);
-      md5_transform(ctx->buf, (uint32_t *)ctx->in);
+      md5_block(ctx, buf);
       buf += 64;
       len -= 64;
     }
@@ -47,6 +47,7 @@
 #include <sys/ioctl.h>
 
 #include <inttypes.h>
+#include <fcntl.h>
 #include <sched.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -152,6 +153,17 @@
 #  define CONFIG_NETUTILS_DHCPD_MAXLEASES 16
 #endif
 
+#if CONFIG_NETUTILS_DHCPD_MAXLEASES > 65534
+#  error CONFIG_NETUTILS_DHCPD_MAXLEASES is limited to 65534
+#endif
+
+/* The leases are found by MAC address through a hash table of
+ * DHCPD_HASHSIZE buckets, and the free ones through a bitmap.
+ */
+
+#define DHCPD_HASHSIZE  CONFIG_NETUTILS_DHCPD_MAXLEASES
+#define DHCPD_MAPWORDS  ((CONFIG_NETUTILS_DHCPD_MAXLEASES + 31) / 32)
+
 #ifndef CONFIG_NETUTILS_DHCPD_STARTIP
 #  define CONFIG_NETUTILS_DHCPD_STARTIP (10L<<24|0L<<16|0L<<16|2L)
 #endif
@@ -188,6 +200,21 @@
 #  define HAVE_LEASE_TIME 1
 #endif
 
+/* The journal keeps the lease expiration times */
+
+#undef HAVE_JOURNAL
+#if defined(CONFIG_NETUTILS_DHCPD_JOURNAL) && defined(HAVE_LEASE_TIME)
+#  define HAVE_JOURNAL 1
+#  ifndef CONFIG_NETUTILS_DHCPD_JOURNAL_PATH
+#    define CONFIG_NETUTILS_DHCPD_JOURNAL_PATH "/data/dhcpd.leases"
+#  endif
+#  ifndef CONFIG_NETUTILS_DHCPD_JOURNAL_MAXRECORDS
+#    define CONFIG_NETUTILS_DHCPD_JOURNAL_MAXRECORDS 256
+#  endif
+#  define DHCPD_JOURNAL_MAGIC     0x4c434844 /* "DHCL" */
+#  define DHCPD_JOURNAL_BATCH     16         /* Records per write */
+#endif
+
 #define g_state  (*g_dhcpd_daemon.ds_data)
 
 /****************************************************************************
@@ -196,18 +223,34 @@
 
 /* This structure describes one element in the lease table. There is one
  * slot in the lease table for each assign-able IP address (hence, the IP
- * address itself does not have to be in the table.
+ * address itself does not have to be in the table.  Whether the address is
+ * allocated is kept in the ds_allocmap bitmap.
  */
 
 struct lease_s
 {
   uint8_t  mac[DHCP_HLEN_ETHERNET]; /* MAC address (network order) -- could be larger! */
-  bool     allocated;               /* true: IP address is allocated */
+  uint16_t next;                    /* Next lease + 1 in MAC hash bucket */
 #ifdef HAVE_LEASE_TIME
   time_t   expiry;                  /* Lease expiration time (seconds past Epoch) */
 #endif
 };
 
+#ifdef HAVE_JOURNAL
+/* One record of the lease journal.  The file starts with
+ * DHCPD_JOURNAL_MAGIC and a later record of an address replaces the
+ * earlier ones.
+ */
+
+struct dhcpd_journal_s
+{
+  uint32_t ipaddr;                  /* Leased IP address (host order) */
+  uint32_t expiry;                  /* Lease expiration time, 0: released */
+  uint8_t  mac[DHCP_HLEN_ETHERNET]; /* MAC address, zero if declined */
+  uint8_t  reserved[2];
+};
+#endif
+
 struct dhcpmsg_s
 {
   uint8_t  op;
@@ -265,6 +308,14 @@ struct dhcpd_state_s
   /* Leases */
 
   struct lease_s   ds_leases[CONFIG_NETUTILS_DHCPD_MAXLEASES];
+  uint16_t         ds_machash[DHCPD_HASHSIZE];  /* First lease + 1, 0: none */
+  uint32_t         ds_allocmap[DHCPD_MAPWORDS]; /* Allocated leases */
+  int              ds_cursor;                   /* Next lease to allocate */
+
+#ifdef HAVE_JOURNAL
+  int              ds_journalfd;                /* Journal, -1: not open */
+  int              ds_journalrecs;              /* Appended since compacted */
+#endif
 };
 
 /* This type describes the state of the DHCPD client daemon.  Only one
@@ -304,6 +355,8 @@ static const uint8_t        g_magiccookie[4] =
   99, 130, 83, 99
 };
 
+static const uint8_t        g_nullmac[DHCP_HLEN_ETHERNET];
+
 /* This type describes the state of the DHCPD client daemon.  Only one
  * instance of the DHCPD daemon is permitted in this implementation.  This
  * limitation is due only to this global data structure.
@@ -387,6 +440,95 @@ static time_t dhcpd_time(void)
 #  define dhcpd_time() (0)
 #endif
 
+/****************************************************************************
+ * Name: dhcpd_machash
+ ****************************************************************************/
+
+static unsigned int dhcpd_machash(FAR const uint8_t *mac)
+{
+  uint32_t hash = 2166136261u;
+  int i;
+
+  /* FNV-1a */
+
+  for (i = 0; i < DHCP_HLEN_ETHERNET; i++)
+    {
+      hash ^= mac[i];
+      hash *= 16777619u;
+    }
+
+  return hash % DHCPD_HASHSIZE;
+}
+
+/****************************************************************************
+ * Name: dhcpd_setmac
+ *
+ * Description:
+ *   Change the MAC address of a lease, keeping the MAC hash up to date.
+ *   Only leases with a non-zero MAC address are in the hash.
+ *
+ ****************************************************************************/
+
+static void dhcpd_setmac(FAR struct lease_s *lease, FAR const uint8_t *mac)
+{
+  uint16_t ndx = lease - g_state.ds_leases + 1;
+  FAR uint16_t *link;
+
+  if (memcmp(lease->mac, g_nullmac, DHCP_HLEN_ETHERNET) != 0)
+    {
+      link = &g_state.ds_machash[dhcpd_machash(lease->mac)];
+      while (*link != ndx)
+        {
+          link = &g_state.ds_leases[*link - 1].next;
+        }
+
+      *link = lease->next;
+      lease->next = 0;
+    }
+
+  memcpy(lease->mac, mac, DHCP_HLEN_ETHERNET);
+
+  if (memcmp(mac, g_nullmac, DHCP_HLEN_ETHERNET) != 0)
+    {
+      link = &g_state.ds_machash[dhcpd_machash(mac)];
+      lease->next = *link;
+      *link = ndx;
+    }
+}
+
+/****************************************************************************
+ * Name: dhcpd_isallocated
+ ****************************************************************************/
+
+static inline bool dhcpd_isallocated(int ndx)
+{
+  return (g_state.ds_allocmap[ndx >> 5] & (1u << (ndx & 31))) != 0;
+}
+
+/****************************************************************************
+ * Name: dhcpd_markallocated
+ ****************************************************************************/
+
+static inline void dhcpd_markallocated(int ndx)
+{
+  g_state.ds_allocmap[ndx >> 5] |= 1u << (ndx & 31);
+}
+
+/****************************************************************************
+ * Name: dhcpd_freelease
+ ****************************************************************************/
+
+static void dhcpd_freelease(FAR struct lease_s *lease)
+{
+  int ndx = lease - g_state.ds_leases;
+
+  dhcpd_setmac(lease, g_nullmac);
+#ifdef HAVE_LEASE_TIME
+  lease->expiry = 0;
+#endif
+  g_state.ds_allocmap[ndx >> 5] &= ~(1u << (ndx & 31));
+}
+
 /****************************************************************************
  * Name: dhcpd_leaseexpired
  ****************************************************************************/
@@ -400,7 +542,7 @@ static inline bool dhcpd_leaseexpired(struct lease_s *lease)
     }
   else
     {
-      memset(lease, 0, sizeof(struct lease_s));
+      dhcpd_freelease(lease);
       return true;
     }
 }
@@ -431,8 +573,8 @@ struct lease_s *dhcpd_setlease(const uint8_t *mac,
   if (ndx >= 0 && ndx < CONFIG_NETUTILS_DHCPD_MAXLEASES)
     {
        ret = &g_state.ds_leases[ndx];
-       memcpy(ret->mac, mac, DHCP_HLEN_ETHERNET);
-       ret->allocated = true;
+       dhcpd_setmac(ret, mac);
+       dhcpd_markallocated(ndx);
 #ifdef HAVE_LEASE_TIME
        ret->expiry = dhcpd_time() + expiry;
 #endif
@@ -459,14 +601,19 @@ static inline in_addr_t dhcp_leaseipaddr(FAR struct lease_s *lease)
 
 static FAR struct lease_s *dhcpd_findbymac(FAR const uint8_t *mac)
 {
-  int i;
+  FAR struct lease_s *lease;
+  uint16_t ndx;
 
-  for (i = 0; i < CONFIG_NETUTILS_DHCPD_MAXLEASES; i++)
+  ndx = g_state.ds_machash[dhcpd_machash(mac)];
+  while (ndx != 0)
     {
-      if (memcmp(g_state.ds_leases[i].mac, mac, DHCP_HLEN_ETHERNET) == 0)
+      lease = &g_state.ds_leases[ndx - 1];
+      if (memcmp(lease->mac, mac, DHCP_HLEN_ETHERNET) == 0)
         {
-          return &(g_state.ds_leases[i]);
+          return lease;
         }
+
+      ndx = lease->next;
     }
 
   return NULL;
@@ -481,11 +628,11 @@ static FAR struct lease_s *dhcpd_findbyipaddr(in_addr_t ipaddr)
   if (ipaddr >= g_dhcpd_config.ds_startip &&
       ipaddr <= g_dhcpd_config.ds_endip)
     {
-      FAR struct lease_s *lease =
-        &g_state.ds_leases[ipaddr - g_dhcpd_config.ds_startip];
-      if (lease->allocated > 0)
+      int ndx = ipaddr - g_dhcpd_config.ds_startip;
+
+      if (dhcpd_isallocated(ndx))
         {
-          return lease;
+          return &g_state.ds_leases[ndx];
         }
     }
 
@@ -493,49 +640,307 @@ static FAR struct lease_s *dhcpd_findbyipaddr(in_addr_t ipaddr)
 }
 
 /****************************************************************************
- * Name: dhcpd_allocipaddr
+ * Name: dhcpd_validipaddr
  ****************************************************************************/
 
-static in_addr_t dhcpd_allocipaddr(void)
+static inline bool dhcpd_validipaddr(in_addr_t ipaddr)
 {
-  struct lease_s *lease = NULL;
-  in_addr_t ipaddr, startaddr;
+  /* Skip over address ending in 0 or 255 */
 
-  ipaddr = startaddr = g_dhcpd_config.ds_startip;
-  for (; ipaddr <= g_dhcpd_config.ds_endip; ipaddr++)
+  return (ipaddr & 0xff) != 0 && (ipaddr & 0xff) != 0xff;
+}
+
+/****************************************************************************
+ * Name: dhcpd_findfree
+ *
+ * Description:
+ *   Find the first address that is not allocated from the allocation
+ *   cursor on, skipping full words of the bitmap.  Starting after the last
+ *   allocated address hands out every address before reusing a released
+ *   one.
+ *
+ ****************************************************************************/
+
+static int dhcpd_findfree(void)
+{
+  int ndx = g_state.ds_cursor;
+  int n = 0;
+
+  while (n < CONFIG_NETUTILS_DHCPD_MAXLEASES)
     {
-      /* Skip over address ending in 0 or 255 */
+      if (ndx >= CONFIG_NETUTILS_DHCPD_MAXLEASES)
+        {
+          ndx = 0;
+        }
 
-      if ((ipaddr & 0xff) == 0 || (ipaddr & 0xff) == 0xff)
+      if ((ndx & 31) == 0 && g_state.ds_allocmap[ndx >> 5] == UINT32_MAX)
         {
+          ndx += 32;
+          n   += 32;
           continue;
         }
 
-      /* Is there already a lease on this address?  If so, has it expired? */
+      if (!dhcpd_isallocated(ndx) &&
+          dhcpd_validipaddr(g_dhcpd_config.ds_startip + ndx))
+        {
+          return ndx;
+        }
+
+      ndx++;
+      n++;
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: dhcpd_allocipaddr
+ ****************************************************************************/
+
+static in_addr_t dhcpd_allocipaddr(void)
+{
+  int ndx;
+
+  ndx = dhcpd_findfree();
 
-      lease = dhcpd_findbyipaddr(ipaddr);
-      if ((!lease || dhcpd_leaseexpired(lease)))
+#ifdef HAVE_LEASE_TIME
+  /* All addresses are allocated, so reclaim the first expired lease.  Only
+   * this case looks at every lease.
+   */
+
+  if (ndx < 0)
+    {
+      int i;
+
+      for (i = 0; i < CONFIG_NETUTILS_DHCPD_MAXLEASES; i++)
         {
+          if (dhcpd_isallocated(i) &&
+              dhcpd_validipaddr(g_dhcpd_config.ds_startip + i) &&
+              dhcpd_leaseexpired(&g_state.ds_leases[i]))
+            {
+              ndx = i;
+              break;
+            }
+        }
+    }
+#endif
+
+  if (ndx < 0)
+    {
+      return 0;
+    }
+
 #ifdef CONFIG_CPP_HAVE_WARNING
 #  warning "FIXME: Should check if anything responds to an ARP request or ping"
 #  warning "       to verify that there is no other user of this IP address"
 #endif
-          memset(g_state.ds_leases[ipaddr - startaddr].mac,
-          0, DHCP_HLEN_ETHERNET);
-          g_state.ds_leases[ipaddr - startaddr].allocated = true;
+
+  /* A free lease has no MAC address */
+
+  dhcpd_markallocated(ndx);
 #ifdef HAVE_LEASE_TIME
-          g_state.ds_leases[ipaddr - startaddr].expiry =
-            dhcpd_time() + CONFIG_NETUTILS_DHCPD_OFFERTIME;
+  g_state.ds_leases[ndx].expiry =
+    dhcpd_time() + CONFIG_NETUTILS_DHCPD_OFFERTIME;
 #endif
-          /* Return the address in host order */
+  g_state.ds_cursor = ndx + 1;
+
+  /* Return the address in host order */
 
-          return ipaddr;
+  return g_dhcpd_config.ds_startip + ndx;
+}
+
+/****************************************************************************
+ * Name: dhcpd_journal_compact
+ *
+ * Description:
+ *   Rewrite the journal with one record per live lease, then reopen it
+ *   to append.  The new journal replaces the old one only once complete.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_JOURNAL
+static void dhcpd_journal_compact(void)
+{
+  struct dhcpd_journal_s recs[DHCPD_JOURNAL_BATCH];
+  uint32_t magic = DHCPD_JOURNAL_MAGIC;
+  time_t now = dhcpd_time();
+  size_t size;
+  int nrecs = 0;
+  int fd;
+  int i;
+
+  if (g_state.ds_journalfd >= 0)
+    {
+      close(g_state.ds_journalfd);
+      g_state.ds_journalfd = -1;
+    }
+
+  fd = open(CONFIG_NETUTILS_DHCPD_JOURNAL_PATH ".tmp",
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    {
+      nerr("ERROR: Failed to create the lease journal: %d\n", errno);
+      return;
+    }
+
+  if (write(fd, &magic, sizeof(magic)) != sizeof(magic))
+    {
+      goto errout;
+    }
+
+  memset(recs, 0, sizeof(recs));
+  for (i = 0; i < CONFIG_NETUTILS_DHCPD_MAXLEASES; i++)
+    {
+      FAR struct lease_s *lease = &g_state.ds_leases[i];
+
+      if (dhcpd_isallocated(i) && lease->expiry > now)
+        {
+          recs[nrecs].ipaddr = g_dhcpd_config.ds_startip + i;
+          recs[nrecs].expiry = lease->expiry;
+          memcpy(recs[nrecs].mac, lease->mac, DHCP_HLEN_ETHERNET);
+          nrecs++;
         }
+
+      if (nrecs == DHCPD_JOURNAL_BATCH ||
+          (nrecs > 0 && i == CONFIG_NETUTILS_DHCPD_MAXLEASES - 1))
+        {
+          size = nrecs * sizeof(struct dhcpd_journal_s);
+          if (write(fd, recs, size) != (ssize_t)size)
+            {
+              goto errout;
+            }
+
+          nrecs = 0;
+        }
+    }
+
+  close(fd);
+  if (rename(CONFIG_NETUTILS_DHCPD_JOURNAL_PATH ".tmp",
+             CONFIG_NETUTILS_DHCPD_JOURNAL_PATH) < 0)
+    {
+      nerr("ERROR: Failed to replace the lease journal: %d\n", errno);
+      return;
     }
 
-  return 0;
+  g_state.ds_journalfd = open(CONFIG_NETUTILS_DHCPD_JOURNAL_PATH,
+                              O_WRONLY | O_APPEND | O_CLOEXEC);
+  g_state.ds_journalrecs = 0;
+  return;
+
+errout:
+  nerr("ERROR: Failed to write the lease journal: %d\n", errno);
+  close(fd);
+  unlink(CONFIG_NETUTILS_DHCPD_JOURNAL_PATH ".tmp");
 }
 
+/****************************************************************************
+ * Name: dhcpd_journal_write
+ *
+ * Description:
+ *   Append the state of a lease to the journal.
+ *
+ ****************************************************************************/
+
+static void dhcpd_journal_write(FAR struct lease_s *lease)
+{
+  struct dhcpd_journal_s rec;
+  int ndx = lease - g_state.ds_leases;
+
+  if (g_state.ds_journalfd < 0)
+    {
+      return;
+    }
+
+  memset(&rec, 0, sizeof(rec));
+  rec.ipaddr = g_dhcpd_config.ds_startip + ndx;
+  rec.expiry = dhcpd_isallocated(ndx) ? lease->expiry : 0;
+  memcpy(rec.mac, lease->mac, DHCP_HLEN_ETHERNET);
+
+  if (write(g_state.ds_journalfd, &rec, sizeof(rec)) != sizeof(rec))
+    {
+      nerr("ERROR: Failed to write the lease journal: %d\n", errno);
+      close(g_state.ds_journalfd);
+      g_state.ds_journalfd = -1;
+      return;
+    }
+
+  if (++g_state.ds_journalrecs > CONFIG_NETUTILS_DHCPD_JOURNAL_MAXRECORDS)
+    {
+      dhcpd_journal_compact();
+    }
+}
+
+/****************************************************************************
+ * Name: dhcpd_journal_load
+ *
+ * Description:
+ *   Restore the leases that have not expired from the journal, then
+ *   compact it.
+ *
+ ****************************************************************************/
+
+static void dhcpd_journal_load(void)
+{
+  struct dhcpd_journal_s rec;
+  uint32_t magic;
+  time_t now = dhcpd_time();
+  int ndx;
+  int fd;
+
+  g_state.ds_journalfd = -1;
+
+  fd = open(CONFIG_NETUTILS_DHCPD_JOURNAL_PATH, O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      if (read(fd, &magic, sizeof(magic)) == sizeof(magic) &&
+          magic == DHCPD_JOURNAL_MAGIC)
+        {
+          while (read(fd, &rec, sizeof(rec)) == sizeof(rec))
+            {
+              if (rec.ipaddr < g_dhcpd_config.ds_startip ||
+                  rec.ipaddr > g_dhcpd_config.ds_endip)
+                {
+                  continue;
+                }
+
+              ndx = rec.ipaddr - g_dhcpd_config.ds_startip;
+              if (rec.expiry > now)
+                {
+                  dhcpd_setmac(&g_state.ds_leases[ndx], rec.mac);
+                  dhcpd_markallocated(ndx);
+                  g_state.ds_leases[ndx].expiry = rec.expiry;
+                }
+              else if (dhcpd_isallocated(ndx))
+                {
+                  dhcpd_freelease(&g_state.ds_leases[ndx]);
+                }
+            }
+        }
+
+      close(fd);
+    }
+
+  dhcpd_journal_compact();
+}
+
+/****************************************************************************
+ * Name: dhcpd_journal_close
+ ****************************************************************************/
+
+static void dhcpd_journal_close(void)
+{
+  if (g_state.ds_journalfd >= 0)
+    {
+      close(g_state.ds_journalfd);
+      g_state.ds_journalfd = -1;
+    }
+}
+#else
+#  define dhcpd_journal_write(lease)
+#  define dhcpd_journal_load()
+#  define dhcpd_journal_close()
+#endif
+
 /****************************************************************************
  * Name: dhcpd_parseoptions
  ****************************************************************************/
@@ -1106,6 +1511,7 @@ static int dhcpd_sendnak(int sockfd)
 int dhcpd_sendack(int sockfd, in_addr_t ipaddr)
 {
   uint32_t leasetime = CONFIG_NETUTILS_DHCPD_LEASETIME;
+  FAR struct lease_s *lease;
   in_addr_t netaddr;
 #ifdef HAVE_DNSIP
   uint32_t dnsaddr;
@@ -1150,7 +1556,12 @@ int dhcpd_sendack(int sockfd, in_addr_t ipaddr)
       return ERROR;
     }
 
-  dhcpd_setlease(g_state.ds_inpacket.chaddr, ipaddr, leasetime);
+  lease = dhcpd_setlease(g_state.ds_inpacket.chaddr, ipaddr, leasetime);
+  if (lease != NULL)
+    {
+      dhcpd_journal_write(lease);
+    }
+
   return OK;
 }
 
@@ -1409,10 +1820,11 @@ static inline int dhcpd_decline(void)
        * address for a period of time.
        */
 
-      memset(lease->mac, 0, DHCP_HLEN_ETHERNET);
+      dhcpd_setmac(lease, g_nullmac);
 #ifdef HAVE_LEASE_TIME
       lease->expiry = dhcpd_time() + CONFIG_NETUTILS_DHCPD_DECLINETIME;
 #endif
+      dhcpd_journal_write(lease);
     }
 
   return OK;
@@ -1429,7 +1841,8 @@ static inline int dhcpd_release(void)
     {
       /* Release the IP address now */
 
-      memset(lease, 0, sizeof(struct lease_s));
+      dhcpd_freelease(lease);
+      dhcpd_journal_write(lease);
     }
 
   return OK;
@@ -1532,6 +1945,10 @@ int dhcpd_run(FAR const char *interface)
 
   memset(g_dhcpd_daemon.ds_data, 0, sizeof(struct dhcpd_state_s));
 
+  /* Restore the leases from before a restart */
+
+  dhcpd_journal_load();
+
   /* Update the pid if running in daemon mode */
 
   g_dhcpd_daemon.ds_pid = getpid();
@@ -1625,6 +2042,7 @@ int dhcpd_run(FAR const char *interface)
         }
     }
 
+  dhcpd_journal_close();
   free(g_dhcpd_daemon.ds_data);
   g_dhcpd_daemon.ds_data = NULL;
   g_dhcpd_daemon.ds_pid   = -1;
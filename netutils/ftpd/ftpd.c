@@ -47,6 +47,9 @@
 
 #include <sys/socket.h>
 #include <sys/stat.h>
+#ifdef CONFIG_FTPD_SENDFILE
+#  include <sys/sendfile.h>
+#endif
 
 #include <stdint.h>
 #include <stdio.h>
@@ -137,6 +140,9 @@ static int ftpd_getpath(FAR struct ftpd_session_s *session,
 static int ftpd_changedir(FAR struct ftpd_session_s *session,
                           FAR const char *rempath);
 static off_t ftpd_offsatoi(FAR const char *filename, off_t offset);
+#ifdef CONFIG_FTPD_SENDFILE
+static int ftpd_sendfile(FAR struct ftpd_session_s *session);
+#endif
 static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype);
 static uint8_t ftpd_listoption(FAR char **param);
 static int ftpd_listbuffer(FAR struct ftpd_session_s *session,
@@ -189,10 +195,18 @@ static int ftpd_command(FAR struct ftpd_session_s *session);
 /* Worker thread */
 
 static int ftpd_startworker(pthread_startroutine_t handler, FAR void *arg,
-                            size_t stacksize);
+                            size_t stacksize, FAR pthread_t *threadid);
 static void ftpd_freesession(FAR struct ftpd_session_s *session);
 static void ftpd_workersetup(FAR struct ftpd_session_s *session);
+static void ftpd_serve(FAR struct ftpd_session_s *session);
 static FAR void *ftpd_worker(FAR void *arg);
+#if CONFIG_FTPD_WORKERS > 0
+static FAR void *ftpd_poolworker(FAR void *arg);
+static int ftpd_poolstart(FAR struct ftpd_server_s *server);
+static int ftpd_poolsubmit(FAR struct ftpd_server_s *server,
+                           FAR struct ftpd_session_s *session);
+static void ftpd_poolstop(FAR struct ftpd_server_s *server);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -1168,6 +1182,11 @@ static FAR struct ftpd_server_s *ftpd_openserver(int port,
   server->head = NULL;
   server->tail = NULL;
 
+#if CONFIG_FTPD_WORKERS > 0
+  pthread_mutex_init(&server->lock, NULL);
+  pthread_cond_init(&server->cond, NULL);
+#endif
+
   /* Create the server listen socket */
 
 #ifdef CONFIG_NET_IPv6
@@ -1233,6 +1252,17 @@ static FAR struct ftpd_server_s *ftpd_openserver(int port,
       return NULL;
     }
 
+#if CONFIG_FTPD_WORKERS > 0
+  /* Start the session worker pool */
+
+  ret = ftpd_poolstart(server);
+  if (ret < 0)
+    {
+      ftpd_close((FTPD_SESSION)server);
+      return NULL;
+    }
+#endif
+
   return (FTPD_SESSION)server;
 }
 
@@ -1758,6 +1788,66 @@ static off_t ftpd_offsatoi(FAR const char *filename, off_t offset)
   return ret;
 }
 
+#ifdef CONFIG_FTPD_SENDFILE
+/****************************************************************************
+ * Name: ftpd_sendfile
+ *
+ * Description:
+ *   Send the rest of session->fd to the data connection with sendfile().
+ *   Returns zero when the whole file was sent, -ENOSYS if sendfile() is not
+ *   supported for this file and nothing was sent (the caller should fall
+ *   back to the buffered copy), or another negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int ftpd_sendfile(FAR struct ftpd_session_s *session)
+{
+  bool sent = false;
+  ssize_t nsent;
+  int ret;
+
+  for (; ; )
+    {
+      if (session->txtimeout >= 0)
+        {
+          ret = ftpd_txpoll(session->data.sd, session->txtimeout);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      nsent = sendfile(session->data.sd, session->fd, NULL,
+                       FTPD_SENDFILE_CHUNK);
+      if (nsent < 0)
+        {
+          ret = -errno;
+          if (ret == -EINTR || ret == -EAGAIN)
+            {
+              continue;
+            }
+
+          if (!sent && (ret == -ENOSYS || ret == -EINVAL))
+            {
+              return -ENOSYS;
+            }
+
+          nerr("ERROR: sendfile() failed: %d\n", ret);
+          return ret;
+        }
+
+      if (nsent == 0)
+        {
+          /* End-of-file */
+
+          return OK;
+        }
+
+      sent = true;
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: ftpd_stream
  ****************************************************************************/
@@ -1773,6 +1863,7 @@ static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
   size_t wantsize;
   ssize_t rdbytes;
   ssize_t wrbytes;
+  ssize_t nrecvd;
   int errval = 0;
   int ret;
 
@@ -1913,6 +2004,31 @@ static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
       goto errout_with_session;
     }
 
+#ifdef CONFIG_FTPD_SENDFILE
+  /* Binary downloads do not need to pass through the data buffer */
+
+  if (cmdtype == 0 && session->type != FTPD_SESSIONTYPE_A)
+    {
+      ret = ftpd_sendfile(session);
+      if (ret == OK)
+        {
+          ftpd_response(session->cmd.sd, session->txtimeout,
+                        g_respfmt1, 226, ' ', "Transfer complete");
+          goto errout_with_session;
+        }
+      else if (ret != -ENOSYS)
+        {
+          ftpd_response(session->cmd.sd, session->txtimeout,
+                        g_respfmt1, 550, ' ', "Data send error !");
+          goto errout_with_session;
+        }
+
+      /* Not supported by this file, use the buffered copy */
+
+      ret = OK;
+    }
+#endif
+
   for (; ; )
     {
       /* Read from the source (file or TCP connection) */
@@ -1941,14 +2057,35 @@ static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
       else
         {
           /* Read from the TCP connection, ftpd_recve returns the negated
-           * error condition.
+           * error condition.  Keep receiving until the buffer is full so
+           * that the small TCP segments are coalesced into one file system
+           * write.
            */
 
-          rdbytes = ftpd_recv(session->data.sd, session->data.buffer,
-                              wantsize, session->rxtimeout);
-          if (rdbytes < 0)
+          rdbytes = 0;
+          do
             {
-              errval = -rdbytes;
+              nrecvd = ftpd_recv(session->data.sd,
+                                 &session->data.buffer[rdbytes],
+                                 wantsize - rdbytes, session->rxtimeout);
+              if (nrecvd <= 0)
+                {
+                  break;
+                }
+
+              rdbytes += nrecvd;
+            }
+          while ((size_t)rdbytes < wantsize);
+
+          /* Report a failure only if no data was received.  Otherwise the
+           * data is written first and the failure repeats on the next
+           * receive.
+           */
+
+          if (nrecvd < 0 && rdbytes == 0)
+            {
+              errval  = -nrecvd;
+              rdbytes = nrecvd;
             }
         }
 
@@ -3986,9 +4123,9 @@ static int ftpd_command(FAR struct ftpd_session_s *session)
  ****************************************************************************/
 
 static int ftpd_startworker(pthread_startroutine_t handler, FAR void *arg,
-                            size_t stacksize)
+                            size_t stacksize, FAR pthread_t *threadid)
 {
-  pthread_t threadid;
+  pthread_t detached;
   pthread_attr_t attr;
   int ret;
 
@@ -4010,18 +4147,25 @@ static int ftpd_startworker(pthread_startroutine_t handler, FAR void *arg,
       goto errout_with_attr;
     }
 
-  /* And create the thread */
+  /* And create the thread.  The caller joins the thread if it asked for
+   * the thread ID.
+   */
 
-  ret = pthread_create(&threadid, &attr, handler, arg);
-  if (ret != 0)
+  ret = pthread_create(threadid != NULL ? threadid : &detached, &attr,
+                       handler, arg);
+  if (ret != 0 || threadid != NULL)
     {
-      nerr("ERROR: pthread_create() failed: %d\n", ret);
+      if (ret != 0)
+        {
+          nerr("ERROR: pthread_create() failed: %d\n", ret);
+        }
+
       goto errout_with_attr;
     }
 
   /* Put the thread in the detached stated */
 
-  ret = pthread_detach(threadid);
+  ret = pthread_detach(detached);
   if (ret != 0)
     {
       nerr("ERROR: pthread_detach() failed: %d\n", ret);
@@ -4120,18 +4264,21 @@ static void ftpd_workersetup(FAR struct ftpd_session_s *session)
 }
 
 /****************************************************************************
- * Name: ftpd_worker
+ * Name: ftpd_serve
+ *
+ * Description:
+ *   Process the FTP commands of one session until it is closed.  The
+ *   caller frees the session.
+ *
  ****************************************************************************/
 
-static FAR void *ftpd_worker(FAR void *arg)
+static void ftpd_serve(FAR struct ftpd_session_s *session)
 {
-  FAR struct ftpd_session_s *session = (FAR struct ftpd_session_s *)arg;
   ssize_t recvbytes;
   size_t offset;
   uint8_t ch;
   int ret;
 
-  ninfo("Worker started\n");
   DEBUGASSERT(session);
 
   /* Configure the session sockets */
@@ -4145,8 +4292,7 @@ static FAR void *ftpd_worker(FAR void *arg)
   if (ret < 0)
     {
       nerr("ERROR: ftpd_response() failed: %d\n", ret);
-      ftpd_freesession(session);
-      return NULL;
+      return;
     }
 
   /* Then loop processing FTP commands */
@@ -4241,11 +4387,206 @@ static FAR void *ftpd_worker(FAR void *arg)
           break;
         }
     }
+}
 
+/****************************************************************************
+ * Name: ftpd_worker
+ ****************************************************************************/
+
+static FAR void *ftpd_worker(FAR void *arg)
+{
+  FAR struct ftpd_session_s *session = (FAR struct ftpd_session_s *)arg;
+
+  ninfo("Worker started\n");
+
+  ftpd_serve(session);
   ftpd_freesession(session);
   return NULL;
 }
 
+#if CONFIG_FTPD_WORKERS > 0
+/****************************************************************************
+ * Name: ftpd_poolworker
+ *
+ * Description:
+ *   Body of the pool worker threads.  Take the sessions queued by
+ *   ftpd_session() one at a time until ftpd_poolstop() is called.
+ *
+ ****************************************************************************/
+
+static FAR void *ftpd_poolworker(FAR void *arg)
+{
+  FAR struct ftpd_server_s *server = (FAR struct ftpd_server_s *)arg;
+  FAR struct ftpd_session_s *session;
+  int slot;
+
+  pthread_mutex_lock(&server->lock);
+  slot = server->nworkers++;
+
+  ninfo("Pool worker %d started\n", slot);
+
+  for (; ; )
+    {
+      server->nidle++;
+      while (!server->stop && server->qhead == NULL)
+        {
+          pthread_cond_wait(&server->cond, &server->lock);
+        }
+
+      server->nidle--;
+      if (server->stop)
+        {
+          break;
+        }
+
+      /* Take the oldest queued session */
+
+      session       = server->qhead;
+      server->qhead = session->flink;
+      if (server->qhead == NULL)
+        {
+          server->qtail = NULL;
+        }
+
+      server->nqueued--;
+      server->active[slot] = session;
+      pthread_mutex_unlock(&server->lock);
+
+      ftpd_serve(session);
+
+      /* Detach the session before freeing it so that ftpd_poolstop() never
+       * sees a stale pointer.
+       */
+
+      pthread_mutex_lock(&server->lock);
+      server->active[slot] = NULL;
+      pthread_mutex_unlock(&server->lock);
+
+      ftpd_freesession(session);
+      pthread_mutex_lock(&server->lock);
+    }
+
+  pthread_mutex_unlock(&server->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ftpd_poolstart
+ ****************************************************************************/
+
+static int ftpd_poolstart(FAR struct ftpd_server_s *server)
+{
+  int ret;
+  int i;
+
+  for (i = 0; i < CONFIG_FTPD_WORKERS; i++)
+    {
+      ret = ftpd_startworker(ftpd_poolworker, (FAR void *)server,
+                             CONFIG_FTPD_WORKERSTACKSIZE,
+                             &server->workers[i]);
+      if (ret < 0)
+        {
+          nerr("ERROR: ftpd_startworker() failed: %d\n", ret);
+          return ret;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftpd_poolsubmit
+ *
+ * Description:
+ *   Queue an accepted session for the pool.  Returns -EBUSY if all workers
+ *   are busy and the queue is full.
+ *
+ ****************************************************************************/
+
+static int ftpd_poolsubmit(FAR struct ftpd_server_s *server,
+                           FAR struct ftpd_session_s *session)
+{
+  pthread_mutex_lock(&server->lock);
+  if (server->nqueued >= server->nidle + CONFIG_FTPD_WORKERQUEUE)
+    {
+      pthread_mutex_unlock(&server->lock);
+      return -EBUSY;
+    }
+
+  session->flink = NULL;
+  if (server->qtail != NULL)
+    {
+      server->qtail->flink = session;
+    }
+  else
+    {
+      server->qhead = session;
+    }
+
+  server->qtail = session;
+  server->nqueued++;
+
+  pthread_cond_signal(&server->cond);
+  pthread_mutex_unlock(&server->lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftpd_poolstop
+ *
+ * Description:
+ *   Stop and join the pool workers.  Sessions in progress are shut down,
+ *   sessions that are still queued are dropped.
+ *
+ ****************************************************************************/
+
+static void ftpd_poolstop(FAR struct ftpd_server_s *server)
+{
+  FAR struct ftpd_session_s *session;
+  int i;
+
+  pthread_mutex_lock(&server->lock);
+  server->stop = true;
+
+  for (i = 0; i < CONFIG_FTPD_WORKERS; i++)
+    {
+      session = server->active[i];
+      if (session != NULL)
+        {
+          shutdown(session->cmd.sd, SHUT_RDWR);
+          if (session->data.sd >= 0)
+            {
+              shutdown(session->data.sd, SHUT_RDWR);
+            }
+        }
+    }
+
+  while ((session = server->qhead) != NULL)
+    {
+      server->qhead = session->flink;
+      ftpd_freesession(session);
+    }
+
+  server->qtail   = NULL;
+  server->nqueued = 0;
+
+  pthread_cond_broadcast(&server->cond);
+  pthread_mutex_unlock(&server->lock);
+
+  for (i = 0; i < CONFIG_FTPD_WORKERS; i++)
+    {
+      if (server->workers[i] != 0)
+        {
+          pthread_join(server->workers[i], NULL);
+          server->workers[i] = 0;
+        }
+    }
+
+  pthread_mutex_destroy(&server->lock);
+  pthread_cond_destroy(&server->cond);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -4355,7 +4696,9 @@ errout:
  *   Execute the FTPD server.  This thread does not return until either (1)
  *   the timeout expires with no connection, (2) some other error occurs, or
  *   (2) a connection was accepted and an FTP worker thread was started to
- *   service the session.
+ *   service the session.  With CONFIG_FTPD_WORKERS the session is queued
+ *   for the worker pool instead; it is refused with -EBUSY if the pool and
+ *   its queue are full.
  *
  * Input Parameters:
  *   handle - A handle previously returned by ftpd_open
@@ -4458,15 +4801,28 @@ int ftpd_session(FTPD_SESSION handle, int timeout)
       goto errout_with_session;
     }
 
+#if CONFIG_FTPD_WORKERS > 0
+  /* Hand the session to the worker pool */
+
+  ret = ftpd_poolsubmit(server, session);
+  if (ret < 0)
+    {
+      nwarn("WARNING: All workers busy, refusing session\n");
+      ftpd_response(session->cmd.sd, 0, g_respfmt1, 421, ' ',
+                    "Too many users, try again later");
+      goto errout_with_session;
+    }
+#else
   /* And create a worker thread to service the session */
 
   ret = ftpd_startworker(ftpd_worker, (FAR void *)session,
-                         CONFIG_FTPD_WORKERSTACKSIZE);
+                         CONFIG_FTPD_WORKERSTACKSIZE, NULL);
   if (ret < 0)
     {
       nerr("ERROR: ftpd_startworker() failed: %d\n", ret);
       goto errout_with_session;
     }
+#endif
 
   /* Successfully connected an launched the worker thread */
 
@@ -4498,6 +4854,11 @@ void ftpd_close(FTPD_SESSION handle)
   DEBUGASSERT(handle);
 
   server = (struct ftpd_server_s *)handle;
+
+#if CONFIG_FTPD_WORKERS > 0
+  ftpd_poolstop(server);
+#endif
+
   if (server->head != NULL)
     {
       ftpd_account_free(server->head);
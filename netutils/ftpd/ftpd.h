@@ -29,6 +29,7 @@
 
 #include <sys/types.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include <netinet/in.h>
 
@@ -50,6 +51,22 @@
 
 #define FTPD_CMDFLAG_LOGIN          (1 << 0)  /* Command requires login */
 
+/* Configuration ************************************************************/
+
+/* Number of bytes handed to sendfile() per call.  The data socket is polled
+ * for the transmit timeout between calls.
+ */
+
+#define FTPD_SENDFILE_CHUNK         (32 * 1024)
+
+#ifndef CONFIG_FTPD_WORKERS
+#  define CONFIG_FTPD_WORKERS       0
+#endif
+
+#ifndef CONFIG_FTPD_WORKERQUEUE
+#  define CONFIG_FTPD_WORKERQUEUE   0
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -105,6 +122,21 @@ struct ftpd_server_s
   union ftpd_sockaddr_u      addr;   /* Listen address */
   FAR struct ftpd_account_s *head;   /* Head of a list of accounts */
   FAR struct ftpd_account_s *tail;   /* Tail of a list of accounts */
+
+#if CONFIG_FTPD_WORKERS > 0
+  /* Session worker pool */
+
+  pthread_mutex_t            lock;     /* Protects the fields below */
+  pthread_cond_t             cond;     /* Signals queued sessions or stop */
+  FAR struct ftpd_session_s *qhead;    /* Sessions waiting for a worker */
+  FAR struct ftpd_session_s *qtail;
+  int                        nqueued;  /* Number of queued sessions */
+  int                        nidle;    /* Number of idle workers */
+  int                        nworkers; /* Number of worker threads started */
+  bool                       stop;     /* Workers should terminate */
+  pthread_t                  workers[CONFIG_FTPD_WORKERS];
+  FAR struct ftpd_session_s *active[CONFIG_FTPD_WORKERS];
+#endif
 };
 
 struct ftpd_stream_s
@@ -118,6 +150,7 @@ struct ftpd_stream_s
 
 struct ftpd_session_s
 {
+  FAR struct ftpd_session_s       *flink;   /* Worker pool queue link */
   FAR const struct ftpd_server_s  *server;
   FAR const struct ftpd_account_s *head;
   bool                             loggedin;
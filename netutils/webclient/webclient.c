@@ -55,6 +55,7 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <stdint.h>
@@ -67,9 +68,11 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #if defined(CONFIG_WEBCLIENT_NET_LOCAL)
 #include <sys/un.h>
 #endif
@@ -132,6 +135,12 @@
 #define CONN_WANT_READ  WEBCLIENT_POLL_INFO_WANT_READ
 #define CONN_WANT_WRITE WEBCLIENT_POLL_INFO_WANT_WRITE
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+#  define WGET_KEEPALIVE(ws) ((ws)->keepalive)
+#else
+#  define WGET_KEEPALIVE(ws) false
+#endif
+
 #ifdef CONFIG_DEBUG_ASSERTIONS
 #define _CHECK_STATE(ctx, s) DEBUGASSERT((ctx)->state == (s))
 #define _SET_STATE(ctx, s)   ctx->state = (s)
@@ -169,6 +178,7 @@ enum webclient_state_e
 #define WGET_FLAG_GOT_CONTENT_LENGTH 1U
 #define WGET_FLAG_CHUNKED            2U
 #define WGET_FLAG_GOT_LOCATION       4U
+#define WGET_FLAG_CONN_CLOSE         8U
 
 struct wget_target_s
 {
@@ -225,6 +235,13 @@ struct wget_s
   size_t data_len;
 
   FAR struct webclient_context *tunnel;
+
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+  bool keepalive;    /* The request leaves the connection open */
+  bool reused;       /* The connection came from the pool */
+  bool noreuse;      /* Retrying on a new connection */
+  bool keep_conn;    /* Give the connection to the pool when done */
+#endif
 };
 
 /****************************************************************************
@@ -239,6 +256,9 @@ static const char g_httpcontenttype[]      = "content-type: ";
 static const char g_httphost[]             = "host: ";
 static const char g_httplocation[]         = "location: ";
 static const char g_httptransferencoding[] = "transfer-encoding: ";
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+static const char g_httpconnection[]       = "connection: ";
+#endif
 
 static const char g_httpuseragentfields[] =
   "User-Agent: "
@@ -496,7 +516,18 @@ static inline int wget_parsestatus(struct webclient_context *ctx,
           ws->state = WEBCLIENT_STATE_HEADERS;
           ws->internal_flags &= ~(WGET_FLAG_GOT_CONTENT_LENGTH |
                                   WGET_FLAG_CHUNKED |
-                                  WGET_FLAG_GOT_LOCATION);
+                                  WGET_FLAG_GOT_LOCATION |
+                                  WGET_FLAG_CONN_CLOSE);
+
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+          /* An HTTP/1.0 server closes the connection after the response */
+
+          if (strncmp(ws->line, g_http10, strlen(g_http10)) == 0)
+            {
+              ws->internal_flags |= WGET_FLAG_CONN_CLOSE;
+            }
+#endif
+
           ndx = 0;
           break;
         }
@@ -752,6 +783,17 @@ static inline int wget_parseheaders(struct webclient_context *ctx,
                   ninfo("transfer encodings: '%s'\n", encodings);
                   ws->internal_flags |= WGET_FLAG_CHUNKED;
                 }
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+              else if (strncasecmp(ws->line, g_httpconnection,
+                                   strlen(g_httpconnection)) == 0)
+                {
+                  if (strcasecmp(ws->line + strlen(g_httpconnection),
+                                 "close") == 0)
+                    {
+                      ws->internal_flags |= WGET_FLAG_CONN_CLOSE;
+                    }
+                }
+#endif
             }
 
           if (found && !got_nl)
@@ -1066,6 +1108,355 @@ static int wget_gethostip(FAR char *hostname, FAR struct in_addr *dest)
 #endif
 }
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+
+/****************************************************************************
+ * Name: wget_now
+ ****************************************************************************/
+
+static time_t wget_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+/****************************************************************************
+ * Name: wget_pool_drop
+ ****************************************************************************/
+
+static void wget_pool_drop(FAR struct webclient_pool_conn_s *entry)
+{
+  webclient_conn_close(entry->conn);
+  webclient_conn_free(entry->conn);
+  entry->conn = NULL;
+}
+
+/****************************************************************************
+ * Name: wget_pool_isalive
+ *
+ * Description:
+ *   An idle connection has nothing to read.  If it is readable, the server
+ *   has closed it or sent something we can't match to a request.
+ *
+ ****************************************************************************/
+
+static bool wget_pool_isalive(FAR struct webclient_conn_s *conn)
+{
+  struct webclient_poll_info info;
+  struct pollfd pfd;
+
+  if (conn->tls)
+    {
+      if (conn->tls_ops->get_poll_info == NULL ||
+          conn->tls_ops->get_poll_info(conn->tls_ctx, conn->tls_conn,
+                                       &info) != 0)
+        {
+          return true;
+        }
+    }
+  else
+    {
+      info.fd = conn->sockfd;
+    }
+
+  memset(&pfd, 0, sizeof(pfd));
+  pfd.fd     = info.fd;
+  pfd.events = POLLIN;
+
+  return poll(&pfd, 1, 0) == 0;
+}
+
+/****************************************************************************
+ * Name: wget_pool_get
+ *
+ * Description:
+ *   Decide whether the request may keep its connection open and, if so,
+ *   take a matching idle connection from the pool.
+ *
+ * Returned Value:
+ *   true if ws->conn was replaced by a pooled connection.
+ *
+ ****************************************************************************/
+
+static bool wget_pool_get(FAR struct webclient_context *ctx,
+                          FAR struct wget_s *ws)
+{
+  FAR struct webclient_pool_s *pool = ctx->pool;
+  FAR struct webclient_pool_conn_s *entry;
+  FAR struct webclient_pool_conn_s *best;
+  unsigned int i;
+
+  ws->keepalive = pool != NULL &&
+                  ctx->protocol_version ==
+                  WEBCLIENT_PROTOCOL_VERSION_HTTP_1_1 &&
+                  (ctx->flags & WEBCLIENT_FLAG_TUNNEL) == 0 &&
+                  ctx->proxy == NULL;
+#if defined(CONFIG_WEBCLIENT_NET_LOCAL)
+  ws->keepalive = ws->keepalive && ctx->unix_socket_path == NULL;
+#endif
+
+  ws->reused    = false;
+  ws->keep_conn = false;
+  if (!ws->keepalive)
+    {
+      return false;
+    }
+
+  webclient_pool_expire(pool);
+
+  while (!ws->noreuse)
+    {
+      /* Take the most recently used match, it is the least likely to
+       * have been closed by the server.
+       */
+
+      best = NULL;
+      for (i = 0; i < CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN; i++)
+        {
+          entry = &pool->conns[i];
+          if (entry->conn != NULL &&
+              entry->port == ws->target.port &&
+              entry->flags == (ctx->flags & WEBCLIENT_FLAG_NON_BLOCKING) &&
+              entry->timeout_sec == ctx->timeout_sec &&
+              (!entry->conn->tls ||
+               (entry->conn->tls_ops == ctx->tls_ops &&
+                entry->conn->tls_ctx == ctx->tls_ctx)) &&
+              strcmp(entry->scheme, ws->target.scheme) == 0 &&
+              strcmp(entry->hostname, ws->target.hostname) == 0 &&
+              (best == NULL || entry->idle_since > best->idle_since))
+            {
+              best = entry;
+            }
+        }
+
+      if (best == NULL)
+        {
+          break;
+        }
+
+      if (!wget_pool_isalive(best->conn))
+        {
+          ninfo("Pooled connection to %s was closed\n", best->hostname);
+          wget_pool_drop(best);
+          continue;
+        }
+
+      ninfo("Reusing connection to %s:%u\n", best->hostname, best->port);
+      webclient_conn_free(ws->conn);
+      ws->conn            = best->conn;
+      best->conn          = NULL;
+      ws->reused          = true;
+      ws->need_conn_close = true;
+      pool->nreused++;
+      return true;
+    }
+
+  pool->nconnected++;
+  return false;
+}
+
+/****************************************************************************
+ * Name: wget_pool_put
+ *
+ * Description:
+ *   Give the connection of a finished request to the pool.
+ *
+ ****************************************************************************/
+
+static void wget_pool_put(FAR struct webclient_context *ctx,
+                          FAR struct wget_s *ws)
+{
+  FAR struct webclient_pool_s *pool = ctx->pool;
+  FAR struct webclient_pool_conn_s *entry = NULL;
+  unsigned int i;
+
+  webclient_pool_expire(pool);
+
+  /* Use a free entry, or replace the one idle for the longest time */
+
+  for (i = 0; i < CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN; i++)
+    {
+      if (pool->conns[i].conn == NULL)
+        {
+          entry = &pool->conns[i];
+          break;
+        }
+
+      if (entry == NULL || pool->conns[i].idle_since < entry->idle_since)
+        {
+          entry = &pool->conns[i];
+        }
+    }
+
+  if (entry->conn != NULL)
+    {
+      wget_pool_drop(entry);
+    }
+
+  strlcpy(entry->scheme, ws->target.scheme, sizeof(entry->scheme));
+  strlcpy(entry->hostname, ws->target.hostname, sizeof(entry->hostname));
+  entry->port        = ws->target.port;
+  entry->flags       = ctx->flags & WEBCLIENT_FLAG_NON_BLOCKING;
+  entry->timeout_sec = ctx->timeout_sec;
+  entry->idle_since  = wget_now();
+  entry->conn        = ws->conn;
+  entry->conn->flags = 0;
+  ws->conn           = NULL;
+}
+
+/****************************************************************************
+ * Name: wget_pool_gethostip
+ *
+ * Description:
+ *   wget_gethostip() through the address cache of the pool, if any.
+ *
+ ****************************************************************************/
+
+static int wget_pool_gethostip(FAR struct webclient_pool_s *pool,
+                               FAR char *hostname,
+                               FAR struct in_addr *dest)
+{
+  FAR struct webclient_pool_dns_s *entry = NULL;
+  time_t now;
+  int ret;
+  int i;
+
+  if (pool == NULL)
+    {
+      return wget_gethostip(hostname, dest);
+    }
+
+  now = wget_now();
+  for (i = 0; i < CONFIG_WEBCLIENT_DNSCACHE_ENTRIES; i++)
+    {
+      if (pool->dns[i].expires > now &&
+          strcmp(pool->dns[i].hostname, hostname) == 0)
+        {
+          dest->s_addr = pool->dns[i].addr;
+          pool->ndnshits++;
+          return OK;
+        }
+
+      /* Remember a free entry, or the one expiring first */
+
+      if (entry == NULL || pool->dns[i].expires < entry->expires)
+        {
+          entry = &pool->dns[i];
+        }
+    }
+
+  ret = wget_gethostip(hostname, dest);
+  if (ret == OK)
+    {
+      strlcpy(entry->hostname, hostname, sizeof(entry->hostname));
+      entry->addr    = dest->s_addr;
+      entry->expires = now + CONFIG_WEBCLIENT_DNSCACHE_TTL;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: wget_pool_forgethost
+ *
+ * Description:
+ *   Drop the cached address of a host that could not be connected to, in
+ *   case it has moved.
+ *
+ ****************************************************************************/
+
+static void wget_pool_forgethost(FAR struct webclient_pool_s *pool,
+                                 FAR const char *hostname)
+{
+  int i;
+
+  for (i = 0; pool != NULL && i < CONFIG_WEBCLIENT_DNSCACHE_ENTRIES; i++)
+    {
+      if (strcmp(pool->dns[i].hostname, hostname) == 0)
+        {
+          pool->dns[i].expires = 0;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: wget_response_done
+ *
+ * Description:
+ *   Whether the whole response has been received while the server keeps
+ *   the connection open.
+ *
+ ****************************************************************************/
+
+static bool wget_response_done(FAR struct webclient_context *ctx,
+                               FAR struct wget_s *ws)
+{
+  if ((ws->internal_flags & WGET_FLAG_CONN_CLOSE) != 0 ||
+      ws->httpstatus == HTTPSTATUS_MOVED)
+    {
+      return false;
+    }
+
+  if (ws->state == WEBCLIENT_STATE_WAIT_CLOSE)
+    {
+      return true;  /* After the last chunk */
+    }
+
+  if (ws->state != WEBCLIENT_STATE_DATA)
+    {
+      return false;
+    }
+
+  /* Responses without a body, RFC 7230 section 3.3.3 */
+
+  if (strcmp(ctx->method, "HEAD") == 0 || ctx->http_status / 100 == 1 ||
+      ctx->http_status == 204 || ctx->http_status == 304)
+    {
+      return true;
+    }
+
+  return (ws->internal_flags & WGET_FLAG_GOT_CONTENT_LENGTH) != 0 &&
+         ws->received_body_len == ws->expected_resp_body_len;
+}
+
+/****************************************************************************
+ * Name: wget_can_retry
+ *
+ * Description:
+ *   Whether a request that failed on a reused connection may be sent again
+ *   on a new one: the server closed the connection before it saw the
+ *   request, and the body can be produced again.
+ *
+ ****************************************************************************/
+
+static bool wget_can_retry(FAR struct webclient_context *ctx,
+                           FAR struct wget_s *ws, int ret)
+{
+  if (!ws->reused)
+    {
+      return false;
+    }
+
+  if (ret != -EPIPE && ret != -ECONNRESET && ret != -ECONNABORTED &&
+      ret != -ENOTCONN)
+    {
+      return false;
+    }
+
+  if (ctx->bodylen != 0 && ctx->body_callback != webclient_static_body_func)
+    {
+      return false;
+    }
+
+  return ws->state == WEBCLIENT_STATE_SEND_REQUEST ||
+         ws->state == WEBCLIENT_STATE_SEND_REQUEST_BODY ||
+         (ws->state == WEBCLIENT_STATE_STATUSLINE && ws->datend == 0);
+}
+
+#endif /* CONFIG_WEBCLIENT_KEEPALIVE */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -1164,6 +1555,73 @@ void webclient_conn_free(FAR struct webclient_conn_s *conn)
   free(conn);
 }
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+
+/****************************************************************************
+ * Name: webclient_pool_init
+ *
+ * Description:
+ *   Initialize an empty keep-alive connection pool.
+ *
+ ****************************************************************************/
+
+void webclient_pool_init(FAR struct webclient_pool_s *pool)
+{
+  memset(pool, 0, sizeof(*pool));
+}
+
+/****************************************************************************
+ * Name: webclient_pool_expire
+ *
+ * Description:
+ *   Close the connections idle for CONFIG_WEBCLIENT_KEEPALIVE_IDLE_TIMEOUT
+ *   seconds.  webclient_perform() does it on every pooled request, an
+ *   application that stops making requests for a while may call it to
+ *   release the connections earlier.
+ *
+ ****************************************************************************/
+
+void webclient_pool_expire(FAR struct webclient_pool_s *pool)
+{
+  time_t now = wget_now();
+  int i;
+
+  for (i = 0; i < CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN; i++)
+    {
+      if (pool->conns[i].conn != NULL &&
+          now - pool->conns[i].idle_since >=
+          CONFIG_WEBCLIENT_KEEPALIVE_IDLE_TIMEOUT)
+        {
+          wget_pool_drop(&pool->conns[i]);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: webclient_pool_deinit
+ *
+ * Description:
+ *   Close all the connections of the pool.
+ *
+ ****************************************************************************/
+
+void webclient_pool_deinit(FAR struct webclient_pool_s *pool)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_WEBCLIENT_KEEPALIVE_MAXCONN; i++)
+    {
+      if (pool->conns[i].conn != NULL)
+        {
+          wget_pool_drop(&pool->conns[i]);
+        }
+    }
+
+  memset(pool, 0, sizeof(*pool));
+}
+
+#endif /* CONFIG_WEBCLIENT_KEEPALIVE */
+
 /****************************************************************************
  * Name: webclient_perform
  *
@@ -1316,6 +1774,14 @@ int webclient_perform(FAR struct webclient_context *ctx)
           ws->ndx        = 0;
           ws->redirected = 0;
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+          if (wget_pool_get(ctx, ws))
+            {
+              conn = ws->conn;
+              ws->state = WEBCLIENT_STATE_PREPARE_REQUEST;
+            }
+          else
+#endif
           if (conn->tls)
             {
 #if defined(CONFIG_WEBCLIENT_NET_LOCAL)
@@ -1443,9 +1909,30 @@ int webclient_perform(FAR struct webclient_context *ctx)
                       goto errout_with_errno;
                     }
                 }
+
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+              /* The request headers and body are sent separately.  On a
+               * reused connection, Nagle would hold the body back until
+               * the server acknowledges the headers, which it delays.
+               */
+
+              if (ws->keepalive)
+                {
+                  int one = 1;
+
+                  if (setsockopt(conn->sockfd, IPPROTO_TCP, TCP_NODELAY,
+                                 &one, sizeof(one)) != 0)
+                    {
+                      ninfo("TCP_NODELAY not supported: %d\n", errno);
+                    }
+                }
+#endif
             }
 
-          ws->state = WEBCLIENT_STATE_CONNECT;
+          if (ws->state == WEBCLIENT_STATE_SOCKET)
+            {
+              ws->state = WEBCLIENT_STATE_CONNECT;
+            }
         }
 
       if (ws->state == WEBCLIENT_STATE_CONNECT)
@@ -1589,8 +2076,13 @@ int webclient_perform(FAR struct webclient_context *ctx)
 
                   server_in.sin_family = AF_INET;
                   server_in.sin_port   = htons(target->port);
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+                  ret = wget_pool_gethostip(ctx->pool, target->hostname,
+                                            &server_in.sin_addr);
+#else
                   ret = wget_gethostip(target->hostname,
                                        &server_in.sin_addr);
+#endif
                   if (ret < 0)
                     {
                       /* Could not resolve host (or malformed IP address) */
@@ -1635,6 +2127,15 @@ int webclient_perform(FAR struct webclient_context *ctx)
           if (ret < 0)
             {
               nerr("ERROR: connect failed: %d\n", errno);
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+              if (ret != -EAGAIN && ret != -EINPROGRESS && ret != -EALREADY)
+                {
+                  wget_pool_forgethost(ctx->pool, ctx->proxy != NULL ?
+                                                  ws->proxy.hostname :
+                                                  ws->target.hostname);
+                }
+#endif
+
               goto errout_with_errno;
             }
 
@@ -1774,9 +2275,10 @@ int webclient_perform(FAR struct webclient_context *ctx)
               dest = append(dest, ep, g_httpcrnl);
             }
 
-          if (ctx->protocol_version == WEBCLIENT_PROTOCOL_VERSION_HTTP_1_1)
+          if (ctx->protocol_version ==
+              WEBCLIENT_PROTOCOL_VERSION_HTTP_1_1 && !WGET_KEEPALIVE(ws))
             {
-              /* We don't implement persistect connections. */
+              /* Connections are only kept open for a pool */
 
               dest = append(dest, ep, g_httpconn_close);
               dest = append(dest, ep, g_httpcrnl);
@@ -1913,10 +2415,35 @@ int webclient_perform(FAR struct webclient_context *ctx)
           ws->state == WEBCLIENT_STATE_HEADERS ||
           ws->state == WEBCLIENT_STATE_DATA ||
           ws->state == WEBCLIENT_STATE_CHUNKED_HEADER ||
-          ws->state == WEBCLIENT_STATE_CHUNKED_DATA)
+          ws->state == WEBCLIENT_STATE_CHUNKED_DATA ||
+          ws->state == WEBCLIENT_STATE_CHUNKED_ENDDATA ||
+          ws->state == WEBCLIENT_STATE_CHUNKED_TRAILER ||
+          ws->state == WEBCLIENT_STATE_WAIT_CLOSE)
         {
           for (; ; )
             {
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+              /* Don't wait for the server to close a connection it keeps
+               * open.
+               */
+
+              if (ws->keepalive && wget_response_done(ctx, ws))
+                {
+                  if (ws->datend != ws->offset)
+                    {
+                      nerr("ERROR: %d bytes after the response\n",
+                           ws->datend - ws->offset);
+                      ret = -EPROTO;
+                      goto errout_with_errno;
+                    }
+
+                  ws->keep_conn = true;
+                  ws->state = WEBCLIENT_STATE_CLOSE;
+                  ws->redirected = 0;
+                  break;
+                }
+#endif
+
               if (ws->datend - ws->offset == 0)
                 {
                   size_t want = ws->buflen;
@@ -2065,6 +2592,21 @@ int webclient_perform(FAR struct webclient_context *ctx)
 
                           ws->chunk_received += received;
                         }
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+                      else if (ws->keepalive &&
+                               (ws->internal_flags &
+                                WGET_FLAG_GOT_CONTENT_LENGTH) != 0 &&
+                               received > ws->expected_resp_body_len -
+                                          ws->received_body_len)
+                        {
+                          /* The rest belongs to no response, it is
+                           * reported above on the next iteration.
+                           */
+
+                          received = ws->expected_resp_body_len -
+                                     ws->received_body_len;
+                        }
+#endif
 
                       ninfo("Processing resp body %ju - %ju\n",
                             ws->received_body_len,
@@ -2157,7 +2699,17 @@ int webclient_perform(FAR struct webclient_context *ctx)
 
       if (ws->state == WEBCLIENT_STATE_CLOSE)
         {
-          webclient_conn_close(conn);
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+          if (ws->keep_conn)
+            {
+              wget_pool_put(ctx, ws);
+            }
+          else
+#endif
+            {
+              webclient_conn_close(conn);
+            }
+
           ws->need_conn_close = false;
           if (ws->redirected)
             {
@@ -2197,6 +2749,19 @@ errout_with_errno:
       return -EAGAIN;
     }
 
+#ifdef CONFIG_WEBCLIENT_KEEPALIVE
+  if (wget_can_retry(ctx, ws, ret))
+    {
+      nwarn("WARNING: Reused connection failed: %d, retrying\n", ret);
+      webclient_conn_close(conn);
+      conn->flags         = 0;
+      ws->need_conn_close = false;
+      ws->noreuse         = true;
+      ws->state           = WEBCLIENT_STATE_SOCKET;
+      return webclient_perform(ctx);
+    }
+#endif
+
   if (ws->need_conn_close)
     {
       webclient_conn_close(conn);
@@ -0,0 +1,546 @@
+/****************************************************************************
+ * apps/netutils/webclient/webclient_multi.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+#include <debug.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "netutils/netlib.h"
+#include "netutils/webclient.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define MULTI_NO_DEADLINE UINT64_MAX
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct webclient_multi_xfer_s
+{
+  FAR struct webclient_multi_xfer_s *flink;
+  FAR struct webclient_context *ctx;
+  webclient_multi_done_t done;
+  FAR void *arg;
+  int result;                     /* For the done callback */
+  bool running;
+  bool ready;                     /* Perform again without waiting */
+  int pollidx;                    /* Index in the poll() array, or -1 */
+  struct webclient_poll_info info;
+  uint64_t deadline;              /* Inactivity timeout, in ms */
+  uint16_t port;
+  char host[CONFIG_WEBCLIENT_MAXHOSTNAME];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: multi_now
+ ****************************************************************************/
+
+static uint64_t multi_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/****************************************************************************
+ * Name: multi_sethost
+ *
+ * Description:
+ *   Find the host and port a transfer connects to, which is all the
+ *   per-host limit needs.  An URL that does not parse leaves an empty
+ *   host: webclient_perform() will report the error.
+ *
+ ****************************************************************************/
+
+static void multi_sethost(FAR struct webclient_multi_xfer_s *xfer)
+{
+  FAR struct webclient_context *ctx = xfer->ctx;
+  struct url_s url;
+  char scheme[sizeof("https") + 1];
+  char path[2];
+  int ret;
+
+  if ((ctx->flags & WEBCLIENT_FLAG_TUNNEL) != 0)
+    {
+      strlcpy(xfer->host, ctx->tunnel_target_host, sizeof(xfer->host));
+      xfer->port = ctx->tunnel_target_port;
+      return;
+    }
+
+  memset(&url, 0, sizeof(url));
+  url.scheme    = scheme;
+  url.schemelen = sizeof(scheme);
+  url.host      = xfer->host;
+  url.hostlen   = sizeof(xfer->host);
+  url.path      = path;
+  url.pathlen   = sizeof(path);
+
+  /* Only the path is expected not to fit */
+
+  ret = netlib_parseurl(ctx->url, &url);
+  if (ret < 0 && ret != -E2BIG)
+    {
+      xfer->host[0] = '\0';
+      return;
+    }
+
+  if (url.port == 0)
+    {
+      url.port = strcmp(scheme, "https") == 0 ? 443 : 80;
+    }
+
+  xfer->port = url.port;
+}
+
+/****************************************************************************
+ * Name: multi_nhost
+ *
+ * Description:
+ *   Count the running transfers to the host of xfer.
+ *
+ ****************************************************************************/
+
+static unsigned int multi_nhost(FAR struct webclient_multi_s *multi,
+                                FAR struct webclient_multi_xfer_s *xfer)
+{
+  FAR struct webclient_multi_xfer_s *other;
+  unsigned int n = 0;
+
+  for (other = multi->xfers; other != NULL; other = other->flink)
+    {
+      if (other->running && other->port == xfer->port &&
+          strcmp(other->host, xfer->host) == 0)
+        {
+          n++;
+        }
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: multi_unlink
+ ****************************************************************************/
+
+static void multi_unlink(FAR struct webclient_multi_s *multi,
+                         FAR struct webclient_multi_xfer_s *xfer)
+{
+  FAR struct webclient_multi_xfer_s **prev;
+
+  for (prev = &multi->xfers; *prev != xfer; prev = &(*prev)->flink)
+    {
+      DEBUGASSERT(*prev != NULL);
+    }
+
+  *prev = xfer->flink;
+  xfer->flink = NULL;
+
+  if (xfer->running)
+    {
+      multi->nrunning--;
+    }
+}
+
+/****************************************************************************
+ * Name: multi_finish
+ *
+ * Description:
+ *   Take a transfer that ended out of the multi handle and queue it for
+ *   its done callback.  The callbacks run once webclient_multi_perform()
+ *   no longer walks the list, so that they may add and remove transfers.
+ *
+ ****************************************************************************/
+
+static void multi_finish(FAR struct webclient_multi_s *multi,
+                         FAR struct webclient_multi_xfer_s *xfer,
+                         int result,
+                         FAR struct webclient_multi_xfer_s ***donetail)
+{
+  ninfo("Transfer %p done: %d\n", xfer->ctx, result);
+
+  multi_unlink(multi, xfer);
+  xfer->result = result;
+
+  **donetail = xfer;
+  *donetail  = &xfer->flink;
+}
+
+/****************************************************************************
+ * Name: multi_step
+ *
+ * Description:
+ *   Let a running transfer go as far as it can without blocking.
+ *
+ ****************************************************************************/
+
+static void multi_step(FAR struct webclient_multi_s *multi,
+                       FAR struct webclient_multi_xfer_s *xfer,
+                       FAR struct webclient_multi_xfer_s ***donetail)
+{
+  FAR struct webclient_context *ctx = xfer->ctx;
+  int ret;
+
+  ret = webclient_perform(ctx);
+  if (ret == -EAGAIN)
+    {
+      ret = webclient_get_poll_info(ctx, &xfer->info);
+      if (ret == 0)
+        {
+          xfer->ready    = (xfer->info.flags &
+                            (WEBCLIENT_POLL_INFO_WANT_READ |
+                             WEBCLIENT_POLL_INFO_WANT_WRITE)) == 0;
+          xfer->deadline = ctx->timeout_sec == 0 ? MULTI_NO_DEADLINE :
+                           multi_now() + ctx->timeout_sec * 1000ull;
+          return;
+        }
+
+      nerr("ERROR: webclient_get_poll_info failed: %d\n", ret);
+      webclient_abort(ctx);
+    }
+
+  multi_finish(multi, xfer, ret, donetail);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: webclient_multi_init
+ *
+ * Description:
+ *   Initialize an empty multi handle with the default limits.  The
+ *   application may change max_running and max_per_host afterwards.
+ *
+ ****************************************************************************/
+
+void webclient_multi_init(FAR struct webclient_multi_s *multi)
+{
+  memset(multi, 0, sizeof(*multi));
+  multi->max_running  = CONFIG_WEBCLIENT_MULTI_MAXRUNNING;
+  multi->max_per_host = CONFIG_WEBCLIENT_MULTI_MAXPERHOST;
+}
+
+/****************************************************************************
+ * Name: webclient_multi_add
+ *
+ * Description:
+ *   Queue a transfer.  The context must be in the INITIALIZED state, it is
+ *   switched to WEBCLIENT_FLAG_NON_BLOCKING.  done is called with arg when
+ *   the transfer ends.
+ *
+ * Returned Value:
+ *   0 on success, -ENOMEM if the transfer could not be queued.
+ *
+ ****************************************************************************/
+
+int webclient_multi_add(FAR struct webclient_multi_s *multi,
+                        FAR struct webclient_context *ctx,
+                        webclient_multi_done_t done, FAR void *arg)
+{
+  FAR struct webclient_multi_xfer_s *xfer;
+  FAR struct webclient_multi_xfer_s **tail;
+
+  DEBUGASSERT(done != NULL);
+
+  xfer = calloc(1, sizeof(*xfer));
+  if (xfer == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  xfer->ctx     = ctx;
+  xfer->done    = done;
+  xfer->arg     = arg;
+  xfer->pollidx = -1;
+  ctx->flags   |= WEBCLIENT_FLAG_NON_BLOCKING;
+  multi_sethost(xfer);
+
+  for (tail = &multi->xfers; *tail != NULL; tail = &(*tail)->flink)
+    {
+    }
+
+  *tail = xfer;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: webclient_multi_remove
+ *
+ * Description:
+ *   Take a transfer out of the multi handle without calling its done
+ *   callback.  A running transfer is aborted with webclient_abort().
+ *
+ * Returned Value:
+ *   0 on success, -ENOENT if the context is not in the multi handle.
+ *
+ ****************************************************************************/
+
+int webclient_multi_remove(FAR struct webclient_multi_s *multi,
+                           FAR struct webclient_context *ctx)
+{
+  FAR struct webclient_multi_xfer_s *xfer;
+
+  for (xfer = multi->xfers; xfer != NULL; xfer = xfer->flink)
+    {
+      if (xfer->ctx == ctx)
+        {
+          if (xfer->running)
+            {
+              webclient_abort(ctx);
+            }
+
+          multi_unlink(multi, xfer);
+          free(xfer);
+          return OK;
+        }
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Name: webclient_multi_perform
+ *
+ * Description:
+ *   Start the queued transfers the limits allow, wait up to timeout_ms
+ *   milliseconds (-1 for no limit) for any running transfer to be able to
+ *   make progress, let those make it, and call the done callbacks of the
+ *   transfers that ended.  The wait is shortened when a transfer reaches
+ *   its inactivity timeout.
+ *
+ * Returned Value:
+ *   The number of transfers still queued or running, or a negated errno
+ *   value if poll() failed.
+ *
+ ****************************************************************************/
+
+int webclient_multi_perform(FAR struct webclient_multi_s *multi,
+                            int timeout_ms)
+{
+  struct pollfd pfds[CONFIG_WEBCLIENT_MULTI_MAXRUNNING];
+  FAR struct webclient_multi_xfer_s *done = NULL;
+  FAR struct webclient_multi_xfer_s **donetail = &done;
+  FAR struct webclient_multi_xfer_s *xfer;
+  FAR struct webclient_multi_xfer_s *next;
+  FAR struct webclient_context *ctx;
+  webclient_multi_done_t cb;
+  FAR void *arg;
+  unsigned int max_running;
+  unsigned int max_per_host;
+  uint64_t now;
+  int npfds = 0;
+  int result;
+  int ret = 0;
+
+  max_running = multi->max_running;
+  if (max_running == 0 || max_running > CONFIG_WEBCLIENT_MULTI_MAXRUNNING)
+    {
+      max_running = CONFIG_WEBCLIENT_MULTI_MAXRUNNING;
+    }
+
+  max_per_host = multi->max_per_host > 0 ? multi->max_per_host : 1;
+
+  /* Start transfers in the order they were added.  One that has to wait
+   * for its host does not hold back those to other hosts.
+   */
+
+  for (xfer = multi->xfers;
+       xfer != NULL && multi->nrunning < max_running;
+       xfer = next)
+    {
+      next = xfer->flink;
+      if (!xfer->running && multi_nhost(multi, xfer) < max_per_host)
+        {
+          xfer->running = true;
+          multi->nrunning++;
+          multi_step(multi, xfer, &donetail);
+        }
+    }
+
+  /* Wait for the running transfers */
+
+  now = multi_now();
+  for (xfer = multi->xfers; xfer != NULL; xfer = xfer->flink)
+    {
+      xfer->pollidx = -1;
+      if (!xfer->running)
+        {
+          continue;
+        }
+
+      if (xfer->ready || xfer->deadline <= now)
+        {
+          timeout_ms = 0;
+          continue;
+        }
+
+      if (timeout_ms < 0 || xfer->deadline - now < (uint64_t)timeout_ms)
+        {
+          timeout_ms = xfer->deadline - now < INT_MAX ?
+                       (int)(xfer->deadline - now) : INT_MAX;
+        }
+
+      memset(&pfds[npfds], 0, sizeof(pfds[npfds]));
+      pfds[npfds].fd = xfer->info.fd;
+      if ((xfer->info.flags & WEBCLIENT_POLL_INFO_WANT_READ) != 0)
+        {
+          pfds[npfds].events |= POLLIN;
+        }
+
+      if ((xfer->info.flags & WEBCLIENT_POLL_INFO_WANT_WRITE) != 0)
+        {
+          pfds[npfds].events |= POLLOUT;
+        }
+
+      xfer->pollidx = npfds++;
+    }
+
+  if (npfds > 0)
+    {
+      ret = poll(pfds, npfds, timeout_ms);
+      if (ret < 0)
+        {
+          ret = -errno;
+          if (ret != -EINTR)
+            {
+              nerr("ERROR: poll failed: %d\n", ret);
+            }
+
+          npfds = 0;
+        }
+
+      now = multi_now();
+    }
+
+  /* Let the transfers with events go on, and end the idle ones */
+
+  for (xfer = multi->xfers; xfer != NULL; xfer = next)
+    {
+      next = xfer->flink;
+      if (!xfer->running)
+        {
+          continue;
+        }
+
+      if (xfer->ready ||
+          (xfer->pollidx >= 0 && xfer->pollidx < npfds &&
+           pfds[xfer->pollidx].revents != 0))
+        {
+          multi_step(multi, xfer, &donetail);
+        }
+      else if (xfer->deadline <= now)
+        {
+          nerr("ERROR: Transfer %p timed out\n", xfer->ctx);
+          webclient_abort(xfer->ctx);
+          multi_finish(multi, xfer, -ETIMEDOUT, &donetail);
+        }
+    }
+
+  /* The callbacks may queue new transfers, count them too */
+
+  while (done != NULL)
+    {
+      xfer   = done;
+      done   = xfer->flink;
+      ctx    = xfer->ctx;
+      cb     = xfer->done;
+      arg    = xfer->arg;
+      result = xfer->result;
+
+      free(xfer);
+      cb(ctx, result, arg);
+    }
+
+  if (ret < 0 && ret != -EINTR)
+    {
+      return ret;
+    }
+
+  ret = 0;
+  for (xfer = multi->xfers; xfer != NULL; xfer = xfer->flink)
+    {
+      ret++;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: webclient_multi_run
+ *
+ * Description:
+ *   Call webclient_multi_perform() until every transfer, including those
+ *   the done callbacks queue, has ended.
+ *
+ * Returned Value:
+ *   0 on success, or a negated errno value if poll() failed.
+ *
+ ****************************************************************************/
+
+int webclient_multi_run(FAR struct webclient_multi_s *multi)
+{
+  int ret;
+
+  do
+    {
+      ret = webclient_multi_perform(multi, -1);
+    }
+  while (ret > 0);
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: webclient_multi_deinit
+ *
+ * Description:
+ *   Abort and remove all transfers, without calling their callbacks.
+ *
+ ****************************************************************************/
+
+void webclient_multi_deinit(FAR struct webclient_multi_s *multi)
+{
+  while (multi->xfers != NULL)
+    {
+      webclient_multi_remove(multi, multi->xfers->ctx);
+    }
+}
@@ -39,10 +39,26 @@
 #include <sys/statfs.h>
 #include <sys/types.h>
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+#  include <limits.h>
+#  include <pthread.h>
+#  include <semaphore.h>
+#endif
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_TCP
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
+#if !defined(CONFIG_SYSTEM_FASTBOOTD_USB) && \
+    !defined(CONFIG_SYSTEM_FASTBOOTD_TCP)
+#  error "fastbootd needs at least one transport"
+#endif
+
 #define FASTBOOT_USBDEV             "/dev/fastboot"
 #define FASTBOOT_BLKDEV             "/dev/%s"
 
@@ -65,6 +81,24 @@
                                      ((uint32_t)(p)[1] << 8) | \
                                      (uint32_t)(p)[0])
 
+/* Fastboot over TCP: "FB" + two digit protocol version handshake, then
+ * every packet is prefixed with its length as a 64-bit big-endian value.
+ */
+
+#define FASTBOOT_TCP_HANDSHAKE      "FB01"
+#define FASTBOOT_TCP_HANDSHAKE_LEN  4
+#define FASTBOOT_TCP_HDR_LEN        8
+
+/* Streaming parser states */
+
+#define FASTBOOT_STREAM_SPARSE_HDR  0  /* Collecting the sparse header */
+#define FASTBOOT_STREAM_CHUNK_HDR   1  /* Collecting a chunk header */
+#define FASTBOOT_STREAM_CHUNK_RAW   2  /* Writing raw chunk data */
+#define FASTBOOT_STREAM_CHUNK_FILL  3  /* Collecting the fill pattern */
+#define FASTBOOT_STREAM_SKIP        4  /* Discarding bytes */
+#define FASTBOOT_STREAM_IMAGE       5  /* Writing a non-sparse image */
+#define FASTBOOT_STREAM_DONE        6  /* All chunks consumed */
+
 /****************************************************************************
  * Private types
  ****************************************************************************/
@@ -100,16 +134,65 @@ struct fastboot_chunk_header_s
   uint32_t total_sz;        /* in bytes of chunk input file including chunk header and data */
 };
 
+struct fastboot_ctx_s;
+
+struct fastboot_transport_ops_s
+{
+  CODE int (*init)(FAR struct fastboot_ctx_s *context);
+  CODE void (*deinit)(FAR struct fastboot_ctx_s *context);
+  CODE ssize_t (*read)(FAR struct fastboot_ctx_s *context,
+                       FAR void *buf, size_t len);
+  CODE int (*write)(FAR struct fastboot_ctx_s *context,
+                    FAR void *buf, size_t len);
+};
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+struct fastboot_stream_s
+{
+  int fd;                   /* Armed target partition, -1 if disarmed */
+  int state;                /* FASTBOOT_STREAM_* parser state */
+  int next;                 /* State to enter after FASTBOOT_STREAM_SKIP */
+  int result;               /* First flash error, or OK */
+  bool complete;            /* A whole image has been streamed */
+  off_t offset;             /* Next flash write offset */
+  uint64_t remain;          /* Bytes left in the current state */
+  uint32_t blk_sz;          /* Sparse block size */
+  uint32_t chunks;          /* Sparse chunks left */
+  uint32_t chunk_sz;        /* Blocks in the current chunk */
+  uint16_t chunk_hdr_sz;    /* Chunk header size from the image */
+  size_t hdr_len;           /* Bytes staged in hdr */
+  union
+  {
+    struct fastboot_sparse_header_s sparse;
+    struct fastboot_chunk_header_s chunk;
+    uint8_t raw[FASTBOOT_SPARSE_HEADER];
+  } hdr;
+  FAR uint8_t *buffer[2];   /* Halves of the download buffer */
+  size_t buflen[2];         /* Valid bytes in each half, 0 ends stream */
+  size_t bufsize;           /* Capacity of each half */
+  sem_t full;               /* Halves ready to be written to flash */
+  sem_t empty;              /* Halves ready to be filled by transport */
+  char name[NAME_MAX];      /* Armed partition name */
+};
+#endif
+
 struct fastboot_ctx_s
 {
-  int usbdev_in;
-  int usbdev_out;
+  int tran_fd[2];           /* Transport input/output descriptors */
   size_t download_max;
   size_t download_size;
   size_t download_offset;
   size_t total_imgsize;
   FAR void *download_buffer;
   FAR struct fastboot_var_s *varlist;
+  FAR const struct fastboot_transport_ops_s *ops;
+#ifdef CONFIG_SYSTEM_FASTBOOTD_TCP
+  int listen_fd;            /* Listening socket of the TCP transport */
+  uint64_t tcp_remain;      /* Payload bytes left in current TCP packet */
+#endif
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  struct fastboot_stream_s stream;
+#endif
 };
 
 struct fastboot_cmd_s
@@ -135,6 +218,28 @@ static void fastboot_reboot(FAR struct fastboot_ctx_s *context,
                             FAR const char *arg);
 static void fastboot_reboot_bootloader(FAR struct fastboot_ctx_s *context,
                                        FAR const char *arg);
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+static void fastboot_oem_stream(FAR struct fastboot_ctx_s *context,
+                                FAR const char *arg);
+#endif
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_USB
+static int fastboot_usbdev_init(FAR struct fastboot_ctx_s *context);
+static void fastboot_usbdev_deinit(FAR struct fastboot_ctx_s *context);
+static ssize_t fastboot_usbdev_read(FAR struct fastboot_ctx_s *context,
+                                    FAR void *buf, size_t len);
+static int fastboot_usbdev_write(FAR struct fastboot_ctx_s *context,
+                                 FAR void *buf, size_t len);
+#endif
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_TCP
+static int fastboot_tcp_init(FAR struct fastboot_ctx_s *context);
+static void fastboot_tcp_deinit(FAR struct fastboot_ctx_s *context);
+static ssize_t fastboot_tcp_read(FAR struct fastboot_ctx_s *context,
+                                 FAR void *buf, size_t len);
+static int fastboot_tcp_write(FAR struct fastboot_ctx_s *context,
+                              FAR void *buf, size_t len);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -147,8 +252,31 @@ static const struct fastboot_cmd_s g_fast_cmd[] =
   { "erase:",             fastboot_erase            },
   { "flash:",             fastboot_flash            },
   { "reboot-bootloader",  fastboot_reboot_bootloader},
-  { "reboot",             fastboot_reboot           }
+  { "reboot",             fastboot_reboot           },
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  { "oem stream ",        fastboot_oem_stream       }
+#endif
+};
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_USB
+static const struct fastboot_transport_ops_s g_tran_ops_usb =
+{
+  fastboot_usbdev_init,
+  fastboot_usbdev_deinit,
+  fastboot_usbdev_read,
+  fastboot_usbdev_write
+};
+#endif
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_TCP
+static const struct fastboot_transport_ops_s g_tran_ops_tcp =
+{
+  fastboot_tcp_init,
+  fastboot_tcp_deinit,
+  fastboot_tcp_read,
+  fastboot_tcp_write
 };
+#endif
 
 /****************************************************************************
  * Private Functions
@@ -203,7 +331,7 @@ static void fastboot_ack(FAR struct fastboot_ctx_s *context,
     }
 
   snprintf(response, FASTBOOT_MSG_LEN, "%s%s", code, reason);
-  fastboot_write(context->usbdev_out, response, strlen(response));
+  context->ops->write(context, response, strlen(response));
 }
 
 static void fastboot_fail(FAR struct fastboot_ctx_s *context,
@@ -382,12 +510,435 @@ fastboot_flash_program(FAR struct fastboot_ctx_s *context, int fd)
   return ret;
 }
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+static int fastboot_stream_next_chunk(FAR struct fastboot_stream_s *stream)
+{
+  if (stream->chunks == 0)
+    {
+      return FASTBOOT_STREAM_DONE;
+    }
+
+  stream->chunks--;
+  return FASTBOOT_STREAM_CHUNK_HDR;
+}
+
+static void fastboot_stream_enter(FAR struct fastboot_stream_s *stream,
+                                  int state)
+{
+  stream->state = state;
+  stream->hdr_len = 0;
+
+  switch (state)
+    {
+      case FASTBOOT_STREAM_CHUNK_HDR:
+        stream->remain = FASTBOOT_CHUNK_HEADER;
+        break;
+
+      case FASTBOOT_STREAM_CHUNK_FILL:
+        stream->remain = sizeof(uint32_t);
+        break;
+
+      case FASTBOOT_STREAM_CHUNK_RAW:
+        stream->remain = (uint64_t)stream->chunk_sz * stream->blk_sz;
+        if (stream->remain == 0)
+          {
+            fastboot_stream_enter(stream,
+                                  fastboot_stream_next_chunk(stream));
+          }
+        break;
+
+      default:
+        break;
+    }
+}
+
+static void fastboot_stream_skip(FAR struct fastboot_stream_s *stream,
+                                 uint64_t count, int next)
+{
+  if (count == 0)
+    {
+      fastboot_stream_enter(stream, next);
+    }
+  else
+    {
+      stream->state = FASTBOOT_STREAM_SKIP;
+      stream->next = next;
+      stream->remain = count;
+    }
+}
+
+static int fastboot_stream_header(FAR struct fastboot_stream_s *stream)
+{
+  FAR struct fastboot_chunk_header_s *chunk = &stream->hdr.chunk;
+  uint64_t extra;
+  uint64_t data;
+  int ret;
+
+  switch (stream->state)
+    {
+      case FASTBOOT_STREAM_SPARSE_HDR:
+        if (stream->hdr.sparse.magic != FASTBOOT_SPARSE_MAGIC)
+          {
+            /* No sparse header, everything is raw image data */
+
+            ret = fastboot_flash_write(stream->fd, 0, stream->hdr.raw,
+                                       stream->hdr_len);
+            if (ret < 0)
+              {
+                return ret;
+              }
+
+            stream->offset = stream->hdr_len;
+            fastboot_stream_enter(stream, FASTBOOT_STREAM_IMAGE);
+            return OK;
+          }
+
+        stream->blk_sz = stream->hdr.sparse.blk_sz;
+        stream->chunks = stream->hdr.sparse.total_chunks;
+        stream->chunk_hdr_sz = stream->hdr.sparse.chunk_hdr_sz;
+        if (stream->hdr.sparse.file_hdr_sz < FASTBOOT_SPARSE_HEADER ||
+            stream->chunk_hdr_sz < FASTBOOT_CHUNK_HEADER)
+          {
+            printf("Invalid sparse header\n");
+            return -EINVAL;
+          }
+
+        fastboot_stream_skip(stream, stream->hdr.sparse.file_hdr_sz -
+                                     FASTBOOT_SPARSE_HEADER,
+                             fastboot_stream_next_chunk(stream));
+        break;
+
+      case FASTBOOT_STREAM_CHUNK_HDR:
+        stream->chunk_sz = chunk->chunk_sz;
+        extra = stream->chunk_hdr_sz - FASTBOOT_CHUNK_HEADER;
+        data = chunk->total_sz > stream->chunk_hdr_sz ?
+               chunk->total_sz - stream->chunk_hdr_sz : 0;
+
+        switch (chunk->chunk_type)
+          {
+            case FASTBOOT_CHUNK_RAW:
+              fastboot_stream_skip(stream, extra, FASTBOOT_STREAM_CHUNK_RAW);
+              break;
+
+            case FASTBOOT_CHUNK_FILL:
+              fastboot_stream_skip(stream, extra,
+                                   FASTBOOT_STREAM_CHUNK_FILL);
+              break;
+
+            case FASTBOOT_CHUNK_DONT_CARE:
+              stream->offset += (off_t)stream->chunk_sz * stream->blk_sz;
+              fastboot_stream_skip(stream, extra + data,
+                                   fastboot_stream_next_chunk(stream));
+              break;
+
+            default:
+              printf("Error chunk type:%d, skip\n", chunk->chunk_type);
+
+              /* Fall through */
+
+            case FASTBOOT_CHUNK_CRC32:
+              fastboot_stream_skip(stream, extra + data,
+                                   fastboot_stream_next_chunk(stream));
+              break;
+          }
+        break;
+
+      case FASTBOOT_STREAM_CHUNK_FILL:
+        ret = ffastboot_flash_fill(stream->fd, stream->offset,
+                                   FASTBOOT_GETUINT32(stream->hdr.raw),
+                                   stream->blk_sz, stream->chunk_sz);
+        if (ret < 0)
+          {
+            return ret;
+          }
+
+        stream->offset += (off_t)stream->chunk_sz * stream->blk_sz;
+        fastboot_stream_enter(stream, fastboot_stream_next_chunk(stream));
+        break;
+    }
+
+  return OK;
+}
+
+/* Parse the next piece of the image as it arrives and write the decoded
+ * data to flash.  The parser keeps its position across calls, so the image
+ * may be split at any byte boundary.
+ */
+
+static int fastboot_stream_feed(FAR struct fastboot_stream_s *stream,
+                                FAR const uint8_t *data, size_t len)
+{
+  int ret = OK;
+
+  while (len > 0 && ret >= 0)
+    {
+      size_t n = len;
+
+      switch (stream->state)
+        {
+          case FASTBOOT_STREAM_SPARSE_HDR:
+          case FASTBOOT_STREAM_CHUNK_HDR:
+          case FASTBOOT_STREAM_CHUNK_FILL:
+            n = MIN(len, stream->remain);
+            memcpy(stream->hdr.raw + stream->hdr_len, data, n);
+            stream->hdr_len += n;
+            stream->remain -= n;
+            if (stream->remain == 0)
+              {
+                ret = fastboot_stream_header(stream);
+              }
+            break;
+
+          case FASTBOOT_STREAM_CHUNK_RAW:
+            n = MIN(len, stream->remain);
+            stream->remain -= n;
+
+            /* Fall through */
+
+          case FASTBOOT_STREAM_IMAGE:
+            ret = fastboot_flash_write(stream->fd, stream->offset,
+                                       (FAR void *)data, n);
+            stream->offset += n;
+            if (stream->state == FASTBOOT_STREAM_CHUNK_RAW &&
+                stream->remain == 0)
+              {
+                fastboot_stream_enter(stream,
+                                      fastboot_stream_next_chunk(stream));
+              }
+            break;
+
+          case FASTBOOT_STREAM_SKIP:
+            n = MIN(len, stream->remain);
+            stream->remain -= n;
+            if (stream->remain == 0)
+              {
+                fastboot_stream_enter(stream, stream->next);
+              }
+            break;
+
+          default:
+            break;
+        }
+
+      data += n;
+      len -= n;
+    }
+
+  return ret;
+}
+
+static FAR void *fastboot_stream_thread(FAR void *arg)
+{
+  FAR struct fastboot_stream_s *stream = arg;
+  int index = 0;
+
+  for (; ; )
+    {
+      size_t len;
+
+      sem_wait(&stream->full);
+      len = stream->buflen[index];
+      if (len == 0)
+        {
+          break;
+        }
+
+      /* Keep draining after an error so the reader never blocks */
+
+      if (stream->result >= 0)
+        {
+          stream->result = fastboot_stream_feed(stream,
+                                                stream->buffer[index], len);
+        }
+
+      sem_post(&stream->empty);
+      index ^= 1;
+    }
+
+  /* An image shorter than the sparse header is raw data */
+
+  if (stream->result >= 0 && stream->state == FASTBOOT_STREAM_SPARSE_HDR &&
+      stream->hdr_len > 0)
+    {
+      stream->result = fastboot_flash_write(stream->fd, 0, stream->hdr.raw,
+                                            stream->hdr_len);
+    }
+
+  return NULL;
+}
+
+static int fastboot_stream_download(FAR struct fastboot_ctx_s *context,
+                                    size_t len)
+{
+  FAR struct fastboot_stream_s *stream = &context->stream;
+  pthread_t thread;
+  int index = 0;
+  int ret = OK;
+
+  stream->state = FASTBOOT_STREAM_SPARSE_HDR;
+  stream->remain = FASTBOOT_SPARSE_HEADER;
+  stream->hdr_len = 0;
+  stream->offset = 0;
+  stream->chunks = 0;
+  stream->result = OK;
+  stream->complete = false;
+
+  sem_init(&stream->full, 0, 0);
+  sem_init(&stream->empty, 0, 2);
+
+  ret = pthread_create(&thread, NULL, fastboot_stream_thread, stream);
+  if (ret != 0)
+    {
+      sem_destroy(&stream->full);
+      sem_destroy(&stream->empty);
+      return -ret;
+    }
+
+  /* Fill one half of the buffer from the transport while the writer
+   * thread programs the other half into flash.
+   */
+
+  while (len > 0)
+    {
+      FAR uint8_t *buffer = stream->buffer[index];
+      size_t fill = 0;
+
+      sem_wait(&stream->empty);
+      while (fill < stream->bufsize && len > 0)
+        {
+          ssize_t r = context->ops->read(context, buffer + fill,
+                                         MIN(stream->bufsize - fill, len));
+          if (r <= 0)
+            {
+              printf("fastboot_download read error\n");
+              ret = r < 0 ? r : -EIO;
+              len = 0;
+              break;
+            }
+
+          fill += r;
+          len -= r;
+        }
+
+      if (fill == 0)
+        {
+          sem_post(&stream->empty);
+          break;
+        }
+
+      stream->buflen[index] = fill;
+      sem_post(&stream->full);
+      index ^= 1;
+    }
+
+  sem_wait(&stream->empty);
+  stream->buflen[index] = 0;
+  sem_post(&stream->full);
+  pthread_join(thread, NULL);
+
+  sem_destroy(&stream->full);
+  sem_destroy(&stream->empty);
+
+  stream->complete = ret >= 0;
+  return ret;
+}
+
+static void fastboot_stream_disarm(FAR struct fastboot_ctx_s *context)
+{
+  FAR struct fastboot_stream_s *stream = &context->stream;
+  FAR struct fastboot_var_s *var;
+
+  if (stream->fd >= 0)
+    {
+      fastboot_flash_close(stream->fd);
+      stream->fd = -1;
+    }
+
+  stream->complete = false;
+  context->download_max = CONFIG_SYSTEM_FASTBOOTD_DOWNLOAD_MAX;
+
+  for (var = context->varlist; var != NULL; var = var->next)
+    {
+      if (!strcmp(var->name, "max-download-size"))
+        {
+          var->data = context->download_max;
+        }
+    }
+}
+
+static void fastboot_oem_stream(FAR struct fastboot_ctx_s *context,
+                                FAR const char *arg)
+{
+  FAR struct fastboot_stream_s *stream = &context->stream;
+  FAR struct fastboot_var_s *var;
+  char blkdev[PATH_MAX];
+  off_t size;
+
+  fastboot_stream_disarm(context);
+
+  snprintf(blkdev, PATH_MAX, FASTBOOT_BLKDEV, arg);
+  stream->fd = fastboot_flash_open(blkdev);
+  if (stream->fd < 0)
+    {
+      fastboot_fail(context, "Flash open failure");
+      return;
+    }
+
+  /* The image no longer has to fit in RAM, so let the host send up to the
+   * size of the partition in one download.
+   */
+
+  size = lseek(stream->fd, 0, SEEK_END);
+  if (size <= 0 || size > INT_MAX)
+    {
+      size = INT_MAX;
+    }
+
+  strlcpy(stream->name, arg, sizeof(stream->name));
+  context->download_max = size;
+
+  for (var = context->varlist; var != NULL; var = var->next)
+    {
+      if (!strcmp(var->name, "max-download-size"))
+        {
+          var->data = size;
+        }
+    }
+
+  fastboot_okay(context, "");
+}
+#endif
+
 static void fastboot_flash(FAR struct fastboot_ctx_s *context,
                            FAR const char *arg)
 {
   char blkdev[PATH_MAX];
   int fd;
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  if (context->stream.fd >= 0)
+    {
+      /* The image was already written while it was being downloaded */
+
+      if (!context->stream.complete ||
+          strcmp(context->stream.name, arg) != 0)
+        {
+          fastboot_fail(context, "Stream target mismatch");
+        }
+      else if (context->stream.result < 0)
+        {
+          fastboot_fail(context, "Image flash failure");
+        }
+      else
+        {
+          fastboot_okay(context, "");
+        }
+
+      fastboot_stream_disarm(context);
+      return;
+    }
+#endif
+
   snprintf(blkdev, PATH_MAX, FASTBOOT_BLKDEV, arg);
 
   fd = fastboot_flash_open(blkdev);
@@ -453,22 +1004,40 @@ static void fastboot_download(FAR struct fastboot_ctx_s *context,
     }
 
   snprintf(response, FASTBOOT_MSG_LEN, "DATA%08lx", len);
-  ret = fastboot_write(context->usbdev_out, response, strlen(response));
+  ret = context->ops->write(context, response, strlen(response));
   if (ret < 0)
     {
       printf("Reponse error [%d]\n", -ret);
       return;
     }
 
+  context->download_size = len;
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  if (context->stream.fd >= 0)
+    {
+      ret = fastboot_stream_download(context, len);
+      if (ret < 0)
+        {
+          fastboot_fail(context, "Stream download failure");
+        }
+      else
+        {
+          fastboot_okay(context, "");
+        }
+
+      return;
+    }
+#endif
+
   download = context->download_buffer;
 
   while (len > 0)
     {
-      ssize_t r = fastboot_read(context->usbdev_in,
-                                download, len);
-      if (r < 0)
+      ssize_t r = context->ops->read(context, download, len);
+      if (r <= 0)
         {
-          printf("fastboot_download usb read error\n");
+          printf("fastboot_download read error\n");
           return;
         }
 
@@ -476,7 +1045,6 @@ static void fastboot_download(FAR struct fastboot_ctx_s *context,
       download += r;
     }
 
-  context->download_size = len;
   fastboot_okay(context, "");
 }
 
@@ -527,15 +1095,20 @@ static void fastboot_command_loop(FAR struct fastboot_ctx_s *context)
 {
   while (1)
     {
-      char buffer[FASTBOOT_MSG_LEN];
+      char buffer[FASTBOOT_MSG_LEN + 1];
       size_t ncmds = nitems(g_fast_cmd);
       size_t index;
 
-      ssize_t r = fastboot_read(context->usbdev_in,
-                                buffer, FASTBOOT_MSG_LEN);
-      if (r < 0)
+      ssize_t r = context->ops->read(context, buffer, FASTBOOT_MSG_LEN);
+      if (r == -ECONNRESET)
+        {
+          /* Host went away, wait for the next one */
+
+          continue;
+        }
+      else if (r < 0)
         {
-          printf("USB read error\n");
+          printf("Transport read error\n");
           break;
         }
 
@@ -597,6 +1170,251 @@ static void fastboot_free_publish(FAR struct fastboot_ctx_s *context)
     }
 }
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_USB
+static int fastboot_usbdev_init(FAR struct fastboot_ctx_s *context)
+{
+  char usbdev[32];
+
+  snprintf(usbdev, sizeof(usbdev), "%s/ep%d",
+           FASTBOOT_USBDEV, FASTBOOT_EP_BULKOUT_IDX + 1);
+  context->tran_fd[0] = open(usbdev, O_RDONLY);
+  if (context->tran_fd[0] < 0)
+    {
+      printf("open [%s] error\n", usbdev);
+      return -errno;
+    }
+
+  snprintf(usbdev, sizeof(usbdev), "%s/ep%d",
+           FASTBOOT_USBDEV, FASTBOOT_EP_BULKIN_IDX + 1);
+  context->tran_fd[1] = open(usbdev, O_WRONLY);
+  if (context->tran_fd[1] < 0)
+    {
+      printf("open [%s] error\n", usbdev);
+      close(context->tran_fd[0]);
+      context->tran_fd[0] = -1;
+      return -errno;
+    }
+
+  return OK;
+}
+
+static void fastboot_usbdev_deinit(FAR struct fastboot_ctx_s *context)
+{
+  close(context->tran_fd[1]);
+  context->tran_fd[1] = -1;
+  close(context->tran_fd[0]);
+  context->tran_fd[0] = -1;
+}
+
+static ssize_t fastboot_usbdev_read(FAR struct fastboot_ctx_s *context,
+                                    FAR void *buf, size_t len)
+{
+  return fastboot_read(context->tran_fd[0], buf, len);
+}
+
+static int fastboot_usbdev_write(FAR struct fastboot_ctx_s *context,
+                                 FAR void *buf, size_t len)
+{
+  return fastboot_write(context->tran_fd[1], buf, len);
+}
+#endif
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_TCP
+static int fastboot_tcp_readall(int fd, FAR void *buf, size_t len)
+{
+  FAR char *data = buf;
+
+  while (len > 0)
+    {
+      ssize_t r = fastboot_read(fd, data, len);
+      if (r <= 0)
+        {
+          return r < 0 ? r : -ECONNRESET;
+        }
+
+      data += r;
+      len -= r;
+    }
+
+  return OK;
+}
+
+static void fastboot_tcp_disconnect(FAR struct fastboot_ctx_s *context)
+{
+  if (context->tran_fd[0] >= 0)
+    {
+      close(context->tran_fd[0]);
+    }
+
+  context->tran_fd[0] = -1;
+  context->tran_fd[1] = -1;
+  context->tcp_remain = 0;
+}
+
+static int fastboot_tcp_accept(FAR struct fastboot_ctx_s *context)
+{
+  char handshake[FASTBOOT_TCP_HANDSHAKE_LEN];
+  int ret;
+  int fd;
+
+  fd = accept(context->listen_fd, NULL, NULL);
+  if (fd < 0)
+    {
+      printf("accept error:%d\n", errno);
+      return -errno;
+    }
+
+  context->tran_fd[0] = fd;
+  context->tran_fd[1] = fd;
+  context->tcp_remain = 0;
+
+  ret = fastboot_tcp_readall(fd, handshake, sizeof(handshake));
+  if (ret >= 0)
+    {
+      if (memcmp(handshake, FASTBOOT_TCP_HANDSHAKE, 2) != 0)
+        {
+          printf("Invalid handshake\n");
+          ret = -EPROTO;
+        }
+      else
+        {
+          ret = fastboot_write(fd, FASTBOOT_TCP_HANDSHAKE,
+                               FASTBOOT_TCP_HANDSHAKE_LEN);
+        }
+    }
+
+  if (ret < 0)
+    {
+      fastboot_tcp_disconnect(context);
+    }
+
+  return ret;
+}
+
+static int fastboot_tcp_init(FAR struct fastboot_ctx_s *context)
+{
+  struct sockaddr_in addr;
+  int opt = 1;
+
+  context->tran_fd[0] = -1;
+  context->tran_fd[1] = -1;
+  context->tcp_remain = 0;
+
+  context->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (context->listen_fd < 0)
+    {
+      printf("socket error:%d\n", errno);
+      return -errno;
+    }
+
+  setsockopt(context->listen_fd, SOL_SOCKET, SO_REUSEADDR,
+             &opt, sizeof(opt));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(CONFIG_SYSTEM_FASTBOOTD_TCP_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  if (bind(context->listen_fd, (FAR struct sockaddr *)&addr,
+           sizeof(addr)) < 0 || listen(context->listen_fd, 1) < 0)
+    {
+      printf("bind/listen error:%d\n", errno);
+      close(context->listen_fd);
+      context->listen_fd = -1;
+      return -errno;
+    }
+
+  return OK;
+}
+
+static void fastboot_tcp_deinit(FAR struct fastboot_ctx_s *context)
+{
+  fastboot_tcp_disconnect(context);
+  close(context->listen_fd);
+  context->listen_fd = -1;
+}
+
+static ssize_t fastboot_tcp_read(FAR struct fastboot_ctx_s *context,
+                                 FAR void *buf, size_t len)
+{
+  ssize_t r;
+  int ret;
+
+  if (context->tran_fd[0] < 0)
+    {
+      ret = fastboot_tcp_accept(context);
+      if (ret < 0)
+        {
+          return ret == -ECONNRESET || ret == -EPROTO ? -ECONNRESET : ret;
+        }
+    }
+
+  /* Never read across a packet boundary, commands are one packet each */
+
+  if (context->tcp_remain == 0)
+    {
+      uint8_t hdr[FASTBOOT_TCP_HDR_LEN];
+      int i;
+
+      ret = fastboot_tcp_readall(context->tran_fd[0], hdr, sizeof(hdr));
+      if (ret < 0)
+        {
+          fastboot_tcp_disconnect(context);
+          return -ECONNRESET;
+        }
+
+      for (i = 0; i < FASTBOOT_TCP_HDR_LEN; i++)
+        {
+          context->tcp_remain = (context->tcp_remain << 8) | hdr[i];
+        }
+
+      if (context->tcp_remain == 0)
+        {
+          return 0;
+        }
+    }
+
+  r = fastboot_read(context->tran_fd[0], buf,
+                    MIN(len, context->tcp_remain));
+  if (r <= 0)
+    {
+      fastboot_tcp_disconnect(context);
+      return -ECONNRESET;
+    }
+
+  context->tcp_remain -= r;
+  return r;
+}
+
+static int fastboot_tcp_write(FAR struct fastboot_ctx_s *context,
+                              FAR void *buf, size_t len)
+{
+  uint8_t hdr[FASTBOOT_TCP_HDR_LEN];
+  uint64_t size = len;
+  int ret;
+  int i;
+
+  if (context->tran_fd[1] < 0)
+    {
+      return -ENOTCONN;
+    }
+
+  for (i = FASTBOOT_TCP_HDR_LEN - 1; i >= 0; i--)
+    {
+      hdr[i] = size & 0xff;
+      size >>= 8;
+    }
+
+  ret = fastboot_write(context->tran_fd[1], hdr, sizeof(hdr));
+  if (ret >= 0)
+    {
+      ret = fastboot_write(context->tran_fd[1], buf, len);
+    }
+
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -605,9 +1423,36 @@ int main(int argc, FAR char **argv)
 {
   FAR struct fastboot_ctx_s context;
   FAR void *buffer = NULL;
-  char usbdev[32];
   int ret = OK;
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_USB
+  context.ops = &g_tran_ops_usb;
+#else
+  context.ops = &g_tran_ops_tcp;
+#endif
+
+  if (argc > 1)
+    {
+#ifdef CONFIG_SYSTEM_FASTBOOTD_USB
+      if (strcmp(argv[1], "usb") == 0)
+        {
+          context.ops = &g_tran_ops_usb;
+        }
+      else
+#endif
+#ifdef CONFIG_SYSTEM_FASTBOOTD_TCP
+      if (strcmp(argv[1], "tcp") == 0)
+        {
+          context.ops = &g_tran_ops_tcp;
+        }
+      else
+#endif
+        {
+          printf("Usage: %s [usb|tcp]\n", argv[0]);
+          return -EINVAL;
+        }
+    }
+
   buffer = malloc(CONFIG_SYSTEM_FASTBOOTD_DOWNLOAD_MAX);
   if (buffer == NULL)
     {
@@ -615,41 +1460,38 @@ int main(int argc, FAR char **argv)
       return -ENOMEM;
     }
 
-  snprintf(usbdev, sizeof(usbdev), "%s/ep%d",
-           FASTBOOT_USBDEV, FASTBOOT_EP_BULKOUT_IDX + 1);
-  context.usbdev_in = open(usbdev, O_RDONLY);
-  if (context.usbdev_in < 0)
+  ret = context.ops->init(&context);
+  if (ret < 0)
     {
-      printf("open [%s] error\n", usbdev);
-      ret = -errno;
       goto err_with_mem;
     }
 
-  snprintf(usbdev, sizeof(usbdev), "%s/ep%d",
-           FASTBOOT_USBDEV, FASTBOOT_EP_BULKIN_IDX + 1);
-  context.usbdev_out = open(usbdev, O_WRONLY);
-  if (context.usbdev_out < 0)
-    {
-      printf("open [%s] error\n", usbdev);
-      ret = -errno;
-      goto err_with_in;
-    }
-
   context.download_buffer = buffer;
   context.download_size   = 0;
   context.download_offset = 0;
+  context.total_imgsize   = 0;
   context.download_max    = CONFIG_SYSTEM_FASTBOOTD_DOWNLOAD_MAX;
+  context.varlist         = NULL;
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  /* Streaming downloads double buffer within the download buffer */
+
+  context.stream.fd        = -1;
+  context.stream.complete  = false;
+  context.stream.bufsize   = CONFIG_SYSTEM_FASTBOOTD_DOWNLOAD_MAX / 2;
+  context.stream.buffer[0] = buffer;
+  context.stream.buffer[1] = (FAR uint8_t *)buffer +
+                             context.stream.bufsize;
+#endif
 
   fastboot_create_publish(&context);
   fastboot_command_loop(&context);
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  fastboot_stream_disarm(&context);
+#endif
   fastboot_free_publish(&context);
 
-  close(context.usbdev_out);
-  context.usbdev_out = -1;
-
-err_with_in:
-  close(context.usbdev_in);
-  context.usbdev_in = -1;
+  context.ops->deinit(&context);
 
 err_with_mem:
   free(buffer);
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <poll.h>
 
@@ -44,6 +45,7 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <system/nxcamera.h>
@@ -61,10 +63,348 @@
 #define NXCAMERA_STATE_LOOPING   2
 #define NXCAMERA_STATE_PAUSED    3
 
+/* A queue holds at most one entry per capture buffer or converted frame */
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+#  define NXCAMERA_QUEUE_SIZE    MAX(CONFIG_VIDEO_REQBUFS_COUNT_MAX, \
+                                     CONFIG_NXCAMERA_PIPELINE_FRAMES)
+#else
+#  define NXCAMERA_QUEUE_SIZE    CONFIG_VIDEO_REQBUFS_COUNT_MAX
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A frame on its way through the pipeline */
+
+struct nxcamera_frame_s
+{
+  int                     index;     /* Capture buffer or converted frame */
+  uint64_t                stamp;     /* Time of capture, in microseconds */
+};
+
+/* Bounded FIFO of frames between two threads */
+
+struct nxcamera_queue_s
+{
+  pthread_mutex_t         lock;      /* Protects the fields below */
+  pthread_cond_t          cond;      /* Signals a new entry or stop */
+  int                     head;      /* Oldest entry */
+  int                     count;     /* Number of entries */
+  bool                    stop;      /* The stream is being torn down */
+  struct nxcamera_frame_s frames[NXCAMERA_QUEUE_SIZE];
+};
+
+/* Per-stream state that lives from nxcamera_stream() to the end of the
+ * loop thread.
+ */
+
+struct nxcamera_pipeline_s
+{
+  pthread_mutex_t         lock;      /* Protects the statistics */
+  struct nxcamera_stats_s stats;     /* Statistics of the stream */
+  uint64_t                total[NXCAMERA_NSTAGES];  /* Sum of frame times */
+  uint64_t                second[NXCAMERA_NSTAGES]; /* Start of fps window */
+  uint32_t                window[NXCAMERA_NSTAGES]; /* Frames in window */
+  uint64_t                latency;   /* Sum of capture to display times */
+  FAR uint8_t            *i420;      /* Intermediate frame for conversion */
+
+  /* Raw frame file used as capture device */
+
+  struct nxcamera_queue_s freebufs;  /* Capture buffers ready to be filled */
+  uint64_t                period;    /* Frame period, in microseconds */
+  uint64_t                next;      /* Time the next frame is due */
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+  struct nxcamera_queue_s convq;     /* Captured frames to be converted */
+  struct nxcamera_queue_s dispq;     /* Converted frames to be displayed */
+  struct nxcamera_queue_s freeq;     /* Converted frames ready to be reused */
+  pthread_t               convert;   /* The conversion thread */
+  pthread_t               display;   /* The display thread */
+  size_t                  framesize; /* Size of a converted frame */
+  FAR uint8_t            *frames[CONFIG_NXCAMERA_PIPELINE_FRAMES];
+#endif
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxcamera_now
+ *
+ *   Return the monotonic time in microseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t nxcamera_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: nxcamera_queue_*
+ *
+ *   Frame queues between the capture, conversion and display stages.  A
+ *   queue never holds more than NXCAMERA_QUEUE_SIZE frames, so push does
+ *   not block.  pop blocks until a frame is queued and returns false once
+ *   the queue is stopped.
+ *
+ ****************************************************************************/
+
+static void nxcamera_queue_init(FAR struct nxcamera_queue_s *queue)
+{
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->cond, NULL);
+  queue->head  = 0;
+  queue->count = 0;
+  queue->stop  = false;
+}
+
+static void nxcamera_queue_destroy(FAR struct nxcamera_queue_s *queue)
+{
+  pthread_cond_destroy(&queue->cond);
+  pthread_mutex_destroy(&queue->lock);
+}
+
+static void nxcamera_queue_push(FAR struct nxcamera_queue_s *queue,
+                                int index, uint64_t stamp)
+{
+  FAR struct nxcamera_frame_s *frame;
+
+  pthread_mutex_lock(&queue->lock);
+  DEBUGASSERT(queue->count < NXCAMERA_QUEUE_SIZE);
+
+  frame = &queue->frames[(queue->head + queue->count) % NXCAMERA_QUEUE_SIZE];
+  frame->index = index;
+  frame->stamp = stamp;
+  queue->count++;
+
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+static bool nxcamera_queue_pop(FAR struct nxcamera_queue_s *queue,
+                               FAR struct nxcamera_frame_s *frame)
+{
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->stop)
+    {
+      pthread_cond_wait(&queue->cond, &queue->lock);
+    }
+
+  if (queue->stop)
+    {
+      pthread_mutex_unlock(&queue->lock);
+      return false;
+    }
+
+  *frame = queue->frames[queue->head];
+  queue->head = (queue->head + 1) % NXCAMERA_QUEUE_SIZE;
+  queue->count--;
+
+  pthread_mutex_unlock(&queue->lock);
+  return true;
+}
+
+static void nxcamera_queue_stop(FAR struct nxcamera_queue_s *queue)
+{
+  pthread_mutex_lock(&queue->lock);
+  queue->stop = true;
+  pthread_cond_broadcast(&queue->cond);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/****************************************************************************
+ * Name: nxcamera_account
+ *
+ *   Account one frame that spent start..end (microseconds) in a stage.
+ *   The frame rate of the stage is updated about once per second.
+ *
+ ****************************************************************************/
+
+static void nxcamera_account(FAR struct nxcamera_s *pcam, int stage,
+                             uint64_t start, uint64_t end)
+{
+  FAR struct nxcamera_pipeline_s *pipe = pcam->pipeline;
+  FAR struct nxcamera_stage_stats_s *stats = &pipe->stats.stage[stage];
+  uint32_t elapsed = end - start;
+
+  pthread_mutex_lock(&pipe->lock);
+
+  stats->frames++;
+  pipe->total[stage] += elapsed;
+  stats->avgtime = pipe->total[stage] / stats->frames;
+  if (elapsed > stats->maxtime)
+    {
+      stats->maxtime = elapsed;
+    }
+
+  if (pipe->second[stage] == 0)
+    {
+      pipe->second[stage] = start;
+    }
+
+  pipe->window[stage]++;
+  if (end - pipe->second[stage] >= 1000000)
+    {
+      stats->fps = (uint64_t)pipe->window[stage] * 1000000 /
+                   (end - pipe->second[stage]);
+      pipe->window[stage] = 0;
+      pipe->second[stage] = end;
+    }
+
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+/****************************************************************************
+ * Name: nxcamera_latency
+ *
+ *   Account the time from the capture of a frame to the end of its display.
+ *
+ ****************************************************************************/
+
+static void nxcamera_latency(FAR struct nxcamera_s *pcam, uint64_t stamp,
+                             uint64_t end)
+{
+  FAR struct nxcamera_pipeline_s *pipe = pcam->pipeline;
+  FAR struct nxcamera_stats_s *stats = &pipe->stats;
+  uint32_t latency = end - stamp;
+
+  pthread_mutex_lock(&pipe->lock);
+
+  pipe->latency += latency;
+  stats->avglatency = pipe->latency /
+                      stats->stage[NXCAMERA_STAGE_DISPLAY].frames;
+  if (latency > stats->maxlatency)
+    {
+      stats->maxlatency = latency;
+    }
+
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+/****************************************************************************
+ * Name: nxcamera_framesize
+ *
+ *   Return the size of a raw frame of the given V4L2 pixel format, or 0 if
+ *   the format is not known.
+ *
+ ****************************************************************************/
+
+static size_t nxcamera_framesize(uint32_t format, uint16_t width,
+                                 uint16_t height)
+{
+  size_t pixels = (size_t)width * height;
+
+  switch (format)
+    {
+      case V4L2_PIX_FMT_YUV420:
+      case V4L2_PIX_FMT_NV12:
+        return pixels * 3 / 2;
+
+      case V4L2_PIX_FMT_RGB565:
+      case V4L2_PIX_FMT_YUYV:
+      case V4L2_PIX_FMT_UYVY:
+        return pixels * 2;
+
+      case V4L2_PIX_FMT_RGB24:
+        return pixels * 3;
+
+      case V4L2_PIX_FMT_RGB32:
+        return pixels * 4;
+
+      default:
+        return 0;
+    }
+}
+
+/****************************************************************************
+ * Name: nxcamera_dqbuf
+ *
+ *   Get the next captured frame.  A raw frame file is read from the start
+ *   again at its end, one frame per frame period.
+ *
+ ****************************************************************************/
+
+static int nxcamera_dqbuf(FAR struct nxcamera_s *pcam,
+                          FAR struct v4l2_buffer *buf)
+{
+  FAR struct nxcamera_pipeline_s *pipe = pcam->pipeline;
+  struct nxcamera_frame_s frame;
+  size_t size = pcam->fmt.fmt.pix.sizeimage;
+  ssize_t nread;
+  uint64_t now;
+
+  if (!pcam->capture_file)
+    {
+      if (ioctl(pcam->capture_fd, VIDIOC_DQBUF, (uintptr_t)buf) < 0)
+        {
+          return -errno;
+        }
+
+      return OK;
+    }
+
+  if (!nxcamera_queue_pop(&pipe->freebufs, &frame))
+    {
+      return -ESHUTDOWN;
+    }
+
+  nread = read(pcam->capture_fd, pcam->bufs[frame.index], size);
+  if (nread == 0)
+    {
+      lseek(pcam->capture_fd, 0, SEEK_SET);
+      nread = read(pcam->capture_fd, pcam->bufs[frame.index], size);
+    }
+
+  if (nread != (ssize_t)size)
+    {
+      return nread < 0 ? -errno : -ENODATA;
+    }
+
+  now = nxcamera_now();
+  if (pipe->next > now)
+    {
+      usleep(pipe->next - now);
+      now = pipe->next;
+    }
+
+  pipe->next = now + pipe->period;
+
+  buf->index     = frame.index;
+  buf->bytesused = size;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxcamera_qbuf
+ *
+ *   Give a capture buffer back to the device.
+ *
+ ****************************************************************************/
+
+static int nxcamera_qbuf(FAR struct nxcamera_s *pcam,
+                         FAR struct v4l2_buffer *buf)
+{
+  if (!pcam->capture_file)
+    {
+      if (ioctl(pcam->capture_fd, VIDIOC_QBUF, (uintptr_t)buf) < 0)
+        {
+          return -errno;
+        }
+
+      return OK;
+    }
+
+  nxcamera_queue_push(&pcam->pipeline->freebufs, buf->index, 0);
+  return OK;
+}
+
 /****************************************************************************
  * pan_display
  ****************************************************************************/
@@ -78,190 +418,619 @@ static void pan_display(int fb_device, FAR struct fb_planeinfo_s *plane_info)
 
   ret = poll(&pfd, 1, 0);
 
-  if (ret > 0)
+  if (ret > 0)
+    {
+      ioctl(fb_device, FBIOPAN_DISPLAY, plane_info);
+    }
+}
+
+/****************************************************************************
+ * show_image
+ *
+ *   Convert capture buffer index into the display format at dst, whose
+ *   lines are stride bytes apart.
+ *
+ ****************************************************************************/
+
+static int show_image(FAR struct nxcamera_s *pcam, uint32_t index,
+                      FAR uint8_t *dst, uint32_t stride)
+{
+  FAR uint8_t *src = pcam->bufs[index];
+  uint32_t width = pcam->fmt.fmt.pix.width;
+  uint32_t height = pcam->fmt.fmt.pix.height;
+
+  /* The frame is already in the display format, copy the lines */
+
+  if (pcam->fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_RGB565 &&
+      pcam->display_vinfo.fmt == FB_FMT_RGB16_565)
+    {
+      uint32_t y;
+
+      for (y = 0; y < height; y++)
+        {
+          memcpy(&dst[y * stride], &src[y * width * 2], width * 2);
+        }
+
+      return 0;
+    }
+
+#ifdef CONFIG_LIBYUV
+  if (pcam->display_vinfo.fmt == FB_FMT_RGB32)
+    {
+      return ConvertToARGB(src,
+                           pcam->buf_sizes[index],
+                           dst,
+                           stride,
+                           0,
+                           0,
+                           width,
+                           height,
+                           width,
+                           height,
+                           0,
+                           pcam->fmt.fmt.pix.pixelformat);
+    }
+  else if (pcam->display_vinfo.fmt == FB_FMT_RGB16_565)
+    {
+      FAR uint8_t *i420 = src;
+      int ret;
+
+      /* Anything but I420 goes through the preallocated I420 frame */
+
+      if (pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUV420)
+        {
+          i420 = pcam->pipeline->i420;
+          ret = ConvertToI420(src,
+                              pcam->buf_sizes[index],
+                              i420,
+                              width,
+                              &i420[width * height],
+                              width / 2,
+                              &i420[width * height * 5 / 4],
+                              width / 2,
+                              0,
+                              0,
+                              width,
+                              height,
+                              width,
+                              height,
+                              0,
+                              pcam->fmt.fmt.pix.pixelformat);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      return ConvertFromI420(i420,
+                             width,
+                             &i420[width * height],
+                             width / 2,
+                             &i420[width * height * 5 / 4],
+                             width / 2,
+                             dst,
+                             stride,
+                             width,
+                             height,
+                             V4L2_PIX_FMT_RGB565);
+    }
+
+  return 0;
+#else
+  FAR uint32_t *pbuf = (FAR uint32_t *)src;
+  vinfo("show image from %p: %" PRIx32 " %" PRIx32, pbuf, pbuf[0], pbuf[1]);
+  return 0;
+#endif
+}
+
+/****************************************************************************
+ * Name: nxcamera_opendevice
+ *
+ *   nxcamera_opendevice() tries to open the preferred devices as specified.
+ *
+ * Return:
+ *    OK        if compatible device opened (searched or preferred)
+ *    -ENODEV   if no compatible device opened.
+ *    -ENOENT   if preferred device couldn't be opened.
+ *
+ ****************************************************************************/
+
+static int nxcamera_opendevice(FAR struct nxcamera_s *pcam)
+{
+  int errcode;
+
+  if (pcam->capturedev[0] != '\0')
+    {
+      pcam->capture_fd = open(pcam->capturedev,
+                              pcam->capture_file ? O_RDONLY : O_RDWR);
+      if (pcam->capture_fd == -1)
+        {
+          errcode = errno;
+          DEBUGASSERT(errcode > 0);
+
+          verr("ERROR: Failed to open pcam->capturedev %d\n", -errcode);
+          return -errcode;
+        }
+
+      if (pcam->displaydev[0] != '\0')
+        {
+          pcam->display_fd = open(pcam->displaydev, O_RDWR);
+          if (pcam->display_fd == -1)
+            {
+              errcode = errno;
+              DEBUGASSERT(errcode > 0);
+
+              close(pcam->capture_fd);
+              pcam->capture_fd = -1;
+              verr("ERROR: Failed to open pcam->displaydev %d\n", -errcode);
+              return -errcode;
+            }
+
+          errcode = ioctl(pcam->display_fd, FBIOGET_PLANEINFO,
+                          ((uintptr_t)&pcam->display_pinfo));
+
+          if (errcode == OK)
+            {
+              pcam->display_pinfo.fbmem = mmap(NULL,
+                                               pcam->display_pinfo.fblen,
+                                               PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_FILE,
+                                               pcam->display_fd,
+                                               0);
+            }
+
+          if (errcode < 0 || pcam->display_pinfo.fbmem == MAP_FAILED)
+            {
+              errcode = errno;
+              close(pcam->capture_fd);
+              close(pcam->display_fd);
+              verr("ERROR: ioctl(FBIOGET_PLANEINFO) failed: %d\n", -errcode);
+              return -errcode;
+            }
+
+          return OK;
+        }
+      else
+        {
+          /* TODO: Add file output */
+
+          return -ENOTSUP;
+        }
+    }
+
+  return -ENODEV;
+}
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+
+/****************************************************************************
+ * Name: nxcamera_stopstream
+ *
+ *   Ask the loop thread to stop the stream, e.g. after an error in one of
+ *   the pipeline threads.
+ *
+ ****************************************************************************/
+
+static void nxcamera_stopstream(FAR struct nxcamera_s *pcam)
+{
+  struct video_msg_s term_msg;
+
+  term_msg.msg_id = VIDEO_MSG_STOP;
+  term_msg.u.data = 0;
+  mq_send(pcam->mq, (FAR const char *)&term_msg, sizeof(term_msg),
+          CONFIG_NXCAMERA_MSG_PRIO);
+
+  /* The loop thread may be waiting for a buffer of a raw frame file that
+   * will never be returned.
+   */
+
+  nxcamera_queue_stop(&pcam->pipeline->freebufs);
+}
+
+/****************************************************************************
+ * Name: nxcamera_convertthread
+ *
+ *   Convert captured frames into free converted frames and give the capture
+ *   buffers back to the device.
+ *
+ ****************************************************************************/
+
+static FAR void *nxcamera_convertthread(pthread_addr_t pvarg)
+{
+  FAR struct nxcamera_s *pcam = (FAR struct nxcamera_s *)pvarg;
+  FAR struct nxcamera_pipeline_s *pipe = pcam->pipeline;
+  struct nxcamera_frame_s captured;
+  struct nxcamera_frame_s slot;
+  struct v4l2_buffer buf;
+  uint64_t start;
+  int ret;
+
+  memset(&buf, 0, sizeof(buf));
+  buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+
+  while (nxcamera_queue_pop(&pipe->convq, &captured) &&
+         nxcamera_queue_pop(&pipe->freeq, &slot))
+    {
+      start = nxcamera_now();
+      ret = show_image(pcam, captured.index, pipe->frames[slot.index],
+                       pcam->display_pinfo.stride);
+      nxcamera_account(pcam, NXCAMERA_STAGE_CONVERT, start, nxcamera_now());
+
+      buf.index = captured.index;
+      if (ret >= 0)
+        {
+          ret = nxcamera_qbuf(pcam, &buf);
+        }
+
+      if (ret < 0)
+        {
+          verr("Fail to convert image %d\n", -ret);
+          nxcamera_stopstream(pcam);
+          break;
+        }
+
+      nxcamera_queue_push(&pipe->dispq, slot.index, captured.stamp);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxcamera_displaythread
+ *
+ *   Copy converted frames to the framebuffer.
+ *
+ ****************************************************************************/
+
+static FAR void *nxcamera_displaythread(pthread_addr_t pvarg)
+{
+  FAR struct nxcamera_s *pcam = (FAR struct nxcamera_s *)pvarg;
+  FAR struct nxcamera_pipeline_s *pipe = pcam->pipeline;
+  struct nxcamera_frame_s frame;
+  uint64_t start;
+  uint64_t end;
+
+  while (nxcamera_queue_pop(&pipe->dispq, &frame))
+    {
+      start = nxcamera_now();
+      memcpy(pcam->display_pinfo.fbmem, pipe->frames[frame.index],
+             MIN(pipe->framesize, pcam->display_pinfo.fblen));
+
+      if (pcam->display_pinfo.yres_virtual > pcam->display_vinfo.yres)
+        {
+          pan_display(pcam->display_fd, &pcam->display_pinfo);
+        }
+
+      end = nxcamera_now();
+      nxcamera_account(pcam, NXCAMERA_STAGE_DISPLAY, start, end);
+      nxcamera_latency(pcam, frame.stamp, end);
+
+      nxcamera_queue_push(&pipe->freeq, frame.index, 0);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxcamera_startthread
+ ****************************************************************************/
+
+static int nxcamera_startthread(FAR pthread_t *thread,
+                                pthread_startroutine_t entry,
+                                FAR struct nxcamera_s *pcam,
+                                FAR const char *name)
+{
+  struct sched_param sparam;
+  pthread_attr_t     tattr;
+  int                ret;
+
+  pthread_attr_init(&tattr);
+  sparam.sched_priority = sched_get_priority_max(SCHED_FIFO) - 9;
+  pthread_attr_setschedparam(&tattr, &sparam);
+  pthread_attr_setstacksize(&tattr, CONFIG_NXCAMERA_PIPELINE_STACKSIZE);
+
+  ret = pthread_create(thread, &tattr, entry, (pthread_addr_t)pcam);
+  pthread_attr_destroy(&tattr);
+  if (ret != OK)
+    {
+      verr("ERROR: Failed to create %s thread: %d\n", name, ret);
+      return -ret;
+    }
+
+  pthread_setname_np(*thread, name);
+  return OK;
+}
+#endif /* CONFIG_NXCAMERA_PIPELINE */
+
+/****************************************************************************
+ * Name: nxcamera_pipeline_free
+ *
+ *   Stop the pipeline threads and free the per-stream state.  The
+ *   statistics are kept in the context for nxcamera_getstats().
+ *
+ ****************************************************************************/
+
+static void nxcamera_pipeline_free(FAR struct nxcamera_s *pcam)
+{
+  FAR struct nxcamera_pipeline_s *pipe = pcam->pipeline;
+#ifdef CONFIG_NXCAMERA_PIPELINE
+  int i;
+#endif
+
+  if (pipe == NULL)
+    {
+      return;
+    }
+
+  nxcamera_queue_stop(&pipe->freebufs);
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+  nxcamera_queue_stop(&pipe->convq);
+  nxcamera_queue_stop(&pipe->dispq);
+  nxcamera_queue_stop(&pipe->freeq);
+
+  if (pipe->convert > 0)
+    {
+      pthread_join(pipe->convert, NULL);
+    }
+
+  if (pipe->display > 0)
+    {
+      pthread_join(pipe->display, NULL);
+    }
+
+  for (i = 0; i < CONFIG_NXCAMERA_PIPELINE_FRAMES; i++)
+    {
+      free(pipe->frames[i]);
+    }
+
+  nxcamera_queue_destroy(&pipe->convq);
+  nxcamera_queue_destroy(&pipe->dispq);
+  nxcamera_queue_destroy(&pipe->freeq);
+#endif
+
+  pthread_mutex_lock(&pcam->mutex);
+  pcam->stats = pipe->stats;
+  pcam->stats.streaming = false;
+  pcam->pipeline = NULL;
+  pthread_mutex_unlock(&pcam->mutex);
+
+  nxcamera_queue_destroy(&pipe->freebufs);
+  pthread_mutex_destroy(&pipe->lock);
+  free(pipe->i420);
+  free(pipe);
+}
+
+/****************************************************************************
+ * Name: nxcamera_pipeline_alloc
+ *
+ *   Allocate the per-stream state: the conversion buffers for the current
+ *   format and, with CONFIG_NXCAMERA_PIPELINE, the converted frames and the
+ *   conversion and display threads.
+ *
+ ****************************************************************************/
+
+static int nxcamera_pipeline_alloc(FAR struct nxcamera_s *pcam,
+                                   uint32_t framerate)
+{
+  FAR struct nxcamera_pipeline_s *pipe;
+#ifdef CONFIG_NXCAMERA_PIPELINE
+  int ret;
+  int i;
+#endif
+
+  pipe = zalloc(sizeof(struct nxcamera_pipeline_s));
+  if (pipe == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  pthread_mutex_init(&pipe->lock, NULL);
+  nxcamera_queue_init(&pipe->freebufs);
+  pipe->stats.streaming = true;
+  pipe->period = framerate > 0 ? 1000000 / framerate : 0;
+  pcam->pipeline = pipe;
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+  nxcamera_queue_init(&pipe->convq);
+  nxcamera_queue_init(&pipe->dispq);
+  nxcamera_queue_init(&pipe->freeq);
+#endif
+
+#ifdef CONFIG_LIBYUV
+  /* Formats other than I420 are converted to RGB565 through I420 */
+
+  if (pcam->display_vinfo.fmt == FB_FMT_RGB16_565 &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUV420 &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_RGB565)
+    {
+      pipe->i420 = malloc(pcam->fmt.fmt.pix.width *
+                          pcam->fmt.fmt.pix.height * 3 / 2);
+      if (pipe->i420 == NULL)
+        {
+          nxcamera_pipeline_free(pcam);
+          return -ENOMEM;
+        }
+    }
+#endif
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+  pipe->framesize = pcam->display_pinfo.stride * pcam->fmt.fmt.pix.height;
+  for (i = 0; i < CONFIG_NXCAMERA_PIPELINE_FRAMES; i++)
+    {
+      pipe->frames[i] = malloc(pipe->framesize);
+      if (pipe->frames[i] == NULL)
+        {
+          nxcamera_pipeline_free(pcam);
+          return -ENOMEM;
+        }
+
+      nxcamera_queue_push(&pipe->freeq, i, 0);
+    }
+
+  ret = nxcamera_startthread(&pipe->convert, nxcamera_convertthread, pcam,
+                             "nxcameraconv");
+  if (ret < 0)
+    {
+      nxcamera_pipeline_free(pcam);
+      return ret;
+    }
+
+  ret = nxcamera_startthread(&pipe->display, nxcamera_displaythread, pcam,
+                             "nxcameradisp");
+  if (ret < 0)
+    {
+      nxcamera_pipeline_free(pcam);
+      return ret;
+    }
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxcamera_mmapbufs
+ *
+ *   Set the capture format and map the capture buffers of the device.
+ *
+ ****************************************************************************/
+
+static int nxcamera_mmapbufs(FAR struct nxcamera_s *pcam, uint32_t framerate)
+{
+  struct v4l2_buffer         buf;
+  struct v4l2_requestbuffers req;
+  struct v4l2_streamparm     parm;
+  int                        ret;
+  int                        i;
+
+  ret = ioctl(pcam->capture_fd, VIDIOC_S_FMT, (uintptr_t)&pcam->fmt);
+  if (ret < 0)
+    {
+      ret = -errno;
+      verr("VIDIOC_S_FMT failed: %d\n", ret);
+      return ret;
+    }
+
+  memset(&parm, 0, sizeof(parm));
+  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  parm.parm.capture.timeperframe.denominator = framerate;
+  parm.parm.capture.timeperframe.numerator = 1;
+  ret = ioctl(pcam->capture_fd, VIDIOC_S_PARM, (uintptr_t)&parm);
+  if (ret < 0)
+    {
+      ret = -errno;
+      verr("VIDIOC_S_PARM failed: %d\n", ret);
+      return ret;
+    }
+
+  /* VIDIOC_REQBUFS initiate user pointer I/O */
+
+  memset(&req, 0, sizeof(req));
+  req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.memory = V4L2_MEMORY_MMAP;
+  req.count  = CONFIG_VIDEO_REQBUFS_COUNT_MAX;
+
+  ret = ioctl(pcam->capture_fd, VIDIOC_REQBUFS, (uintptr_t)&req);
+  if (ret < 0)
+    {
+      ret = -errno;
+      verr("VIDIOC_REQBUFS failed: %d\n", ret);
+      return ret;
+    }
+
+  if (req.count < 2)
     {
-      ioctl(fb_device, FBIOPAN_DISPLAY, plane_info);
+      verr("VIDIOC_REQBUFS failed: not enough buffers\n");
+      return -ENOMEM;
     }
-}
 
-static int show_image(FAR struct nxcamera_s *pcam, FAR v4l2_buffer_t *buf)
-{
-#ifdef CONFIG_LIBYUV
-  if (pcam->display_vinfo.fmt == FB_FMT_RGB32)
+  pcam->nbuffers  = req.count;
+  pcam->bufs      = calloc(req.count, sizeof(*pcam->bufs));
+  pcam->buf_sizes = calloc(req.count, sizeof(*pcam->buf_sizes));
+  if (pcam->bufs == NULL || pcam->buf_sizes == NULL)
     {
-      return ConvertToARGB(pcam->bufs[buf->index],
-                           pcam->buf_sizes[buf->index],
-                           pcam->display_pinfo.fbmem,
-                           pcam->display_pinfo.stride,
-                           0,
-                           0,
-                           pcam->fmt.fmt.pix.width,
-                           pcam->fmt.fmt.pix.height,
-                           pcam->fmt.fmt.pix.width,
-                           pcam->fmt.fmt.pix.height,
-                           0,
-                           pcam->fmt.fmt.pix.pixelformat);
+      verr("Cannot allocate buffer pointers\n");
+      return -ENOMEM;
     }
-  else if (pcam->display_vinfo.fmt == FB_FMT_RGB16_565)
+
+  /* VIDIOC_QBUF enqueue buffer */
+
+  for (i = 0; i < req.count; i++)
     {
-      if (pcam->fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUV420)
+      memset(&buf, 0, sizeof(buf));
+      buf.type   = req.type;
+      buf.memory = V4L2_MEMORY_MMAP;
+      buf.index  = i;
+      ret = ioctl(pcam->capture_fd, VIDIOC_QUERYBUF, (uintptr_t)&buf);
+      if (ret < 0)
         {
-          return ConvertFromI420(pcam->bufs[buf->index],
-                                 pcam->fmt.fmt.pix.width,
-                                 &pcam->bufs[buf->index][
-                                            pcam->fmt.fmt.pix.width *
-                                            pcam->fmt.fmt.pix.height],
-                                 pcam->fmt.fmt.pix.width / 2,
-                                 &pcam->bufs[buf->index][
-                                      pcam->fmt.fmt.pix.width *
-                                      pcam->fmt.fmt.pix.height * 5 / 4],
-                                 pcam->fmt.fmt.pix.width / 2,
-                                 pcam->display_pinfo.fbmem,
-                                 pcam->display_pinfo.stride,
-                                 pcam->fmt.fmt.pix.width,
-                                 pcam->fmt.fmt.pix.height,
-                                 V4L2_PIX_FMT_RGB565);
+          ret = -errno;
+          verr("VIDIOC_QUERYBUF failed: %d\n", ret);
+          return ret;
         }
-      else
-        {
-          int ret;
-          FAR uint8_t *dst = malloc(pcam->fmt.fmt.pix.width *
-                                    pcam->fmt.fmt.pix.height * 3 / 2);
-          if (!dst)
-            {
-              return -ENOMEM;
-            }
-
-          ret = ConvertToI420(pcam->bufs[buf->index],
-                              pcam->buf_sizes[buf->index],
-                              dst,
-                              pcam->fmt.fmt.pix.width,
-                              &dst[pcam->fmt.fmt.pix.width *
-                                        pcam->fmt.fmt.pix.height],
-                              pcam->fmt.fmt.pix.width / 2,
-                              &dst[pcam->fmt.fmt.pix.width *
-                                        pcam->fmt.fmt.pix.height * 5 / 4],
-                              pcam->fmt.fmt.pix.width / 2,
-                              0,
-                              0,
-                              pcam->fmt.fmt.pix.width,
-                              pcam->fmt.fmt.pix.height,
-                              pcam->fmt.fmt.pix.width,
-                              pcam->fmt.fmt.pix.height,
-                              0,
-                              pcam->fmt.fmt.pix.pixelformat);
-          if (ret < 0)
-            {
-              goto err;
-            }
-
-          ret = ConvertFromI420(dst,
-                                pcam->fmt.fmt.pix.width,
-                                &dst[pcam->fmt.fmt.pix.width *
-                                            pcam->fmt.fmt.pix.height],
-                                pcam->fmt.fmt.pix.width / 2,
-                                &dst[pcam->fmt.fmt.pix.width *
-                                     pcam->fmt.fmt.pix.height * 5 / 4],
-                                pcam->fmt.fmt.pix.width / 2,
-                                pcam->display_pinfo.fbmem,
-                                pcam->display_pinfo.stride,
-                                pcam->fmt.fmt.pix.width,
-                                pcam->fmt.fmt.pix.height,
-                                V4L2_PIX_FMT_RGB565);
-          if (ret < 0)
-            {
-              goto err;
-            }
 
-err:
-          free(dst);
+      pcam->bufs[i] = mmap(NULL, buf.length,
+                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                           pcam->capture_fd, buf.m.offset);
+      if (pcam->bufs[i] == MAP_FAILED)
+        {
+          ret = -errno;
+          verr("MMAP failed\n");
           return ret;
         }
+
+      pcam->buf_sizes[i] = buf.length;
     }
 
-  return 0;
-#else
-  FAR uint32_t *pbuf = (FAR uint32_t *)pcam->bufs[buf->index];
-  vinfo("show image from %p: %" PRIx32 " %" PRIx32, pbuf, pbuf[0], pbuf[1]);
-  return 0;
-#endif
+  return OK;
 }
 
 /****************************************************************************
- * Name: nxcamera_opendevice
- *
- *   nxcamera_opendevice() tries to open the preferred devices as specified.
+ * Name: nxcamera_filebufs
  *
- * Return:
- *    OK        if compatible device opened (searched or preferred)
- *    -ENODEV   if no compatible device opened.
- *    -ENOENT   if preferred device couldn't be opened.
+ *   Allocate the capture buffers of a raw frame file.
  *
  ****************************************************************************/
 
-static int nxcamera_opendevice(FAR struct nxcamera_s *pcam)
+static int nxcamera_filebufs(FAR struct nxcamera_s *pcam)
 {
-  int errcode;
+  size_t size = nxcamera_framesize(pcam->fmt.fmt.pix.pixelformat,
+                                   pcam->fmt.fmt.pix.width,
+                                   pcam->fmt.fmt.pix.height);
+  int i;
 
-  if (pcam->capturedev[0] != '\0')
+  if (size == 0)
     {
-      pcam->capture_fd = open(pcam->capturedev, O_RDWR);
-      if (pcam->capture_fd == -1)
-        {
-          errcode = errno;
-          DEBUGASSERT(errcode > 0);
-
-          verr("ERROR: Failed to open pcam->capturedev %d\n", -errcode);
-          return -errcode;
-        }
-
-      if (pcam->displaydev[0] != '\0')
-        {
-          pcam->display_fd = open(pcam->displaydev, O_RDWR);
-          if (pcam->display_fd == -1)
-            {
-              errcode = errno;
-              DEBUGASSERT(errcode > 0);
-
-              close(pcam->capture_fd);
-              pcam->capture_fd = -1;
-              verr("ERROR: Failed to open pcam->displaydev %d\n", -errcode);
-              return -errcode;
-            }
-
-          errcode = ioctl(pcam->display_fd, FBIOGET_PLANEINFO,
-                          ((uintptr_t)&pcam->display_pinfo));
+      return -ENOSYS;
+    }
 
-          if (errcode == OK)
-            {
-              pcam->display_pinfo.fbmem = mmap(NULL,
-                                               pcam->display_pinfo.fblen,
-                                               PROT_READ | PROT_WRITE,
-                                               MAP_SHARED | MAP_FILE,
-                                               pcam->display_fd,
-                                               0);
-            }
+  if (CONFIG_VIDEO_REQBUFS_COUNT_MAX < 2)
+    {
+      return -ENOMEM;
+    }
 
-          if (errcode < 0 || pcam->display_pinfo.fbmem == MAP_FAILED)
-            {
-              errcode = errno;
-              close(pcam->capture_fd);
-              close(pcam->display_fd);
-              verr("ERROR: ioctl(FBIOGET_PLANEINFO) failed: %d\n", -errcode);
-              return -errcode;
-            }
+  pcam->fmt.fmt.pix.sizeimage = size;
+  pcam->nbuffers  = CONFIG_VIDEO_REQBUFS_COUNT_MAX;
+  pcam->bufs      = calloc(pcam->nbuffers, sizeof(*pcam->bufs));
+  pcam->buf_sizes = calloc(pcam->nbuffers, sizeof(*pcam->buf_sizes));
+  if (pcam->bufs == NULL || pcam->buf_sizes == NULL)
+    {
+      return -ENOMEM;
+    }
 
-          return OK;
-        }
-      else
+  for (i = 0; i < pcam->nbuffers; i++)
+    {
+      pcam->bufs[i] = malloc(size);
+      if (pcam->bufs[i] == NULL)
         {
-          /* TODO: Add file output */
-
-          return -ENOTSUP;
+          return -ENOMEM;
         }
+
+      pcam->buf_sizes[i] = size;
     }
 
-  return -ENODEV;
+  return OK;
 }
 
 /****************************************************************************
@@ -298,6 +1067,8 @@ static void nxcamera_jointhread(FAR struct nxcamera_s *pcam)
  * Name: nxcamera_loopthread
  *
  *  This is the thread that streams the video and handles video controls.
+ *  With CONFIG_NXCAMERA_PIPELINE it only captures frames and hands them to
+ *  the conversion thread, otherwise it also converts and displays them.
  *
  ****************************************************************************/
 
@@ -312,6 +1083,11 @@ static void *nxcamera_loopthread(pthread_addr_t pvarg)
   int                     ret;
   struct v4l2_buffer      buf;
   uint32_t                type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  uint64_t                start;
+  uint64_t                stamp;
+#ifndef CONFIG_NXCAMERA_PIPELINE
+  uint64_t                end;
+#endif
 
   vinfo("Entry\n");
   memset(&buf, 0, sizeof(buf));
@@ -320,7 +1096,7 @@ static void *nxcamera_loopthread(pthread_addr_t pvarg)
       buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
       buf.memory = V4L2_MEMORY_MMAP;
       buf.index = i;
-      ret = ioctl(pcam->capture_fd, VIDIOC_QBUF, (uintptr_t)&buf);
+      ret = nxcamera_qbuf(pcam, &buf);
       if (ret < 0)
         {
           verr("VIDIOC_QBUF failed: %d\n", ret);
@@ -330,7 +1106,8 @@ static void *nxcamera_loopthread(pthread_addr_t pvarg)
 
   /* VIDIOC_STREAMON start stream */
 
-  ret = ioctl(pcam->capture_fd, VIDIOC_STREAMON, (uintptr_t)&type);
+  ret = pcam->capture_file ? OK :
+        ioctl(pcam->capture_fd, VIDIOC_STREAMON, (uintptr_t)&type);
   if (ret < 0)
     {
       verr("VIDIOC_STREAMON failed: %d\n", ret);
@@ -376,7 +1153,12 @@ static void *nxcamera_loopthread(pthread_addr_t pvarg)
                 /* Send a stop message to the device */
 
                 vinfo("Stopping looping\n");
-                ioctl(pcam->capture_fd, VIDIOC_STREAMOFF, (uintptr_t)&type);
+                if (!pcam->capture_file)
+                  {
+                    ioctl(pcam->capture_fd, VIDIOC_STREAMOFF,
+                          (uintptr_t)&type);
+                  }
+
                 streaming = false;
                 goto err_out;
 
@@ -387,31 +1169,49 @@ static void *nxcamera_loopthread(pthread_addr_t pvarg)
             }
         }
 
-      ret = ioctl(pcam->capture_fd, VIDIOC_DQBUF, (uintptr_t)&buf);
+      start = nxcamera_now();
+      ret = nxcamera_dqbuf(pcam, &buf);
       if (ret < 0)
         {
-          verr("Fail DQBUF %d\n", errno);
+          verr("Fail DQBUF %d\n", -ret);
           goto err_out;
         }
 
-      ret = show_image(pcam, &buf);
+      stamp = nxcamera_now();
+      nxcamera_account(pcam, NXCAMERA_STAGE_CAPTURE, start, stamp);
+
+#ifdef CONFIG_NXCAMERA_PIPELINE
+      /* The conversion thread gives the buffer back to the device */
+
+      nxcamera_queue_push(&pcam->pipeline->convq, buf.index, stamp);
+#else
+      ret = show_image(pcam, buf.index, pcam->display_pinfo.fbmem,
+                       pcam->display_pinfo.stride);
       if (ret < 0)
         {
           verr("Fail to show image %d\n", -ret);
           goto err_out;
         }
 
+      start = nxcamera_now();
+      nxcamera_account(pcam, NXCAMERA_STAGE_CONVERT, stamp, start);
+
       if (pcam->display_pinfo.yres_virtual > pcam->display_vinfo.yres)
         {
           pan_display(pcam->display_fd, &pcam->display_pinfo);
         }
 
-      ret = ioctl(pcam->capture_fd, VIDIOC_QBUF, (uintptr_t)&buf);
+      end = nxcamera_now();
+      nxcamera_account(pcam, NXCAMERA_STAGE_DISPLAY, start, end);
+      nxcamera_latency(pcam, stamp, end);
+
+      ret = nxcamera_qbuf(pcam, &buf);
       if (ret < 0)
         {
-          verr("Fail QBUF %d\n", errno);
+          verr("Fail QBUF %d\n", -ret);
           goto err_out;
         }
+#endif
     }
 
   /* Release our video buffers and unregister / release the device */
@@ -419,6 +1219,10 @@ static void *nxcamera_loopthread(pthread_addr_t pvarg)
 err_out:
   vinfo("Clean-up and exit\n");
 
+  /* Stop the conversion and display threads before the buffers go away */
+
+  nxcamera_pipeline_free(pcam);
+
   /* Cleanup */
 
   pthread_mutex_lock(&pcam->mutex);  /* Lock the mutex */
@@ -432,11 +1236,20 @@ err_out:
   pcam->loopstate = NXCAMERA_STATE_IDLE;
   for (i = 0; i < pcam->nbuffers; i++)
     {
-      munmap(pcam->bufs[i], pcam->buf_sizes[i]);
+      if (pcam->capture_file)
+        {
+          free(pcam->bufs[i]);
+        }
+      else
+        {
+          munmap(pcam->bufs[i], pcam->buf_sizes[i]);
+        }
     }
 
   free(pcam->bufs);
   free(pcam->buf_sizes);
+  pcam->bufs = NULL;
+  pcam->buf_sizes = NULL;
   pthread_mutex_unlock(&pcam->mutex);     /* Unlock the mutex */
 
   vinfo("Exit\n");
@@ -452,7 +1265,8 @@ err_out:
  * Name: nxcamera_setdevice
  *
  *   nxcamera_setdevice() sets the preferred video device to use with the
- *   provided nxcamera context.
+ *   provided nxcamera context.  A regular file is accepted as a source of
+ *   raw frames, which is read in a loop at the stream frame rate.
  *
  ****************************************************************************/
 
@@ -461,10 +1275,18 @@ int nxcamera_setdevice(FAR struct nxcamera_s *pcam,
 {
   int                    temp_fd;
   struct v4l2_capability caps;
+  struct stat            st;
 
   DEBUGASSERT(pcam != NULL);
   DEBUGASSERT(device != NULL);
 
+  if (stat(device, &st) == 0 && S_ISREG(st.st_mode))
+    {
+      strlcpy(pcam->capturedev, device, sizeof(pcam->capturedev));
+      pcam->capture_file = true;
+      return OK;
+    }
+
   /* Try to open the device */
 
   temp_fd = open(device, O_RDWR);
@@ -497,6 +1319,7 @@ int nxcamera_setdevice(FAR struct nxcamera_s *pcam,
     }
 
   strlcpy(pcam->capturedev, device, sizeof(pcam->capturedev));
+  pcam->capture_file = false;
   return OK;
 }
 
@@ -668,9 +1491,6 @@ int nxcamera_stream(FAR struct nxcamera_s *pcam,
   pthread_attr_t             tattr;
   int                        ret;
   int                        i;
-  struct v4l2_buffer         buf;
-  struct v4l2_requestbuffers req;
-  struct v4l2_streamparm     parm;
 
   DEBUGASSERT(pcam != NULL);
 
@@ -706,86 +1526,20 @@ int nxcamera_stream(FAR struct nxcamera_s *pcam,
   pcam->fmt.fmt.pix.field       = V4L2_FIELD_ANY;
   pcam->fmt.fmt.pix.pixelformat = format;
 
-  ret = ioctl(pcam->capture_fd, VIDIOC_S_FMT, (uintptr_t)&pcam->fmt);
-  if (ret < 0)
+  if (pcam->capture_file)
     {
-      ret = -errno;
-      verr("VIDIOC_S_FMT failed: %d\n", ret);
-      return ret;
+      ret = nxcamera_filebufs(pcam);
     }
-
-  memset(&parm, 0, sizeof(parm));
-  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  parm.parm.capture.timeperframe.denominator = framerate;
-  parm.parm.capture.timeperframe.numerator = 1;
-  ret = ioctl(pcam->capture_fd, VIDIOC_S_PARM, (uintptr_t)&parm);
-  if (ret < 0)
+  else
     {
-      ret = -errno;
-      verr("VIDIOC_S_PARM failed: %d\n", ret);
-      return ret;
+      ret = nxcamera_mmapbufs(pcam, framerate);
     }
 
-  /* VIDIOC_REQBUFS initiate user pointer I/O */
-
-  memset(&req, 0, sizeof(req));
-  req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  req.memory = V4L2_MEMORY_MMAP;
-  req.count  = CONFIG_VIDEO_REQBUFS_COUNT_MAX;
-
-  ret = ioctl(pcam->capture_fd, VIDIOC_REQBUFS, (uintptr_t)&req);
   if (ret < 0)
     {
-      ret = -errno;
-      verr("VIDIOC_REQBUFS failed: %d\n", ret);
-      return ret;
-    }
-
-  if (req.count < 2)
-    {
-      verr("VIDIOC_REQBUFS failed: not enough buffers\n");
-      return -ENOMEM;
-    }
-
-  pcam->nbuffers  = req.count;
-  pcam->bufs      = calloc(req.count, sizeof(*pcam->bufs));
-  pcam->buf_sizes = calloc(req.count, sizeof(*pcam->buf_sizes));
-  if (pcam->bufs == NULL || pcam->buf_sizes == NULL)
-    {
-      verr("Cannot allocate buffer pointers\n");
-      ret = -ENOMEM;
       goto err_out;
     }
 
-  /* VIDIOC_QBUF enqueue buffer */
-
-  for (i = 0; i < req.count; i++)
-    {
-      memset(&buf, 0, sizeof(buf));
-      buf.type   = req.type;
-      buf.memory = V4L2_MEMORY_MMAP;
-      buf.index  = i;
-      ret = ioctl(pcam->capture_fd, VIDIOC_QUERYBUF, (uintptr_t)&buf);
-      if (ret < 0)
-        {
-          ret = -errno;
-          verr("VIDIOC_QUERYBUF failed: %d\n", ret);
-          goto err_out;
-        }
-
-      pcam->bufs[i] = mmap(NULL, buf.length,
-                           PROT_READ | PROT_WRITE, MAP_SHARED,
-                           pcam->capture_fd, buf.m.offset);
-      if (pcam->bufs[i] == MAP_FAILED)
-        {
-          ret = -errno;
-          verr("MMAP failed\n");
-          goto err_out;
-        }
-
-      pcam->buf_sizes[i] = buf.length;
-    }
-
   /* Create a message queue for the loopthread */
 
   memset(&attr, 0, sizeof(attr));
@@ -806,6 +1560,17 @@ int nxcamera_stream(FAR struct nxcamera_s *pcam,
       goto err_out;
     }
 
+  /* Preallocate the conversion buffers and start the pipeline threads */
+
+  ret = nxcamera_pipeline_alloc(pcam, framerate);
+  if (ret < 0)
+    {
+      verr("ERROR: Failed to allocate the pipeline: %d\n", ret);
+      mq_close(pcam->mq);
+      mq_unlink(pcam->mqname);
+      goto err_out;
+    }
+
   /* Check if there was a previous thread and join it if there was
    * to perform clean-up.
    */
@@ -830,6 +1595,9 @@ int nxcamera_stream(FAR struct nxcamera_s *pcam,
     {
       ret = -ret;
       verr("ERROR: Failed to create loopthread: %d\n", ret);
+      nxcamera_pipeline_free(pcam);
+      mq_close(pcam->mq);
+      mq_unlink(pcam->mqname);
       goto err_out;
     }
 
@@ -843,18 +1611,24 @@ err_out:
     {
       for (i = 0; i < pcam->nbuffers; i++)
         {
-          if (pcam->bufs[i] != NULL && pcam->bufs[i] != MAP_FAILED)
+          if (pcam->capture_file)
+            {
+              free(pcam->bufs[i]);
+            }
+          else if (pcam->bufs[i] != NULL && pcam->bufs[i] != MAP_FAILED)
             {
               munmap(pcam->bufs[i], pcam->buf_sizes[i]);
             }
         }
 
       free(pcam->bufs);
+      pcam->bufs = NULL;
     }
 
   if (pcam->buf_sizes)
     {
       free(pcam->buf_sizes);
+      pcam->buf_sizes = NULL;
     }
 
   return ret;
@@ -965,3 +1739,34 @@ void nxcamera_reference(FAR struct nxcamera_s *pcam)
   pcam->crefs++;
   pthread_mutex_unlock(&pcam->mutex);
 }
+
+/****************************************************************************
+ * Name: nxcamera_getstats
+ *
+ *   nxcamera_getstats() returns the per-stage statistics of the current
+ *   stream, or of the last one if the camera is idle.
+ *
+ ****************************************************************************/
+
+int nxcamera_getstats(FAR struct nxcamera_s *pcam,
+                      FAR struct nxcamera_stats_s *stats)
+{
+  DEBUGASSERT(pcam != NULL && stats != NULL);
+
+  pthread_mutex_lock(&pcam->mutex);
+  if (pcam->pipeline != NULL)
+    {
+      /* The stage threads update the statistics under the pipeline lock */
+
+      pthread_mutex_lock(&pcam->pipeline->lock);
+      *stats = pcam->pipeline->stats;
+      pthread_mutex_unlock(&pcam->pipeline->lock);
+    }
+  else
+    {
+      *stats = pcam->stats;
+    }
+
+  pthread_mutex_unlock(&pcam->mutex);
+  return OK;
+}
@@ -32,6 +32,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <assert.h>
 
 #include <system/readline.h>
@@ -72,6 +73,7 @@ static int nxcamera_cmd_stream(FAR struct nxcamera_s *pcam, FAR char *parg);
 static int nxcamera_cmd_input(FAR struct nxcamera_s *pcam, FAR char *parg);
 static int nxcamera_cmd_output(FAR struct nxcamera_s *pcam, FAR char *parg);
 static int nxcamera_cmd_stop(FAR struct nxcamera_s *pcam, FAR char *parg);
+static int nxcamera_cmd_stats(FAR struct nxcamera_s *pcam, FAR char *parg);
 #ifdef CONFIG_NXCAMERA_INCLUDE_HELP
 static int nxcamera_cmd_help(FAR struct nxcamera_s *pcam, FAR char *parg);
 #endif
@@ -120,6 +122,12 @@ static const struct nxcamera_cmd_s g_nxcamera_cmds[] =
     nxcamera_cmd_stop,
     NXCAMERA_HELP_TEXT("Stop stream")
   },
+  {
+    "stats",
+    "",
+    nxcamera_cmd_stats,
+    NXCAMERA_HELP_TEXT("Show per-stage frame rate and latency")
+  },
   {
     "q",
     "",
@@ -212,6 +220,41 @@ static int nxcamera_cmd_stop(FAR struct nxcamera_s *pcam, FAR char *parg)
   return nxcamera_stop(pcam);
 }
 
+/****************************************************************************
+ * Name: nxcamera_cmd_stats
+ *
+ *   nxcamera_cmd_stats() shows the statistics of the current or of the last
+ *   stream.
+ *
+ ****************************************************************************/
+
+static int nxcamera_cmd_stats(FAR struct nxcamera_s *pcam, FAR char *parg)
+{
+  static FAR const char *const names[NXCAMERA_NSTAGES] =
+  {
+    "capture", "convert", "display"
+  };
+
+  struct nxcamera_stats_s stats;
+  int i;
+
+  nxcamera_getstats(pcam, &stats);
+
+  printf("%s\n", stats.streaming ? "Streaming" : "Idle");
+  for (i = 0; i < NXCAMERA_NSTAGES; i++)
+    {
+      printf("  %-8s %8" PRIu32 " frames %4" PRIu32 " fps, avg %" PRIu32
+             " us, max %" PRIu32 " us\n", names[i], stats.stage[i].frames,
+             stats.stage[i].fps, stats.stage[i].avgtime,
+             stats.stage[i].maxtime);
+    }
+
+  printf("  latency  avg %" PRIu32 " us, max %" PRIu32 " us\n",
+         stats.avglatency, stats.maxlatency);
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: nxcamera_cmd_input
  *
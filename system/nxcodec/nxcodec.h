@@ -45,6 +45,9 @@ typedef struct nxcodec_s
 
 int nxcodec_init(FAR nxcodec_t *codec);
 int nxcodec_start(FAR nxcodec_t *codec);
+#ifdef CONFIG_SYSTEM_NXCODEC_PIPELINE
+int nxcodec_pipeline(FAR nxcodec_t *codec);
+#endif
 int nxcodec_stop(FAR nxcodec_t *codec);
 int nxcodec_uninit(FAR nxcodec_t *codec);
 
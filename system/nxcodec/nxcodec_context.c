@@ -24,6 +24,7 @@
 
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/param.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -39,7 +40,13 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define NXCODEC_CONTEXT_BUFNUMBER 3
+#ifdef CONFIG_SYSTEM_NXCODEC_PIPELINE
+#  define NXCODEC_CONTEXT_BUFNUMBER CONFIG_SYSTEM_NXCODEC_PIPELINE_BUFFERS
+#else
+#  define NXCODEC_CONTEXT_BUFNUMBER 3
+#endif
+
+#define NXCODEC_CONTEXT_READ_CHUNK 1024
 
 /****************************************************************************
  * Private Functions
@@ -53,32 +60,6 @@ nxcodec_context_to_nxcodec(FAR nxcodec_context_t *ctx)
          container_of(ctx, nxcodec_t, capture);
 }
 
-static FAR nxcodec_context_buf_t *
-nxcodec_context_dequeue_buf(FAR nxcodec_context_t *ctx)
-{
-  FAR nxcodec_t *codec = nxcodec_context_to_nxcodec(ctx);
-  struct v4l2_buffer buf;
-  int ret;
-
-  memset(&buf, 0, sizeof(buf));
-  buf.memory = V4L2_MEMORY_MMAP;
-  buf.type = ctx->type;
-
-  ret = ioctl(codec->fd, VIDIOC_DQBUF, &buf);
-  if (ret < 0)
-    {
-      printf("%s: VIDIOC_DQBUF - %s\n",
-        V4L2_TYPE_IS_OUTPUT(ctx->type) ? "output" : "capture",
-        strerror(errno));
-      return NULL;
-    }
-
-  ctx->buf[buf.index].free = true;
-  ctx->buf[buf.index].buf = buf;
-
-  return &ctx->buf[buf.index];
-}
-
 static FAR nxcodec_context_buf_t *
 nxcodec_context_get_freebuf(FAR nxcodec_context_t *ctx)
 {
@@ -115,65 +96,74 @@ static int nxcodec_context_read_yuv_data(FAR nxcodec_context_t *ctx,
   ssize_t ret;
 
   ret = read(ctx->fd, buf, buflen);
-  if (ret <= 0)
+  if (ret < 0)
     {
       return -errno;
     }
+  else if (ret == 0)
+    {
+      return -ENODATA;
+    }
 
   *bytesused = ret;
   return 0;
 }
 
 static int nxcodec_context_read_h264_data(FAR nxcodec_context_t *ctx,
-                                          FAR char *buf,
+                                          FAR char *buf, size_t buflen,
                                           FAR uint32_t *bytesused)
 {
-  char start_code[4];
   ssize_t ret;
-  int size;
-
-  memset(start_code, 0, 4);
+  size_t size;
+  size_t i;
 
   ret = read(ctx->fd, buf, 4);
-  if (ret <= 0)
+  if (ret < 0)
     {
       return -errno;
     }
+  else if (ret == 0)
+    {
+      return -ENODATA;
+    }
 
-  if (buf[0] == 0x00 && buf[1] == 0x00 &&
-      buf[2] == 0x00 && buf[3] == 0x01)
+  if (ret < 4 || buf[0] != 0x00 || buf[1] != 0x00 ||
+      buf[2] != 0x00 || buf[3] != 0x01)
     {
-      size = 4;
-      while (1)
-        {
-          ret = read(ctx->fd, buf + size, 1);
-          if (ret < 0)
-            {
-              return -errno;
-            }
-          else if (ret == 0)
-            {
-              break;
-            }
+      return -EINVAL;
+    }
+
+  /* Read in chunks and scan the new bytes, together with the last three
+   * of the previous chunk, for the start code of the next NAL unit.  What
+   * was read past it is given back to the file.
+   */
 
-          start_code[0] = start_code[1];
-          start_code[1] = start_code[2];
-          start_code[2] = start_code[3];
-          start_code[3] = *(buf + size);
-          size++;
+  size = 4;
+  while (size < buflen)
+    {
+      ret = read(ctx->fd, buf + size,
+                 MIN(buflen - size, NXCODEC_CONTEXT_READ_CHUNK));
+      if (ret < 0)
+        {
+          return -errno;
+        }
+      else if (ret == 0)
+        {
+          break;
+        }
 
-          if (start_code[0] == 0x00 && start_code[1] == 0x00 &&
-              start_code[2] == 0x00 && start_code[3] == 0x01)
+      for (i = size > 7 ? size - 3 : 4; i + 4 <= size + ret; i++)
+        {
+          if (buf[i] == 0x00 && buf[i + 1] == 0x00 &&
+              buf[i + 2] == 0x00 && buf[i + 3] == 0x01)
             {
-              size -= 4;
-              lseek(ctx->fd, -4, SEEK_CUR);
-              break;
+              lseek(ctx->fd, (off_t)i - (off_t)(size + ret), SEEK_CUR);
+              *bytesused = i;
+              return 0;
             }
         }
-    }
-  else
-    {
-      return -EINVAL;
+
+      size += ret;
     }
 
   *bytesused = size;
@@ -192,74 +182,119 @@ int nxcodec_context_set_status(FAR nxcodec_context_t *ctx, uint32_t cmd)
   return ioctl(codec->fd, cmd, &ctx->type) < 0 ? -errno : 0;
 }
 
-int nxcodec_context_enqueue_frame(FAR nxcodec_context_t *ctx)
+FAR nxcodec_context_buf_t *
+nxcodec_context_dequeue_buf(FAR nxcodec_context_t *ctx)
 {
   FAR nxcodec_t *codec = nxcodec_context_to_nxcodec(ctx);
-  FAR nxcodec_context_buf_t *buf;
+  struct v4l2_buffer buf;
   int ret;
 
-  buf = nxcodec_context_get_freebuf(ctx);
-  if (!buf)
+  memset(&buf, 0, sizeof(buf));
+  buf.memory = V4L2_MEMORY_MMAP;
+  buf.type = ctx->type;
+
+  ret = ioctl(codec->fd, VIDIOC_DQBUF, &buf);
+  if (ret < 0)
     {
-      return -EAGAIN;
+      if (errno != EAGAIN)
+        {
+          printf("%s: VIDIOC_DQBUF - %s\n",
+            V4L2_TYPE_IS_OUTPUT(ctx->type) ? "output" : "capture",
+            strerror(errno));
+        }
+
+      return NULL;
+    }
+
+  ctx->buf[buf.index].free = true;
+  ctx->buf[buf.index].buf = buf;
+
+  return &ctx->buf[buf.index];
+}
+
+int nxcodec_context_queue_buf(FAR nxcodec_context_t *ctx,
+                              FAR nxcodec_context_buf_t *buf)
+{
+  FAR nxcodec_t *codec = nxcodec_context_to_nxcodec(ctx);
+  int ret;
+
+  /* The driver may hand the buffer back to another thread as soon as it
+   * is queued, so it must be marked busy before.
+   */
+
+  buf->free = false;
+
+  ret = ioctl(codec->fd, VIDIOC_QBUF, &buf->buf);
+  if (ret < 0)
+    {
+      buf->free = true;
+      return -errno;
     }
 
+  return 0;
+}
+
+int nxcodec_context_read_frame(FAR nxcodec_context_t *ctx,
+                               FAR nxcodec_context_buf_t *buf)
+{
   if (ctx->format.fmt.pix.pixelformat == V4L2_PIX_FMT_H264)
     {
-      ret = nxcodec_context_read_h264_data(ctx,
-                                           buf->addr,
-                                           &buf->buf.bytesused);
-      if (ret < 0)
-        {
-          return ret;
-        }
+      return nxcodec_context_read_h264_data(ctx, buf->addr, buf->length,
+                                            &buf->buf.bytesused);
     }
   else if (ctx->format.fmt.pix.pixelformat == V4L2_PIX_FMT_YUV420)
     {
-      ret = nxcodec_context_read_yuv_data(ctx,
-                                          buf->addr,
-                                          &buf->buf.bytesused);
-      if (ret < 0)
-        {
-          return ret;
-        }
+      return nxcodec_context_read_yuv_data(ctx, buf->addr,
+                                           &buf->buf.bytesused);
     }
 
-  ret = ioctl(codec->fd, VIDIOC_QBUF, &buf->buf);
-  if (ret < 0)
+  return 0;
+}
+
+int nxcodec_context_write_frame(FAR nxcodec_context_t *ctx,
+                                FAR nxcodec_context_buf_t *buf)
+{
+  if (buf->buf.length > 0)
     {
-      return -errno;
+      return nxcodec_context_write_data(ctx, buf->addr,
+                                        buf->buf.bytesused);
     }
 
-  buf->free = false;
   return 0;
 }
 
-int nxcodec_context_dequeue_frame(FAR nxcodec_context_t *ctx)
+int nxcodec_context_enqueue_frame(FAR nxcodec_context_t *ctx)
 {
-  FAR nxcodec_t *codec = nxcodec_context_to_nxcodec(ctx);
   FAR nxcodec_context_buf_t *buf;
   int ret;
 
-  buf = nxcodec_context_dequeue_buf(ctx);
+  buf = nxcodec_context_get_freebuf(ctx);
   if (!buf)
     {
       return -EAGAIN;
     }
 
-  if (buf->buf.length > 0)
+  ret = nxcodec_context_read_frame(ctx, buf);
+  if (ret < 0)
     {
-      nxcodec_context_write_data(ctx, buf->addr, buf->buf.bytesused);
+      return ret;
     }
 
-  ret = ioctl(codec->fd, VIDIOC_QBUF, &buf->buf);
-  if (ret < 0)
+  return nxcodec_context_queue_buf(ctx, buf);
+}
+
+int nxcodec_context_dequeue_frame(FAR nxcodec_context_t *ctx)
+{
+  FAR nxcodec_context_buf_t *buf;
+
+  buf = nxcodec_context_dequeue_buf(ctx);
+  if (!buf)
     {
-      return -errno;
+      return -EAGAIN;
     }
 
-  buf->free = false;
-  return 0;
+  nxcodec_context_write_frame(ctx, buf);
+  return nxcodec_context_queue_buf(ctx, buf);
 }
 
 int nxcodec_context_get_format(FAR nxcodec_context_t *ctx)
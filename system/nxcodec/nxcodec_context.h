@@ -56,6 +56,14 @@ typedef struct nxcodec_context_s
 
 int nxcodec_context_init(FAR nxcodec_context_t *ctx);
 int nxcodec_context_set_status(FAR nxcodec_context_t *ctx, uint32_t cmd);
+FAR nxcodec_context_buf_t *
+nxcodec_context_dequeue_buf(FAR nxcodec_context_t *ctx);
+int nxcodec_context_queue_buf(FAR nxcodec_context_t *ctx,
+                              FAR nxcodec_context_buf_t *buf);
+int nxcodec_context_read_frame(FAR nxcodec_context_t *ctx,
+                               FAR nxcodec_context_buf_t *buf);
+int nxcodec_context_write_frame(FAR nxcodec_context_t *ctx,
+                                FAR nxcodec_context_buf_t *buf);
 int nxcodec_context_enqueue_frame(FAR nxcodec_context_t *ctx);
 int nxcodec_context_dequeue_frame(FAR nxcodec_context_t *ctx);
 int nxcodec_context_get_format(FAR nxcodec_context_t *ctx);
@@ -189,6 +189,9 @@ int main(int argc, FAR char **argv)
       goto end0;
     }
 
+#ifdef CONFIG_SYSTEM_NXCODEC_PIPELINE
+  ret = nxcodec_pipeline(&codec);
+#else
   while (1)
     {
       struct pollfd pfd =
@@ -215,6 +218,7 @@ int main(int argc, FAR char **argv)
             }
         }
     }
+#endif
 
   nxcodec_stop(&codec);
 
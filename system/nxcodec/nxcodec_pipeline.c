@@ -0,0 +1,519 @@
+/****************************************************************************
+ * apps/system/nxcodec/nxcodec_pipeline.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <sys/param.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+
+#include "nxcodec.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* How often the driver loop looks at the reader state while the codec
+ * is quiet, and how long the codec may stay quiet after the last input
+ * frame before the remaining output is considered flushed.
+ */
+
+#define NXCODEC_PIPELINE_POLL_TIMEOUT  100  /* ms */
+#define NXCODEC_PIPELINE_DRAIN_TIMEOUT 200  /* ms */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A queue of V4L2 buffers handed between the driver loop and a worker.
+ * Each buffer is in at most one queue, so the ring never overflows.
+ */
+
+struct nxcodec_queue_s
+{
+  pthread_mutex_t               lock;
+  pthread_cond_t                cond;
+  FAR nxcodec_context_buf_t   **bufs;
+  int                           size;
+  int                           head;
+  int                           count;
+  bool                          stop;
+};
+
+struct nxcodec_stage_s
+{
+  uint32_t frames;
+  uint64_t bytes;
+  uint64_t busy;                       /* Time spent in file I/O, us */
+};
+
+struct nxcodec_pipeline_s
+{
+  FAR nxcodec_t          *codec;
+  struct nxcodec_queue_s  freeq;       /* Output buffers to be filled */
+  struct nxcodec_queue_s  writeq;      /* Capture buffers to be written */
+  pthread_t               reader;
+  pthread_t               writer;
+
+  /* Statistics and state shared with the workers, protected by lock */
+
+  pthread_mutex_t         lock;
+  struct nxcodec_stage_s  read;
+  struct nxcodec_stage_s  write;
+  uint32_t                consumed;    /* Output buffers done by the codec */
+  uint32_t                produced;    /* Capture buffers from the codec */
+  int                     queued;      /* Output buffers in the driver */
+  uint64_t                idlestart;
+  uint64_t                idle;        /* Time the codec had no input, us */
+  bool                    eof;
+  int                     error;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static uint64_t nxcodec_pipeline_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int nxcodec_queue_init(FAR struct nxcodec_queue_s *q, int size)
+{
+  q->bufs = calloc(size, sizeof(*q->bufs));
+  if (q->bufs == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  pthread_mutex_init(&q->lock, NULL);
+  pthread_cond_init(&q->cond, NULL);
+  q->size  = size;
+  q->head  = 0;
+  q->count = 0;
+  q->stop  = false;
+  return 0;
+}
+
+static void nxcodec_queue_destroy(FAR struct nxcodec_queue_s *q)
+{
+  pthread_cond_destroy(&q->cond);
+  pthread_mutex_destroy(&q->lock);
+  free(q->bufs);
+}
+
+static void nxcodec_queue_push(FAR struct nxcodec_queue_s *q,
+                               FAR nxcodec_context_buf_t *buf)
+{
+  pthread_mutex_lock(&q->lock);
+  q->bufs[(q->head + q->count++) % q->size] = buf;
+  pthread_cond_signal(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+}
+
+/* Wait for the next buffer.  Returns NULL once the queue is stopped and
+ * empty.
+ */
+
+static FAR nxcodec_context_buf_t *
+nxcodec_queue_pop(FAR struct nxcodec_queue_s *q)
+{
+  FAR nxcodec_context_buf_t *buf = NULL;
+
+  pthread_mutex_lock(&q->lock);
+  while (q->count == 0 && !q->stop)
+    {
+      pthread_cond_wait(&q->cond, &q->lock);
+    }
+
+  if (q->count > 0)
+    {
+      buf = q->bufs[q->head];
+      q->head = (q->head + 1) % q->size;
+      q->count--;
+    }
+
+  pthread_mutex_unlock(&q->lock);
+  return buf;
+}
+
+/* Stop the queue.  With discard the buffers still in it are dropped,
+ * otherwise the worker gets them before it sees the stop.
+ */
+
+static void nxcodec_queue_stop(FAR struct nxcodec_queue_s *q, bool discard)
+{
+  pthread_mutex_lock(&q->lock);
+  q->stop = true;
+  if (discard)
+    {
+      q->count = 0;
+    }
+
+  pthread_cond_broadcast(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+}
+
+/****************************************************************************
+ * Name: nxcodec_pipeline_reader
+ *
+ * Description:
+ *   Fill the output buffers returned by the codec with the next frames of
+ *   the input file and queue them back, so the codec always has input
+ *   while the driver loop waits for it.
+ *
+ ****************************************************************************/
+
+static FAR void *nxcodec_pipeline_reader(FAR void *arg)
+{
+  FAR struct nxcodec_pipeline_s *pipe = arg;
+  FAR nxcodec_context_t *ctx = &pipe->codec->output;
+  FAR nxcodec_context_buf_t *buf;
+  uint32_t bytesused;
+  uint64_t start;
+  uint64_t now;
+  int ret;
+
+  while ((buf = nxcodec_queue_pop(&pipe->freeq)) != NULL)
+    {
+      start = nxcodec_pipeline_now();
+      ret = nxcodec_context_read_frame(ctx, buf);
+      now = nxcodec_pipeline_now();
+      bytesused = buf->buf.bytesused;
+
+      pthread_mutex_lock(&pipe->lock);
+      if (ret >= 0)
+        {
+          pipe->read.frames++;
+          pipe->read.bytes += bytesused;
+          pipe->read.busy += now - start;
+          if (pipe->queued++ == 0)
+            {
+              pipe->idle += now - pipe->idlestart;
+            }
+        }
+
+      pthread_mutex_unlock(&pipe->lock);
+
+      if (ret >= 0)
+        {
+          ret = nxcodec_context_queue_buf(ctx, buf);
+          if (ret >= 0)
+            {
+              continue;
+            }
+
+          pthread_mutex_lock(&pipe->lock);
+          if (--pipe->queued == 0)
+            {
+              pipe->idlestart = nxcodec_pipeline_now();
+            }
+
+          pthread_mutex_unlock(&pipe->lock);
+        }
+
+      /* End of the input or an error: the buffer stays with us */
+
+      pthread_mutex_lock(&pipe->lock);
+      pipe->eof = true;
+      if (ret != -ENODATA)
+        {
+          printf("input failed: %d\n", ret);
+          pipe->error = ret;
+        }
+
+      pthread_mutex_unlock(&pipe->lock);
+      break;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxcodec_pipeline_writer
+ *
+ * Description:
+ *   Write the capture buffers dequeued by the driver loop to the output
+ *   file and give them back to the codec.
+ *
+ ****************************************************************************/
+
+static FAR void *nxcodec_pipeline_writer(FAR void *arg)
+{
+  FAR struct nxcodec_pipeline_s *pipe = arg;
+  FAR nxcodec_context_t *ctx = &pipe->codec->capture;
+  FAR nxcodec_context_buf_t *buf;
+  uint64_t start;
+  int ret;
+
+  while ((buf = nxcodec_queue_pop(&pipe->writeq)) != NULL)
+    {
+      start = nxcodec_pipeline_now();
+      ret = nxcodec_context_write_frame(ctx, buf);
+
+      pthread_mutex_lock(&pipe->lock);
+      if (ret < 0)
+        {
+          printf("write output failed: %d\n", ret);
+          pipe->error = ret;
+        }
+      else
+        {
+          pipe->write.frames++;
+          pipe->write.bytes += buf->buf.bytesused;
+          pipe->write.busy += nxcodec_pipeline_now() - start;
+        }
+
+      pthread_mutex_unlock(&pipe->lock);
+
+      /* A buffer that can't be queued again is lost to the codec, which
+       * could then wait for it forever.
+       */
+
+      ret = nxcodec_context_queue_buf(ctx, buf);
+      if (ret < 0)
+        {
+          printf("queue capture buffer failed: %d\n", ret);
+          pthread_mutex_lock(&pipe->lock);
+          pipe->error = ret;
+          pthread_mutex_unlock(&pipe->lock);
+        }
+    }
+
+  return NULL;
+}
+
+static void nxcodec_pipeline_report(FAR struct nxcodec_pipeline_s *pipe,
+                                    uint64_t elapsed)
+{
+  uint64_t ms = MAX(elapsed / 1000, 1);
+  uint64_t pct = MAX(elapsed / 100, 1);
+
+  printf("nxcodec: %" PRIu64 ".%03" PRIu64 " s\n", ms / 1000, ms % 1000);
+  printf("  read:  %" PRIu32 " frames, %" PRIu64 " KiB/s, busy %" PRIu64
+         "%%\n", pipe->read.frames, pipe->read.bytes * 1000 / 1024 / ms,
+         pipe->read.busy / pct);
+  printf("  codec: %" PRIu32 " in, %" PRIu32 " out, %" PRIu64 ".%" PRIu64
+         " fps, idle %" PRIu64 "%%\n", pipe->consumed, pipe->produced,
+         (uint64_t)pipe->produced * 1000 / ms,
+         (uint64_t)pipe->produced * 10000 / ms % 10, pipe->idle / pct);
+  printf("  write: %" PRIu32 " frames, %" PRIu64 " KiB/s, busy %" PRIu64
+         "%%\n", pipe->write.frames, pipe->write.bytes * 1000 / 1024 / ms,
+         pipe->write.busy / pct);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxcodec_pipeline
+ *
+ * Description:
+ *   Run a started codec until the input is exhausted and the codec has
+ *   flushed its output.  The input file is read ahead by a reader thread
+ *   and the output file written by a writer thread; this thread only
+ *   moves buffers between the driver and them.  Throughput of each stage
+ *   is printed at the end.
+ *
+ ****************************************************************************/
+
+int nxcodec_pipeline(FAR nxcodec_t *codec)
+{
+  FAR struct nxcodec_pipeline_s *pipe;
+  FAR nxcodec_context_buf_t *buf;
+  pthread_attr_t attr;
+  uint64_t start;
+  uint64_t end;
+  bool drain;
+  int ret;
+  int i;
+
+  pipe = calloc(1, sizeof(*pipe));
+  if (pipe == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  pipe->codec = codec;
+
+  ret = nxcodec_queue_init(&pipe->freeq, codec->output.nbuffers);
+  if (ret < 0)
+    {
+      free(pipe);
+      return ret;
+    }
+
+  ret = nxcodec_queue_init(&pipe->writeq, codec->capture.nbuffers);
+  if (ret < 0)
+    {
+      nxcodec_queue_destroy(&pipe->freeq);
+      free(pipe);
+      return ret;
+    }
+
+  pthread_mutex_init(&pipe->lock, NULL);
+
+  /* nxcodec_start() may already have queued the first frame */
+
+  for (i = 0; i < codec->output.nbuffers; i++)
+    {
+      if (codec->output.buf[i].free)
+        {
+          nxcodec_queue_push(&pipe->freeq, &codec->output.buf[i]);
+        }
+      else
+        {
+          pipe->queued++;
+        }
+    }
+
+  start = nxcodec_pipeline_now();
+  pipe->idlestart = start;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_SYSTEM_NXCODEC_PIPELINE_STACKSIZE);
+
+  ret = -pthread_create(&pipe->reader, &attr, nxcodec_pipeline_reader, pipe);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = -pthread_create(&pipe->writer, &attr, nxcodec_pipeline_writer, pipe);
+  if (ret < 0)
+    {
+      nxcodec_queue_stop(&pipe->freeq, true);
+      pthread_join(pipe->reader, NULL);
+      goto errout;
+    }
+
+  while (1)
+    {
+      struct pollfd pfd =
+      {
+        .events = POLLIN | POLLOUT,
+        .fd = codec->fd,
+      };
+
+      pthread_mutex_lock(&pipe->lock);
+      drain = pipe->eof && pipe->queued == 0;
+      ret = pipe->error;
+      pthread_mutex_unlock(&pipe->lock);
+
+      if (ret < 0)
+        {
+          break;
+        }
+
+      ret = poll(&pfd, 1, drain ? NXCODEC_PIPELINE_DRAIN_TIMEOUT :
+                                  NXCODEC_PIPELINE_POLL_TIMEOUT);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          ret = -errno;
+          break;
+        }
+      else if (ret == 0)
+        {
+          if (drain)
+            {
+              break;
+            }
+
+          continue;
+        }
+
+      if (pfd.revents & POLLOUT)
+        {
+          while ((buf = nxcodec_context_dequeue_buf(&codec->output)) != NULL)
+            {
+              pthread_mutex_lock(&pipe->lock);
+              pipe->consumed++;
+              if (--pipe->queued == 0)
+                {
+                  pipe->idlestart = nxcodec_pipeline_now();
+                }
+
+              pthread_mutex_unlock(&pipe->lock);
+              nxcodec_queue_push(&pipe->freeq, buf);
+            }
+        }
+
+      if (pfd.revents & POLLIN)
+        {
+          while ((buf = nxcodec_context_dequeue_buf(&codec->capture)) != NULL)
+            {
+              pthread_mutex_lock(&pipe->lock);
+              pipe->produced++;
+              pthread_mutex_unlock(&pipe->lock);
+              nxcodec_queue_push(&pipe->writeq, buf);
+            }
+        }
+    }
+
+  /* The quiet time that ended the stream does not count */
+
+  end = nxcodec_pipeline_now();
+  if (ret == 0 && drain)
+    {
+      end -= NXCODEC_PIPELINE_DRAIN_TIMEOUT * 1000;
+    }
+
+  /* The reader is stopped right away, the writer first writes out what
+   * the codec has already produced.
+   */
+
+  nxcodec_queue_stop(&pipe->freeq, true);
+  nxcodec_queue_stop(&pipe->writeq, false);
+  pthread_join(pipe->reader, NULL);
+  pthread_join(pipe->writer, NULL);
+
+  if (ret >= 0)
+    {
+      ret = pipe->error;
+    }
+
+  nxcodec_pipeline_report(pipe, end - start);
+
+errout:
+  pthread_attr_destroy(&attr);
+  pthread_mutex_destroy(&pipe->lock);
+  nxcodec_queue_destroy(&pipe->writeq);
+  nxcodec_queue_destroy(&pipe->freeq);
+  free(pipe);
+  return ret;
+}
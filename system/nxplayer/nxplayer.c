@@ -68,6 +68,10 @@
 #  define CONFIG_NXPLAYER_PLAYTHREAD_STACKSIZE    1500
 #endif
 
+/* Sent by the prefetch thread when data is ready for a starved buffer */
+
+#define NXPLAYER_MSG_PREFETCH    AUDIO_MSG_USER
+
 /****************************************************************************
  * Private Type Declarations
  ****************************************************************************/
@@ -81,6 +85,23 @@ struct nxplayer_ext_fmt_s
 };
 #endif
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+/* Ring of buffers filled by the prefetch thread ahead of the device */
+
+struct nxplayer_prefetch_s
+{
+  pthread_mutex_t         lock;      /* Protects the fields below */
+  pthread_cond_t          cond;      /* Signals free space or stop */
+  pthread_t               thread;    /* The prefetch thread */
+  int                     head;      /* Next slot to hand to the device */
+  int                     count;     /* Number of filled slots */
+  bool                    eof;       /* The final buffer has been read */
+  bool                    stop;      /* The prefetch thread must exit */
+  bool                    notify;    /* The play thread waits for data */
+  FAR struct ap_buffer_s *slots[CONFIG_NXPLAYER_PREFETCH_BUFFERS];
+};
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -690,6 +711,317 @@ static int nxplayer_readbuffer(FAR struct nxplayer_s *pplayer,
   return OK;
 }
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+/****************************************************************************
+ * Name: nxplayer_prefetchthread
+ *
+ *  Fill the read-ahead ring from the media file until the end of the file
+ *  or until nxplayer_prefetch_stop() is called.
+ *
+ ****************************************************************************/
+
+static FAR void *nxplayer_prefetchthread(pthread_addr_t pvarg)
+{
+  FAR struct nxplayer_s *pplayer = (FAR struct nxplayer_s *)pvarg;
+  FAR struct nxplayer_prefetch_s *ring = pplayer->prefetch;
+  FAR struct ap_buffer_s *apb;
+  struct audio_msg_s msg;
+  bool notify;
+  int ret;
+
+  for (; ; )
+    {
+      /* Wait for a free slot */
+
+      pthread_mutex_lock(&ring->lock);
+      while (ring->count == CONFIG_NXPLAYER_PREFETCH_BUFFERS && !ring->stop)
+        {
+          pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+
+      if (ring->stop)
+        {
+          pthread_mutex_unlock(&ring->lock);
+          break;
+        }
+
+      apb = ring->slots[(ring->head + ring->count) %
+                        CONFIG_NXPLAYER_PREFETCH_BUFFERS];
+      pthread_mutex_unlock(&ring->lock);
+
+      /* The slot is not visible to the play thread until count is
+       * incremented, so it can be filled without holding the lock.
+       */
+
+      ret = pplayer->ops->fill_data(pplayer->fd, apb);
+
+      pthread_mutex_lock(&ring->lock);
+      ring->count++;
+      ring->eof = ret < 0;
+      pplayer->stats.level = ring->count;
+
+      notify       = ring->notify;
+      ring->notify = false;
+
+      pthread_cond_broadcast(&ring->cond);
+      pthread_mutex_unlock(&ring->lock);
+
+      /* Wake up the play thread if it holds buffers waiting for data */
+
+      if (notify)
+        {
+          msg.msg_id = NXPLAYER_MSG_PREFETCH;
+          msg.u.data = 0;
+          mq_send(pplayer->mq, (FAR const char *)&msg, sizeof(msg),
+                  CONFIG_NXPLAYER_MSG_PRIO);
+        }
+
+      if (ret < 0)
+        {
+          /* End of file or read error */
+
+          break;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetch_start
+ *
+ *  Allocate the read-ahead ring, start the prefetch thread and wait until
+ *  the ring is full (or the whole file has been read).
+ *
+ ****************************************************************************/
+
+static int nxplayer_prefetch_start(FAR struct nxplayer_s *pplayer,
+                                   apb_samp_t bufsize)
+{
+  FAR struct nxplayer_prefetch_s *ring;
+  pthread_attr_t tattr;
+  int ret;
+  int x;
+
+  ring = (FAR struct nxplayer_prefetch_s *)
+    zalloc(sizeof(struct nxplayer_prefetch_s));
+  if (ring == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (x = 0; x < CONFIG_NXPLAYER_PREFETCH_BUFFERS; x++)
+    {
+      ring->slots[x] = (FAR struct ap_buffer_s *)
+        zalloc(sizeof(struct ap_buffer_s) + bufsize);
+      if (ring->slots[x] == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout;
+        }
+
+      ring->slots[x]->samp      = (FAR uint8_t *)&ring->slots[x][1];
+      ring->slots[x]->nmaxbytes = bufsize;
+    }
+
+  pthread_mutex_init(&ring->lock, NULL);
+  pthread_cond_init(&ring->cond, NULL);
+
+  pthread_mutex_lock(&pplayer->mutex);
+  memset(&pplayer->stats, 0, sizeof(pplayer->stats));
+  pplayer->stats.nbuffers = CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+  pplayer->stats.minlevel = CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+  pplayer->prefetch       = ring;
+  pthread_mutex_unlock(&pplayer->mutex);
+
+  pthread_attr_init(&tattr);
+  pthread_attr_setstacksize(&tattr, CONFIG_NXPLAYER_PREFETCH_STACKSIZE);
+  ret = pthread_create(&ring->thread, &tattr, nxplayer_prefetchthread,
+                       (pthread_addr_t)pplayer);
+  pthread_attr_destroy(&tattr);
+  if (ret != OK)
+    {
+      auderr("ERROR: Failed to create prefetch thread: %d\n", ret);
+
+      pthread_mutex_lock(&pplayer->mutex);
+      pplayer->prefetch = NULL;
+      pthread_mutex_unlock(&pplayer->mutex);
+
+      pthread_cond_destroy(&ring->cond);
+      pthread_mutex_destroy(&ring->lock);
+      ret = -ret;
+      goto errout;
+    }
+
+  pthread_setname_np(ring->thread, "prefetch");
+
+  /* Preroll: start playback with a full ring */
+
+  pthread_mutex_lock(&ring->lock);
+  while (ring->count < CONFIG_NXPLAYER_PREFETCH_BUFFERS && !ring->eof)
+    {
+      pthread_cond_wait(&ring->cond, &ring->lock);
+    }
+
+  pthread_mutex_unlock(&ring->lock);
+  return OK;
+
+errout:
+  for (x = 0; x < CONFIG_NXPLAYER_PREFETCH_BUFFERS; x++)
+    {
+      free(ring->slots[x]);
+    }
+
+  free(ring);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetch_stop
+ *
+ *  Stop the prefetch thread and free the read-ahead ring.  The statistics
+ *  are kept for nxplayer_getstats().
+ *
+ ****************************************************************************/
+
+static void nxplayer_prefetch_stop(FAR struct nxplayer_s *pplayer)
+{
+  FAR struct nxplayer_prefetch_s *ring = pplayer->prefetch;
+  int x;
+
+  if (ring == NULL)
+    {
+      return;
+    }
+
+  pthread_mutex_lock(&ring->lock);
+  ring->stop = true;
+  pthread_cond_broadcast(&ring->cond);
+  pthread_mutex_unlock(&ring->lock);
+
+  pthread_join(ring->thread, NULL);
+
+  pthread_mutex_lock(&pplayer->mutex);
+  pplayer->prefetch = NULL;
+  pthread_mutex_unlock(&pplayer->mutex);
+
+  for (x = 0; x < CONFIG_NXPLAYER_PREFETCH_BUFFERS; x++)
+    {
+      free(ring->slots[x]);
+    }
+
+  pthread_cond_destroy(&ring->cond);
+  pthread_mutex_destroy(&ring->lock);
+  free(ring);
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetch_get
+ *
+ *  Copy the next prefetched buffer into the device buffer apb.  Returns
+ *  -ENODATA after the final buffer has been returned.  If no data is ready
+ *  and wait is false, -EAGAIN is returned and the prefetch thread will
+ *  send NXPLAYER_MSG_PREFETCH when the next buffer is ready.
+ *
+ ****************************************************************************/
+
+static int nxplayer_prefetch_get(FAR struct nxplayer_s *pplayer,
+                                 FAR struct ap_buffer_s *apb, bool wait)
+{
+  FAR struct nxplayer_prefetch_s *ring = pplayer->prefetch;
+  FAR struct ap_buffer_s *slot;
+
+  pthread_mutex_lock(&ring->lock);
+  while (ring->count == 0 && !ring->eof)
+    {
+      if (!wait)
+        {
+          ring->notify = true;
+          pthread_mutex_unlock(&ring->lock);
+          return -EAGAIN;
+        }
+
+      pthread_cond_wait(&ring->cond, &ring->lock);
+    }
+
+  if (ring->count == 0)
+    {
+      pthread_mutex_unlock(&ring->lock);
+      return -ENODATA;
+    }
+
+  slot = ring->slots[ring->head];
+  pthread_mutex_unlock(&ring->lock);
+
+  /* The producer does not touch a filled slot, copy without the lock */
+
+  apb->nbytes  = MIN(slot->nbytes, apb->nmaxbytes);
+  apb->curbyte = slot->curbyte;
+  apb->flags   = slot->flags;
+  memcpy(apb->samp, slot->samp, apb->nbytes);
+
+  pthread_mutex_lock(&ring->lock);
+  ring->head = (ring->head + 1) % CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+  ring->count--;
+
+  pplayer->stats.level = ring->count;
+  if (!wait && ring->count < pplayer->stats.minlevel)
+    {
+      pplayer->stats.minlevel = ring->count;
+    }
+
+  pthread_cond_broadcast(&ring->cond);
+  pthread_mutex_unlock(&ring->lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetch_starved
+ *
+ *  Account for a device buffer that could not be refilled.  underrun is
+ *  true if the device has no other buffers queued.
+ *
+ ****************************************************************************/
+
+static void nxplayer_prefetch_starved(FAR struct nxplayer_s *pplayer,
+                                      bool underrun)
+{
+  FAR struct nxplayer_prefetch_s *ring = pplayer->prefetch;
+
+  pthread_mutex_lock(&ring->lock);
+  pplayer->stats.starved++;
+  if (underrun)
+    {
+      pplayer->stats.underruns++;
+      audwarn("WARNING: Audio underrun\n");
+    }
+
+  pthread_mutex_unlock(&ring->lock);
+}
+#endif
+
+/****************************************************************************
+ * Name: nxplayer_closefile
+ *
+ *   Stop reading from the media file and close it.
+ *
+ ****************************************************************************/
+
+static void nxplayer_closefile(FAR struct nxplayer_s *pplayer)
+{
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  /* The prefetch thread may be reading from the file */
+
+  nxplayer_prefetch_stop(pplayer);
+#endif
+
+  if (pplayer->fd >= 0)
+    {
+      close(pplayer->fd);
+      pplayer->fd = -1;
+    }
+}
+
 /****************************************************************************
  * Name: nxplayer_enqueuebuffer
  *
@@ -796,6 +1128,11 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
   struct ap_buffer_info_s buf_info;
   FAR struct ap_buffer_s  **buffers;
   unsigned int            prio;
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  FAR struct ap_buffer_s  **starved = NULL;
+  int                     nstarved = 0;
+  int                     inflight = 0;
+#endif
 #ifdef CONFIG_DEBUG_FEATURES
   int                     outstanding = 0;
 #endif
@@ -858,13 +1195,40 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
         }
     }
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  /* Start reading ahead of the device.  Device buffers that are returned
+   * while the read-ahead ring is empty are parked in starved[] until the
+   * prefetch thread catches up.
+   */
+
+  starved = (FAR struct ap_buffer_s **)
+    malloc(buf_info.nbuffers * sizeof(FAR void *));
+  if (starved == NULL)
+    {
+      running = false;
+      goto err_out;
+    }
+
+  ret = nxplayer_prefetch_start(pplayer, buf_info.buffer_size);
+  if (ret < 0)
+    {
+      auderr("ERROR: Could not start prefetch: %d\n", ret);
+      running = false;
+      goto err_out;
+    }
+#endif
+
   /* Fill up the pipeline with enqueued buffers */
 
   for (x = 0; x < buf_info.nbuffers; x++)
     {
       /* Read the next buffer of data */
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+      ret = nxplayer_prefetch_get(pplayer, buffers[x], true);
+#else
       ret = nxplayer_readbuffer(pplayer, buffers[x]);
+#endif
       if (ret != OK)
         {
           /* nxplayer_readbuffer will return an error if there is no further
@@ -907,8 +1271,7 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
                * file so that no further data is read.
                */
 
-              close(pplayer->fd);
-              pplayer->fd = -1;
+              nxplayer_closefile(pplayer);
 
               /* We are no longer streaming data from the file.  Be we will
                * need to wait for any outstanding buffers to be recovered.
@@ -921,14 +1284,17 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
                failed = true;
                break;
             }
-#ifdef CONFIG_DEBUG_FEATURES
           else
             {
+#ifdef CONFIG_NXPLAYER_PREFETCH
+              inflight++;
+#endif
+#ifdef CONFIG_DEBUG_FEATURES
               /* The audio driver has one more buffer */
 
               outstanding++;
-            }
 #endif
+            }
         }
     }
 
@@ -1032,6 +1398,9 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
             DEBUGASSERT(msg.u.ptr && outstanding > 0);
             outstanding--;
 #endif
+#ifdef CONFIG_NXPLAYER_PREFETCH
+            inflight--;
+#endif
 
             /* Read data from the file directly into this buffer and
              * re-enqueue it.  streaming == true means that we have
@@ -1042,7 +1411,22 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
               {
                 /* Read the next buffer of data */
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+                ret = nxplayer_prefetch_get(pplayer, msg.u.ptr, false);
+                if (ret == -EAGAIN)
+                  {
+                    /* The read-ahead ring ran dry.  Hold on to the buffer
+                     * until the prefetch thread wakes us up.
+                     */
+
+                    starved[nstarved++] = msg.u.ptr;
+                    nxplayer_prefetch_starved(pplayer, inflight == 0);
+                    break;
+                  }
+#else
                 ret = nxplayer_readbuffer(pplayer, msg.u.ptr);
+#endif
+
                 if (ret != OK)
                   {
                     /* Out of data.  Stay in the loop until the device sends
@@ -1067,8 +1451,7 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
                          * Close the file so that no further data is read.
                          */
 
-                        close(pplayer->fd);
-                        pplayer->fd = -1;
+                        nxplayer_closefile(pplayer);
 
                         /* Stop streaming and wait for buffers to be
                          * returned and to receive the AUDIO_MSG_COMPLETE
@@ -1078,18 +1461,61 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
                         streaming = false;
                         failed = true;
                       }
-#ifdef CONFIG_DEBUG_FEATURES
                     else
                       {
+#ifdef CONFIG_NXPLAYER_PREFETCH
+                        inflight++;
+#endif
+#ifdef CONFIG_DEBUG_FEATURES
                         /* The audio driver has one more buffer */
 
                         outstanding++;
-                      }
 #endif
+                      }
                   }
               }
             break;
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+          /* The prefetch thread has data for the starved buffers */
+
+          case NXPLAYER_MSG_PREFETCH:
+            while (streaming && nstarved > 0)
+              {
+                ret = nxplayer_prefetch_get(pplayer, starved[0], false);
+                if (ret == -EAGAIN)
+                  {
+                    break;
+                  }
+                else if (ret != OK)
+                  {
+                    /* The final buffer has already been sent */
+
+                    streaming = false;
+                    break;
+                  }
+
+                ret = nxplayer_enqueuebuffer(pplayer, starved[0]);
+                nstarved--;
+                memmove(&starved[0], &starved[1],
+                        nstarved * sizeof(FAR void *));
+
+                if (ret != OK)
+                  {
+                    nxplayer_closefile(pplayer);
+                    streaming = false;
+                    failed = true;
+                    break;
+                  }
+
+                inflight++;
+#ifdef CONFIG_DEBUG_FEATURES
+                outstanding++;
+#endif
+              }
+            break;
+#endif
+
           /* Someone wants to stop the playback. */
 
           case AUDIO_MSG_STOP:
@@ -1136,6 +1562,11 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
 err_out:
   audinfo("Clean-up and exit\n");
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  nxplayer_prefetch_stop(pplayer);
+  free(starved);
+#endif
+
   if (buffers != NULL)
     {
       audinfo("Freeing buffers\n");
@@ -2186,6 +2617,10 @@ FAR struct nxplayer_s *nxplayer_create(void)
   pplayer->mq = 0;
   pplayer->play_id = 0;
   pplayer->crefs = 1;
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  pplayer->prefetch = NULL;
+  memset(&pplayer->stats, 0, sizeof(pplayer->stats));
+#endif
 
 #ifndef CONFIG_AUDIO_EXCLUDE_TONE
   pplayer->bass = 50;
@@ -2336,3 +2771,41 @@ int nxplayer_systemreset(FAR struct nxplayer_s *pplayer)
   return OK;
 }
 #endif /* CONFIG_NXPLAYER_INCLUDE_SYSTEM_RESET */
+
+/****************************************************************************
+ * Name: nxplayer_getstats
+ *
+ *   nxplayer_getstats() returns the read-ahead statistics of the current
+ *   or of the last playback.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+int nxplayer_getstats(FAR struct nxplayer_s *pplayer,
+                      FAR struct nxplayer_stats_s *stats)
+{
+  DEBUGASSERT(pplayer != NULL && stats != NULL);
+
+  pthread_mutex_lock(&pplayer->mutex);
+  if (pplayer->prefetch != NULL)
+    {
+      /* The prefetch thread updates the statistics under the ring lock */
+
+      pthread_mutex_lock(&pplayer->prefetch->lock);
+      *stats = pplayer->stats;
+      pthread_mutex_unlock(&pplayer->prefetch->lock);
+    }
+  else
+    {
+      *stats = pplayer->stats;
+    }
+
+  /* The state stays IDLE while the play thread prerolls, but the device
+   * is open for the whole life of the play thread.
+   */
+
+  stats->playing = pplayer->dev_fd >= 0;
+  pthread_mutex_unlock(&pplayer->mutex);
+  return OK;
+}
+#endif
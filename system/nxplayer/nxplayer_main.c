@@ -31,6 +31,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <assert.h>
 
 #include "system/readline.h"
@@ -85,6 +86,10 @@ static int nxplayer_cmd_resume(FAR struct nxplayer_s *pplayer, char *parg);
 static int nxplayer_cmd_mediadir(FAR struct nxplayer_s *pplayer, char *parg);
 #endif
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+static int nxplayer_cmd_stats(FAR struct nxplayer_s *pplayer, char *parg);
+#endif
+
 #ifndef CONFIG_AUDIO_EXCLUDE_STOP
 static int nxplayer_cmd_stop(FAR struct nxplayer_s *pplayer, char *parg);
 #endif
@@ -195,6 +200,14 @@ static struct mp_cmd_s g_nxplayer_cmds[] =
     NXPLAYER_HELP_TEXT("Resume playback")
   },
 #endif
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  {
+    "stats",
+    "",
+    nxplayer_cmd_stats,
+    NXPLAYER_HELP_TEXT("Show read-ahead statistics")
+  },
+#endif
 #ifndef CONFIG_AUDIO_EXCLUDE_STOP
   {
     "stop",
@@ -523,6 +536,30 @@ static int nxplayer_cmd_mediadir(FAR struct nxplayer_s *pplayer, char *parg)
 }
 #endif
 
+/****************************************************************************
+ * Name: nxplayer_cmd_stats
+ *
+ *   nxplayer_cmd_stats() shows the read-ahead statistics of the current
+ *   or of the last playback.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+static int nxplayer_cmd_stats(FAR struct nxplayer_s *pplayer, char *parg)
+{
+  struct nxplayer_stats_s stats;
+
+  nxplayer_getstats(pplayer, &stats);
+
+  printf("%s: buffered %u/%u, lowest %u, starved %" PRIu32
+         ", underruns %" PRIu32 "\n",
+         stats.playing ? "Playing" : "Idle", stats.level, stats.nbuffers,
+         stats.minlevel, stats.starved, stats.underruns);
+
+  return OK;
+}
+#endif
+
 /****************************************************************************
  * Name: nxplayer_cmd_stop
  *
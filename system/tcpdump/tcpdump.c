@@ -26,11 +26,16 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <net/if.h>
 #include <net/if_arp.h>
 #include <netpacket/packet.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -50,6 +55,38 @@
 
 #define DEFAULT_SNAPLEN 262144
 
+/* pcapng block types and options, see
+ * https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng-02.html
+ */
+
+#define PCAPNG_BT_SHB       0x0a0d0d0a /* Section Header Block */
+#define PCAPNG_BT_IDB       0x00000001 /* Interface Description Block */
+#define PCAPNG_BT_ISB       0x00000005 /* Interface Statistics Block */
+#define PCAPNG_BT_EPB       0x00000006 /* Enhanced Packet Block */
+#define PCAPNG_BYTE_ORDER   0x1a2b3c4d
+
+#define PCAPNG_OPT_END      0
+#define PCAPNG_IF_NAME      2
+#define PCAPNG_IF_TSRESOL   9          /* 9 means nanosecond timestamps */
+#define PCAPNG_ISB_START    2
+#define PCAPNG_ISB_END      3
+#define PCAPNG_ISB_IFRECV   4
+#define PCAPNG_ISB_OSDROP   7
+#define PCAPNG_ISB_USRDELIV 8
+
+#define PCAPNG_PAD(n)       (((n) + 3) & ~3)
+
+/* Packet records in the capture ring are aligned to this size, a record
+ * with caplen == TCPDUMP_REC_WRAP tells the writer to continue at the
+ * start of the ring.
+ */
+
+#define TCPDUMP_REC_ALIGN(n) (((n) + sizeof(uintptr_t) - 1) & \
+                              ~(sizeof(uintptr_t) - 1))
+#define TCPDUMP_REC_WRAP     UINT32_MAX
+#define TCPDUMP_REC_MAX      TCPDUMP_REC_ALIGN(sizeof(struct tcpdump_rec_s) + \
+                                               MAX_NETDEV_PKTSIZE)
+
 /* https://www.tcpdump.org/linktypes.html */
 
 #define LINKTYPE_ETHERNET 1   /* IEEE 802.3 Ethernet */
@@ -78,11 +115,25 @@ struct pcap_pkthdr_s
   uint32_t len;     /* length of this packet (off wire) */
 };
 
+/* Header of a packet in the capture ring, followed by caplen bytes */
+
+struct tcpdump_rec_s
+{
+  uint32_t caplen;
+  uint32_t len;
+  struct timespec ts;
+};
+
 struct tcpdump_args_s
 {
   FAR struct arg_str *interface;
   FAR struct arg_str *file;
   FAR struct arg_int *snaplen;
+  FAR struct arg_int *filesize;
+  FAR struct arg_int *filecount;
+  FAR struct arg_int *bufsize;
+  FAR struct arg_lit *buffered;
+  FAR struct arg_lit *pcapng;
   FAR struct arg_end *end;
 };
 
@@ -92,6 +143,41 @@ struct tcpdump_cfgs_s
   int sd;
   uint32_t snaplen;
   uint32_t linktype;
+  FAR const char *ifname;
+  bool pcapng;               /* Write pcapng instead of pcap */
+  bool pktbuffered;          /* Flush after every batch of packets */
+
+  /* Output files */
+
+  FAR const char *path;
+  uint32_t filesize;         /* Rotate after this many bytes, 0: never */
+  uint32_t filecount;        /* Number of files in the ring, 0: no limit */
+  uint32_t fileno;           /* Number of the current file */
+  uint32_t written;          /* Bytes in the current file */
+
+  /* Write buffer, flushed in full buffers only */
+
+  FAR uint8_t *wbuf;
+  size_t wbufsize;
+  size_t wpos;
+
+  /* Ring of captured packets between the capture and the writer thread */
+
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  FAR uint8_t *ring;
+  size_t ringsize;
+  size_t head;               /* Next record written by the capture thread */
+  size_t tail;               /* Next record read by the writer thread */
+  size_t used;               /* Bytes between tail and head */
+  bool stop;
+
+  /* Interface statistics */
+
+  struct timespec start;
+  uint64_t recv;             /* Packets read from the socket */
+  uint64_t drop;             /* Packets dropped because the ring was full */
+  uint64_t deliv;            /* Packets written to the files */
 };
 
 /****************************************************************************
@@ -113,11 +199,155 @@ static void sigexit(int signo)
   g_exiting = true;
 }
 
+/****************************************************************************
+ * Name: tcpdump_flush
+ *
+ * Description:
+ *   Write the buffered data to the current file.
+ *
+ ****************************************************************************/
+
+static int tcpdump_flush(FAR struct tcpdump_cfgs_s *cfgs)
+{
+  size_t off = 0;
+  ssize_t ret;
+
+  while (off < cfgs->wpos)
+    {
+      ret = write(cfgs->fd, cfgs->wbuf + off, cfgs->wpos - off);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          perror("ERROR: write() failed");
+          return -errno;
+        }
+
+      off += ret;
+    }
+
+  cfgs->wpos = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tcpdump_put
+ *
+ * Description:
+ *   Append data to the write buffer.  The buffer is only written out when
+ *   it is full, so all writes but the last one of a file have the size of
+ *   the buffer and start at a multiple of it.
+ *
+ ****************************************************************************/
+
+static int tcpdump_put(FAR struct tcpdump_cfgs_s *cfgs, FAR const void *buf,
+                       size_t len)
+{
+  FAR const uint8_t *src = buf;
+  size_t n;
+  int ret;
+
+  cfgs->written += len;
+  while (len > 0)
+    {
+      n = MIN(len, cfgs->wbufsize - cfgs->wpos);
+      memcpy(cfgs->wbuf + cfgs->wpos, src, n);
+      cfgs->wpos += n;
+      src        += n;
+      len        -= n;
+
+      if (cfgs->wpos == cfgs->wbufsize)
+        {
+          ret = tcpdump_flush(cfgs);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tcpdump_put32
+ ****************************************************************************/
+
+static int tcpdump_put32(FAR struct tcpdump_cfgs_s *cfgs, uint32_t value)
+{
+  return tcpdump_put(cfgs, &value, sizeof(value));
+}
+
+/****************************************************************************
+ * Name: tcpdump_put16
+ *
+ * Description:
+ *   Append two 16-bit fields that share a 32-bit word, each in host order.
+ *
+ ****************************************************************************/
+
+static int tcpdump_put16(FAR struct tcpdump_cfgs_s *cfgs, uint16_t first,
+                         uint16_t second)
+{
+  uint16_t value[2] =
+    {
+      first, second
+    };
+
+  return tcpdump_put(cfgs, value, sizeof(value));
+}
+
+/****************************************************************************
+ * Name: tcpdump_putopt
+ *
+ * Description:
+ *   Append a pcapng option, padded to 32 bits.
+ *
+ ****************************************************************************/
+
+static int tcpdump_putopt(FAR struct tcpdump_cfgs_s *cfgs, uint16_t code,
+                          FAR const void *value, uint16_t len)
+{
+  static const uint8_t zero[4];
+
+  if (tcpdump_put16(cfgs, code, len) < 0 ||
+      tcpdump_put(cfgs, value, len) < 0)
+    {
+      return -EIO;
+    }
+
+  return tcpdump_put(cfgs, zero, PCAPNG_PAD(len) - len);
+}
+
+/****************************************************************************
+ * Name: tcpdump_putts
+ *
+ * Description:
+ *   Append a pcapng timestamp: nanoseconds as two 32-bit words, high word
+ *   first.
+ *
+ ****************************************************************************/
+
+static int tcpdump_putts(FAR struct tcpdump_cfgs_s *cfgs,
+                         FAR const struct timespec *ts)
+{
+  uint64_t ns = (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+  uint32_t ts32[2] =
+    {
+      (uint32_t)(ns >> 32), (uint32_t)ns
+    };
+
+  return tcpdump_put(cfgs, ts32, sizeof(ts32));
+}
+
 /****************************************************************************
  * Name: write_filehdr
  ****************************************************************************/
 
-static int write_filehdr(int fd, uint32_t snaplen, uint32_t linktype)
+static int write_filehdr(FAR struct tcpdump_cfgs_s *cfgs)
 {
   /* No need to change byte order of any field, reader will swap all fields
    * if magic number is in swapped order.
@@ -130,53 +360,335 @@ static int write_filehdr(int fd, uint32_t snaplen, uint32_t linktype)
       TCPDUMP_VERSION_MINOR, /* version_minor */
       0,                     /* thiszone */
       0,                     /* sigfigs */
-      snaplen,               /* snaplen */
-      linktype               /* linktype */
+      cfgs->snaplen,         /* snaplen */
+      cfgs->linktype         /* linktype */
     };
 
-  /* Write hdr into file. */
+  static const uint32_t shblen = 28;
+  static const uint8_t tsresol = 9;
+  size_t namelen;
+  uint32_t len;
 
-  if (write(fd, &hdr, sizeof(hdr)) < 0)
+  if (!cfgs->pcapng)
     {
-      perror("ERROR: write() failed");
-      return -errno;
+      return tcpdump_put(cfgs, &hdr, sizeof(hdr));
     }
 
-  return OK;
+  /* pcapng: one section with one interface */
+
+  namelen = strlen(cfgs->ifname);
+  len     = 20 + 4 + PCAPNG_PAD(namelen) + 4 + 4 + 4;
+
+  if (tcpdump_put32(cfgs, PCAPNG_BT_SHB) < 0 ||
+      tcpdump_put32(cfgs, shblen) < 0 ||
+      tcpdump_put32(cfgs, PCAPNG_BYTE_ORDER) < 0 ||
+      tcpdump_put16(cfgs, 1, 0) < 0 ||          /* major, minor version */
+      tcpdump_put32(cfgs, UINT32_MAX) < 0 ||    /* section length unknown */
+      tcpdump_put32(cfgs, UINT32_MAX) < 0 ||
+      tcpdump_put32(cfgs, shblen) < 0 ||
+      tcpdump_put32(cfgs, PCAPNG_BT_IDB) < 0 ||
+      tcpdump_put32(cfgs, len) < 0 ||
+      tcpdump_put16(cfgs, cfgs->linktype, 0) < 0 || /* linktype, reserved */
+      tcpdump_put32(cfgs, cfgs->snaplen) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_IF_NAME, cfgs->ifname, namelen) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_IF_TSRESOL, &tsresol, 1) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_OPT_END, NULL, 0) < 0)
+    {
+      return -EIO;
+    }
+
+  return tcpdump_put32(cfgs, len);
 }
 
 /****************************************************************************
  * Name: write_packet
  ****************************************************************************/
 
-static int write_packet(int fd, uint32_t snaplen, uint32_t pkt_len,
-                        FAR const void *buf, FAR const struct timespec *ts)
+static int write_packet(FAR struct tcpdump_cfgs_s *cfgs,
+                        FAR const struct tcpdump_rec_s *rec)
 {
+  static const uint8_t zero[4];
+  uint32_t len;
+
   struct pcap_pkthdr_s hdr =
     {
-      ts->tv_sec,            /* ts_sec */
-      ts->tv_nsec,           /* ts_nsec */
-      MIN(snaplen, pkt_len), /* caplen */
-      pkt_len                /* len */
+      rec->ts.tv_sec,        /* ts_sec */
+      rec->ts.tv_nsec,       /* ts_nsec */
+      rec->caplen,           /* caplen */
+      rec->len               /* len */
     };
 
-  /* Write hdr into file. */
+  if (!cfgs->pcapng)
+    {
+      if (tcpdump_put(cfgs, &hdr, sizeof(hdr)) < 0)
+        {
+          return -EIO;
+        }
 
-  if (write(fd, &hdr, sizeof(hdr)) < 0)
+      return tcpdump_put(cfgs, rec + 1, rec->caplen);
+    }
+
+  len = 28 + PCAPNG_PAD(rec->caplen) + 4;
+
+  if (tcpdump_put32(cfgs, PCAPNG_BT_EPB) < 0 ||
+      tcpdump_put32(cfgs, len) < 0 ||
+      tcpdump_put32(cfgs, 0) < 0 ||                /* interface id */
+      tcpdump_putts(cfgs, &rec->ts) < 0 ||
+      tcpdump_put32(cfgs, rec->caplen) < 0 ||
+      tcpdump_put32(cfgs, rec->len) < 0 ||
+      tcpdump_put(cfgs, rec + 1, rec->caplen) < 0 ||
+      tcpdump_put(cfgs, zero, PCAPNG_PAD(rec->caplen) - rec->caplen) < 0)
     {
-      perror("ERROR: write() failed");
-      return -errno;
+      return -EIO;
     }
 
-  /* Write pkt into file. */
+  return tcpdump_put32(cfgs, len);
+}
 
-  if (write(fd, buf, hdr.caplen) < 0)
+/****************************************************************************
+ * Name: packet_size
+ *
+ * Description:
+ *   Return the file space taken by a packet, including the statistics
+ *   block that follows the last packet of a pcapng file.
+ *
+ ****************************************************************************/
+
+static uint32_t packet_size(FAR const struct tcpdump_cfgs_s *cfgs,
+                            uint32_t caplen)
+{
+  if (!cfgs->pcapng)
+    {
+      return sizeof(struct pcap_pkthdr_s) + caplen;
+    }
+
+  return 28 + PCAPNG_PAD(caplen) + 4 + 20 + 5 * 12 + 4 + 4;
+}
+
+/****************************************************************************
+ * Name: write_stats
+ *
+ * Description:
+ *   Close a pcapng section with the interface statistics.  The counters
+ *   cover the whole capture, not only the current file.
+ *
+ ****************************************************************************/
+
+static int write_stats(FAR struct tcpdump_cfgs_s *cfgs)
+{
+  struct timespec now;
+  uint64_t recv;
+  uint64_t drop;
+  uint32_t len;
+
+  if (!cfgs->pcapng)
+    {
+      return OK;
+    }
+
+  pthread_mutex_lock(&cfgs->lock);
+  recv = cfgs->recv;
+  drop = cfgs->drop;
+  pthread_mutex_unlock(&cfgs->lock);
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  len = 20 + 5 * 12 + 4 + 4;
+
+  if (tcpdump_put32(cfgs, PCAPNG_BT_ISB) < 0 ||
+      tcpdump_put32(cfgs, len) < 0 ||
+      tcpdump_put32(cfgs, 0) < 0 ||                /* interface id */
+      tcpdump_putts(cfgs, &now) < 0 ||
+      tcpdump_put16(cfgs, PCAPNG_ISB_START, 8) < 0 ||
+      tcpdump_putts(cfgs, &cfgs->start) < 0 ||
+      tcpdump_put16(cfgs, PCAPNG_ISB_END, 8) < 0 ||
+      tcpdump_putts(cfgs, &now) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_ISB_IFRECV, &recv, 8) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_ISB_OSDROP, &drop, 8) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_ISB_USRDELIV, &cfgs->deliv, 8) < 0 ||
+      tcpdump_putopt(cfgs, PCAPNG_OPT_END, NULL, 0) < 0)
+    {
+      return -EIO;
+    }
+
+  return tcpdump_put32(cfgs, len);
+}
+
+/****************************************************************************
+ * Name: file_open
+ *
+ * Description:
+ *   Open the next output file and write its header.  With -C the files
+ *   are numbered like tcpdump does: "file", "file1", "file2", ... or, with
+ *   -W, "file0", "file1", ... reusing the oldest number once all
+ *   filecount files exist.
+ *
+ ****************************************************************************/
+
+static int file_open(FAR struct tcpdump_cfgs_s *cfgs)
+{
+  char path[PATH_MAX];
+  int width = 1;
+  uint32_t n;
+
+  if (cfgs->filecount > 0)
+    {
+      for (n = cfgs->filecount - 1; n >= 10; n /= 10)
+        {
+          width++;
+        }
+
+      snprintf(path, sizeof(path), "%s%0*" PRIu32, cfgs->path, width,
+               cfgs->fileno % cfgs->filecount);
+    }
+  else if (cfgs->fileno > 0)
     {
-      perror("ERROR: write() failed");
+      snprintf(path, sizeof(path), "%s%" PRIu32, cfgs->path, cfgs->fileno);
+    }
+  else
+    {
+      strlcpy(path, cfgs->path, sizeof(path));
+    }
+
+  cfgs->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (cfgs->fd < 0)
+    {
+      perror("ERROR: open() failed");
       return -errno;
     }
 
-  return OK;
+  cfgs->written = 0;
+  cfgs->wpos    = 0;
+  return write_filehdr(cfgs);
+}
+
+/****************************************************************************
+ * Name: file_close
+ ****************************************************************************/
+
+static int file_close(FAR struct tcpdump_cfgs_s *cfgs)
+{
+  int ret;
+
+  if (cfgs->fd < 0)
+    {
+      return -EBADF;
+    }
+
+  ret = write_stats(cfgs);
+  if (ret >= 0)
+    {
+      ret = tcpdump_flush(cfgs);
+    }
+
+  close(cfgs->fd);
+  cfgs->fd = -1;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: do_write
+ *
+ * Description:
+ *   Writer thread: move the captured packets from the ring to the files.
+ *   All packets available are written in one batch without holding the
+ *   lock, then their space is returned to the capture thread at once.
+ *
+ ****************************************************************************/
+
+static FAR void *do_write(FAR void *arg)
+{
+  FAR struct tcpdump_cfgs_s *cfgs = arg;
+  FAR struct tcpdump_rec_s *rec;
+  size_t tail;
+  size_t avail;
+  size_t done;
+  size_t size;
+  int ret = OK;
+
+  pthread_mutex_lock(&cfgs->lock);
+  for (; ; )
+    {
+      while (cfgs->used == 0 && !cfgs->stop)
+        {
+          pthread_cond_wait(&cfgs->cond, &cfgs->lock);
+        }
+
+      if (cfgs->used == 0)
+        {
+          break;
+        }
+
+      tail  = cfgs->tail;
+      avail = cfgs->used;
+      pthread_mutex_unlock(&cfgs->lock);
+
+      for (done = 0; done < avail && ret >= 0; done += size)
+        {
+          rec = (FAR struct tcpdump_rec_s *)(cfgs->ring + tail);
+          if (cfgs->ringsize - tail < sizeof(struct tcpdump_rec_s) ||
+              rec->caplen == TCPDUMP_REC_WRAP)
+            {
+              /* The rest of the ring is unused */
+
+              size = cfgs->ringsize - tail;
+              tail = 0;
+              continue;
+            }
+
+          size = TCPDUMP_REC_ALIGN(sizeof(struct tcpdump_rec_s) +
+                                   rec->caplen);
+
+          /* Continue in the next file if this packet does not fit */
+
+          if (cfgs->filesize > 0 &&
+              cfgs->written + packet_size(cfgs, rec->caplen) >
+              cfgs->filesize)
+            {
+              ret = file_close(cfgs);
+              if (ret >= 0)
+                {
+                  cfgs->fileno++;
+                  ret = file_open(cfgs);
+                }
+            }
+
+          if (ret >= 0)
+            {
+              ret = write_packet(cfgs, rec);
+              if (ret >= 0)
+                {
+                  cfgs->deliv++;
+                }
+            }
+
+          tail += size;
+          if (tail == cfgs->ringsize)
+            {
+              tail = 0;
+            }
+        }
+
+      if (ret >= 0 && cfgs->pktbuffered)
+        {
+          ret = tcpdump_flush(cfgs);
+        }
+
+      pthread_mutex_lock(&cfgs->lock);
+      cfgs->tail  = tail;
+      cfgs->used -= avail;
+
+      if (ret < 0)
+        {
+          /* Stop the capture, the packets are dropped from now on */
+
+          g_exiting = true;
+          cfgs->used = 0;
+          break;
+        }
+    }
+
+  pthread_mutex_unlock(&cfgs->lock);
+  return NULL;
 }
 
 /****************************************************************************
@@ -234,41 +746,137 @@ static uint32_t get_linktype(FAR const char *ifname)
 }
 
 /****************************************************************************
- * Name: do_capture
+ * Name: ring_reserve
+ *
+ * Description:
+ *   Find room for the largest possible packet in the capture ring.  Must
+ *   be called with the ring locked.  Returns the offset of the room or -1
+ *   if the ring is full.
+ *
  ****************************************************************************/
 
-static void do_capture(FAR const struct tcpdump_cfgs_s *cfgs)
+static ssize_t ring_reserve(FAR struct tcpdump_cfgs_s *cfgs)
 {
-  ssize_t len;
-  uint8_t buf[MAX_NETDEV_PKTSIZE];
-  struct timespec ts;
+  FAR struct tcpdump_rec_s *rec;
+
+  if (cfgs->used == 0)
+    {
+      cfgs->head = 0;
+      cfgs->tail = 0;
+    }
+
+  if (cfgs->head >= cfgs->tail && cfgs->used < cfgs->ringsize)
+    {
+      if (cfgs->ringsize - cfgs->head >= TCPDUMP_REC_MAX)
+        {
+          return cfgs->head;
+        }
+
+      if (cfgs->tail < TCPDUMP_REC_MAX)
+        {
+          return -1;
+        }
+
+      /* Skip the end of the ring */
+
+      if (cfgs->ringsize - cfgs->head >= sizeof(struct tcpdump_rec_s))
+        {
+          rec = (FAR struct tcpdump_rec_s *)(cfgs->ring + cfgs->head);
+          rec->caplen = TCPDUMP_REC_WRAP;
+        }
 
-  /* Write file header */
+      cfgs->used += cfgs->ringsize - cfgs->head;
+      cfgs->head  = 0;
+      return 0;
+    }
 
-  if (write_filehdr(cfgs->fd, cfgs->snaplen, cfgs->linktype) < 0)
+  if (cfgs->head < cfgs->tail && cfgs->tail - cfgs->head >= TCPDUMP_REC_MAX)
     {
-      return;
+      return cfgs->head;
     }
 
-  /* Dump packets */
+  return -1;
+}
+
+/****************************************************************************
+ * Name: do_capture
+ *
+ * Description:
+ *   Read the packets straight into the capture ring and leave the file
+ *   I/O to the writer thread.  Packets are dropped and counted if the ring
+ *   is full.
+ *
+ ****************************************************************************/
+
+static void do_capture(FAR struct tcpdump_cfgs_s *cfgs)
+{
+  FAR struct tcpdump_rec_s *rec;
+  uint8_t scratch[4];
+  ssize_t off;
+  ssize_t len;
+
+  clock_gettime(CLOCK_REALTIME, &cfgs->start);
 
-  while ((len = read(cfgs->sd, buf, sizeof(buf))) >= 0 && !g_exiting)
+  while (!g_exiting)
     {
-      if (len == 0)
+      pthread_mutex_lock(&cfgs->lock);
+      off = ring_reserve(cfgs);
+      pthread_mutex_unlock(&cfgs->lock);
+
+      if (off < 0)
         {
+          /* The writer is behind, consume the packet and drop it */
+
+          len = read(cfgs->sd, scratch, sizeof(scratch));
+          if (len > 0)
+            {
+              pthread_mutex_lock(&cfgs->lock);
+              cfgs->recv++;
+              cfgs->drop++;
+              pthread_mutex_unlock(&cfgs->lock);
+            }
+          else if (len < 0)
+            {
+              break;
+            }
+
           continue;
         }
 
-      if (clock_gettime(CLOCK_REALTIME, &ts) < 0)
+      /* The reserved room is not visible to the writer until head moves */
+
+      rec = (FAR struct tcpdump_rec_s *)(cfgs->ring + off);
+      len = read(cfgs->sd, rec + 1, MAX_NETDEV_PKTSIZE);
+      if (len < 0)
+        {
+          break;
+        }
+      else if (len == 0)
+        {
+          continue;
+        }
+
+      if (clock_gettime(CLOCK_REALTIME, &rec->ts) < 0)
         {
           perror("ERROR: clock_gettime() failed");
           return;
         }
 
-      if (write_packet(cfgs->fd, cfgs->snaplen, len, buf, &ts) < 0)
+      rec->len    = len;
+      rec->caplen = MIN(cfgs->snaplen, len);
+
+      pthread_mutex_lock(&cfgs->lock);
+      cfgs->head  = off + TCPDUMP_REC_ALIGN(sizeof(struct tcpdump_rec_s) +
+                                            rec->caplen);
+      cfgs->used += cfgs->head - off;
+      if (cfgs->head == cfgs->ringsize)
         {
-          return;
+          cfgs->head = 0;
         }
+
+      cfgs->recv++;
+      pthread_cond_signal(&cfgs->cond);
+      pthread_mutex_unlock(&cfgs->lock);
     }
 
   if (!g_exiting)
@@ -285,6 +893,7 @@ int main(int argc, FAR char *argv[])
 {
   int ifindex;
   int nerrors;
+  pthread_t writer;
   struct tcpdump_cfgs_s cfgs;
   struct tcpdump_args_s args;
 
@@ -295,7 +904,18 @@ int main(int argc, FAR char *argv[])
   args.file      = arg_str1("w", NULL, "file", "Path to dump file");
   args.snaplen   = arg_int0("s", "snapshot-length", "snaplen",
                             "Max dump length of each packet");
-  args.end       = arg_end(3);
+  args.filesize  = arg_int0("C", "file-size", "file_size",
+                            "Start a new file after file_size million "
+                            "bytes");
+  args.filecount = arg_int0("W", "file-count", "filecount",
+                            "Reuse the oldest file after filecount files");
+  args.bufsize   = arg_int0("B", "buffer-size", "buffer_size",
+                            "Capture ring size in KiB");
+  args.buffered  = arg_lit0("U", "packet-buffered",
+                            "Write the packets out as soon as possible");
+  args.pcapng    = arg_lit0(NULL, "pcapng",
+                            "Write pcapng with interface statistics");
+  args.end       = arg_end(8);
 
   nerrors = arg_parse(argc, argv, (FAR void**)&args);
   if (nerrors != 0)
@@ -313,35 +933,113 @@ int main(int argc, FAR char *argv[])
       goto out;
     }
 
-  cfgs.fd = open(args.file->sval[0], O_WRONLY | O_CREAT | O_TRUNC, 0644);
-  if (cfgs.fd < 0)
+  memset(&cfgs, 0, sizeof(cfgs));
+  cfgs.ifname      = args.interface->sval[0];
+  cfgs.path        = args.file->sval[0];
+  cfgs.pcapng      = args.pcapng->count > 0;
+  cfgs.pktbuffered = args.buffered->count > 0;
+  cfgs.wbufsize    = CONFIG_SYSTEM_TCPDUMP_BUFSIZE;
+  cfgs.ringsize    = CONFIG_SYSTEM_TCPDUMP_RINGSIZE;
+
+  if (args.snaplen->count > 0)
     {
-      perror("ERROR: open() failed");
-      goto out;
+      cfgs.snaplen = *args.snaplen->ival;
+    }
+  else
+    {
+      cfgs.snaplen = DEFAULT_SNAPLEN;
+    }
+
+  if (args.filesize->count > 0 && *args.filesize->ival > 0)
+    {
+      if (*args.filesize->ival > UINT32_MAX / 1000000)
+        {
+          printf("-C is at most %" PRIu32 " MB\n",
+                 (uint32_t)(UINT32_MAX / 1000000));
+          goto out;
+        }
+
+      cfgs.filesize = (uint32_t)*args.filesize->ival * 1000000;
+    }
+
+  if (args.filecount->count > 0 && *args.filecount->ival > 0)
+    {
+      if (cfgs.filesize == 0)
+        {
+          printf("-W requires -C\n");
+          goto out;
+        }
+
+      cfgs.filecount = *args.filecount->ival;
+    }
+
+  if (args.bufsize->count > 0 && *args.bufsize->ival > 0)
+    {
+      cfgs.ringsize = *args.bufsize->ival * 1024;
+    }
+
+  /* The ring must hold at least two packets of the largest size */
+
+  cfgs.ringsize = MAX(cfgs.ringsize, 2 * TCPDUMP_REC_MAX);
+  cfgs.ring     = malloc(cfgs.ringsize);
+  cfgs.wbuf     = malloc(cfgs.wbufsize);
+  if (cfgs.ring == NULL || cfgs.wbuf == NULL)
+    {
+      printf("Failed to allocate the capture buffers\n");
+      goto out_with_buffers;
+    }
+
+  cfgs.linktype = get_linktype(cfgs.ifname);
+
+  if (file_open(&cfgs) < 0)
+    {
+      if (cfgs.fd >= 0)
+        {
+          close(cfgs.fd);
+        }
+
+      goto out_with_buffers;
     }
 
   cfgs.sd = socket_open(ifindex);
   if (cfgs.sd < 0)
     {
       close(cfgs.fd);
-      goto out;
+      goto out_with_buffers;
     }
 
-  if (args.snaplen->count > 0)
+  pthread_mutex_init(&cfgs.lock, NULL);
+  pthread_cond_init(&cfgs.cond, NULL);
+
+  if (pthread_create(&writer, NULL, do_write, &cfgs) != 0)
     {
-      cfgs.snaplen = *args.snaplen->ival;
+      printf("Failed to create the writer thread\n");
     }
   else
     {
-      cfgs.snaplen = DEFAULT_SNAPLEN;
-    }
+      do_capture(&cfgs);
 
-  cfgs.linktype = get_linktype(args.interface->sval[0]);
+      /* Let the writer drain the ring */
 
-  do_capture(&cfgs);
+      pthread_mutex_lock(&cfgs.lock);
+      cfgs.stop = true;
+      pthread_cond_signal(&cfgs.cond);
+      pthread_mutex_unlock(&cfgs.lock);
+      pthread_join(writer, NULL);
 
+      printf("%" PRIu64 " packets captured, %" PRIu64 " dropped\n",
+             cfgs.deliv, cfgs.drop);
+    }
+
+  file_close(&cfgs);
   close(cfgs.sd);
-  close(cfgs.fd);
+
+  pthread_cond_destroy(&cfgs.cond);
+  pthread_mutex_destroy(&cfgs.lock);
+
+out_with_buffers:
+  free(cfgs.wbuf);
+  free(cfgs.ring);
 
 out:
   arg_freetable((FAR void **)&args, 1);
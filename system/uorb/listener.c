@@ -26,6 +26,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <dirent.h>
 #include <poll.h>
 #include <signal.h>
@@ -33,6 +34,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/param.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -45,6 +47,15 @@
 #define ORB_MAX_PRINT_NAME 32
 #define ORB_TOP_WAIT_TIME  1000
 
+#ifdef CONFIG_UORB_STATS
+#  define ORB_STATS_MAX_SUBS 8
+#  define ORB_STATS_USAGE \
+  "\t[-S       ]  Statistics of instrumented topics and subscribers,\n" \
+  "\t             continuously or once with -l\n"
+#else
+#  define ORB_STATS_USAGE ""
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -77,6 +88,10 @@ static int listener_update(FAR struct list_node *objlist,
 static void listener_top(FAR struct list_node *objlist,
                          FAR const char *filter,
                          bool only_once);
+#ifdef CONFIG_UORB_STATS
+static void listener_print_stats(FAR struct orb_object *object);
+static void listener_stats(FAR struct list_node *objlist, bool only_once);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -120,8 +135,8 @@ listener <command> [arguments...]\n\
 \t             default: 0\n\
 \t[-t <val> ]  Time of listener, in seconds, default: 5\n\
 \t[-T       ]  Top, continuously print updating objects\n\
-\t[-l       ]  Top only execute once.\n\
-  ");
+\t[-l       ]  Top only execute once.\n"
+ORB_STATS_USAGE);
 }
 
 /****************************************************************************
@@ -693,6 +708,134 @@ static void listener_top(FAR struct list_node *objlist,
   while (!quit && !only_once);
 }
 
+#ifdef CONFIG_UORB_STATS
+/****************************************************************************
+ * Name: listener_print_stats
+ *
+ * Description:
+ *   Print the statistics of an object, then one line per subscriber.
+ *
+ * Input Parameters:
+ *   object   Object to print.
+ *
+ * Returned Value:
+ *   None.
+ ****************************************************************************/
+
+static void listener_print_stats(FAR struct orb_object *object)
+{
+  struct orb_sub_stats subs[ORB_STATS_MAX_SUBS];
+  FAR struct orb_sub_stats *sub;
+  struct orb_stats stats;
+  char name[ORB_MAX_PRINT_NAME];
+  uint32_t max_latency = 0;
+  int nsubs;
+  int i;
+
+  nsubs = orb_get_stats(object->meta, object->instance, &stats, subs,
+                        ORB_STATS_MAX_SUBS);
+  if (nsubs < 0)
+    {
+      return;
+    }
+
+  nsubs = MIN(nsubs, ORB_STATS_MAX_SUBS);
+  for (i = 0; i < nsubs; i++)
+    {
+      max_latency = MAX(max_latency, subs[i].max_latency);
+    }
+
+  uorbinfo_raw("\033[K" "%-*s %4d %6" PRIu32 " %6" PRIu32 " %6" PRIu32
+               " %6" PRIu32 " %6" PRIu32 " %5" PRIu32 " %5" PRIu32
+               " %5" PRIu32 " %5" PRIu32 " %5" PRIu32 " %5" PRIu32
+               " %5" PRIu32 " %6" PRIu32,
+               ORB_MAX_PRINT_NAME, object->meta->o_name, object->instance,
+               stats.npublish, stats.avg_cycles, stats.max_cycles,
+               stats.ncopies, stats.dropped, stats.latency[0],
+               stats.latency[1], stats.latency[2], stats.latency[3],
+               stats.latency[4], stats.latency[5], stats.latency[6],
+               max_latency);
+
+  for (i = 0; i < nsubs; i++)
+    {
+      sub = &subs[i];
+      snprintf(name, sizeof(name), "  %s(%d)", sub->name, sub->pid);
+      uorbinfo_raw("\033[K" "%-*s %4d %6s %6s %6s %6" PRIu32 " %6" PRIu32
+                   " %5" PRIu32 " %5" PRIu32 " %5" PRIu32 " %5" PRIu32
+                   " %5" PRIu32 " %5" PRIu32 " %5" PRIu32 " %6" PRIu32,
+                   ORB_MAX_PRINT_NAME, name, sub->fd, "-", "-", "-",
+                   sub->ncopies, sub->dropped, sub->latency[0],
+                   sub->latency[1], sub->latency[2], sub->latency[3],
+                   sub->latency[4], sub->latency[5], sub->latency[6],
+                   sub->max_latency);
+    }
+}
+
+/****************************************************************************
+ * Name: listener_stats
+ *
+ * Description:
+ *   Continuously print the statistics of the objects, with a line per
+ *   subscriber below each object.  A subscriber line shows the subscriber
+ *   fd in the INST column.  Exited when the user presses the enter key.
+ *
+ * Input Parameters:
+ *   objlist    List of objects.
+ *   only_once  Print only once, then exit.
+ *
+ * Returned Value:
+ *   None.
+ ****************************************************************************/
+
+static void listener_stats(FAR struct list_node *objlist, bool only_once)
+{
+  FAR struct listen_object_s *tmp;
+  struct pollfd fds;
+  char c;
+
+  fds.fd     = STDIN_FILENO;
+  fds.events = POLLIN;
+
+  if (!only_once)
+    {
+      uorbinfo_raw("\033[2J\n"); /* clear screen */
+    }
+
+  do
+    {
+      if (!only_once)
+        {
+          uorbinfo_raw("\033[H"); /* move cursor to top left corner */
+        }
+
+      uorbinfo_raw("\033[K" "%-*s INST   #PUB AVGCYC MAXCYC  #COPY  #DROP"
+                   "  <10u <100u   <1m  <10m <100m   <1s  >=1s MAXLAT",
+                   ORB_MAX_PRINT_NAME, "NAME");
+
+      list_for_every_entry(objlist, tmp, struct listen_object_s, node)
+        {
+          listener_print_stats(&tmp->object);
+        }
+
+      if (only_once)
+        {
+          break;
+        }
+
+      uorbinfo_raw("\033[0J"); /* Clear the rest of the screen */
+
+      /* Wait a while, quit if user input some thing */
+
+      if (poll(&fds, 1, ORB_TOP_WAIT_TIME) > 0 &&
+          read(STDIN_FILENO, &c, 1) > 0)
+        {
+          break;
+        }
+    }
+  while (!g_should_exit);
+}
+#endif
+
 static void exit_handler(int signo)
 {
   g_should_exit = true;
@@ -712,6 +855,9 @@ int main(int argc, FAR char *argv[])
   int timeout       = 5;
   bool top          = false;
   bool only_once    = false;
+#ifdef CONFIG_UORB_STATS
+  bool stats        = false;
+#endif
   FAR char *filter  = NULL;
   int ret;
   int ch;
@@ -724,7 +870,7 @@ int main(int argc, FAR char *argv[])
 
   /* Pasrse Argument */
 
-  while ((ch = getopt(argc, argv, "r:b:n:t:Tlh")) != EOF)
+  while ((ch = getopt(argc, argv, "r:b:n:t:TlSh")) != EOF)
     {
       switch (ch)
       {
@@ -768,6 +914,12 @@ int main(int argc, FAR char *argv[])
           only_once = true;
           break;
 
+#ifdef CONFIG_UORB_STATS
+        case 'S':
+          stats = true;
+          break;
+#endif
+
         case 'h':
         default:
           goto error;
@@ -788,6 +940,13 @@ int main(int argc, FAR char *argv[])
       return 0;
     }
 
+#ifdef CONFIG_UORB_STATS
+  if (stats)
+    {
+      listener_stats(&objlist, only_once);
+    }
+  else
+#endif
   if (top)
     {
       listener_top(&objlist, filter, only_once);
@@ -0,0 +1,858 @@
+/****************************************************************************
+ * apps/system/uorb/record/record.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <uORB/uORB.h>
+
+#include "record.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RECORD_POLL_TIME   100  /* ms */
+#define RECORD_INDEX_GROW  64
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct record_topic_s
+{
+  FAR const struct orb_metadata *meta;      /* Recorded topic */
+  int                            instance;  /* Recorded instance */
+  int                            fd;        /* Subscriber handle */
+  uint32_t                       queue_size; /* Samples per batch copy */
+  unsigned long                  count;     /* Samples recorded */
+};
+
+struct record_s
+{
+  int                         fd;        /* Log file */
+  int                         error;     /* First write error */
+  FAR uint8_t                *buffer;    /* Write buffer */
+  size_t                      size;      /* Size of the write buffer */
+  size_t                      len;       /* Bytes in the write buffer */
+  uint64_t                    offset;    /* File offset of buffer[0] */
+  orb_abstime                 start;     /* Start of the recording */
+  orb_abstime                 last;      /* Time of the previous record */
+  orb_abstime                 sync;      /* Time of the last sync record */
+  bool                        synced;    /* A sync record was written */
+  FAR struct orb_log_index_s *index;     /* Sync records */
+  size_t                      nindex;
+  size_t                      maxindex;
+  FAR struct record_topic_s  *topics;    /* Recorded objects */
+  int                         ntopics;
+  FAR uint8_t                *samples;   /* Batch copy buffer */
+  unsigned long               nsamples;  /* Samples recorded */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int record_add_topic(FAR struct record_s *rec,
+                            FAR const struct orb_metadata *meta,
+                            int instance);
+static int record_find_topics(FAR struct record_s *rec,
+                              FAR const char *filter);
+static int record_flush(FAR struct record_s *rec);
+static int record_put(FAR struct record_s *rec, FAR const void *data,
+                      size_t len);
+static int record_emit(FAR struct record_s *rec, uint8_t type, uint8_t id,
+                       FAR const void *payload, size_t len,
+                       orb_abstime now);
+static int record_data(FAR struct record_s *rec, int id,
+                       FAR const void *sample, orb_abstime now);
+static int record_subscribe(FAR struct record_s *rec, float rate,
+                            int latency);
+static orb_abstime record_stamp(FAR struct record_s *rec,
+                                FAR const struct orb_metadata *meta,
+                                FAR const void *sample, orb_abstime now);
+static int record_copy(FAR struct record_s *rec, int id);
+static int record_close(FAR struct record_s *rec);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static bool g_should_exit = false;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void usage(void)
+{
+  uorbinfo_raw("\n\
+Utility to record uORB topics into a binary log for uorb_replay.\n\
+\n\
+The recorder can be exited any time by pressing Ctrl+C.\n\
+\n\
+uorb_record [arguments...] [topics]\n\
+ Commands:\n\
+\t<topics_name> Topic name. Multi name are separated by ','\n\
+\t              All topics are recorded if not specified\n\
+\t[-h       ]  Recorder commands help\n\
+\t[-f <file>]  Log file, default: " CONFIG_UORB_RECORDER_FILE "\n\
+\t[-r <val> ]  Subscription rate (unlimited if 0), default: 0\n\
+\t[-b <val> ]  Subscription maximum report latency in us(unlimited if 0),\n\
+\t             default: 0\n\
+\t[-t <val> ]  Time of recording, in seconds (unlimited if 0),\n\
+\t             default: 0\n");
+}
+
+static void exit_handler(int signo)
+{
+  g_should_exit = true;
+}
+
+/****************************************************************************
+ * Name: record_add_topic
+ *
+ * Description:
+ *   Add an object to the recorded objects, once.
+ *
+ * Returned Value:
+ *   0 on success, negative errno on failure.
+ ****************************************************************************/
+
+static int record_add_topic(FAR struct record_s *rec,
+                            FAR const struct orb_metadata *meta,
+                            int instance)
+{
+  FAR struct record_topic_s *topics;
+  int i;
+
+  for (i = 0; i < rec->ntopics; i++)
+    {
+      if (rec->topics[i].meta == meta && rec->topics[i].instance == instance)
+        {
+          return 0;
+        }
+    }
+
+  if (rec->ntopics >= ORB_LOG_MAX_TOPICS)
+    {
+      uorberr("Too many objects, %s%d is not recorded",
+              meta->o_name, instance);
+      return -E2BIG;
+    }
+
+  topics = realloc(rec->topics, (rec->ntopics + 1) * sizeof(*topics));
+  if (topics == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  rec->topics = topics;
+  topics += rec->ntopics++;
+  memset(topics, 0, sizeof(*topics));
+  topics->meta     = meta;
+  topics->instance = instance;
+  topics->fd       = -1;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: record_find_topics
+ *
+ * Description:
+ *   Collect the objects to record.  A topic name without instance number
+ *   selects all its existing instances, no filter selects all the objects
+ *   under ORB_SENSOR_PATH.
+ *
+ * Returned Value:
+ *   Number of objects on success, negative errno on failure.
+ ****************************************************************************/
+
+static int record_find_topics(FAR struct record_s *rec,
+                              FAR const char *filter)
+{
+  FAR const struct orb_metadata *meta;
+  FAR struct dirent *entry;
+  char name[ORB_PATH_MAX];
+  FAR DIR *dir;
+  size_t len;
+  int instance;
+  int ret;
+
+  if (filter)
+    {
+      FAR const char *member = filter;
+      FAR const char *tmp;
+
+      do
+        {
+          while (*member == ',')
+            {
+              member++;
+            }
+
+          tmp = strchr(member, ',');
+          len = tmp ? tmp - member : strlen(member);
+          if (len == 0 || len >= ORB_PATH_MAX)
+            {
+              break;
+            }
+
+          strlcpy(name, member, len + 1);
+          member = tmp;
+
+          meta = orb_get_meta(name);
+          if (meta == NULL)
+            {
+              uorbinfo_raw("Unknown topic %s", name);
+              continue;
+            }
+
+          if (isdigit(name[len - 1]))
+            {
+              ret = record_add_topic(rec, meta, name[len - 1] - '0');
+            }
+          else
+            {
+              for (instance = 0, ret = 0;
+                   ret >= 0 && orb_exists(meta, instance) == 0;
+                   instance++)
+                {
+                  ret = record_add_topic(rec, meta, instance);
+                }
+            }
+
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+      while (member);
+
+      return rec->ntopics;
+    }
+
+  dir = opendir(ORB_SENSOR_PATH);
+  if (!dir)
+    {
+      return 0;
+    }
+
+  while ((entry = readdir(dir)))
+    {
+      if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+        {
+          continue;
+        }
+
+      len = strlen(entry->d_name);
+      if (len == 0 || !isdigit(entry->d_name[len - 1]))
+        {
+          continue;
+        }
+
+      meta = orb_get_meta(entry->d_name);
+      if (meta == NULL)
+        {
+          continue;
+        }
+
+      ret = record_add_topic(rec, meta, entry->d_name[len - 1] - '0');
+      if (ret < 0)
+        {
+          closedir(dir);
+          return ret;
+        }
+    }
+
+  closedir(dir);
+  return rec->ntopics;
+}
+
+/****************************************************************************
+ * Name: record_flush
+ *
+ * Description:
+ *   Write the buffered records to the log.
+ ****************************************************************************/
+
+static int record_flush(FAR struct record_s *rec)
+{
+  size_t pos = 0;
+  ssize_t ret;
+
+  while (rec->error == 0 && pos < rec->len)
+    {
+      ret = write(rec->fd, rec->buffer + pos, rec->len - pos);
+      if (ret < 0)
+        {
+          if (errno != EINTR)
+            {
+              rec->error = -errno;
+            }
+
+          continue;
+        }
+      else if (ret == 0)
+        {
+          rec->error = -EIO;
+          break;
+        }
+
+      pos += ret;
+    }
+
+  rec->offset += pos;
+  rec->len     = 0;
+  return rec->error;
+}
+
+/****************************************************************************
+ * Name: record_put
+ *
+ * Description:
+ *   Append bytes to the write buffer, the buffer is written out whenever
+ *   it is full.
+ ****************************************************************************/
+
+static int record_put(FAR struct record_s *rec, FAR const void *data,
+                      size_t len)
+{
+  FAR const uint8_t *src = data;
+  size_t n;
+  int ret;
+
+  while (len > 0)
+    {
+      if (rec->len == rec->size)
+        {
+          ret = record_flush(rec);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      n = rec->size - rec->len;
+      if (n > len)
+        {
+          n = len;
+        }
+
+      memcpy(rec->buffer + rec->len, src, n);
+      rec->len += n;
+      src      += n;
+      len      -= n;
+    }
+
+  return rec->error;
+}
+
+/****************************************************************************
+ * Name: record_emit
+ *
+ * Description:
+ *   Append one record.  The time of the record becomes the reference of
+ *   the next delta.
+ ****************************************************************************/
+
+static int record_emit(FAR struct record_s *rec, uint8_t type, uint8_t id,
+                       FAR const void *payload, size_t len,
+                       orb_abstime now)
+{
+  struct orb_log_record_s hdr;
+  int ret;
+
+  hdr.type  = type;
+  hdr.id    = id;
+  hdr.size  = len;
+  hdr.delta = now - rec->last;
+
+  ret = record_put(rec, &hdr, sizeof(hdr));
+  if (ret >= 0)
+    {
+      ret = record_put(rec, payload, len);
+    }
+
+  rec->last = now;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: record_data
+ *
+ * Description:
+ *   Append one sample, preceded by a sync record when it is due or when
+ *   the delta would not fit in the record.
+ ****************************************************************************/
+
+static int record_data(FAR struct record_s *rec, int id,
+                       FAR const void *sample, orb_abstime now)
+{
+  FAR struct record_topic_s *topic = &rec->topics[id];
+  int ret;
+
+  if (!rec->synced || now - rec->sync >= ORB_LOG_SYNC_INTERVAL ||
+      now - rec->last > UINT32_MAX)
+    {
+      uint64_t time = now - rec->start;
+
+      if (rec->nindex == rec->maxindex)
+        {
+          FAR struct orb_log_index_s *index;
+          size_t max = rec->maxindex + RECORD_INDEX_GROW;
+
+          /* The log stays usable without the index, so just stop indexing
+           * if the memory runs out.
+           */
+
+          index = realloc(rec->index, max * sizeof(*index));
+          if (index != NULL)
+            {
+              rec->index    = index;
+              rec->maxindex = max;
+            }
+        }
+
+      if (rec->nindex < rec->maxindex)
+        {
+          rec->index[rec->nindex].time   = time;
+          rec->index[rec->nindex].offset = rec->offset + rec->len;
+          rec->nindex++;
+        }
+
+      ret = record_emit(rec, ORB_LOG_SYNC, 0, &time, sizeof(time), now);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      rec->sync   = now;
+      rec->synced = true;
+    }
+
+  topic->count++;
+  rec->nsamples++;
+  return record_emit(rec, ORB_LOG_DATA, id, sample, topic->meta->o_size,
+                     now);
+}
+
+/****************************************************************************
+ * Name: record_subscribe
+ *
+ * Description:
+ *   Subscribe the objects, write the topic records and allocate the batch
+ *   copy buffer for the deepest queue.
+ *
+ * Returned Value:
+ *   0 on success, negative errno on failure.
+ ****************************************************************************/
+
+static int record_subscribe(FAR struct record_s *rec, float rate,
+                            int latency)
+{
+  char payload[sizeof(struct orb_log_topic_s) + ORB_PATH_MAX];
+  FAR struct orb_log_topic_s *info = (FAR struct orb_log_topic_s *)payload;
+  FAR struct record_topic_s *topic;
+  struct orb_state state;
+  size_t maxsize = 0;
+  size_t len;
+  int ret;
+  int i;
+
+  for (i = 0; i < rec->ntopics; i++)
+    {
+      topic = &rec->topics[i];
+      topic->fd = orb_subscribe_multi(topic->meta, topic->instance);
+      if (topic->fd < 0)
+        {
+          uorberr("Subscribe %s%d failed", topic->meta->o_name,
+                  topic->instance);
+          return -errno;
+        }
+
+      topic->queue_size = 1;
+      if (orb_get_state(topic->fd, &state) == 0 && state.queue_size > 1)
+        {
+          topic->queue_size = state.queue_size;
+        }
+
+      if (rate > 0)
+        {
+          orb_set_interval(topic->fd, (unsigned)(1000000 / rate));
+          if (latency > 0)
+            {
+              orb_set_batch_interval(topic->fd, latency);
+            }
+        }
+
+      if (topic->queue_size * topic->meta->o_size > maxsize)
+        {
+          maxsize = topic->queue_size * topic->meta->o_size;
+        }
+
+      len = strlen(topic->meta->o_name);
+      if (len > ORB_PATH_MAX)
+        {
+          len = ORB_PATH_MAX;
+        }
+
+      info->queue_size = topic->queue_size;
+      info->size       = topic->meta->o_size;
+      info->instance   = topic->instance;
+      info->reserved   = 0;
+      memcpy(info + 1, topic->meta->o_name, len);
+
+      ret = record_emit(rec, ORB_LOG_TOPIC, i, payload,
+                        sizeof(*info) + len, rec->start);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  rec->samples = malloc(maxsize);
+  return rec->samples != NULL ? 0 : -ENOMEM;
+}
+
+/****************************************************************************
+ * Name: record_stamp
+ *
+ * Description:
+ *   Return the time of a sample: the leading timestamp field of the topic,
+ *   kept between the previous record and now so the deltas stay valid, or
+ *   now if the topic has no usable timestamp.
+ ****************************************************************************/
+
+static orb_abstime record_stamp(FAR struct record_s *rec,
+                                FAR const struct orb_metadata *meta,
+                                FAR const void *sample, orb_abstime now)
+{
+  uint64_t timestamp;
+
+  if (meta->o_size < sizeof(timestamp))
+    {
+      return now;
+    }
+
+  memcpy(&timestamp, sample, sizeof(timestamp));
+  if (timestamp == 0 || timestamp > now)
+    {
+      return now;
+    }
+
+  return timestamp > rec->last ? timestamp : rec->last;
+}
+
+/****************************************************************************
+ * Name: record_copy
+ *
+ * Description:
+ *   Record all the pending samples of an object, each at its own time so
+ *   the replay keeps their spacing.
+ ****************************************************************************/
+
+static int record_copy(FAR struct record_s *rec, int id)
+{
+  FAR struct record_topic_s *topic = &rec->topics[id];
+  FAR const uint8_t *sample;
+  orb_abstime now;
+  ssize_t n;
+  ssize_t i;
+  int ret;
+
+  n = orb_copy_batch(topic->meta, topic->fd, rec->samples,
+                     topic->queue_size);
+  if (n <= 0)
+    {
+      return 0;
+    }
+
+  now = orb_absolute_time();
+  for (i = 0; i < n; i++)
+    {
+      sample = rec->samples + i * topic->meta->o_size;
+      ret    = record_data(rec, id, sample,
+                           record_stamp(rec, topic->meta, sample, now));
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: record_close
+ *
+ * Description:
+ *   Terminate the records, append the index and the trailer and close the
+ *   log.
+ ****************************************************************************/
+
+static int record_close(FAR struct record_s *rec)
+{
+  struct orb_log_trailer_s trailer;
+  int ret;
+
+  ret = record_emit(rec, ORB_LOG_END, 0, NULL, 0, rec->last);
+  if (ret >= 0)
+    {
+      trailer.index  = rec->offset + rec->len;
+      trailer.nindex = rec->nindex;
+      memcpy(trailer.magic, ORB_LOG_INDEX_MAGIC, sizeof(trailer.magic));
+
+      ret = record_put(rec, rec->index, rec->nindex * sizeof(*rec->index));
+    }
+
+  if (ret >= 0)
+    {
+      ret = record_put(rec, &trailer, sizeof(trailer));
+    }
+
+  if (ret >= 0)
+    {
+      ret = record_flush(rec);
+    }
+
+  if (close(rec->fd) < 0 && ret >= 0)
+    {
+      ret = -errno;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = CONFIG_UORB_RECORDER_FILE;
+  FAR const char *filter = NULL;
+  FAR struct pollfd *fds = NULL;
+  struct orb_log_header_s header;
+  struct record_s rec;
+  float rate = 0;
+  int latency = 0;
+  int duration = 0;
+  int ret;
+  int ch;
+  int i;
+
+  g_should_exit = false;
+  if (signal(SIGINT, exit_handler) == SIG_ERR)
+    {
+      return 1;
+    }
+
+  while ((ch = getopt(argc, argv, "f:r:b:t:h")) != EOF)
+    {
+      switch (ch)
+        {
+          case 'f':
+            path = optarg;
+            break;
+
+          case 'r':
+            rate = atof(optarg);
+            if (rate < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'b':
+            latency = strtol(optarg, NULL, 0);
+            if (latency < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 't':
+            duration = strtol(optarg, NULL, 0);
+            if (duration < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'h':
+          default:
+            goto error;
+        }
+    }
+
+  if (optind < argc)
+    {
+      filter = argv[optind];
+    }
+
+  memset(&rec, 0, sizeof(rec));
+  rec.fd = -1;
+
+  ret = record_find_topics(&rec, filter);
+  if (ret <= 0)
+    {
+      uorbinfo_raw("No object to record");
+      goto out;
+    }
+
+  rec.size   = CONFIG_UORB_RECORDER_BUFSIZE;
+  rec.buffer = malloc(rec.size);
+  fds        = malloc(rec.ntopics * sizeof(struct pollfd));
+  if (rec.buffer == NULL || fds == NULL)
+    {
+      ret = -ENOMEM;
+      goto out;
+    }
+
+  rec.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (rec.fd < 0)
+    {
+      ret = -errno;
+      uorbinfo_raw("Open %s failed: %d", path, ret);
+      goto out;
+    }
+
+  rec.start = orb_absolute_time();
+  rec.last  = rec.start;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ORB_LOG_MAGIC, sizeof(ORB_LOG_MAGIC));
+  header.version = ORB_LOG_VERSION;
+  header.ntopics = rec.ntopics;
+  header.start   = rec.start;
+
+  ret = record_put(&rec, &header, sizeof(header));
+  if (ret >= 0)
+    {
+      ret = record_subscribe(&rec, rate, latency);
+    }
+
+  if (ret < 0)
+    {
+      goto out;
+    }
+
+  for (i = 0; i < rec.ntopics; i++)
+    {
+      fds[i].fd     = rec.topics[i].fd;
+      fds[i].events = POLLIN;
+    }
+
+  uorbinfo_raw("Recording %d objects to %s", rec.ntopics, path);
+
+  while (!g_should_exit &&
+         (duration == 0 ||
+          orb_elapsed_time(&rec.start) < duration * 1000000ull))
+    {
+      if (poll(fds, rec.ntopics, RECORD_POLL_TIME) < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          ret = -errno;
+          break;
+        }
+
+      for (i = 0; ret >= 0 && i < rec.ntopics; i++)
+        {
+          if (fds[i].revents & POLLIN)
+            {
+              ret = record_copy(&rec, i);
+            }
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+out:
+  for (i = 0; i < rec.ntopics; i++)
+    {
+      if (rec.topics[i].fd >= 0)
+        {
+          if (ret >= 0)
+            {
+              uorbinfo_raw("%s%d: %lu samples", rec.topics[i].meta->o_name,
+                           rec.topics[i].instance, rec.topics[i].count);
+            }
+
+          orb_unsubscribe(rec.topics[i].fd);
+        }
+    }
+
+  if (rec.fd >= 0)
+    {
+      int err = record_close(&rec);
+
+      if (ret >= 0)
+        {
+          ret = err;
+        }
+
+      if (ret >= 0)
+        {
+          uorbinfo_raw("Recorded %lu samples, %" PRIu64 " bytes in %"
+                       PRIu64 " ms", rec.nsamples, rec.offset,
+                       (rec.last - rec.start) / 1000);
+        }
+    }
+
+  if (ret < 0)
+    {
+      uorbinfo_raw("Recording failed: %d", ret);
+    }
+
+  free(rec.samples);
+  free(rec.index);
+  free(rec.topics);
+  free(rec.buffer);
+  free(fds);
+  return ret < 0 ? 1 : 0;
+
+error:
+  usage();
+  return 1;
+}
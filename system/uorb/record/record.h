@@ -0,0 +1,105 @@
+/****************************************************************************
+ * apps/system/uorb/record/record.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_SYSTEM_UORB_RECORD_RECORD_H
+#define __APPS_SYSTEM_UORB_RECORD_RECORD_H
+
+/* Layout of a uORB log, all fields in the byte order of the recorder:
+ *
+ *   header | record ... | end record | index | trailer
+ *
+ * Every record starts with struct orb_log_record_s.  The topic records
+ * come first, right after the header, one per recorded object.  Each data
+ * record carries one sample and the time since the previous record.  A
+ * sync record with the absolute time since the start of the recording is
+ * written before the first data record and then at least once every
+ * ORB_LOG_SYNC_INTERVAL, the index lists the sync records so a replay can
+ * seek without parsing the whole log.
+ *
+ * The index and the trailer are only written when the recording is
+ * closed.  A log without them is still replayed from the start.
+ *
+ * All structures are naturally aligned and have no padding.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ORB_LOG_MAGIC          "uORBLOG"
+#define ORB_LOG_INDEX_MAGIC    "uIDX"
+#define ORB_LOG_VERSION        1
+
+#define ORB_LOG_TOPIC          'T'  /* struct orb_log_topic_s and name */
+#define ORB_LOG_SYNC           'S'  /* uint64_t time since start, us */
+#define ORB_LOG_DATA           'D'  /* One sample of the topic */
+#define ORB_LOG_END            'E'  /* No payload, index follows */
+
+#define ORB_LOG_SYNC_INTERVAL  1000000 /* us */
+#define ORB_LOG_MAX_TOPICS     256
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct orb_log_header_s
+{
+  char     magic[8];            /* ORB_LOG_MAGIC */
+  uint32_t version;             /* ORB_LOG_VERSION */
+  uint32_t ntopics;             /* Number of topic records */
+  uint64_t start;               /* orb_absolute_time() of the start, us */
+};
+
+struct orb_log_record_s
+{
+  uint8_t  type;                /* ORB_LOG_* */
+  uint8_t  id;                  /* Topic record number */
+  uint16_t size;                /* Size of the payload */
+  uint32_t delta;               /* Time since the previous record, us */
+};
+
+struct orb_log_topic_s
+{
+  uint32_t queue_size;          /* Queue size of the recorded object */
+  uint16_t size;                /* Sample size, meta->o_size */
+  uint8_t  instance;            /* Instance of the recorded object */
+  uint8_t  reserved;            /* Followed by the name, no terminator */
+};
+
+struct orb_log_index_s
+{
+  uint64_t time;                /* Time of the sync record, us */
+  uint64_t offset;              /* File offset of the sync record */
+};
+
+struct orb_log_trailer_s
+{
+  uint64_t index;               /* File offset of the index */
+  uint32_t nindex;              /* Number of index entries */
+  char     magic[4];            /* ORB_LOG_INDEX_MAGIC, no terminator */
+};
+
+#endif /* __APPS_SYSTEM_UORB_RECORD_RECORD_H */
@@ -0,0 +1,591 @@
+/****************************************************************************
+ * apps/system/uorb/record/replay.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <uORB/uORB.h>
+
+#include "record.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define REPLAY_SLEEP_MAX   100000 /* us, keeps Ctrl+C responsive */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct replay_topic_s
+{
+  struct orb_metadata            local;    /* Metadata of unknown topics */
+  char                           name[ORB_PATH_MAX + 1];
+  FAR const struct orb_metadata *meta;     /* Replayed topic */
+  int                            instance; /* Replayed instance */
+  int                            fd;       /* Advertiser handle */
+  unsigned long                  count;    /* Samples published */
+};
+
+struct replay_s
+{
+  int                         fd;       /* Log file */
+  FAR uint8_t                *buffer;   /* Read buffer */
+  size_t                      size;     /* Size of the read buffer */
+  size_t                      pos;      /* First unparsed byte */
+  size_t                      len;      /* Bytes in the read buffer */
+  FAR struct replay_topic_s  *topics;   /* Topics of the log */
+  int                         ntopics;
+  unsigned long               nsamples; /* Samples published */
+  uint32_t                    max_late; /* Worst publish lateness, us */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int replay_fill(FAR struct replay_s *rp, size_t len);
+static int replay_next(FAR struct replay_s *rp,
+                       FAR struct orb_log_record_s *hdr,
+                       FAR const uint8_t **payload);
+static int replay_seek(FAR struct replay_s *rp, uint64_t time,
+                       FAR uint64_t *offset);
+static int replay_topic(FAR struct replay_s *rp,
+                        FAR const struct orb_log_record_s *hdr,
+                        FAR const uint8_t *payload);
+static void replay_wait(FAR struct replay_s *rp, orb_abstime target);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static bool g_should_exit = false;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void usage(void)
+{
+  uorbinfo_raw("\n\
+Utility to publish again the uORB topics recorded by uorb_record.\n\
+\n\
+The topics are advertised with the recorded instance and queue size, so\n\
+stop the real publishers first.  The replayer can be exited any time by\n\
+pressing Ctrl+C.\n\
+\n\
+uorb_replay [arguments...]\n\
+ Commands:\n\
+\t[-h       ]  Replayer commands help\n\
+\t[-f <file>]  Log file, default: " CONFIG_UORB_RECORDER_FILE "\n\
+\t[-s <val> ]  Speed factor, as fast as possible if 0, default: 1\n\
+\t[-o <val> ]  Start offset in the log, in seconds, default: 0\n");
+}
+
+static void exit_handler(int signo)
+{
+  g_should_exit = true;
+}
+
+/****************************************************************************
+ * Name: replay_fill
+ *
+ * Description:
+ *   Make sure at least len unparsed bytes are in the read buffer.  The log
+ *   is read in chunks as large as the buffer.
+ *
+ * Returned Value:
+ *   0 on success, -ENODATA at the end of the log, other negative errno on
+ *   failure.
+ ****************************************************************************/
+
+static int replay_fill(FAR struct replay_s *rp, size_t len)
+{
+  ssize_t ret;
+
+  if (rp->len - rp->pos >= len)
+    {
+      return 0;
+    }
+
+  if (len > rp->size)
+    {
+      FAR uint8_t *buffer = realloc(rp->buffer, len);
+
+      if (buffer == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      rp->buffer = buffer;
+      rp->size   = len;
+    }
+
+  memmove(rp->buffer, rp->buffer + rp->pos, rp->len - rp->pos);
+  rp->len -= rp->pos;
+  rp->pos  = 0;
+
+  while (rp->len < len)
+    {
+      ret = read(rp->fd, rp->buffer + rp->len, rp->size - rp->len);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+      else if (ret == 0)
+        {
+          return -ENODATA;
+        }
+
+      rp->len += ret;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: replay_next
+ *
+ * Description:
+ *   Parse the next record.  The payload stays valid until the next call.
+ *
+ * Returned Value:
+ *   1 if a record was parsed, 0 at the end of the records, negative errno
+ *   on failure.
+ ****************************************************************************/
+
+static int replay_next(FAR struct replay_s *rp,
+                       FAR struct orb_log_record_s *hdr,
+                       FAR const uint8_t **payload)
+{
+  int ret;
+
+  /* A log that was not closed ends without an end record, possibly in
+   * the middle of a record.
+   */
+
+  ret = replay_fill(rp, sizeof(*hdr));
+  if (ret >= 0)
+    {
+      memcpy(hdr, rp->buffer + rp->pos, sizeof(*hdr));
+      ret = replay_fill(rp, sizeof(*hdr) + hdr->size);
+    }
+
+  if (ret < 0)
+    {
+      return ret == -ENODATA ? 0 : ret;
+    }
+
+  *payload = rp->buffer + rp->pos + sizeof(*hdr);
+  rp->pos += sizeof(*hdr) + hdr->size;
+  return hdr->type != ORB_LOG_END;
+}
+
+/****************************************************************************
+ * Name: replay_seek
+ *
+ * Description:
+ *   Look up the last sync record at or before time in the index of the
+ *   log.  Only the index entries visited by the binary search are read.
+ *
+ * Returned Value:
+ *   0 and the file offset of the sync record on success, negative errno
+ *   if the log has no index or no entry is early enough.
+ ****************************************************************************/
+
+static int replay_seek(FAR struct replay_s *rp, uint64_t time,
+                       FAR uint64_t *offset)
+{
+  struct orb_log_trailer_s trailer;
+  struct orb_log_index_s entry;
+  struct stat st;
+  uint32_t low;
+  uint32_t high;
+  uint32_t mid;
+
+  if (fstat(rp->fd, &st) < 0 || st.st_size < (off_t)sizeof(trailer) ||
+      pread(rp->fd, &trailer, sizeof(trailer),
+            st.st_size - sizeof(trailer)) != sizeof(trailer) ||
+      memcmp(trailer.magic, ORB_LOG_INDEX_MAGIC, sizeof(trailer.magic)))
+    {
+      return -ENOENT;
+    }
+
+  /* Find the first entry later than time, the one before it is the
+   * answer.
+   */
+
+  low  = 0;
+  high = trailer.nindex;
+  while (low < high)
+    {
+      mid = low + (high - low) / 2;
+      if (pread(rp->fd, &entry, sizeof(entry),
+                trailer.index + mid * sizeof(entry)) != sizeof(entry))
+        {
+          return -EIO;
+        }
+
+      if (entry.time <= time)
+        {
+          low = mid + 1;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  if (low == 0 ||
+      pread(rp->fd, &entry, sizeof(entry),
+            trailer.index + (low - 1) * sizeof(entry)) != sizeof(entry))
+    {
+      return -ENOENT;
+    }
+
+  *offset = entry.offset;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: replay_topic
+ *
+ * Description:
+ *   Advertise the object of a topic record.  Topics this image does not
+ *   know are advertised with metadata built from the record.
+ ****************************************************************************/
+
+static int replay_topic(FAR struct replay_s *rp,
+                        FAR const struct orb_log_record_s *hdr,
+                        FAR const uint8_t *payload)
+{
+  FAR struct replay_topic_s *topic;
+  struct orb_log_topic_s info;
+  size_t len;
+
+  if (hdr->id >= rp->ntopics || hdr->size <= sizeof(info))
+    {
+      return -EINVAL;
+    }
+
+  memcpy(&info, payload, sizeof(info));
+  len = hdr->size - sizeof(info);
+  if (len > ORB_PATH_MAX)
+    {
+      len = ORB_PATH_MAX;
+    }
+
+  topic = &rp->topics[hdr->id];
+  memcpy(topic->name, payload + sizeof(info), len);
+  topic->name[len] = '\0';
+  topic->instance  = info.instance;
+
+  topic->meta = orb_get_meta(topic->name);
+  if (topic->meta == NULL || topic->meta->o_size != info.size)
+    {
+      topic->local.o_name = topic->name;
+      topic->local.o_size = info.size;
+      topic->meta         = &topic->local;
+    }
+
+  topic->fd = orb_advertise_multi_queue(topic->meta, NULL,
+                                        &topic->instance,
+                                        info.queue_size);
+  if (topic->fd < 0)
+    {
+      uorbinfo_raw("Advertise %s%d failed, its samples are dropped",
+                   topic->name, topic->instance);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: replay_wait
+ *
+ * Description:
+ *   Sleep until the target time, or note how late the replay is.
+ ****************************************************************************/
+
+static void replay_wait(FAR struct replay_s *rp, orb_abstime target)
+{
+  orb_abstime now = orb_absolute_time();
+
+  if (now > target)
+    {
+      if (now - target > rp->max_late)
+        {
+          rp->max_late = now - target > UINT32_MAX ?
+                         UINT32_MAX : now - target;
+        }
+
+      return;
+    }
+
+  while (now < target && !g_should_exit)
+    {
+      usleep(target - now > REPLAY_SLEEP_MAX ?
+             REPLAY_SLEEP_MAX : target - now);
+      now = orb_absolute_time();
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = CONFIG_UORB_RECORDER_FILE;
+  FAR const uint8_t *payload;
+  struct orb_log_header_s header;
+  struct orb_log_record_s hdr;
+  FAR struct replay_topic_s *topic;
+  struct replay_s rp;
+  orb_abstime start = 0;
+  uint64_t offset = 0;
+  uint64_t logtime = 0;
+  uint64_t base;
+  bool started = false;
+  bool topics = true;
+  float speed = 1;
+  float skip = 0;
+  int ret;
+  int ch;
+  int i;
+
+  g_should_exit = false;
+  if (signal(SIGINT, exit_handler) == SIG_ERR)
+    {
+      return 1;
+    }
+
+  while ((ch = getopt(argc, argv, "f:s:o:h")) != EOF)
+    {
+      switch (ch)
+        {
+          case 'f':
+            path = optarg;
+            break;
+
+          case 's':
+            speed = atof(optarg);
+            if (speed < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'o':
+            skip = atof(optarg);
+            if (skip < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'h':
+          default:
+            goto error;
+        }
+    }
+
+  memset(&rp, 0, sizeof(rp));
+  rp.size   = CONFIG_UORB_RECORDER_BUFSIZE;
+  rp.buffer = malloc(rp.size);
+  if (rp.buffer == NULL)
+    {
+      return 1;
+    }
+
+  rp.fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (rp.fd < 0)
+    {
+      uorbinfo_raw("Open %s failed: %d", path, errno);
+      free(rp.buffer);
+      return 1;
+    }
+
+  ret = replay_fill(&rp, sizeof(header));
+  if (ret >= 0)
+    {
+      memcpy(&header, rp.buffer, sizeof(header));
+      rp.pos = sizeof(header);
+      if (memcmp(header.magic, ORB_LOG_MAGIC, sizeof(ORB_LOG_MAGIC)) ||
+          header.version != ORB_LOG_VERSION ||
+          header.ntopics > ORB_LOG_MAX_TOPICS)
+        {
+          ret = -EINVAL;
+        }
+    }
+
+  if (ret >= 0)
+    {
+      rp.ntopics = header.ntopics;
+      rp.topics  = calloc(rp.ntopics, sizeof(struct replay_topic_s));
+      if (rp.topics == NULL && rp.ntopics > 0)
+        {
+          ret = -ENOMEM;
+        }
+    }
+
+  if (ret < 0)
+    {
+      uorbinfo_raw("%s is not a uORB log: %d", path, ret);
+      goto out;
+    }
+
+  for (i = 0; i < rp.ntopics; i++)
+    {
+      rp.topics[i].fd = -1;
+    }
+
+  /* The records before the requested offset are skipped, the index lets
+   * most of them be skipped without reading them.
+   */
+
+  base = (uint64_t)(skip * 1000000);
+  if (base > 0 && replay_seek(&rp, base, &offset) < 0)
+    {
+      offset = 0;
+    }
+
+  while (!g_should_exit && (ret = replay_next(&rp, &hdr, &payload)) > 0)
+    {
+      if (hdr.type == ORB_LOG_TOPIC)
+        {
+          ret = replay_topic(&rp, &hdr, payload);
+          if (ret < 0)
+            {
+              break;
+            }
+
+          continue;
+        }
+
+      if (topics)
+        {
+          /* All the topics are known now, jump to the offset */
+
+          topics = false;
+          if (offset > 0)
+            {
+              if (lseek(rp.fd, offset, SEEK_SET) < 0)
+                {
+                  ret = -errno;
+                  break;
+                }
+
+              rp.pos = 0;
+              rp.len = 0;
+              continue;
+            }
+        }
+
+      logtime += hdr.delta;
+      if (hdr.type == ORB_LOG_SYNC && hdr.size == sizeof(uint64_t))
+        {
+          memcpy(&logtime, payload, sizeof(uint64_t));
+        }
+
+      if (hdr.type != ORB_LOG_DATA || logtime < base ||
+          hdr.id >= rp.ntopics)
+        {
+          continue;
+        }
+
+      topic = &rp.topics[hdr.id];
+      if (topic->fd < 0 || hdr.size != topic->meta->o_size)
+        {
+          continue;
+        }
+
+      if (!started)
+        {
+          start   = orb_absolute_time();
+          base    = logtime;
+          started = true;
+        }
+
+      if (speed > 0)
+        {
+          replay_wait(&rp, start + (orb_abstime)((logtime - base) / speed));
+        }
+
+      if (orb_publish_multi(topic->fd, payload, hdr.size) == hdr.size)
+        {
+          topic->count++;
+          rp.nsamples++;
+        }
+    }
+
+  for (i = 0; i < rp.ntopics; i++)
+    {
+      topic = &rp.topics[i];
+      if (topic->fd >= 0)
+        {
+          uorbinfo_raw("%s%d: %lu samples", topic->name, topic->instance,
+                       topic->count);
+          orb_unadvertise(topic->fd);
+        }
+    }
+
+  if (ret < 0)
+    {
+      uorbinfo_raw("Replay failed: %d", ret);
+    }
+  else
+    {
+      uorbinfo_raw("Replayed %lu samples in %" PRIu64 " ms, "
+                   "max lateness %" PRIu32 " us", rp.nsamples,
+                   started ? orb_elapsed_time(&start) / 1000 : 0,
+                   rp.max_late);
+    }
+
+out:
+  close(rp.fd);
+  free(rp.topics);
+  free(rp.buffer);
+  return ret < 0 ? 1 : 0;
+
+error:
+  usage();
+  return 1;
+}
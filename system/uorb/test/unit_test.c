@@ -23,6 +23,7 @@
  ****************************************************************************/
 
 #include <errno.h>
+#include <inttypes.h>
 #include <math.h>
 #include <poll.h>
 #include <string.h>
@@ -34,6 +35,12 @@
 
 #include "utility.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define UORB_THROUGHPUT_ROUNDS 1000
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -231,6 +238,109 @@ static int latency_test(bool print)
   return g_pubsubtest_res;
 }
 
+static int throughput_test(void)
+{
+  FAR const char *names[] =
+    {
+      "orb_copy", "orb_copy_batch", "orb_view_next"
+    };
+
+  FAR const struct orb_test_medium_s *sample;
+  struct orb_test_medium_s samples[16];
+  struct orb_test_medium_s pub;
+  struct orb_view view;
+  orb_abstime elapsed;
+  unsigned long total;
+  int instance = 0;
+  int ptopic;
+  int round;
+  int mode;
+  int sfd;
+  int i;
+
+  test_note("---------------- THROUGHPUT TEST ------------------");
+
+  memset(&pub, 0, sizeof(pub));
+  sfd = orb_subscribe(ORB_ID(orb_test_medium_queue));
+  if (sfd < 0)
+    {
+      return test_fail("subscribe failed: %d", errno);
+    }
+
+  ptopic = orb_advertise_multi_queue_persist(
+    ORB_ID(orb_test_medium_queue), &pub, &instance, nitems(samples));
+  if (ptopic < 0)
+    {
+      return test_fail("advertise failed: %d", errno);
+    }
+
+  orb_view_init(&view, ORB_ID(orb_test_medium_queue), sfd);
+
+  /* Each round publishes a full queue, then reads it back.  The cost of
+   * publishing is the same for all the ways of reading.
+   */
+
+  for (mode = 0; mode < nitems(names); mode++)
+    {
+      while (orb_copy_batch(ORB_ID(orb_test_medium_queue), sfd, samples,
+                            nitems(samples)) > 0);
+
+      total   = 0;
+      elapsed = orb_absolute_time();
+
+      for (round = 0; round < UORB_THROUGHPUT_ROUNDS; round++)
+        {
+          for (i = 0; i < nitems(samples); i++)
+            {
+              pub.val = i;
+              orb_publish(ORB_ID(orb_test_medium_queue), ptopic, &pub);
+            }
+
+          switch (mode)
+            {
+              case 0:
+                for (i = 0; i < nitems(samples); i++)
+                  {
+                    if (orb_copy(ORB_ID(orb_test_medium_queue), sfd,
+                                 &samples[i]) == OK)
+                      {
+                        total++;
+                      }
+                  }
+                break;
+
+              case 1:
+                total += orb_copy_batch(ORB_ID(orb_test_medium_queue), sfd,
+                                        samples, nitems(samples));
+                break;
+
+              default:
+                while ((sample = orb_view_next(&view, NULL)) != NULL)
+                  {
+                    total++;
+                  }
+                break;
+            }
+        }
+
+      elapsed = orb_absolute_time() - elapsed;
+      test_note("%-16s %lu samples in %" PRIu64 " us, %" PRIu64
+                " samples/s", names[mode], total, elapsed,
+                elapsed ? total * 1000000ull / elapsed : 0);
+
+      if (total != UORB_THROUGHPUT_ROUNDS * nitems(samples))
+        {
+          return test_fail("%s read %lu samples, expected %d", names[mode],
+                           total, UORB_THROUGHPUT_ROUNDS * nitems(samples));
+        }
+    }
+
+  orb_view_uninit(&view);
+  orb_unadvertise(ptopic);
+  orb_unsubscribe(sfd);
+  return OK;
+}
+
 static int test_single(void)
 {
   struct orb_test_s sample;
@@ -873,6 +983,241 @@ int test_queue(void)
   return test_note("PASS orb queuing");
 }
 
+static int test_batch(void)
+{
+  FAR const struct orb_test_medium_s *sample;
+  struct orb_test_medium_s samples[16];
+  struct orb_test_medium_s pub;
+  const int queue_size  = nitems(samples);
+  const int overflow_by = 3;
+  struct orb_view view;
+  uint64_t generation;
+  uint64_t first;
+  ssize_t nsamples;
+  int instance = 0;
+  int ptopic;
+  int sfd;
+  int i;
+
+  test_note("Testing orb batched copy and view");
+
+  memset(&pub, 0, sizeof(pub));
+  sfd = orb_subscribe(ORB_ID(orb_test_medium_queue));
+  if (sfd < 0)
+    {
+      return test_fail("subscribe failed: %d", errno);
+    }
+
+  ptopic = orb_advertise_multi_queue_persist(
+    ORB_ID(orb_test_medium_queue), &pub, &instance, queue_size);
+  if (ptopic < 0)
+    {
+      return test_fail("advertise failed: %d", errno);
+    }
+
+  while (orb_copy_batch(ORB_ID(orb_test_medium_queue), sfd, samples,
+                        queue_size) > 0);
+
+  for (i = 0; i < 5; i++)
+    {
+      pub.val = i;
+      orb_publish(ORB_ID(orb_test_medium_queue), ptopic, &pub);
+    }
+
+  nsamples = orb_copy_batch(ORB_ID(orb_test_medium_queue), sfd, samples,
+                            queue_size);
+  if (nsamples != 5)
+    {
+      return test_fail("batch copied %zd samples, expected 5", nsamples);
+    }
+
+  for (i = 0; i < 5; i++)
+    {
+      if (samples[i].val != i)
+        {
+          return test_fail("batch sample %d is %" PRId32, i,
+                           samples[i].val);
+        }
+    }
+
+  if (orb_copy_batch(ORB_ID(orb_test_medium_queue), sfd, samples,
+                     queue_size) != 0)
+    {
+      return test_fail("batch copied a stale sample");
+    }
+
+  test_note("  Testing the view...");
+
+  orb_view_init(&view, ORB_ID(orb_test_medium_queue), sfd);
+
+  pub.val = 943;
+  orb_publish(ORB_ID(orb_test_medium_queue), ptopic, &pub);
+
+  sample = orb_view_next(&view, &first);
+  if (sample == NULL || sample->val != pub.val)
+    {
+      return test_fail("view did not return the latest sample");
+    }
+
+  if (orb_view_next(&view, NULL) != NULL)
+    {
+      return test_fail("view returned a spurious sample");
+    }
+
+  for (i = 0; i < queue_size + overflow_by; i++)
+    {
+      pub.val = i;
+      orb_publish(ORB_ID(orb_test_medium_queue), ptopic, &pub);
+    }
+
+  for (i = 0; i < queue_size; i++)
+    {
+      sample = orb_view_next(&view, &generation);
+      if (sample == NULL || sample->val != i + overflow_by)
+        {
+          return test_fail("view sample %d is wrong", i);
+        }
+
+      if (generation != first + 1 + overflow_by + i)
+        {
+          return test_fail("view generation %" PRIu64 ", expected %"
+                           PRIu64, generation,
+                           first + 1 + overflow_by + i);
+        }
+    }
+
+  if (orb_view_next(&view, NULL) != NULL)
+    {
+      return test_fail("view returned a spurious sample");
+    }
+
+  if (view.dropped != overflow_by)
+    {
+      return test_fail("view dropped %" PRIu32 ", expected %d",
+                       view.dropped, overflow_by);
+    }
+
+  orb_view_uninit(&view);
+  orb_unadvertise(ptopic);
+  orb_unsubscribe(sfd);
+
+  return test_note("PASS orb batched copy and view");
+}
+
+#ifdef CONFIG_UORB_STATS
+static int test_stats(void)
+{
+  const int queue_size  = 16;
+  const int overflow_by = 3;
+  struct orb_test_medium_s sample;
+  struct orb_test_medium_s sub_sample;
+  struct orb_sub_stats before;
+  struct orb_sub_stats after;
+  struct orb_stats stats;
+  uint32_t nlatency = 0;
+  bool updated;
+  int instance = 0;
+  int ptopic;
+  int sfd;
+  int ret;
+  int i;
+
+  test_note("Testing orb statistics");
+
+  sfd = orb_subscribe(ORB_ID(orb_test_medium_queue));
+  if (sfd < 0)
+    {
+      return test_fail("subscribe failed: %d", errno);
+    }
+
+  ptopic = orb_advertise_multi_queue_persist(
+    ORB_ID(orb_test_medium_queue), &sample, &instance, queue_size);
+  if (ptopic < 0)
+    {
+      return test_fail("advertise failed: %d", errno);
+    }
+
+  /* Catch up with everything published so far */
+
+  do
+    {
+      orb_check(sfd, &updated);
+      if (updated)
+        {
+          orb_copy(ORB_ID(orb_test_medium_queue), sfd, &sub_sample);
+        }
+    }
+  while (updated);
+
+  ret = orb_get_stats(ORB_ID(orb_test_medium_queue), 0, &stats, &before,
+                      1);
+  if (ret != 1)
+    {
+      return test_fail("%d instrumented subscribers, expected 1", ret);
+    }
+
+  if (before.pid != getpid() || before.fd != sfd)
+    {
+      return test_fail("subscriber %d/%d, expected %d/%d",
+                       before.pid, before.fd, getpid(), sfd);
+    }
+
+  /* Overflow the queue, then copy what is left */
+
+  for (i = 0; i < queue_size + overflow_by; ++i)
+    {
+      sample.val = i;
+      orb_publish(ORB_ID(orb_test_medium_queue), ptopic, &sample);
+    }
+
+  for (i = 0; i < queue_size; ++i)
+    {
+      orb_copy(ORB_ID(orb_test_medium_queue), sfd, &sub_sample);
+    }
+
+  orb_get_stats(ORB_ID(orb_test_medium_queue), 0, &stats, &after, 1);
+
+  if (after.ncopies - before.ncopies != queue_size)
+    {
+      return test_fail("%" PRIu32 " copies, expected %d",
+                       after.ncopies - before.ncopies, queue_size);
+    }
+
+  if (after.dropped - before.dropped != overflow_by)
+    {
+      return test_fail("%" PRIu32 " dropped, expected %d",
+                       after.dropped - before.dropped, overflow_by);
+    }
+
+  for (i = 0; i < ORB_STATS_NBUCKETS; i++)
+    {
+      nlatency += after.latency[i] - before.latency[i];
+    }
+
+  if (nlatency == 0 || nlatency > queue_size)
+    {
+      return test_fail("%" PRIu32 " latencies for %d copies",
+                       nlatency, queue_size);
+    }
+
+  if (stats.npublish < queue_size + overflow_by)
+    {
+      return test_fail("%" PRIu32 " publishes, expected at least %d",
+                       stats.npublish, queue_size + overflow_by);
+    }
+
+  orb_unadvertise(ptopic);
+  orb_unsubscribe(sfd);
+
+  if (orb_get_stats(ORB_ID(orb_test_medium_queue), 0, &stats, NULL, 0) >= 0)
+    {
+      return test_fail("statistics outlived the topic");
+    }
+
+  return test_note("PASS orb statistics");
+}
+#endif
+
 static int pub_test_queue_entry(int argc, char *argv[])
 {
   const int queue_size = 50;
@@ -1057,6 +1402,20 @@ static int test(void)
       return ret;
     }
 
+  ret = test_batch();
+  if (ret != OK)
+    {
+      return ret;
+    }
+
+#ifdef CONFIG_UORB_STATS
+  ret = test_stats();
+  if (ret != OK)
+    {
+      return ret;
+    }
+#endif
+
   return test_queue_poll_notify();
 }
 
@@ -1085,6 +1444,13 @@ int main(int argc, FAR char *argv[])
       return latency_test(true);
     }
 
-  printf("Usage: uorb_tests [latency_test]\n");
+  /* Test the throughput. */
+
+  if (argc > 1 && !strcmp(argv[1], "throughput_test"))
+    {
+      return throughput_test();
+    }
+
+  printf("Usage: uorb_tests [latency_test|throughput_test]\n");
   return -EINVAL;
 }
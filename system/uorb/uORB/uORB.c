@@ -26,15 +26,477 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
+#ifdef CONFIG_UORB_STATS
+#  include <pthread.h>
+#  include <nuttx/clock.h>
+#endif
+
 #include <uORB/uORB.h>
 
+#ifdef CONFIG_UORB_STATS
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct orb_stats_stamp_s
+{
+  uint64_t    generation;       /* Generation published */
+  orb_abstime time;             /* When it was published */
+};
+
+struct orb_stats_topic_s
+{
+  FAR const struct orb_metadata *meta;  /* NULL if the entry is free */
+  int          instance;
+  unsigned int nhandles;        /* Advertisers and subscribers */
+  uint32_t     npublish;
+  uint64_t     cycles;          /* Total publish cost */
+  uint32_t     max_cycles;
+  struct orb_stats_stamp_s stamps[CONFIG_UORB_STATS_NSTAMPS];
+};
+
+struct orb_stats_handle_s
+{
+  FAR struct orb_stats_topic_s *topic;  /* NULL if the entry is free */
+  bool         subscriber;
+  bool         interval;        /* Generations are skipped on purpose */
+  uint64_t     next;            /* Generation of the next element to copy */
+  struct orb_sub_stats stats;   /* pid and fd identify the handle */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static pthread_mutex_t g_orb_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct orb_stats_topic_s
+  g_orb_stats_topics[CONFIG_UORB_STATS_NTOPICS];
+static struct orb_stats_handle_s
+  g_orb_stats_handles[CONFIG_UORB_STATS_NHANDLES];
+
+#endif /* CONFIG_UORB_STATS */
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+#ifdef CONFIG_UORB_STATS
+/****************************************************************************
+ * Name: orb_stats_find
+ *
+ * Description:
+ *   Find the instrumented handle of fd in the calling process.  Must be
+ *   called with g_orb_stats_lock held.
+ ****************************************************************************/
+
+static FAR struct orb_stats_handle_s *orb_stats_find(int fd)
+{
+  FAR struct orb_stats_handle_s *handle;
+  pid_t pid = getpid();
+  int i;
+
+  for (i = 0; i < CONFIG_UORB_STATS_NHANDLES; i++)
+    {
+      handle = &g_orb_stats_handles[i];
+      if (handle->topic != NULL && handle->stats.fd == fd &&
+          handle->stats.pid == pid)
+        {
+          return handle;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: orb_stats_release
+ *
+ * Description:
+ *   Free a handle, and its topic with its last handle.  Must be called
+ *   with g_orb_stats_lock held.
+ ****************************************************************************/
+
+static void orb_stats_release(FAR struct orb_stats_handle_s *handle)
+{
+  if (--handle->topic->nhandles == 0)
+    {
+      handle->topic->meta = NULL;
+    }
+
+  handle->topic = NULL;
+}
+
+/****************************************************************************
+ * Name: orb_stats_bucket
+ *
+ * Description:
+ *   Get the latency histogram bucket of a latency in us.
+ ****************************************************************************/
+
+static int orb_stats_bucket(orb_abstime latency)
+{
+  int i;
+
+  for (i = 0; i < ORB_STATS_NBUCKETS - 1 && latency >= 10; i++)
+    {
+      latency /= 10;
+    }
+
+  return i;
+}
+
+/****************************************************************************
+ * Name: orb_stats_open
+ *
+ * Description:
+ *   Start instrumenting a new advertiser or subscriber.  Nothing is
+ *   recorded for it if the tables are full.
+ *
+ * Input Parameters:
+ *   meta         The uORB metadata.
+ *   instance     Instance number of the topic.
+ *   fd           The fd of the advertiser or subscriber.
+ *   subscriber   True for a subscriber.
+ ****************************************************************************/
+
+static void orb_stats_open(FAR const struct orb_metadata *meta,
+                           int instance, int fd, bool subscriber)
+{
+  FAR struct orb_stats_handle_s *handle = NULL;
+  FAR struct orb_stats_topic_s *topic = NULL;
+  FAR struct orb_stats_topic_s *tmp;
+  struct sensor_state_s state;
+  int i;
+
+  if (ioctl(fd, SNIOC_GET_STATE, (unsigned long)(uintptr_t)&state) < 0)
+    {
+      return;
+    }
+
+  pthread_mutex_lock(&g_orb_stats_lock);
+
+  /* Forget a handle left behind by a plain close() of the same fd */
+
+  handle = orb_stats_find(fd);
+  if (handle != NULL)
+    {
+      orb_stats_release(handle);
+      handle = NULL;
+    }
+
+  for (i = 0; i < CONFIG_UORB_STATS_NHANDLES && handle == NULL; i++)
+    {
+      if (g_orb_stats_handles[i].topic == NULL)
+        {
+          handle = &g_orb_stats_handles[i];
+        }
+    }
+
+  for (i = 0; i < CONFIG_UORB_STATS_NTOPICS; i++)
+    {
+      tmp = &g_orb_stats_topics[i];
+      if (tmp->meta == meta && tmp->instance == instance)
+        {
+          topic = tmp;
+          break;
+        }
+      else if (tmp->meta == NULL && topic == NULL)
+        {
+          topic = tmp;
+        }
+    }
+
+  if (handle == NULL || topic == NULL)
+    {
+      pthread_mutex_unlock(&g_orb_stats_lock);
+      uorbwarn("%s%d is not instrumented", meta->o_name, instance);
+      return;
+    }
+
+  if (topic->meta == NULL)
+    {
+      memset(topic, 0, sizeof(*topic));
+      memset(topic->stamps, 0xff, sizeof(topic->stamps));
+      topic->meta     = meta;
+      topic->instance = instance;
+    }
+
+  /* A new subscriber can copy the latest generation */
+
+  memset(handle, 0, sizeof(*handle));
+  handle->topic      = topic;
+  handle->subscriber = subscriber;
+  handle->next       = state.generation ? state.generation - 1 : 0;
+  handle->stats.pid  = getpid();
+  handle->stats.fd   = fd;
+  pthread_getname_np(pthread_self(), handle->stats.name,
+                     sizeof(handle->stats.name));
+  topic->nhandles++;
+
+  pthread_mutex_unlock(&g_orb_stats_lock);
+}
+
+/****************************************************************************
+ * Name: orb_stats_close
+ *
+ * Description:
+ *   Stop instrumenting fd.
+ ****************************************************************************/
+
+static void orb_stats_close(int fd)
+{
+  FAR struct orb_stats_handle_s *handle;
+
+  pthread_mutex_lock(&g_orb_stats_lock);
+
+  handle = orb_stats_find(fd);
+  if (handle != NULL)
+    {
+      orb_stats_release(handle);
+    }
+
+  pthread_mutex_unlock(&g_orb_stats_lock);
+}
+
+/****************************************************************************
+ * Name: orb_stats_publish
+ *
+ * Description:
+ *   Account a publish and remember when its generation was published.
+ *
+ * Input Parameters:
+ *   fd       The fd of the advertiser.
+ *   now      Time of the publish.
+ *   cycles   Cost of the publish.
+ ****************************************************************************/
+
+static void orb_stats_publish(int fd, orb_abstime now, clock_t cycles)
+{
+  FAR struct orb_stats_handle_s *handle;
+  FAR struct orb_stats_topic_s *topic;
+  FAR struct orb_stats_stamp_s *stamp;
+  struct sensor_state_s state;
+  int ret;
+
+  /* The generation just published is the latest one, unless another
+   * advertiser published in between.
+   */
+
+  ret = ioctl(fd, SNIOC_GET_STATE, (unsigned long)(uintptr_t)&state);
+
+  pthread_mutex_lock(&g_orb_stats_lock);
+
+  handle = orb_stats_find(fd);
+  if (handle != NULL)
+    {
+      topic = handle->topic;
+      topic->npublish++;
+      topic->cycles += cycles;
+      if (cycles > topic->max_cycles)
+        {
+          topic->max_cycles = cycles;
+        }
+
+      if (ret >= 0 && state.generation > 0)
+        {
+          stamp = &topic->stamps[(state.generation - 1) %
+                                 CONFIG_UORB_STATS_NSTAMPS];
+          stamp->generation = state.generation - 1;
+          stamp->time       = now;
+        }
+    }
+
+  pthread_mutex_unlock(&g_orb_stats_lock);
+}
+
+/****************************************************************************
+ * Name: orb_stats_copy
+ *
+ * Description:
+ *   Account a copy of one or more samples.  The kernel returns the oldest
+ *   queued generations, and skips to the oldest one still in the queue if
+ *   the subscriber fell more than a queue behind; this follows the same
+ *   steps to find the generations that were copied and the ones that were
+ *   lost.
+ *
+ * Input Parameters:
+ *   fd       The fd of the subscriber.
+ *   state    Topic state taken right before the copy.
+ *   nbytes   Number of bytes copied.
+ ****************************************************************************/
+
+static void orb_stats_copy(int fd, FAR const struct sensor_state_s *state,
+                           size_t nbytes)
+{
+  FAR struct orb_stats_handle_s *handle;
+  FAR struct orb_stats_stamp_s *stamp;
+  orb_abstime now = orb_absolute_time();
+  orb_abstime latency;
+  uint64_t generation;
+  size_t nsamples;
+
+  pthread_mutex_lock(&g_orb_stats_lock);
+
+  handle = orb_stats_find(fd);
+  if (handle == NULL || !handle->subscriber)
+    {
+      goto out;
+    }
+
+  nsamples = nbytes / handle->topic->meta->o_size;
+  if (nsamples == 0)
+    {
+      nsamples = 1;
+    }
+
+  handle->stats.ncopies += nsamples;
+
+  /* Nothing new, the latest generation was copied again */
+
+  if (handle->next >= state->generation)
+    {
+      goto out;
+    }
+
+  if (handle->interval)
+    {
+      generation   = state->generation > nsamples ?
+                     state->generation - nsamples : 0;
+      handle->next = state->generation;
+    }
+  else
+    {
+      if (state->generation - handle->next > state->nbuffer)
+        {
+          handle->stats.dropped += state->generation - state->nbuffer -
+                                   handle->next;
+          handle->next = state->generation - state->nbuffer;
+        }
+
+      generation    = handle->next;
+      handle->next += nsamples;
+    }
+
+  for (; nsamples > 0; nsamples--, generation++)
+    {
+      stamp = &handle->topic->stamps[generation %
+                                     CONFIG_UORB_STATS_NSTAMPS];
+      if (stamp->generation != generation || now < stamp->time)
+        {
+          continue;
+        }
+
+      latency = now - stamp->time;
+      handle->stats.latency[orb_stats_bucket(latency)]++;
+      if (latency > handle->stats.max_latency)
+        {
+          handle->stats.max_latency = latency;
+        }
+    }
+
+out:
+  pthread_mutex_unlock(&g_orb_stats_lock);
+}
+
+/****************************************************************************
+ * Name: orb_stats_interval
+ *
+ * Description:
+ *   Remember whether a subscriber has an interval.
+ ****************************************************************************/
+
+static void orb_stats_interval(int fd, unsigned interval)
+{
+  FAR struct orb_stats_handle_s *handle;
+
+  pthread_mutex_lock(&g_orb_stats_lock);
+
+  handle = orb_stats_find(fd);
+  if (handle != NULL)
+    {
+      handle->interval = interval != 0;
+    }
+
+  pthread_mutex_unlock(&g_orb_stats_lock);
+}
+#endif /* CONFIG_UORB_STATS */
+
+/****************************************************************************
+ * Name: orb_view_refill
+ *
+ * Description:
+ *   Read all pending samples into the view.  The buffer grows with the
+ *   topic queue, which the first advertiser may have enlarged.
+ *
+ * Input Parameters:
+ *   view     The view to refill.
+ *
+ * Returned Value:
+ *   The number of samples read, 0 if there is none,
+ *   -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+static ssize_t orb_view_refill(FAR struct orb_view *view)
+{
+  struct sensor_state_s state;
+  FAR uint8_t *buffer;
+  uint64_t first;
+  ssize_t nsamples;
+
+  if (ioctl(view->fd, SNIOC_GET_STATE,
+            (unsigned long)(uintptr_t)&state) < 0)
+    {
+      return -1;
+    }
+
+  if (state.nbuffer > view->size)
+    {
+      buffer = realloc(view->buffer, state.nbuffer * view->meta->o_size);
+      if (buffer == NULL)
+        {
+          errno = ENOMEM;
+          return -1;
+        }
+
+      view->buffer = buffer;
+      view->size   = state.nbuffer;
+    }
+
+  nsamples = orb_copy_batch(view->meta, view->fd, view->buffer,
+                            view->size);
+  if (nsamples <= 0)
+    {
+      return nsamples;
+    }
+
+  /* The samples read end with the latest generation */
+
+  first = state.generation > nsamples ? state.generation - nsamples : 0;
+  if (view->synced)
+    {
+      if (first > view->generation)
+        {
+          view->dropped += first - view->generation;
+        }
+      else
+        {
+          first = view->generation;
+        }
+    }
+
+  view->generation = first;
+  view->synced     = true;
+  view->count      = nsamples;
+  view->pos        = 0;
+  return nsamples;
+}
+
 /****************************************************************************
  * Name: orb_advsub_open
  *
@@ -132,6 +594,10 @@ orb_advertise_multi_queue_flags(FAR const struct orb_metadata *meta,
       return -1;
     }
 
+#ifdef CONFIG_UORB_STATS
+  orb_stats_open(meta, inst, fd, false);
+#endif
+
   /* The advertiser may perform an initial publish to initialise the object */
 
   if (data != NULL)
@@ -165,6 +631,10 @@ int orb_open(FAR const char *name, int instance, int flags)
 
 int orb_close(int fd)
 {
+#ifdef CONFIG_UORB_STATS
+  orb_stats_close(fd);
+#endif
+
   return close(fd);
 }
 
@@ -187,18 +657,121 @@ int orb_advertise_multi_queue_persist(FAR const struct orb_metadata *meta,
 
 ssize_t orb_publish_multi(int fd, const void *data, size_t len)
 {
+#ifdef CONFIG_UORB_STATS
+  orb_abstime now = orb_absolute_time();
+  clock_t start = perf_gettime();
+  ssize_t ret;
+
+  ret = write(fd, data, len);
+  if (ret > 0)
+    {
+      orb_stats_publish(fd, now, perf_gettime() - start);
+    }
+
+  return ret;
+#else
   return write(fd, data, len);
+#endif
 }
 
 int orb_subscribe_multi(FAR const struct orb_metadata *meta,
                         unsigned instance)
 {
+#ifdef CONFIG_UORB_STATS
+  int fd;
+
+  fd = orb_advsub_open(meta, O_RDONLY, instance, 0);
+  if (fd >= 0)
+    {
+      orb_stats_open(meta, instance, fd, true);
+    }
+
+  return fd;
+#else
   return orb_advsub_open(meta, O_RDONLY, instance, 0);
+#endif
 }
 
 ssize_t orb_copy_multi(int fd, FAR void *buffer, size_t len)
 {
+#ifdef CONFIG_UORB_STATS
+  struct sensor_state_s state;
+  ssize_t ret;
+  int err;
+
+  /* The state before the copy tells which generation is copied */
+
+  err = ioctl(fd, SNIOC_GET_STATE, (unsigned long)(uintptr_t)&state);
+  ret = read(fd, buffer, len);
+  if (ret > 0 && err >= 0)
+    {
+      orb_stats_copy(fd, &state, ret);
+    }
+
+  return ret;
+#else
   return read(fd, buffer, len);
+#endif
+}
+
+ssize_t orb_copy_batch(FAR const struct orb_metadata *meta, int fd,
+                       FAR void *buffer, size_t nmemb)
+{
+  bool updated;
+  ssize_t ret;
+
+  ret = orb_check(fd, &updated);
+  if (ret < 0 || !updated)
+    {
+      return ret;
+    }
+
+  ret = orb_copy_multi(fd, buffer, nmemb * meta->o_size);
+  return ret < 0 ? ret : ret / meta->o_size;
+}
+
+int orb_view_init(FAR struct orb_view *view,
+                  FAR const struct orb_metadata *meta, int fd)
+{
+  if (view == NULL || meta == NULL)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  memset(view, 0, sizeof(*view));
+  view->meta = meta;
+  view->fd   = fd;
+  return 0;
+}
+
+FAR const void *orb_view_next(FAR struct orb_view *view,
+                              FAR uint64_t *generation)
+{
+  FAR const void *sample;
+
+  if (view->pos == view->count && orb_view_refill(view) <= 0)
+    {
+      return NULL;
+    }
+
+  sample = view->buffer + view->pos++ * view->meta->o_size;
+  if (generation != NULL)
+    {
+      *generation = view->generation;
+    }
+
+  view->generation++;
+  return sample;
+}
+
+void orb_view_uninit(FAR struct orb_view *view)
+{
+  free(view->buffer);
+  view->buffer = NULL;
+  view->size   = 0;
+  view->count  = 0;
+  view->pos    = 0;
 }
 
 int orb_get_state(int fd, FAR struct orb_state *state)
@@ -239,7 +812,19 @@ int orb_ioctl(int fd, int cmd, unsigned long arg)
 
 int orb_set_interval(int fd, unsigned interval)
 {
+#ifdef CONFIG_UORB_STATS
+  int ret;
+
+  ret = ioctl(fd, SNIOC_SET_INTERVAL, (unsigned long)interval);
+  if (ret >= 0)
+    {
+      orb_stats_interval(fd, interval);
+    }
+
+  return ret;
+#else
   return ioctl(fd, SNIOC_SET_INTERVAL, (unsigned long)interval);
+#endif
 }
 
 int orb_get_interval(int fd, FAR unsigned *interval)
@@ -322,3 +907,66 @@ int orb_group_count(FAR const struct orb_metadata *meta)
 
   return instance;
 }
+
+#ifdef CONFIG_UORB_STATS
+int orb_get_stats(FAR const struct orb_metadata *meta, int instance,
+                  FAR struct orb_stats *stats,
+                  FAR struct orb_sub_stats *subs, unsigned int nsubs)
+{
+  FAR struct orb_stats_handle_s *handle;
+  FAR struct orb_stats_topic_s *topic = NULL;
+  unsigned int n = 0;
+  int i;
+  int j;
+
+  pthread_mutex_lock(&g_orb_stats_lock);
+
+  for (i = 0; i < CONFIG_UORB_STATS_NTOPICS; i++)
+    {
+      if (g_orb_stats_topics[i].meta == meta &&
+          g_orb_stats_topics[i].instance == instance)
+        {
+          topic = &g_orb_stats_topics[i];
+          break;
+        }
+    }
+
+  if (topic == NULL)
+    {
+      pthread_mutex_unlock(&g_orb_stats_lock);
+      errno = ENOENT;
+      return -1;
+    }
+
+  memset(stats, 0, sizeof(*stats));
+  stats->npublish   = topic->npublish;
+  stats->avg_cycles = topic->npublish ? topic->cycles / topic->npublish : 0;
+  stats->max_cycles = topic->max_cycles;
+
+  for (i = 0; i < CONFIG_UORB_STATS_NHANDLES; i++)
+    {
+      handle = &g_orb_stats_handles[i];
+      if (handle->topic != topic || !handle->subscriber)
+        {
+          continue;
+        }
+
+      stats->ncopies += handle->stats.ncopies;
+      stats->dropped += handle->stats.dropped;
+      for (j = 0; j < ORB_STATS_NBUCKETS; j++)
+        {
+          stats->latency[j] += handle->stats.latency[j];
+        }
+
+      if (subs != NULL && n < nsubs)
+        {
+          subs[n] = handle->stats;
+        }
+
+      n++;
+    }
+
+  pthread_mutex_unlock(&g_orb_stats_lock);
+  return n;
+}
+#endif
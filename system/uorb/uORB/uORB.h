@@ -28,6 +28,7 @@
 #include <nuttx/sensors/ioctl.h>
 #include <nuttx/sensors/sensor.h>
 
+#include <sys/types.h>
 #include <sys/time.h>
 #include <debug.h>
 #include <stdint.h>
@@ -64,12 +65,57 @@ struct orb_state
   uint64_t generation;          /* Mainline generation */
 };
 
+#ifdef CONFIG_UORB_STATS
+/* Publish to copy latency histogram: bucket 0 counts copies within 10us,
+ * each following bucket is ten times wider, the last one counts the rest.
+ */
+
+#define ORB_STATS_NBUCKETS     7
+#define ORB_STATS_NAME_MAX     16
+
+struct orb_sub_stats
+{
+  pid_t    pid;                          /* Process of the subscriber */
+  int      fd;                           /* Subscriber fd in that process */
+  char     name[ORB_STATS_NAME_MAX];     /* Thread that subscribed */
+  uint32_t ncopies;                      /* Number of successful copies */
+  uint32_t dropped;                      /* Generations overwritten in the
+                                          * queue before they were copied
+                                          */
+  uint32_t latency[ORB_STATS_NBUCKETS];  /* Publish to copy latency */
+  uint32_t max_latency;                  /* Maximum latency, us */
+};
+
+struct orb_stats
+{
+  uint32_t npublish;                     /* Number of publishes */
+  uint32_t avg_cycles;                   /* Average publish cost, cycles */
+  uint32_t max_cycles;                   /* Maximum publish cost, cycles */
+  uint32_t ncopies;                      /* Copies of all subscribers */
+  uint32_t dropped;                      /* Drops of all subscribers */
+  uint32_t latency[ORB_STATS_NBUCKETS];  /* Latency of all subscribers */
+};
+#endif
+
 struct orb_object
 {
   orb_id_t meta;                /* The metadata of topic object */
   int      instance;            /* The instance of topic object */
 };
 
+struct orb_view
+{
+  orb_id_t      meta;           /* The metadata of topic object */
+  int           fd;             /* Subscriber fd */
+  FAR uint8_t  *buffer;         /* Samples of the last refill */
+  size_t        size;           /* Capacity of buffer, in samples */
+  size_t        count;          /* Number of samples in buffer */
+  size_t        pos;            /* Next sample in buffer */
+  uint64_t      generation;     /* Generation of the next sample */
+  uint32_t      dropped;        /* Generations lost before they were read */
+  bool          synced;         /* True once generation is known */
+};
+
 typedef uint64_t orb_abstime;
 
 /****************************************************************************
@@ -451,6 +497,88 @@ static inline int orb_copy(FAR const struct orb_metadata *meta,
   return ret == meta->o_size ? 0 : -1;
 }
 
+/****************************************************************************
+ * Name: orb_copy_batch
+ *
+ * Description:
+ *   Fetch all pending samples of a topic with a single read, oldest first.
+ *
+ *   Unlike orb_copy, nothing is copied if the topic has not been updated,
+ *   so the latest sample of a persistent topic is not returned twice.
+ *   With orb_set_batch_interval, the subscriber is woken once per batch
+ *   and this fetches the whole batch.  With orb_set_interval, the samples
+ *   picked for the interval are returned.
+ *
+ * Input Parameters:
+ *   meta     The uORB metadata (usually from the ORB_ID() macro)
+ *   fd       A fd returned from orb_subscribe.
+ *   buffer   Pointer to the buffer receiving the samples.
+ *   nmemb    The number of samples the buffer can hold.
+ *
+ * Returned Value:
+ *   The number of samples copied, 0 if there is none,
+ *   -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+ssize_t orb_copy_batch(FAR const struct orb_metadata *meta, int fd,
+                       FAR void *buffer, size_t nmemb);
+
+/****************************************************************************
+ * Name: orb_view_init
+ *
+ * Description:
+ *   Set up a read-only view of the queue of a subscription.
+ *
+ *   The view is refilled with orb_copy_batch into a buffer as deep as the
+ *   topic queue, and hands out pointers to the samples in it, so readers
+ *   do not copy each sample again.  The view keeps a generation cursor,
+ *   and counts the generations that were overwritten in the queue before
+ *   the view got them.  Generations are only exact without
+ *   orb_set_interval.
+ *
+ * Input Parameters:
+ *   view     The view to initialize.
+ *   meta     The uORB metadata (usually from the ORB_ID() macro)
+ *   fd       A fd returned from orb_subscribe.
+ *
+ * Returned Value:
+ *   0 on success, -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+int orb_view_init(FAR struct orb_view *view,
+                  FAR const struct orb_metadata *meta, int fd);
+
+/****************************************************************************
+ * Name: orb_view_next
+ *
+ * Description:
+ *   Get the next sample of the view.  The queue is read again once all the
+ *   samples of the previous read were handed out.  A sample stays valid
+ *   until the next call that has to read the queue again.
+ *
+ * Input Parameters:
+ *   view         The view returned by orb_view_init.
+ *   generation   The returned generation of the sample, may be NULL.
+ *
+ * Returned Value:
+ *   Pointer to the sample, or NULL if there is none.
+ ****************************************************************************/
+
+FAR const void *orb_view_next(FAR struct orb_view *view,
+                              FAR uint64_t *generation);
+
+/****************************************************************************
+ * Name: orb_view_uninit
+ *
+ * Description:
+ *   Release the buffer of a view.  The subscription stays open.
+ *
+ * Input Parameters:
+ *   view     The view returned by orb_view_init.
+ ****************************************************************************/
+
+void orb_view_uninit(FAR struct orb_view *view);
+
 /****************************************************************************
  * Name: orb_get_state
  *
@@ -475,6 +603,35 @@ static inline int orb_copy(FAR const struct orb_metadata *meta,
 
 int orb_get_state(int fd, FAR struct orb_state *state);
 
+#ifdef CONFIG_UORB_STATS
+/****************************************************************************
+ * Name: orb_get_stats
+ *
+ * Description:
+ *   Get the statistics of a topic and of its subscribers.
+ *
+ *   Only advertisers and subscribers opened through uORB are instrumented,
+ *   and the statistics go away with the last of them.  Drops are not
+ *   counted for subscribers with an interval, which skip generations on
+ *   purpose.
+ *
+ * Input Parameters:
+ *   meta       ORB topic metadata.
+ *   instance   ORB instance.
+ *   stats      The returned statistics of the topic.
+ *   subs       The returned statistics of each subscriber, may be NULL.
+ *   nsubs      Number of entries in subs.
+ *
+ * Returned Value:
+ *   The number of instrumented subscribers, which may be more than nsubs.
+ *   -1 with errno set to ENOENT if the topic is not instrumented.
+ ****************************************************************************/
+
+int orb_get_stats(FAR const struct orb_metadata *meta, int instance,
+                  FAR struct orb_stats *stats,
+                  FAR struct orb_sub_stats *subs, unsigned int nsubs);
+#endif
+
 /****************************************************************************
  * Name: orb_check
  *
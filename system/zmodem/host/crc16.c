@@ -119,7 +119,8 @@ uint16_t crc16part(const uint8_t *src, size_t len, uint16_t crc16val)
 
   for (i = 0;  i < len;  i++)
     {
-      crc16val = crc16_tab[((crc16val >> 8) & 255)] ^ (crc16val << 8) ^ src[i];
+      crc16val = crc16_tab[((crc16val >> 8) ^ src[i]) & 0xff] ^
+                 (crc16val << 8);
     }
 
   return crc16val;
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+# apps/system/zmodem/host/zmbench.py
+#
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.  The
+# ASF licenses this file to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance with the
+# License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+# Transfer a file from the host sz to the host rz (see Makefile.host) over
+# two pty pairs joined by a relay that adds one-way latency and an optional
+# baud rate limit, verify the received file and report the throughput.
+#
+# Instead of --rz, --device may name a serial port connected to a target
+# running "rz"; the relay is not used in that case.
+#
+import argparse
+import filecmp
+import os
+import pty
+import select
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import tty
+
+
+class Link(threading.Thread):
+    """Forward bytes between two pty masters with latency and baud limit."""
+
+    def __init__(self, fda, fdb, latency, baud):
+        super().__init__(daemon=True)
+        self.fds = (fda, fdb)
+        self.latency = latency
+        self.bytetime = 10.0 / baud if baud else 0.0
+        self.queues = ([], [])
+        self.busy = [0.0, 0.0]
+        self.running = True
+
+    def run(self):
+        while self.running:
+            now = time.monotonic()
+            timeout = 0.05
+            for q in self.queues:
+                if q:
+                    timeout = min(timeout, max(0.0, q[0][0] - now))
+
+            try:
+                rd, _, _ = select.select(self.fds, [], [], timeout)
+            except (OSError, ValueError):
+                return
+
+            now = time.monotonic()
+            for i, fd in enumerate(self.fds):
+                if fd not in rd:
+                    continue
+                try:
+                    data = os.read(fd, 4096)
+                except OSError:
+                    continue
+
+                # Serialize on the emulated wire, then add the latency
+
+                start = max(now, self.busy[i])
+                self.busy[i] = start + len(data) * self.bytetime
+                self.queues[i].append((self.busy[i] + self.latency, data))
+
+            for i, q in enumerate(self.queues):
+                while q and q[0][0] <= now:
+                    _, data = q.pop(0)
+                    try:
+                        os.write(self.fds[1 - i], data)
+                    except OSError:
+                        pass
+
+    def stop(self):
+        self.running = False
+
+
+def openpty():
+    master, slave = pty.openpty()
+    tty.setraw(master)
+    return master, slave, os.ttyname(slave)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Zmodem throughput test")
+    parser.add_argument("--sz", default="./sz", help="host sz binary")
+    parser.add_argument("--rz", default="./rz", help="host rz binary")
+    parser.add_argument("--device", help="serial port of a target rz")
+    parser.add_argument("--size", type=int, default=256 * 1024,
+                        help="file size in bytes")
+    parser.add_argument("--latency", type=float, default=10.0,
+                        help="one-way link latency in ms")
+    parser.add_argument("--baud", type=int, default=0,
+                        help="emulated baud rate, 0 for unlimited")
+    parser.add_argument("--timeout", type=float, default=120.0,
+                        help="give up after this many seconds")
+    args = parser.parse_args()
+
+    tmpdir = tempfile.mkdtemp(prefix="zmbench")
+    srcdir = os.path.join(tmpdir, "src")
+    dstdir = os.path.join(tmpdir, "dst")
+    os.mkdir(srcdir)
+    os.mkdir(dstdir)
+
+    src = os.path.join(srcdir, "zmbench.bin")
+    with open(src, "wb") as f:
+        f.write(os.urandom(args.size))
+
+    link = None
+    rz = None
+    if args.device:
+        szdev = args.device
+    else:
+        m1, s1, szdev = openpty()
+        m2, s2, rzdev = openpty()
+        link = Link(m1, m2, args.latency / 1000.0, args.baud)
+        link.start()
+        rz = subprocess.Popen([args.rz, "-d", rzdev, "-p", dstdir],
+                              stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL)
+
+    start = time.monotonic()
+    sz = subprocess.Popen([args.sz, "-d", szdev, "-x", "1", src],
+                          stdout=subprocess.DEVNULL,
+                          stderr=subprocess.DEVNULL)
+
+    ok = True
+    try:
+        sz.wait(timeout=args.timeout)
+        if rz is not None:
+            rz.wait(timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        ok = False
+
+    elapsed = time.monotonic() - start
+
+    for proc in (sz, rz):
+        if proc is not None and proc.poll() is None:
+            proc.kill()
+
+    if link is not None:
+        link.stop()
+
+    dst = os.path.join(dstdir, "zmbench.bin")
+    if rz is not None:
+        ok = ok and sz.returncode == 0 and rz.returncode == 0
+        ok = ok and os.path.exists(dst) and filecmp.cmp(src, dst, False)
+
+    print("size %d bytes, latency %.1f ms, baud %s: %.2f s, %.1f KiB/s %s"
+          % (args.size, args.latency, args.baud or "unlimited", elapsed,
+             args.size / elapsed / 1024, "PASS" if ok else "FAIL"))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -261,6 +261,15 @@ errout_with_zmodem:
 
 errout_with_device:
 
+  /* zms_release() just sent the final "OO".  Let it go out before the
+   * flush below discards it, otherwise the receiver times out waiting.
+   */
+
+  if (exitcode == EXIT_SUCCESS)
+    {
+      tcdrain(fd);
+    }
+
   /* Flush the serial output to assure do not hang trying to drain it */
 
   tcflush(fd, TCIOFLUSH);
@@ -209,6 +209,16 @@
 
 #define ZM_PKTBUFSIZE (CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE + 5)
 
+/* The send window only applies to full streaming (ZCRCG), which needs the
+ * reverse channel to be sampled.  Zero means no window.
+ */
+
+#if !defined(CONFIG_SYSTEM_ZMODEM_RCVSAMPLE) || \
+    !defined(CONFIG_SYSTEM_ZMODEM_SNDWINDOW)
+#  undef  CONFIG_SYSTEM_ZMODEM_SNDWINDOW
+#  define CONFIG_SYSTEM_ZMODEM_SNDWINDOW 0
+#endif
+
 /* Debug Definitions ********************************************************/
 
 /* Non-standard debug selectable with CONFIG_DEBUG_ZMODEM.  Debug output goes
@@ -403,7 +413,10 @@ struct zms_state_s
   FAR const char *rfilename; /* Remote filename */
   off_t offset;              /* Current file offset */
   off_t lastoffs;            /* Last acknowledged file offset */
+  off_t ackoffs;             /* File offset of the last ZCRCQ sent */
   off_t zrpos;               /* Last offset from ZRPOS */
+  off_t crcoffs;             /* Bytes accumulated in filecrc */
+  uint32_t filecrc;          /* Running (uncomplemented) CRC32 of the file */
   off_t filesize;            /* Size of the file to send */
   int infd;                  /* Local input file descriptor */
 };
@@ -317,8 +317,15 @@ static int zmr_zrinit(FAR struct zm_state_s *pzm)
   /* Send ZRINIT */
 
   pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
+#ifdef CONFIG_SYSTEM_ZMODEM_RCVOVIO
+  /* A zero buffer length permits nonstop streaming */
+
+  buf[0]       = 0;
+  buf[1]       = 0;
+#else
   buf[0]       = CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE & 0xff;
   buf[1]       = (CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE >> 8) & 0xff;
+#endif
   buf[2]       = 0;
   buf[3]       = pzmr->rcaps;
   return zm_sendhexhdr(pzm, ZRINIT, buf);
@@ -1620,6 +1627,9 @@ ZMRHANDLE zmr_initialize(int remfd)
       pzm->psubstate = PIDLE_ZPAD;
       pzm->remfd     = remfd;
       pzmr->rcaps    = CANFC32 | CANFDX;
+#ifdef CONFIG_SYSTEM_ZMODEM_RCVOVIO
+      pzmr->rcaps   |= CANOVIO;
+#endif
       pzmr->outfd    = -1;
 
       /* Create a timer to handle timeout events */
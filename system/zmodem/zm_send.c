@@ -135,6 +135,8 @@ static int zms_endoftransfer(FAR struct zm_state_s *pzm);
 static int zms_fileskip(FAR struct zm_state_s *pzm);
 static int zms_sendfiledata(FAR struct zm_state_s *pzm);
 static int zms_sendpacket(FAR struct zm_state_s *pzm);
+static int zms_sendack(FAR struct zm_state_s *pzm);
+static int zms_sendtimeout(FAR struct zm_state_s *pzm);
 static int zms_filecrc(FAR struct zm_state_s *pzm);
 static int zms_sendwaitack(FAR struct zm_state_s *pzm);
 static int zms_sendnak(FAR struct zm_state_s *pzm);
@@ -249,14 +251,14 @@ static const struct zm_transition_s g_zms_crcwait[] =
 static const struct zm_transition_s g_zmr_sending[] =
 {
   {ZME_SINIT,     false, ZMS_START,    zms_attention},
-  {ZME_ACK,       false, ZMS_SENDING,  zms_sendpacket},
+  {ZME_ACK,       false, ZMS_SENDING,  zms_sendack},
   {ZME_RPOS,      true,  ZMS_SENDING,  zms_sendrpos},
   {ZME_SKIP,      true,  ZMS_FILEWAIT, zms_fileskip},
   {ZME_NAK,       true,  ZMS_SENDING,  zms_sendnak},
   {ZME_RINIT,     true,  ZMS_FILEWAIT, zms_sendfilename},
   {ZME_ABORT,     true,  ZMS_FINISH,   zms_abort},
   {ZME_FERR,      true,  ZMS_FINISH,   zms_abort},
-  {ZME_TIMEOUT,   false, ZMS_SENDING,  zms_sendpacket},
+  {ZME_TIMEOUT,   false, ZMS_SENDING,  zms_sendtimeout},
   {ZME_ERROR,     false, ZMS_SENDING,  zms_error},
 };
 
@@ -861,6 +863,8 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
   uint8_t *ptr;
   uint8_t type;
   bool wait = false;
+  bool resync = false;
+  off_t pktend;
   int sndsize;
   int pktsize;
   int i;
@@ -901,7 +905,7 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
               /* Yes... clip the maximum so that we stay within that limit */
 
               int maximum = pzms->rcvmax - unacked;
-              if (sndsize < maximum)
+              if (sndsize > maximum)
                 {
                   sndsize = maximum;
                 }
@@ -911,9 +915,46 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
             }
         }
 
+#if CONFIG_SYSTEM_ZMODEM_SNDWINDOW > 0
+      /* When streaming with ZCRCG, keep at most SNDWINDOW bytes in flight.
+       * The window is advanced by the ZACKs of the periodic ZCRCQ
+       * subpackets.
+       */
+
+      if (pzms->dpkttype == ZCRCG)
+        {
+          int avail = CONFIG_SYSTEM_ZMODEM_SNDWINDOW - unacked;
+
+          if (avail <= 0)
+            {
+              if ((pzm->flags & ZM_FLAG_WAIT) == 0)
+                {
+                  /* Window is full.  Stay in ZMS_SENDING until the next
+                   * ZACK opens it again.
+                   */
+
+                  zmdbg("Window full: unacked %d\n", unacked);
+                  pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
+                  return OK;
+                }
+
+              /* The ZACKs were lost.  End the frame with an empty ZCRCW
+               * so that the receiver reports its position.
+               */
+
+              sndsize = 0;
+              resync  = true;
+            }
+          else if (sndsize > avail)
+            {
+              sndsize = avail;
+            }
+        }
+#endif
+
       /* Can we send anything? */
 
-      if (sndsize <= 0)
+      if (sndsize <= 0 && !resync)
         {
           /* No, not now. Keep waiting */
 
@@ -960,6 +1001,17 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
           type = pzms->dpkttype;
         }
 
+#if CONFIG_SYSTEM_ZMODEM_SNDWINDOW > 0
+      /* Ask for a ZACK every quarter window so that it keeps sliding */
+
+      if (type == ZCRCG && pzms->offset - pzms->ackoffs >=
+                           CONFIG_SYSTEM_ZMODEM_SNDWINDOW / 4)
+        {
+          type = ZCRCQ;
+          pzms->ackoffs = pzms->offset;
+        }
+#endif
+
       /* Read characters from file and put into buffer until buffer is full
        * or file is exhausted
        */
@@ -970,6 +1022,7 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 
       ptr         = pzm->scratch;
       pktsize     = 0;
+      pktend      = pzms->offset + sndsize;
 
 #ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
       /* Read multiple bytes of file and store into the temporal buffer */
@@ -979,8 +1032,12 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
       i = 0;
 #endif
 
-      while (pktsize <= (CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - 10) &&
-             (pzms->offset < pzms->filesize))
+      /* Leave room for an escaped data byte plus the escaped trailer:  2
+       * bytes for ZDLE and the frame end type and up to 8 for the CRC.
+       */
+
+      while (pktsize < (CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - 12) &&
+             (pzms->offset < pktend))
         {
           /* Add the new value to the accumulated CRC */
 
@@ -1002,6 +1059,16 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 
           ptr = zm_putzdle(pzm, ptr, ch);
 
+          /* Accumulate the whole file CRC while the data goes by for the
+           * first time, so that a ZCRC request does not re-read the file.
+           */
+
+          if (pzms->crcoffs == pzms->offset)
+            {
+              pzms->filecrc = crc32part(&ch, 1, pzms->filecrc);
+              pzms->crcoffs++;
+            }
+
           /* Recalculate the accumulated packet size to handle expansion due
            * to escaping.
            */
@@ -1144,6 +1211,61 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
   return OK;
 }
 
+/****************************************************************************
+ * Name: zms_sendack
+ *
+ * Description:
+ *   A ZACK for a ZCRCQ subpacket arrived while streaming.  Slide the window
+ *   up to the acknowledged offset and keep sending.
+ *
+ ****************************************************************************/
+
+static int zms_sendack(FAR struct zm_state_s *pzm)
+{
+  FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  off_t offset;
+
+  offset = zm_bytobe32(pzm->hdrdata + 1);
+  if (offset > pzms->lastoffs && offset <= pzms->offset)
+    {
+      pzms->lastoffs = offset;
+    }
+
+  zmdbg("ZMS_STATE %d: offset: %ld\n", pzm->state, (unsigned long)offset);
+  return zms_sendpacket(pzm);
+}
+
+/****************************************************************************
+ * Name: zms_sendtimeout
+ *
+ * Description:
+ *   Timed out in ZMS_SENDING.  Normally this just means that it is time to
+ *   send more data.  If the send window is full, the ZACKs were lost and
+ *   the next subpacket must ask the receiver for its position.
+ *
+ ****************************************************************************/
+
+static int zms_sendtimeout(FAR struct zm_state_s *pzm)
+{
+#if CONFIG_SYSTEM_ZMODEM_SNDWINDOW > 0
+  FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+
+  if (pzms->dpkttype == ZCRCG &&
+      pzms->offset - pzms->lastoffs >= CONFIG_SYSTEM_ZMODEM_SNDWINDOW)
+    {
+      if (++pzm->nerrors > CONFIG_SYSTEM_ZMODEM_MAXERRORS)
+        {
+          zmdbg("ERROR: Receiver did not acknowledge\n");
+          return -ETIMEDOUT;
+        }
+
+      pzm->flags |= ZM_FLAG_WAIT;
+    }
+#endif
+
+  return zms_sendpacket(pzm);
+}
+
 /****************************************************************************
  * Name: zms_filecrc
  *
@@ -1155,10 +1277,24 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 static int zms_filecrc(FAR struct zm_state_s *pzm)
 {
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  ssize_t nread;
   uint8_t by[4];
   uint32_t crc;
 
-  crc = zm_filecrc(pzm, pzms->filename);
+  /* Only read the part of the file that the send pass has not already
+   * accumulated into the running CRC.
+   */
+
+  while (pzms->crcoffs < pzms->filesize &&
+         (nread = pread(pzms->infd, pzm->scratch,
+                        CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE,
+                        pzms->crcoffs)) > 0)
+    {
+      pzms->filecrc  = crc32part(pzm->scratch, nread, pzms->filecrc);
+      pzms->crcoffs += nread;
+    }
+
+  crc = ~pzms->filecrc;
   zmdbg("ZMS_STATE %d: CRC %08x\n", pzm->state, crc);
 
   zm_be32toby(crc, by);
@@ -1422,6 +1558,7 @@ static int zms_startfiledata(FAR struct zms_state_s *pzms)
   pzms->zrpos      = zm_bytobe32(pzms->cmn.hdrdata + 1);
   pzms->offset     = pzms->zrpos;
   pzms->lastoffs   = pzms->zrpos;
+  pzms->ackoffs    = pzms->zrpos;
 
   /* See to the requested file position */
 
@@ -1519,6 +1656,9 @@ static int zms_sendfile(FAR struct zms_state_s *pzms,
   pzms->fflags[0]  = 0;
   pzms->offset     = 0;
   pzms->lastoffs   = 0;
+  pzms->ackoffs    = 0;
+  pzms->filecrc    = 0xffffffff;
+  pzms->crcoffs    = 0;
 
   pzms->filesize   = buf.st_size;
 #ifdef CONFIG_SYSTEM_ZMODEM_TIMESTAMPS
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <assert.h>
 #include <errno.h>
@@ -543,3 +544,26 @@ void zm_flowc(int fd)
   tcsetattr(fd, TCSANOW, &term);
 }
 #endif
+
+/****************************************************************************
+ * Name: zm_rcvpending
+ *
+ * Description:
+ *   Return true if data from the remote receiver is pending.  In that case,
+ *   the local sender should stop data streaming operations and process the
+ *   incoming data.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSTEM_ZMODEM_RCVSAMPLE
+bool zm_rcvpending(FAR struct zm_state_s *pzm)
+{
+  struct pollfd fds;
+
+  fds.fd      = pzm->remfd;
+  fds.events  = POLLIN;
+  fds.revents = 0;
+
+  return poll(&fds, 1, 0) > 0 && (fds.revents & POLLIN) != 0;
+}
+#endif
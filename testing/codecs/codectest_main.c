@@ -0,0 +1,600 @@
+/****************************************************************************
+ * apps/testing/codecs/codectest_main.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "netutils/base64.h"
+#include "netutils/md5.h"
+#include "netutils/urldecode.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define DEFAULT_SIZE   4096  /* Bytes per benchmark call */
+#define DEFAULT_LOOPS  256   /* Benchmark calls per codec */
+#define MAX_RANDOM     300   /* Longest random round trip input */
+#define RANDOM_SEED    0x2545f491
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct vector_s
+{
+  FAR const char *in;
+  FAR const char *out;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* RFC 4648, section 10 */
+
+static const struct vector_s g_base64_vectors[] =
+{
+  { "",       ""         },
+  { "f",      "Zg=="     },
+  { "fo",     "Zm8="     },
+  { "foo",    "Zm9v"     },
+  { "foob",   "Zm9vYg==" },
+  { "fooba",  "Zm9vYmE=" },
+  { "foobar", "Zm9vYmFy" },
+};
+
+/* RFC 1321, appendix A.5 */
+
+static const struct vector_s g_md5_vectors[] =
+{
+  { "", "d41d8cd98f00b204e9800998ecf8427e" },
+  { "a", "0cc175b9c0f1b6a831c399e269772661" },
+  { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+  { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+  { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+  {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+    "d174ab98d277d9f5a5611c2c9f419d9f"
+  },
+  {
+    "1234567890123456789012345678901234567890"
+    "1234567890123456789012345678901234567890",
+    "57edf4a22be3c955ac49da2e2107b67a"
+  },
+};
+
+static const struct vector_s g_url_vectors[] =
+{
+  { "hello joe",     "hello+joe"         },
+  { "a/b?c=d&e",     "a%2Fb%3Fc%3Dd%26e" },
+  { "-_.~AZaz09",    "-_.~AZaz09"        },
+};
+
+static uint32_t g_seed;
+static int g_nfail;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: random32
+ ****************************************************************************/
+
+static uint32_t random32(void)
+{
+  g_seed ^= g_seed << 13;
+  g_seed ^= g_seed >> 17;
+  g_seed ^= g_seed << 5;
+  return g_seed;
+}
+
+/****************************************************************************
+ * Name: random_fill
+ ****************************************************************************/
+
+static void random_fill(FAR unsigned char *buf, size_t len)
+{
+  while (len-- > 0)
+    {
+      *buf++ = random32();
+    }
+}
+
+/****************************************************************************
+ * Name: check
+ ****************************************************************************/
+
+static void check(bool ok, FAR const char *what, size_t len)
+{
+  if (!ok)
+    {
+      printf("FAIL: %s, length %zu\n", what, len);
+      g_nfail++;
+    }
+}
+
+/****************************************************************************
+ * Name: ref_base64_decode
+ *
+ * Description:
+ *   The strchr() based decoder that the lookup tables replaced, kept to
+ *   check that any input, valid or not, still decodes the same.  The one
+ *   difference is NUL: strchr() found the string terminator and gave it
+ *   the value 64, while the tables decode it as zero like any other byte
+ *   outside the alphabet.
+ *
+ ****************************************************************************/
+
+static size_t ref_base64_decode(FAR const unsigned char *src, size_t len,
+                                FAR unsigned char *dst, bool websafe)
+{
+  FAR const char *tab = websafe ?
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__" :
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  FAR unsigned char *pos = dst;
+  unsigned char block[4];
+  FAR char *tmp;
+  char ch = websafe ? '.' : '=';
+  size_t count = 0;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      tmp = src[i] != '\0' ? strchr(tab, src[i]) : NULL;
+      block[count++] = tmp ? tmp - tab : 0;
+
+      if (count == 4)
+        {
+          *pos++ = (block[0] << 2) | (block[1] >> 4);
+          if (src[i - 1] == ch)
+            {
+              break;
+            }
+
+          *pos++ = (block[1] << 4) | (block[2] >> 2);
+          if (src[i] == ch)
+            {
+              break;
+            }
+
+          *pos++ = (block[2] << 6) | block[3];
+          count = 0;
+        }
+    }
+
+  return pos - dst;
+}
+
+/****************************************************************************
+ * Name: test_base64
+ ****************************************************************************/
+
+static void test_base64(FAR unsigned char *in, FAR unsigned char *enc,
+                        FAR unsigned char *dec)
+{
+  struct base64_encoder_s encoder;
+  FAR const char *alphabet =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/_=.";
+  size_t enclen;
+  size_t declen;
+  size_t reflen;
+  size_t chunk;
+  size_t len;
+  size_t i;
+
+  for (i = 0; i < sizeof(g_base64_vectors) / sizeof(g_base64_vectors[0]);
+       i++)
+    {
+      FAR const struct vector_s *v = &g_base64_vectors[i];
+
+      len = strlen(v->in);
+      base64_encode(v->in, len, enc, &enclen);
+      check(enclen == strlen(v->out) && strcmp((FAR char *)enc, v->out) == 0,
+            "base64 encode vector", len);
+
+      base64_decode(v->out, strlen(v->out), dec, &declen);
+      check(declen == len && memcmp(dec, v->in, len) == 0,
+            "base64 decode vector", len);
+    }
+
+  for (len = 0; len <= MAX_RANDOM; len++)
+    {
+      random_fill(in, len);
+
+      /* Round trip, then decode the encoded text over itself */
+
+      base64_encode(in, len, enc, &enclen);
+      check(enclen == base64_encode_length(len), "base64 length", len);
+
+      base64_decode(enc, enclen, dec, &declen);
+      check(declen == len && memcmp(dec, in, len) == 0,
+            "base64 round trip", len);
+
+      declen = base64_decode_inplace(enc, enclen);
+      check(declen == len && memcmp(enc, in, len) == 0,
+            "base64 in-place decode", len);
+
+      /* The streaming encoder, fed in random chunks */
+
+      base64_encode(in, len, dec, &reflen);
+      base64_encoder_init(&encoder, false);
+      for (i = 0, enclen = 0; i < len; i += chunk)
+        {
+          chunk = random32() % 8;
+          if (chunk > len - i)
+            {
+              chunk = len - i;
+            }
+
+          enclen += base64_encoder_update(&encoder, in + i, chunk,
+                                          enc + enclen);
+        }
+
+      enclen += base64_encoder_final(&encoder, enc + enclen);
+      check(enclen == reflen && memcmp(enc, dec, enclen) == 0,
+            "base64 streaming encode", len);
+
+      /* Web safe text and random text, valid or not, decode as before */
+
+      base64w_encode(in, len, enc, &enclen);
+      reflen = ref_base64_decode(enc, enclen, in, true);
+      base64w_decode(enc, enclen, dec, &declen);
+      check(declen == reflen && memcmp(dec, in, declen) == 0,
+            "base64w decode", len);
+
+      for (i = 0; i < len; i++)
+        {
+          enc[i] = random32() % 4 ? (unsigned char)alphabet[random32() % 67]
+                                  : (unsigned char)(random32() % 256);
+        }
+
+      reflen = ref_base64_decode(enc, len, in, false);
+      base64_decode(enc, len, dec, &declen);
+      check(declen == reflen && memcmp(dec, in, declen) == 0,
+            "base64 decode random text", len);
+    }
+}
+
+/****************************************************************************
+ * Name: md5_hex
+ ****************************************************************************/
+
+static void md5_hex(FAR const uint8_t *digest, FAR char *hex)
+{
+  int i;
+
+  for (i = 0; i < 16; i++)
+    {
+      sprintf(&hex[i * 2], "%02x", digest[i]);
+    }
+}
+
+/****************************************************************************
+ * Name: test_md5
+ ****************************************************************************/
+
+static void test_md5(FAR unsigned char *in)
+{
+  MD5_CTX ctx;
+  uint8_t digest[16];
+  uint8_t ref[16];
+  char hex[33];
+  size_t chunk;
+  size_t len;
+  size_t i;
+
+  for (i = 0; i < sizeof(g_md5_vectors) / sizeof(g_md5_vectors[0]); i++)
+    {
+      FAR const struct vector_s *v = &g_md5_vectors[i];
+
+      md5_sum((FAR const uint8_t *)v->in, strlen(v->in), digest);
+      md5_hex(digest, hex);
+      check(strcmp(hex, v->out) == 0, "md5 vector", strlen(v->in));
+    }
+
+  /* Any split of the data, at any alignment, gives the same digest */
+
+  for (len = 0; len <= MAX_RANDOM; len++)
+    {
+      random_fill(in, len);
+      md5_sum(in, len, ref);
+
+      md5_init(&ctx);
+      for (i = 0; i < len; i += chunk)
+        {
+          chunk = random32() % 100;
+          if (chunk > len - i)
+            {
+              chunk = len - i;
+            }
+
+          md5_update(&ctx, in + i, chunk);
+        }
+
+      md5_final(digest, &ctx);
+      check(memcmp(digest, ref, 16) == 0, "md5 split update", len);
+
+      memmove(in + 1 + len % 3, in, len);
+      md5_sum(in + 1 + len % 3, len, digest);
+      check(memcmp(digest, ref, 16) == 0, "md5 unaligned data", len);
+    }
+}
+
+/****************************************************************************
+ * Name: test_urlcode
+ ****************************************************************************/
+
+static void test_urlcode(FAR unsigned char *in, FAR unsigned char *enc,
+                         FAR unsigned char *dec)
+{
+  int enclen;
+  int declen;
+  size_t len;
+  size_t i;
+
+  for (i = 0; i < sizeof(g_url_vectors) / sizeof(g_url_vectors[0]); i++)
+    {
+      FAR const struct vector_s *v = &g_url_vectors[i];
+
+      len = strlen(v->in);
+      urlencode(v->in, len, (FAR char *)enc, &enclen);
+      check(strcmp((FAR char *)enc, v->out) == 0, "urlencode vector", len);
+
+      urldecode(v->out, strlen(v->out), (FAR char *)dec, &declen);
+      check(declen == (int)len && memcmp(dec, v->in, len) == 0,
+            "urldecode vector", len);
+    }
+
+  for (len = 0; len <= MAX_RANDOM; len++)
+    {
+      random_fill(in, len);
+
+      urlencode((FAR char *)in, len, (FAR char *)enc, &enclen);
+      check(enclen == urlencode_len((FAR char *)in, len),
+            "urlencode length", len);
+      check(urldecode_len((FAR char *)enc, enclen) == (int)len,
+            "urldecode length", len);
+
+      /* The output never runs ahead of the input, decode over itself */
+
+      urldecode((FAR char *)enc, enclen, (FAR char *)enc, &declen);
+      check(declen == (int)len && memcmp(enc, in, len) == 0,
+            "url round trip", len);
+    }
+}
+
+/****************************************************************************
+ * Name: gettime_us
+ ****************************************************************************/
+
+static uint64_t gettime_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: report
+ ****************************************************************************/
+
+static void report(FAR const char *name, size_t bytes, uint64_t us)
+{
+  if (us == 0)
+    {
+      us = 1;
+    }
+
+  printf("%-18s %10lu KB/s\n", name,
+         (unsigned long)((uint64_t)bytes * 1000000 / 1024 / us));
+}
+
+/****************************************************************************
+ * Name: bench
+ *
+ * Description:
+ *   Measure the throughput on random data of the given size, counted in
+ *   bytes of raw data for both directions.
+ *
+ ****************************************************************************/
+
+static void bench(FAR unsigned char *in, FAR unsigned char *enc,
+                  FAR unsigned char *dec, size_t size, int loops)
+{
+  struct base64_encoder_s encoder;
+  uint8_t digest[16];
+  uint64_t start;
+  size_t enclen;
+  size_t declen;
+  int urlenclen;
+  int urldeclen;
+  int i;
+
+  random_fill(in, size);
+  printf("%zu bytes, %d loops\n", size, loops);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      base64_encode(in, size, enc, &enclen);
+    }
+
+  report("base64 encode", size * loops, gettime_us() - start);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      base64_encoder_init(&encoder, false);
+      enclen  = base64_encoder_update(&encoder, in, size / 2, enc);
+      enclen += base64_encoder_update(&encoder, in + size / 2,
+                                      size - size / 2, enc + enclen);
+      enclen += base64_encoder_final(&encoder, enc + enclen);
+    }
+
+  report("base64 stream", size * loops, gettime_us() - start);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      base64_decode(enc, enclen, dec, &declen);
+    }
+
+  report("base64 decode", size * loops, gettime_us() - start);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      ref_base64_decode(enc, enclen, dec, false);
+    }
+
+  report("base64 decode ref", size * loops, gettime_us() - start);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      md5_sum(in, size, digest);
+    }
+
+  report("md5", size * loops, gettime_us() - start);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      urlencode((FAR char *)in, size, (FAR char *)enc, &urlenclen);
+    }
+
+  report("urlencode", size * loops, gettime_us() - start);
+
+  start = gettime_us();
+  for (i = 0; i < loops; i++)
+    {
+      urldecode((FAR char *)enc, urlenclen, (FAR char *)dec, &urldeclen);
+    }
+
+  report("urldecode", size * loops, gettime_us() - start);
+}
+
+/****************************************************************************
+ * Name: show_usage
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname)
+{
+  printf("Usage: %s [-s size] [-n loops] [-t]\n", progname);
+  printf("  -s  Bytes per benchmark call, default %d\n", DEFAULT_SIZE);
+  printf("  -n  Benchmark calls per codec, default %d\n", DEFAULT_LOOPS);
+  printf("  -t  Run the tests only\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR unsigned char *in;
+  FAR unsigned char *enc;
+  FAR unsigned char *dec;
+  size_t size = DEFAULT_SIZE;
+  size_t bufsize;
+  int loops = DEFAULT_LOOPS;
+  bool testonly = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:n:th")) != -1)
+    {
+      switch (opt)
+        {
+          case 's':
+            size = strtoul(optarg, NULL, 0);
+            break;
+
+          case 'n':
+            loops = atoi(optarg);
+            break;
+
+          case 't':
+            testonly = true;
+            break;
+
+          default:
+            show_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (size == 0 || loops <= 0)
+    {
+      show_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  /* URL encoding is the largest, 3 characters per byte */
+
+  bufsize = (size > MAX_RANDOM ? size : MAX_RANDOM) * 3 + 4;
+  in  = malloc(bufsize);
+  enc = malloc(bufsize);
+  dec = malloc(bufsize);
+  if (in == NULL || enc == NULL || dec == NULL)
+    {
+      printf("No memory for %zu byte buffers\n", bufsize);
+      free(in);
+      free(enc);
+      free(dec);
+      return EXIT_FAILURE;
+    }
+
+  g_seed  = RANDOM_SEED;
+  g_nfail = 0;
+
+  test_base64(in, enc, dec);
+  test_md5(in);
+  test_urlcode(in, enc, dec);
+  printf("codec tests: %s, %d failures\n", g_nfail ? "FAIL" : "PASS",
+         g_nfail);
+
+  if (!testonly)
+    {
+      bench(in, enc, dec, size, loops);
+    }
+
+  free(in);
+  free(enc);
+  free(dec);
+  return g_nfail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+/****************************************************************************
+ * apps/testing/cpuload/cpuload.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_TESTING_CPULOAD_CPULOAD_H
+#define __APPS_TESTING_CPULOAD_CPULOAD_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_TESTING_CPULOAD_PROFILE
+
+/****************************************************************************
+ * Name: cpuload_profile
+ *
+ * Description:
+ *   Sample the task running on each CPU rate times per second for
+ *   duration seconds, print the flat profiles and write the folded stacks
+ *   to path, or to stdout if path is NULL.  depth is the number of return
+ *   addresses recorded per sample, zero for none.
+ *
+ * Returned Value:
+ *   EXIT_SUCCESS or EXIT_FAILURE.
+ *
+ ****************************************************************************/
+
+int cpuload_profile(int rate, int duration, int depth,
+                    FAR const char *path);
+
+#endif
+
+#endif /* __APPS_TESTING_CPULOAD_CPULOAD_H */
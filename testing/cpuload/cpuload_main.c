@@ -27,9 +27,12 @@
 
 #include <unistd.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "cpuload.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -37,6 +40,9 @@
 #define CPULOAD_US          (USEC_PER_SEC / CONFIG_SCHED_CPULOAD_TICKSPERSEC)
 #define CPULOAD_DELAY       (10 * CPULOAD_US)
 
+#define CPULOAD_RATE        100
+#define CPULOAD_DURATION    10
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -46,9 +52,21 @@ static void show_usage(FAR const char *progname, int exitcode)
   optind = 0;
 
   printf("\nUsage: %s [-c cpu] -p percent\n", progname);
+#ifdef CONFIG_TESTING_CPULOAD_PROFILE
+  printf("       %s [-c cpu] -s [-r rate] [-d seconds] [-b depth] "
+         "[-o file]\n", progname);
+#endif
   printf("\nWhere:\n");
   printf("  -c bind to specific CPU, don't bind CPU if no this option\n");
   printf("  -p process percent[1-100], exectime / (exectime + idletime)\n");
+#ifdef CONFIG_TESTING_CPULOAD_PROFILE
+  printf("  -s sample the other CPUs instead of loading this one\n");
+  printf("  -r samples per second, default %d\n", CPULOAD_RATE);
+  printf("  -d sampling duration in seconds, default %d\n",
+         CPULOAD_DURATION);
+  printf("  -b return addresses per sample, default 0\n");
+  printf("  -o write the folded stacks to file instead of stdout\n");
+#endif
   exit(exitcode);
 }
 
@@ -66,8 +84,15 @@ int main(int argc, FAR char *argv[])
   int option;
   int cpu = -1;
   int per = 50;
+#ifdef CONFIG_TESTING_CPULOAD_PROFILE
+  FAR const char *path = NULL;
+  bool profile = false;
+  int rate = CPULOAD_RATE;
+  int duration = CPULOAD_DURATION;
+  int depth = 0;
+#endif
 
-  while ((option = getopt(argc, argv, "c:p:")) != ERROR)
+  while ((option = getopt(argc, argv, "c:p:sr:d:b:o:")) != ERROR)
     {
       if (option == 'c')
         {
@@ -77,6 +102,28 @@ int main(int argc, FAR char *argv[])
         {
           per = strtol(optarg, &endptr, 10);
         }
+#ifdef CONFIG_TESTING_CPULOAD_PROFILE
+      else if (option == 's')
+        {
+          profile = true;
+        }
+      else if (option == 'r')
+        {
+          rate = strtol(optarg, &endptr, 10);
+        }
+      else if (option == 'd')
+        {
+          duration = strtol(optarg, &endptr, 10);
+        }
+      else if (option == 'b')
+        {
+          depth = strtol(optarg, &endptr, 10);
+        }
+      else if (option == 'o')
+        {
+          path = optarg;
+        }
+#endif
       else
         {
           printf("Unrecognized option: '%c'\n", option);
@@ -93,7 +140,7 @@ int main(int argc, FAR char *argv[])
     }
 
 #ifdef CONFIG_SMP
-  if (cpu > 0 && cpu < CONFIG_SMP_NCPUS)
+  if (cpu >= 0 && cpu < CONFIG_SMP_NCPUS)
     {
       cpu_set_t cpu_mask;
 
@@ -104,6 +151,13 @@ int main(int argc, FAR char *argv[])
     }
 #endif
 
+#ifdef CONFIG_TESTING_CPULOAD_PROFILE
+  if (profile)
+    {
+      return cpuload_profile(rate, duration, depth, path);
+    }
+#endif
+
   while (1)
     {
       up_udelay(per * CPULOAD_DELAY / 100);
@@ -0,0 +1,846 @@
+/****************************************************************************
+ * apps/testing/cpuload/cpuload_profile.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/clock.h>
+
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpuload.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_TESTING_CPULOAD_PROFILE_MOUNTPOINT
+#  define CONFIG_TESTING_CPULOAD_PROFILE_MOUNTPOINT "/proc"
+#endif
+
+#ifdef CONFIG_SMP
+#  define CPULOAD_NCPUS     CONFIG_SMP_NCPUS
+#else
+#  define CPULOAD_NCPUS     1
+#endif
+
+#ifdef CONFIG_SCHED_BACKTRACE
+#  define CPULOAD_MAXDEPTH  CONFIG_TESTING_CPULOAD_PROFILE_MAXDEPTH
+#  define CPULOAD_NFRAMES   CPULOAD_MAXDEPTH
+#else
+#  define CPULOAD_MAXDEPTH  0
+#  define CPULOAD_NFRAMES   1   /* Keeps the arrays valid */
+#endif
+
+#if CONFIG_TASK_NAME_SIZE > 0
+#  define CPULOAD_NAMESIZE  (CONFIG_TASK_NAME_SIZE + 1)
+#else
+#  define CPULOAD_NAMESIZE  8
+#endif
+
+#define CPULOAD_STATUSSIZE  512
+#define CPULOAD_MINSTACKS   64   /* Initial hash table size, power of 2 */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The flat profile of one task */
+
+struct cpuload_task_s
+{
+  pid_t pid;
+  char name[CPULOAD_NAMESIZE];
+  unsigned long total;
+  unsigned long samples[CPULOAD_NCPUS];
+};
+
+/* The samples of one task on one CPU with one backtrace */
+
+struct cpuload_stack_s
+{
+  unsigned long count;              /* Zero if the slot is free */
+  uint32_t hash;
+  pid_t pid;
+  int16_t cpu;
+  int16_t depth;
+  FAR void *frames[CPULOAD_NFRAMES];
+};
+
+struct cpuload_prof_s
+{
+  FAR struct cpuload_task_s *tasks;
+  int ntasks;
+  int maxtasks;
+
+  FAR struct cpuload_stack_s *stacks;   /* Open addressing hash table */
+  unsigned int nstacks;
+  unsigned int maxstacks;
+
+  int depth;                        /* Frames recorded per sample */
+  unsigned long rounds;
+  unsigned long observed[CPULOAD_NCPUS];   /* Running tasks seen */
+  unsigned long selfcpu[CPULOAD_NCPUS];    /* Rounds run by the sampler */
+  unsigned long overruns;
+  uint64_t scan_ns;
+  uint64_t scan_max_ns;
+
+  char status[CPULOAD_STATUSSIZE];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_name[]  = "Name:";
+static const char g_state[] = "State:";
+static const char g_cpu[]   = "CPU:";
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cpuload_gettime
+ ****************************************************************************/
+
+static uint64_t cpuload_gettime(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: cpuload_isnumeric
+ ****************************************************************************/
+
+static bool cpuload_isnumeric(FAR const char *name)
+{
+  if (*name == '\0')
+    {
+      return false;
+    }
+
+  for (; *name != '\0'; name++)
+    {
+      if (!isdigit(*name))
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: cpuload_value
+ *
+ * Description:
+ *   Return the value of a "Key:   value" status line if it has the given
+ *   key, NULL otherwise.
+ *
+ ****************************************************************************/
+
+static FAR char *cpuload_value(FAR char *line, FAR const char *key)
+{
+  size_t len = strlen(key);
+
+  if (strncmp(line, key, len) != 0)
+    {
+      return NULL;
+    }
+
+  line += len;
+  while (isspace(*line))
+    {
+      line++;
+    }
+
+  return line;
+}
+
+/****************************************************************************
+ * Name: cpuload_readstatus
+ *
+ * Description:
+ *   Read /proc/<pid>/status.  Return true if the task is running, with its
+ *   CPU and name.
+ *
+ ****************************************************************************/
+
+static bool cpuload_readstatus(FAR struct cpuload_prof_s *prof,
+                               FAR const char *dirname, FAR int *cpu,
+                               FAR char *name)
+{
+  FAR char *line;
+  FAR char *next;
+  FAR char *value;
+  bool running = false;
+  ssize_t nread;
+  int fd;
+
+  snprintf(prof->status, sizeof(prof->status), "%s/%s/status",
+           CONFIG_TESTING_CPULOAD_PROFILE_MOUNTPOINT, dirname);
+
+  fd = open(prof->status, O_RDONLY);
+  if (fd < 0)
+    {
+      return false;  /* The task has exited */
+    }
+
+  nread = read(fd, prof->status, sizeof(prof->status) - 1);
+  close(fd);
+  if (nread <= 0)
+    {
+      return false;
+    }
+
+  prof->status[nread] = '\0';
+  *cpu    = 0;
+  name[0] = '\0';
+
+  for (line = prof->status; line != NULL; line = next)
+    {
+      next = strchr(line, '\n');
+      if (next != NULL)
+        {
+          *next++ = '\0';
+        }
+
+      if ((value = cpuload_value(line, g_name)) != NULL)
+        {
+          strlcpy(name, value, CPULOAD_NAMESIZE);
+        }
+      else if ((value = cpuload_value(line, g_cpu)) != NULL)
+        {
+          *cpu = atoi(value);
+        }
+      else if ((value = cpuload_value(line, g_state)) != NULL)
+        {
+          running = strncmp(value, "Running", 7) == 0;
+        }
+    }
+
+  return running;
+}
+
+/****************************************************************************
+ * Name: cpuload_gettask
+ ****************************************************************************/
+
+static FAR struct cpuload_task_s *
+cpuload_gettask(FAR struct cpuload_prof_s *prof, pid_t pid,
+                FAR const char *name)
+{
+  FAR struct cpuload_task_s *task;
+  int i;
+
+  for (i = 0; i < prof->ntasks; i++)
+    {
+      if (prof->tasks[i].pid == pid)
+        {
+          return &prof->tasks[i];
+        }
+    }
+
+  if (prof->ntasks == prof->maxtasks)
+    {
+      int maxtasks = prof->maxtasks > 0 ? 2 * prof->maxtasks : 16;
+
+      task = realloc(prof->tasks, maxtasks * sizeof(*task));
+      if (task == NULL)
+        {
+          return NULL;
+        }
+
+      prof->tasks    = task;
+      prof->maxtasks = maxtasks;
+    }
+
+  task = &prof->tasks[prof->ntasks++];
+  memset(task, 0, sizeof(*task));
+  task->pid = pid;
+  strlcpy(task->name, name, sizeof(task->name));
+  return task;
+}
+
+/****************************************************************************
+ * Name: cpuload_hash
+ *
+ * Description:
+ *   FNV-1a over the CPU, PID and frames of a sample.
+ *
+ ****************************************************************************/
+
+static uint32_t cpuload_hash(int cpu, pid_t pid,
+                             FAR void * const *frames, int depth)
+{
+  uint32_t hash = 2166136261u;
+  uintptr_t word;
+  int shift;
+  int i;
+
+  for (i = -2; i < depth; i++)
+    {
+      word = i == -2 ? (uintptr_t)cpu :
+             i == -1 ? (uintptr_t)pid : (uintptr_t)frames[i];
+
+      for (shift = 0; shift < 8 * sizeof(word); shift += 8)
+        {
+          hash = (hash ^ ((word >> shift) & 0xff)) * 16777619u;
+        }
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: cpuload_findstack
+ ****************************************************************************/
+
+static FAR struct cpuload_stack_s *
+cpuload_findstack(FAR struct cpuload_stack_s *stacks, unsigned int size,
+                  uint32_t hash, int cpu, pid_t pid,
+                  FAR void * const *frames, int depth)
+{
+  FAR struct cpuload_stack_s *stack;
+  unsigned int i;
+
+  for (i = hash & (size - 1); ; i = (i + 1) & (size - 1))
+    {
+      stack = &stacks[i];
+      if (stack->count == 0 ||
+          (stack->hash == hash && stack->cpu == cpu && stack->pid == pid &&
+           stack->depth == depth &&
+           memcmp(stack->frames, frames, depth * sizeof(*frames)) == 0))
+        {
+          return stack;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: cpuload_addstack
+ ****************************************************************************/
+
+static int cpuload_addstack(FAR struct cpuload_prof_s *prof, int cpu,
+                            pid_t pid, FAR void * const *frames, int depth)
+{
+  FAR struct cpuload_stack_s *stack;
+  uint32_t hash;
+  unsigned int i;
+
+  /* Keep the table at most half full */
+
+  if (2 * (prof->nstacks + 1) > prof->maxstacks)
+    {
+      FAR struct cpuload_stack_s *stacks;
+      unsigned int size;
+
+      size   = prof->maxstacks > 0 ? 2 * prof->maxstacks : CPULOAD_MINSTACKS;
+      stacks = calloc(size, sizeof(*stacks));
+      if (stacks == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      for (i = 0; i < prof->maxstacks; i++)
+        {
+          stack = &prof->stacks[i];
+          if (stack->count != 0)
+            {
+              *cpuload_findstack(stacks, size, stack->hash, stack->cpu,
+                                 stack->pid, stack->frames,
+                                 stack->depth) = *stack;
+            }
+        }
+
+      free(prof->stacks);
+      prof->stacks    = stacks;
+      prof->maxstacks = size;
+    }
+
+  hash  = cpuload_hash(cpu, pid, frames, depth);
+  stack = cpuload_findstack(prof->stacks, prof->maxstacks, hash, cpu, pid,
+                            frames, depth);
+  if (stack->count == 0)
+    {
+      stack->hash  = hash;
+      stack->cpu   = cpu;
+      stack->pid   = pid;
+      stack->depth = depth;
+      memcpy(stack->frames, frames, depth * sizeof(*frames));
+      prof->nstacks++;
+    }
+
+  stack->count++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: cpuload_record
+ ****************************************************************************/
+
+static int cpuload_record(FAR struct cpuload_prof_s *prof, int cpu,
+                          pid_t pid, FAR const char *name)
+{
+  FAR struct cpuload_task_s *task;
+  FAR void *frames[CPULOAD_NFRAMES];
+  int nframes = 0;
+
+  task = cpuload_gettask(prof, pid, name);
+  if (task == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  task->samples[cpu]++;
+  task->total++;
+  prof->observed[cpu]++;
+
+#ifdef CONFIG_SCHED_BACKTRACE
+  if (prof->depth > 0)
+    {
+      nframes = sched_backtrace(pid, frames, prof->depth, 0);
+      if (nframes < 0)
+        {
+          nframes = 0;
+        }
+    }
+#endif
+
+  return cpuload_addstack(prof, cpu, pid, frames, nframes);
+}
+
+/****************************************************************************
+ * Name: cpuload_scan
+ *
+ * Description:
+ *   Take one sample of every CPU but the one running the sampler.  The
+ *   status files are read one after the other while the other CPUs go on,
+ *   so a sample is a close look rather than an exact snapshot.
+ *
+ ****************************************************************************/
+
+static int cpuload_scan(FAR struct cpuload_prof_s *prof)
+{
+  char name[CPULOAD_NAMESIZE];
+  FAR struct dirent *entryp;
+  FAR DIR *dirp;
+  pid_t self = gettid();
+  int selfcpu;
+  int cpu;
+  int ret = OK;
+
+  dirp = opendir(CONFIG_TESTING_CPULOAD_PROFILE_MOUNTPOINT);
+  if (dirp == NULL)
+    {
+      return -errno;
+    }
+
+  selfcpu = sched_getcpu();
+  if (selfcpu >= 0 && selfcpu < CPULOAD_NCPUS)
+    {
+      prof->selfcpu[selfcpu]++;
+    }
+
+  while (ret == OK && (entryp = readdir(dirp)) != NULL)
+    {
+      /* Task/thread entries are directories with numeric names */
+
+      if (!DIRENT_ISDIRECTORY(entryp->d_type) ||
+          !cpuload_isnumeric(entryp->d_name))
+        {
+          continue;
+        }
+
+      if (atoi(entryp->d_name) == self ||
+          !cpuload_readstatus(prof, entryp->d_name, &cpu, name))
+        {
+          continue;
+        }
+
+      if (cpu >= 0 && cpu < CPULOAD_NCPUS)
+        {
+          ret = cpuload_record(prof, cpu, atoi(entryp->d_name), name);
+        }
+    }
+
+  closedir(dirp);
+  prof->rounds++;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: cpuload_taskname
+ ****************************************************************************/
+
+static FAR const char *cpuload_taskname(FAR struct cpuload_prof_s *prof,
+                                        pid_t pid)
+{
+  int i;
+
+  for (i = 0; i < prof->ntasks; i++)
+    {
+      if (prof->tasks[i].pid == pid)
+        {
+          return prof->tasks[i].name;
+        }
+    }
+
+  return "?";
+}
+
+/****************************************************************************
+ * Name: cpuload_sort
+ *
+ * Description:
+ *   Order the task indexes by decreasing samples on a CPU, or in total if
+ *   cpu is negative.
+ *
+ ****************************************************************************/
+
+static void cpuload_sort(FAR struct cpuload_prof_s *prof, FAR int *order,
+                         int cpu)
+{
+  unsigned long count;
+  int i;
+  int j;
+
+  for (i = 0; i < prof->ntasks; i++)
+    {
+      count = cpu < 0 ? prof->tasks[i].total : prof->tasks[i].samples[cpu];
+
+      for (j = i; j > 0; j--)
+        {
+          FAR struct cpuload_task_s *prev = &prof->tasks[order[j - 1]];
+
+          if ((cpu < 0 ? prev->total : prev->samples[cpu]) >= count)
+            {
+              break;
+            }
+
+          order[j] = order[j - 1];
+        }
+
+      order[j] = i;
+    }
+}
+
+/****************************************************************************
+ * Name: cpuload_percent
+ ****************************************************************************/
+
+static unsigned int cpuload_percent(unsigned long count, unsigned long total)
+{
+  /* In tenths of a percent */
+
+  return total > 0 ? (unsigned int)((count * 1000 + total / 2) / total) : 0;
+}
+
+/****************************************************************************
+ * Name: cpuload_report
+ ****************************************************************************/
+
+static int cpuload_report(FAR struct cpuload_prof_s *prof, int rate)
+{
+  FAR struct cpuload_task_s *task;
+  unsigned long observed = 0;
+  unsigned int pct;
+  FAR int *order;
+  int cpu;
+  int i;
+
+  order = malloc((prof->ntasks + 1) * sizeof(int));
+  if (order == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (cpu = 0; cpu < CPULOAD_NCPUS; cpu++)
+    {
+      observed += prof->observed[cpu];
+    }
+
+  printf("%lu rounds at %d Hz, %lu overruns, scan %lu us avg %lu us max\n",
+         prof->rounds, rate, prof->overruns,
+         (unsigned long)(prof->scan_ns / (prof->rounds ? prof->rounds : 1) /
+                         1000),
+         (unsigned long)(prof->scan_max_ns / 1000));
+
+  for (cpu = 0; cpu < CPULOAD_NCPUS; cpu++)
+    {
+      if (prof->selfcpu[cpu] > 0)
+        {
+          printf("CPU%d ran the sampler in %lu rounds and was not "
+                 "sampled then\n", cpu, prof->selfcpu[cpu]);
+        }
+    }
+
+  /* Per-task flat profile, the share of each CPU is of that CPU's
+   * samples.
+   */
+
+  printf("\n  PID NAME             TOTAL");
+  for (cpu = 0; cpu < CPULOAD_NCPUS; cpu++)
+    {
+      printf("   CPU%-3d", cpu);
+    }
+
+  printf("\n");
+
+  cpuload_sort(prof, order, -1);
+  for (i = 0; i < prof->ntasks; i++)
+    {
+      task = &prof->tasks[order[i]];
+      pct  = cpuload_percent(task->total, observed);
+      printf("%5d %-16.16s %3u.%u%%", (int)task->pid, task->name,
+             pct / 10, pct % 10);
+
+      for (cpu = 0; cpu < CPULOAD_NCPUS; cpu++)
+        {
+          pct = cpuload_percent(task->samples[cpu], prof->observed[cpu]);
+          printf("  %3u.%u%%", pct / 10, pct % 10);
+        }
+
+      printf("\n");
+    }
+
+  /* Per-CPU flat profiles */
+
+  for (cpu = 0; cpu < CPULOAD_NCPUS; cpu++)
+    {
+      if (prof->observed[cpu] == 0)
+        {
+          continue;
+        }
+
+      printf("\nCPU%d: %lu samples\n", cpu, prof->observed[cpu]);
+
+      cpuload_sort(prof, order, cpu);
+      for (i = 0; i < prof->ntasks; i++)
+        {
+          task = &prof->tasks[order[i]];
+          if (task->samples[cpu] == 0)
+            {
+              break;
+            }
+
+          pct = cpuload_percent(task->samples[cpu], prof->observed[cpu]);
+          printf("  %3u.%u%%  %8lu  %5d %s\n", pct / 10, pct % 10,
+                 task->samples[cpu], (int)task->pid, task->name);
+        }
+    }
+
+  free(order);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: cpuload_folded
+ *
+ * Description:
+ *   Write one "cpu;task;frame;... count" line per distinct sample, the
+ *   input of flamegraph.pl.  Frames go from the outermost call in, as
+ *   hexadecimal addresses to resolve with addr2line.
+ *
+ ****************************************************************************/
+
+static void cpuload_folded(FAR struct cpuload_prof_s *prof, FAR FILE *out)
+{
+  FAR struct cpuload_stack_s *stack;
+  FAR const char *name;
+  unsigned int i;
+  int j;
+
+  for (i = 0; i < prof->maxstacks; i++)
+    {
+      stack = &prof->stacks[i];
+      if (stack->count == 0)
+        {
+          continue;
+        }
+
+      fprintf(out, "CPU%d;", stack->cpu);
+
+      /* Spaces and semicolons would split the frame */
+
+      for (name = cpuload_taskname(prof, stack->pid); *name; name++)
+        {
+          fputc(*name == ' ' || *name == ';' ? '_' : *name, out);
+        }
+
+      fprintf(out, "-%d", (int)stack->pid);
+
+      for (j = stack->depth - 1; j >= 0; j--)
+        {
+          fprintf(out, ";0x%" PRIxPTR, (uintptr_t)stack->frames[j]);
+        }
+
+      fprintf(out, " %lu\n", stack->count);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cpuload_profile
+ ****************************************************************************/
+
+int cpuload_profile(int rate, int duration, int depth,
+                    FAR const char *path)
+{
+  FAR struct cpuload_prof_s *prof;
+  struct sched_param param;
+  struct timespec next;
+  FAR FILE *out = stdout;
+  uint64_t period;
+  uint64_t start;
+  uint64_t now;
+  unsigned long nrounds;
+  unsigned long i;
+  int exitcode = EXIT_FAILURE;
+  int ret;
+
+  if (rate <= 0 || duration <= 0 || depth < 0 || depth > CPULOAD_MAXDEPTH)
+    {
+      printf("Bad rate, duration or depth (at most %d)\n",
+             CPULOAD_MAXDEPTH);
+      return EXIT_FAILURE;
+    }
+
+  prof = calloc(1, sizeof(*prof));
+  if (prof == NULL)
+    {
+      printf("No memory for the profile\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Run ahead of what is sampled so that the rounds stay on time and
+   * the tasks have less time to move during one.
+   */
+
+  prof->depth = depth;
+
+  param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+  sched_setscheduler(0, SCHED_FIFO, &param);
+
+  period  = NSEC_PER_SEC / rate;
+  nrounds = (unsigned long)rate * duration;
+
+  printf("Sampling %d times per second for %d seconds, %d frames\n",
+         rate, duration, depth);
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (i = 0; i < nrounds; i++)
+    {
+      start = cpuload_gettime();
+      ret = cpuload_scan(prof);
+      if (ret < 0)
+        {
+          printf("Sampling failed: %d\n", ret);
+          goto errout;
+        }
+
+      now = cpuload_gettime();
+      prof->scan_ns += now - start;
+      if (now - start > prof->scan_max_ns)
+        {
+          prof->scan_max_ns = now - start;
+        }
+
+      /* Wait for the next round, or start again from now if this one
+       * took longer than the period.
+       */
+
+      next.tv_nsec += period;
+      while (next.tv_nsec >= NSEC_PER_SEC)
+        {
+          next.tv_nsec -= NSEC_PER_SEC;
+          next.tv_sec++;
+        }
+
+      if ((uint64_t)next.tv_sec * NSEC_PER_SEC + next.tv_nsec <= now)
+        {
+          prof->overruns++;
+          next.tv_sec  = now / NSEC_PER_SEC;
+          next.tv_nsec = now % NSEC_PER_SEC;
+          continue;
+        }
+
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+  ret = cpuload_report(prof, rate);
+  if (ret < 0)
+    {
+      printf("No memory for the report\n");
+      goto errout;
+    }
+
+  if (path != NULL)
+    {
+      out = fopen(path, "w");
+      if (out == NULL)
+        {
+          printf("Failed to open %s: %d\n", path, errno);
+          goto errout;
+        }
+    }
+  else
+    {
+      printf("\nFolded stacks:\n");
+    }
+
+  cpuload_folded(prof, out);
+  if (out != stdout)
+    {
+      fclose(out);
+      printf("\nFolded stacks written to %s\n", path);
+    }
+
+  exitcode = EXIT_SUCCESS;
+
+errout:
+  free(prof->tasks);
+  free(prof->stacks);
+  free(prof);
+  return exitcode;
+}
@@ -0,0 +1,330 @@
+/****************************************************************************
+ * apps/testing/drivertest/drivertest_nxcamera.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <cmocka.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "system/nxcamera.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NXCAMERA_TEST_FILE      "/var/nxcamera_test.raw"
+#define NXCAMERA_TEST_FRAMES    8
+
+#define OPTARG_TO_VALUE(value, type, base)                            \
+  do                                                                  \
+    {                                                                 \
+      FAR char *ptr;                                                  \
+      value = (type)strtoul(optarg, &ptr, base);                      \
+      if (*ptr != '\0')                                               \
+        {                                                             \
+          printf("Parameter error: %s\n", optarg);                    \
+          nxcamera_test_help(argv[0], EXIT_FAILURE);                  \
+        }                                                             \
+    } while (0)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct nxcamera_state_s
+{
+  char       fbdev[PATH_MAX];
+  uint16_t   width;
+  uint16_t   height;
+  uint32_t   rate;      /* Frame rate of the fake source */
+  uint32_t   duration;  /* Seconds to stream */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void nxcamera_test_help(FAR const char *progname, int exitcode)
+{
+  printf("Usage: %s\n"
+         " -f <framebuffer device e.g./dev/fb0>\n"
+         " -x <frame width>\n"
+         " -y <frame height>\n"
+         " -r <frame rate>\n"
+         " -t <seconds to stream>\n",
+         progname);
+  printf(" -h shows this message and exits\n");
+
+  exit(exitcode);
+}
+
+/****************************************************************************
+ * Name: parse_commandline
+ ****************************************************************************/
+
+static void parse_commandline(FAR struct nxcamera_state_s *state, int argc,
+                              FAR char **argv)
+{
+  int option;
+
+  while ((option = getopt(argc, argv, "f:x:y:r:t:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'f':
+            strlcpy(state->fbdev, optarg, sizeof(state->fbdev));
+            break;
+
+          case 'x':
+            OPTARG_TO_VALUE(state->width, uint16_t, 10);
+            break;
+
+          case 'y':
+            OPTARG_TO_VALUE(state->height, uint16_t, 10);
+            break;
+
+          case 'r':
+            OPTARG_TO_VALUE(state->rate, uint32_t, 10);
+            break;
+
+          case 't':
+            OPTARG_TO_VALUE(state->duration, uint32_t, 10);
+            break;
+
+          case 'h':
+            nxcamera_test_help(argv[0], EXIT_SUCCESS);
+            break;
+
+          case '?':
+            printf("Unknown option: %c\n", optopt);
+            nxcamera_test_help(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: nxcamera_test_setup
+ *
+ * Description:
+ *   Write the fake source: RGB565 frames, each filled with its own color.
+ *
+ ****************************************************************************/
+
+static int nxcamera_test_setup(FAR void **state)
+{
+  FAR struct nxcamera_state_s *test = *state;
+  FAR uint16_t *frame;
+  size_t pixels = (size_t)test->width * test->height;
+  size_t i;
+  int fd;
+  int n;
+
+  frame = malloc(pixels * sizeof(uint16_t));
+  assert_non_null(frame);
+
+  fd = open(NXCAMERA_TEST_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  assert_true(fd >= 0);
+
+  for (n = 0; n < NXCAMERA_TEST_FRAMES; n++)
+    {
+      for (i = 0; i < pixels; i++)
+        {
+          frame[i] = 0x0821 * (n + 1);
+        }
+
+      assert_int_equal(write(fd, frame, pixels * sizeof(uint16_t)),
+                       pixels * sizeof(uint16_t));
+    }
+
+  close(fd);
+  free(frame);
+  return 0;
+}
+
+static int nxcamera_test_teardown(FAR void **state)
+{
+  unlink(NXCAMERA_TEST_FILE);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: nxcamera_test_stream
+ *
+ * Description:
+ *   Stream the fake source for the configured time and return the
+ *   statistics taken just before the stream is stopped.
+ *
+ ****************************************************************************/
+
+static void nxcamera_test_stream(FAR struct nxcamera_s *pcam,
+                                 FAR struct nxcamera_state_s *state,
+                                 FAR struct nxcamera_stats_s *stats)
+{
+  int i;
+
+  assert_int_equal(nxcamera_stream(pcam, state->width, state->height,
+                                   state->rate, V4L2_PIX_FMT_RGB565), OK);
+  sleep(state->duration);
+
+  nxcamera_getstats(pcam, stats);
+  assert_int_equal(nxcamera_stop(pcam), OK);
+
+  for (i = 0; i < NXCAMERA_NSTAGES; i++)
+    {
+      printf("stage %d: %" PRIu32 " frames, %" PRIu32 " fps, avg %" PRIu32
+             " us, max %" PRIu32 " us\n", i, stats->stage[i].frames,
+             stats->stage[i].fps, stats->stage[i].avgtime,
+             stats->stage[i].maxtime);
+    }
+
+  printf("latency: avg %" PRIu32 " us, max %" PRIu32 " us\n",
+         stats->avglatency, stats->maxlatency);
+}
+
+/****************************************************************************
+ * Name: test_nxcamera_pipeline
+ *
+ * Description:
+ *   Every stage has to keep up with the source, and a frame must not be
+ *   displayed before it is captured and converted.
+ *
+ ****************************************************************************/
+
+static void test_nxcamera_pipeline(FAR void **state)
+{
+  FAR struct nxcamera_state_s *test = *state;
+  FAR struct nxcamera_stage_stats_s *stage;
+  FAR struct nxcamera_s *pcam;
+  struct nxcamera_stats_s stats;
+
+  pcam = nxcamera_create();
+  assert_non_null(pcam);
+  assert_int_equal(nxcamera_setdevice(pcam, NXCAMERA_TEST_FILE), OK);
+  assert_int_equal(nxcamera_setfb(pcam, test->fbdev), OK);
+
+  nxcamera_test_stream(pcam, test, &stats);
+  nxcamera_release(pcam);
+
+  stage = stats.stage;
+  assert_true(stats.streaming);
+  assert_true(stage[NXCAMERA_STAGE_CAPTURE].frames >=
+              test->rate * test->duration * 3 / 4);
+  assert_true(stage[NXCAMERA_STAGE_CAPTURE].fps >= test->rate * 3 / 4);
+  assert_true(stage[NXCAMERA_STAGE_CAPTURE].fps <= test->rate * 5 / 4);
+  assert_true(stage[NXCAMERA_STAGE_CONVERT].frames <=
+              stage[NXCAMERA_STAGE_CAPTURE].frames);
+  assert_true(stage[NXCAMERA_STAGE_DISPLAY].frames <=
+              stage[NXCAMERA_STAGE_CONVERT].frames);
+  assert_true(stage[NXCAMERA_STAGE_DISPLAY].fps >= test->rate * 3 / 4);
+  assert_true(stats.avglatency <= stats.maxlatency);
+  assert_true(stats.maxlatency < 1000000);
+}
+
+/****************************************************************************
+ * Name: test_nxcamera_restart
+ *
+ * Description:
+ *   The statistics of a stopped stream stay frozen until the next stream,
+ *   which starts counting from zero.
+ *
+ ****************************************************************************/
+
+static void test_nxcamera_restart(FAR void **state)
+{
+  FAR struct nxcamera_state_s *test = *state;
+  FAR struct nxcamera_s *pcam;
+  struct nxcamera_stats_s first;
+  struct nxcamera_stats_s stats;
+  uint32_t duration = test->duration;
+
+  pcam = nxcamera_create();
+  assert_non_null(pcam);
+  assert_int_equal(nxcamera_setdevice(pcam, NXCAMERA_TEST_FILE), OK);
+  assert_int_equal(nxcamera_setfb(pcam, test->fbdev), OK);
+
+  test->duration = 1;
+  nxcamera_test_stream(pcam, test, &first);
+
+  nxcamera_getstats(pcam, &stats);
+  assert_false(stats.streaming);
+  usleep(200 * 1000);
+  nxcamera_getstats(pcam, &first);
+  assert_int_equal(stats.stage[NXCAMERA_STAGE_CAPTURE].frames,
+                   first.stage[NXCAMERA_STAGE_CAPTURE].frames);
+
+  nxcamera_test_stream(pcam, test, &stats);
+  test->duration = duration;
+  nxcamera_release(pcam);
+
+  assert_true(stats.streaming);
+  assert_true(stats.stage[NXCAMERA_STAGE_CAPTURE].frames <
+              first.stage[NXCAMERA_STAGE_CAPTURE].frames * 3 / 2);
+  assert_true(stats.stage[NXCAMERA_STAGE_DISPLAY].frames > 0);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct nxcamera_state_s state =
+  {
+    .fbdev    = "/dev/fb0",
+    .width    = 160,
+    .height   = 120,
+    .rate     = 15,
+    .duration = 3,
+  };
+
+  parse_commandline(&state, argc, argv);
+
+  const struct CMUnitTest tests[] =
+    {
+      cmocka_unit_test_prestate_setup_teardown(test_nxcamera_pipeline,
+                                               nxcamera_test_setup,
+                                               nxcamera_test_teardown,
+                                               &state),
+      cmocka_unit_test_prestate_setup_teardown(test_nxcamera_restart,
+                                               nxcamera_test_setup,
+                                               nxcamera_test_teardown,
+                                               &state),
+    };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,330 @@
+/****************************************************************************
+ * apps/testing/drivertest/drivertest_nxplayer.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <cmocka.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "system/nxplayer.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NXPLAYER_TEST_FIFO      "/var/nxplayer_test"
+#define NXPLAYER_TEST_CHUNK     512
+
+#define OPTARG_TO_VALUE(value, type, base)                            \
+  do                                                                  \
+    {                                                                 \
+      FAR char *ptr;                                                  \
+      value = (type)strtoul(optarg, &ptr, base);                      \
+      if (*ptr != '\0')                                               \
+        {                                                             \
+          printf("Parameter error: %s\n", optarg);                    \
+          nxplayer_test_help(argv[0], EXIT_FAILURE);                  \
+        }                                                             \
+    } while (0)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct nxplayer_state_s
+{
+  char       outdev[PATH_MAX];
+  uint32_t   duration;  /* Seconds of audio fed to the player */
+  uint32_t   samprate;
+  uint32_t   bpsamp;
+  uint32_t   chans;
+  uint32_t   stall;     /* Source stall once per second, in ms */
+  uint32_t   lstall;    /* Source stall that must cause an underrun */
+
+  uint32_t   rate;      /* Bytes per second of the PCM stream */
+  uint32_t   nstall;    /* Source stall of the current test case */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void nxplayer_test_help(FAR const char *progname, int exitcode)
+{
+  printf("Usage: %s\n"
+         " -o <output device e.g./dev/audio/pcm0p>\n"
+         " -t <seconds of audio>\n"
+         " -s <sample rate>\n"
+         " -b <bits per sample>\n"
+         " -c <channels>\n"
+         " -l <source stall in ms, must fit in the read-ahead ring>\n"
+         " -L <source stall in ms, must drain the read-ahead ring>\n",
+         progname);
+  printf(" -h shows this message and exits\n");
+
+  exit(exitcode);
+}
+
+/****************************************************************************
+ * Name: parse_commandline
+ ****************************************************************************/
+
+static void parse_commandline(FAR struct nxplayer_state_s *state, int argc,
+                              FAR char **argv)
+{
+  int option;
+
+  while ((option = getopt(argc, argv, "o:t:s:b:c:l:L:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'o':
+            strlcpy(state->outdev, optarg, sizeof(state->outdev));
+            break;
+
+          case 't':
+            OPTARG_TO_VALUE(state->duration, uint32_t, 10);
+            break;
+
+          case 's':
+            OPTARG_TO_VALUE(state->samprate, uint32_t, 10);
+            break;
+
+          case 'b':
+            OPTARG_TO_VALUE(state->bpsamp, uint32_t, 10);
+            break;
+
+          case 'c':
+            OPTARG_TO_VALUE(state->chans, uint32_t, 10);
+            break;
+
+          case 'l':
+            OPTARG_TO_VALUE(state->stall, uint32_t, 10);
+            break;
+
+          case 'L':
+            OPTARG_TO_VALUE(state->lstall, uint32_t, 10);
+            break;
+
+          case 'h':
+            nxplayer_test_help(argv[0], EXIT_SUCCESS);
+            break;
+
+          case '?':
+            printf("Unknown option: %c\n", optopt);
+            nxplayer_test_help(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  state->rate = state->samprate * state->chans * state->bpsamp / 8;
+}
+
+/****************************************************************************
+ * Name: nxplayer_test_source
+ *
+ * Description:
+ *   Throttled file source: write silence into the FIFO 10% faster than the
+ *   device plays it, but stop writing for state->nstall ms every second.
+ *
+ ****************************************************************************/
+
+static FAR void *nxplayer_test_source(FAR void *arg)
+{
+  FAR struct nxplayer_state_s *state = arg;
+  uint8_t buffer[NXPLAYER_TEST_CHUNK];
+  uint32_t period;
+  uint32_t total;
+  uint32_t sent;
+  uint32_t mark;
+  int fd;
+
+  memset(buffer, 0, sizeof(buffer));
+  fd = open(NXPLAYER_TEST_FIFO, O_WRONLY);
+  if (fd < 0)
+    {
+      return NULL;
+    }
+
+  period = (uint64_t)sizeof(buffer) * 900000 / state->rate;
+  total  = state->duration * state->rate;
+  mark   = state->rate;
+
+  for (sent = 0; sent < total; sent += sizeof(buffer))
+    {
+      if (write(fd, buffer, sizeof(buffer)) != sizeof(buffer))
+        {
+          break;
+        }
+
+      usleep(period);
+      if (sent >= mark)
+        {
+          usleep(state->nstall * 1000);
+          mark += state->rate;
+        }
+    }
+
+  close(fd);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxplayer_test_play
+ *
+ * Description:
+ *   Play the throttled source to the end and return the statistics.
+ *
+ ****************************************************************************/
+
+static void nxplayer_test_play(FAR struct nxplayer_state_s *state,
+                               FAR struct nxplayer_stats_s *stats)
+{
+  FAR struct nxplayer_s *pplayer;
+  pthread_t source;
+  int ret;
+
+  unlink(NXPLAYER_TEST_FIFO);
+  assert_int_equal(mkfifo(NXPLAYER_TEST_FIFO, 0666), 0);
+
+  pplayer = nxplayer_create();
+  assert_non_null(pplayer);
+
+#ifdef CONFIG_NXPLAYER_INCLUDE_PREFERRED_DEVICE
+  if (state->outdev[0] != '\0')
+    {
+      assert_int_equal(nxplayer_setdevice(pplayer, state->outdev), OK);
+    }
+#endif
+
+  ret = pthread_create(&source, NULL, nxplayer_test_source, state);
+  assert_int_equal(ret, 0);
+
+  ret = nxplayer_playraw(pplayer, NXPLAYER_TEST_FIFO, state->chans,
+                         state->bpsamp, state->samprate, 0);
+  assert_int_equal(ret, OK);
+
+  do
+    {
+      usleep(100 * 1000);
+      nxplayer_getstats(pplayer, stats);
+    }
+  while (stats->playing);
+
+  pthread_join(source, NULL);
+  nxplayer_release(pplayer);
+  unlink(NXPLAYER_TEST_FIFO);
+
+  printf("stall %" PRIu32 " ms: lowest %u/%u, starved %" PRIu32
+         ", underruns %" PRIu32 "\n", state->nstall, stats->minlevel,
+         stats->nbuffers, stats->starved, stats->underruns);
+}
+
+/****************************************************************************
+ * Name: test_nxplayer_absorb
+ *
+ * Description:
+ *   Short source stalls must be absorbed by the read-ahead ring.
+ *
+ ****************************************************************************/
+
+static void test_nxplayer_absorb(FAR void **state)
+{
+  FAR struct nxplayer_state_s *test = *state;
+  struct nxplayer_stats_s stats;
+
+  test->nstall = test->stall;
+  nxplayer_test_play(test, &stats);
+
+  assert_int_equal(stats.nbuffers, CONFIG_NXPLAYER_PREFETCH_BUFFERS);
+  assert_int_equal(stats.underruns, 0);
+}
+
+/****************************************************************************
+ * Name: test_nxplayer_underrun
+ *
+ * Description:
+ *   A source stall longer than the whole read-ahead has to be reported.
+ *
+ ****************************************************************************/
+
+static void test_nxplayer_underrun(FAR void **state)
+{
+  FAR struct nxplayer_state_s *test = *state;
+  struct nxplayer_stats_s stats;
+  uint32_t duration = test->duration;
+
+  /* Two seconds of audio with a single long stall after the first one */
+
+  test->duration = 2;
+  test->nstall   = test->lstall;
+  nxplayer_test_play(test, &stats);
+  test->duration = duration;
+
+  assert_int_equal(stats.minlevel, 0);
+  assert_true(stats.starved > 0);
+  assert_true(stats.underruns > 0);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct nxplayer_state_s state =
+  {
+    .outdev   = "",
+    .duration = 5,
+    .samprate = 16000,
+    .bpsamp   = 16,
+    .chans    = 1,
+    .stall    = 20,
+    .lstall   = 5000,
+  };
+
+  parse_commandline(&state, argc, argv);
+
+  const struct CMUnitTest tests[] =
+    {
+      cmocka_unit_test_prestate(test_nxplayer_absorb, &state),
+      cmocka_unit_test_prestate(test_nxplayer_underrun, &state),
+    };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
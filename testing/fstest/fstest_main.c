@@ -32,6 +32,8 @@
 #include <sys/boardctl.h>
 #endif
 
+#include <sys/stat.h>
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,6 +41,9 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <dirent.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
 #include <string.h>
 #include <errno.h>
 #include <debug.h>
@@ -56,6 +61,25 @@
 #  define CONFIG_TESTING_FSTEST_VERBOSE 0
 #endif
 
+/* Parallel workers, each one prefixes its file names with its number */
+
+#define FSTEST_MAXTHREADS     16
+#define FSTEST_PREFIXLEN      2
+
+/* Largest file of the metadata test */
+
+#define FSTEST_META_MAXFILE   64
+
+/* Timed phases */
+
+#define FSTEST_PHASE_FILL     0
+#define FSTEST_PHASE_VERIFY   1
+#define FSTEST_PHASE_DELETE   2
+#define FSTEST_PHASE_CREATE   3
+#define FSTEST_PHASE_STAT     4
+#define FSTEST_PHASE_UNLINK   5
+#define FSTEST_NPHASES        6
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -69,6 +93,14 @@ struct fstest_filedesc_s
   uint32_t crc;
 };
 
+struct fstest_phase_s
+{
+  uint64_t elapsed;                  /* Time spent in the phase, us */
+  uint64_t nbytes;                   /* File data written or read */
+  uint32_t nops;                     /* Files created, read, stat'ed or
+                                      * deleted */
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -80,19 +112,41 @@ struct fstest_ctx_s
   FAR uint8_t *fileimage;
   FAR struct fstest_filedesc_s *files;
   char mountdir[CONFIG_TESTING_FSTEST_MAXNAME];
+  char prefix[FSTEST_PREFIXLEN + 1];
   int nfiles;
   int ndeleted;
   int nfailed;
   int max_file;
   int max_open;
+  uint32_t seed;
   struct mallinfo mmbefore;
   struct mallinfo mmprevious;
   struct mallinfo mmafter;
+
+  /* Throughput of each phase, and counters of the current one */
+
+  struct fstest_phase_s phases[FSTEST_NPHASES];
+  uint32_t nops;
+  uint64_t nbytes;
+
+  /* Parallel workers */
+
+  pthread_t thread;
+  FAR pthread_barrier_t *barrier;
+  FAR sem_t *start;
+  int loops;
+  int result;
+  bool meta;
 };
 
 static int tests_ok = 0;
 static int tests_err = 0;
 
+static FAR const char *phase_names[FSTEST_NPHASES] =
+{
+  "fill", "verify", "delete", "create", "stat", "unlink"
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -150,13 +204,46 @@ static void fstest_endmemusage(FAR struct fstest_ctx_s *ctx)
   fstest_showmemusage(&ctx->mmbefore, &ctx->mmafter);
 }
 
+/****************************************************************************
+ * Name: fstest_rand
+ *
+ * Description:
+ *   xorshift32, each worker has its own sequence as rand() shares one
+ *   state between the threads.
+ *
+ ****************************************************************************/
+
+static inline int fstest_rand(FAR struct fstest_ctx_s *ctx)
+{
+  uint32_t x = ctx->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  ctx->seed = x;
+
+  return (int)(x >> 1);
+}
+
+/****************************************************************************
+ * Name: fstest_gettime
+ ****************************************************************************/
+
+static uint64_t fstest_gettime(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /****************************************************************************
  * Name: fstest_randchar
  ****************************************************************************/
 
-static inline char fstest_randchar(void)
+static inline char fstest_randchar(FAR struct fstest_ctx_s *ctx)
 {
-  int value = rand() % 63;
+  int value = fstest_rand(ctx) % 63;
   if (value == 0)
     {
       return '0';
@@ -206,18 +293,20 @@ static inline void fstest_randname(FAR struct fstest_ctx_s *ctx,
                                    FAR struct fstest_filedesc_s *file)
 {
   int dirlen;
+  int prefixlen;
   int maxname;
   int namelen;
   int alloclen;
   int i;
 
-  dirlen   = strlen(ctx->mountdir);
+  dirlen    = strlen(ctx->mountdir);
+  prefixlen = strlen(ctx->prefix);
 
   /* Force the max filename lengh and also the min name len = 4 */
 
-  maxname  = CONFIG_TESTING_FSTEST_MAXNAME - dirlen - 3;
-  namelen  = (rand() % maxname) + 4;
-  alloclen = namelen + dirlen;
+  maxname  = CONFIG_TESTING_FSTEST_MAXNAME - dirlen - prefixlen - 3;
+  namelen  = (fstest_rand(ctx) % maxname) + 4;
+  alloclen = namelen + dirlen + prefixlen;
 
   file->name = (FAR char *)malloc(alloclen + 1);
   if (!file->name)
@@ -228,12 +317,13 @@ static inline void fstest_randname(FAR struct fstest_ctx_s *ctx,
     }
 
   memcpy(file->name, ctx->mountdir, dirlen);
+  memcpy(&file->name[dirlen], ctx->prefix, prefixlen);
 
   do
     {
-      for (i = dirlen; i < alloclen; i++)
+      for (i = dirlen + prefixlen; i < alloclen; i++)
         {
-          file->name[i] = fstest_randchar();
+          file->name[i] = fstest_randchar(ctx);
         }
 
       file->name[alloclen] = '\0';
@@ -250,10 +340,10 @@ static inline void fstest_randfile(FAR struct fstest_ctx_s *ctx,
 {
   int i;
 
-  file->len = (rand() % ctx->max_file) + 1;
+  file->len = (fstest_rand(ctx) % ctx->max_file) + 1;
   for (i = 0; i < file->len; i++)
     {
-      ctx->fileimage[i] = fstest_randchar();
+      ctx->fileimage[i] = fstest_randchar(ctx);
     }
 
   file->crc = crc32(ctx->fileimage, file->len);
@@ -420,7 +510,7 @@ static inline int fstest_wrfile(FAR struct fstest_ctx_s *ctx,
 
   for (offset = 0; offset < file->len; )
     {
-      size_t maxio = (rand() % CONFIG_TESTING_FSTEST_MAXIO) + 1;
+      size_t maxio = (fstest_rand(ctx) % CONFIG_TESTING_FSTEST_MAXIO) + 1;
       size_t nbytestowrite = file->len - offset;
       ssize_t nbyteswritten;
 
@@ -484,6 +574,8 @@ static inline int fstest_wrfile(FAR struct fstest_ctx_s *ctx,
     }
 
   close(fd);
+  ctx->nops++;
+  ctx->nbytes += file->len;
   return OK;
 }
 
@@ -531,7 +623,7 @@ static ssize_t fstest_rdblock(FAR struct fstest_ctx_s *ctx, int fd,
                               FAR struct fstest_filedesc_s *file,
                               size_t offset, size_t len)
 {
-  size_t maxio = (rand() % CONFIG_TESTING_FSTEST_MAXIO) + 1;
+  size_t maxio = (fstest_rand(ctx) % CONFIG_TESTING_FSTEST_MAXIO) + 1;
   ssize_t nbytesread;
 
   if (len > maxio)
@@ -655,6 +747,8 @@ static inline int fstest_rdfile(FAR struct fstest_ctx_s *ctx,
     }
 
   close(fd);
+  ctx->nops++;
+  ctx->nbytes += file->len;
   return OK;
 }
 
@@ -790,7 +884,7 @@ static int fstest_delfiles(FAR struct fstest_ctx_s *ctx)
 
   /* Yes... How many files should we delete? */
 
-  ndel = (rand() % nfiles) + 1;
+  ndel = (fstest_rand(ctx) % nfiles) + 1;
 
   /* Now pick which files to delete */
 
@@ -798,7 +892,7 @@ static int fstest_delfiles(FAR struct fstest_ctx_s *ctx)
     {
       /* Guess a file index */
 
-      int ndx = (rand() % (ctx->nfiles - ctx->ndeleted));
+      int ndx = (fstest_rand(ctx) % (ctx->nfiles - ctx->ndeleted));
 
       /* And delete the next undeleted file after that random index.  NOTE
        * that the entry at ndx is not checked.
@@ -844,6 +938,7 @@ static int fstest_delfiles(FAR struct fstest_ctx_s *ctx)
 #endif
                   file->deleted = true;
                   ctx->ndeleted++;
+                  ctx->nops++;
                   break;
                 }
             }
@@ -882,6 +977,7 @@ static int fstest_delallfiles(FAR struct fstest_ctx_s *ctx)
               printf("  Deleted file %s\n", file->name);
 #endif
               fstest_freefile(file);
+              ctx->nops++;
             }
         }
     }
@@ -938,6 +1034,337 @@ static int fstest_directory(FAR struct fstest_ctx_s *ctx)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fstest_statfiles
+ ****************************************************************************/
+
+static int fstest_statfiles(FAR struct fstest_ctx_s *ctx)
+{
+  FAR struct fstest_filedesc_s *file;
+  struct stat st;
+  int ret;
+  int i;
+
+  for (i = 0; i < ctx->max_open; i++)
+    {
+      file = &ctx->files[i];
+      if (file->name != NULL && !file->deleted)
+        {
+          ret = stat(file->name, &st);
+          if (ret < 0)
+            {
+              printf("ERROR: stat failed: %d\n", errno);
+              printf("  File name: %s\n", file->name);
+              return ERROR;
+            }
+
+          if (st.st_size != file->len)
+            {
+              printf("ERROR: Bad size: %ld vs %zd\n",
+                     (long)st.st_size, file->len);
+              printf("  File name: %s\n", file->name);
+              return ERROR;
+            }
+
+          ctx->nops++;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fstest_fillphase
+ ****************************************************************************/
+
+static int fstest_fillphase(FAR struct fstest_ctx_s *ctx)
+{
+  /* Running out of space or of file structures ends the phase, it is not
+   * an error.
+   */
+
+  fstest_fillfs(ctx);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fstest_phase
+ *
+ * Description:
+ *   Run one phase and add its time, files and bytes to the statistics.
+ *   Parallel workers start each phase together on the barrier; a worker
+ *   which failed still meets the others there, but does nothing.
+ *
+ ****************************************************************************/
+
+static int fstest_phase(FAR struct fstest_ctx_s *ctx, int phase,
+                        CODE int (*func)(FAR struct fstest_ctx_s *ctx))
+{
+  FAR struct fstest_phase_s *stats = &ctx->phases[phase];
+  uint64_t start;
+  int ret;
+
+  if (ctx->barrier != NULL)
+    {
+      pthread_barrier_wait(ctx->barrier);
+    }
+
+  if (ctx->result < 0)
+    {
+      return ctx->result;
+    }
+
+  ctx->nops   = 0;
+  ctx->nbytes = 0;
+
+  start = fstest_gettime();
+  ret = func(ctx);
+  stats->elapsed += fstest_gettime() - start;
+  stats->nops    += ctx->nops;
+  stats->nbytes  += ctx->nbytes;
+
+  if (ret < 0 && ctx->barrier != NULL)
+    {
+      ctx->result = ret;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: fstest_showrates
+ *
+ * Description:
+ *   Show the throughput of each phase over all workers.  The time of a
+ *   phase is the longest time any worker spent in it.
+ *
+ ****************************************************************************/
+
+static void fstest_showrates(FAR struct fstest_ctx_s *ctx, int nworkers)
+{
+  uint64_t elapsed;
+  uint64_t nbytes;
+  uint64_t rate;
+  uint32_t nops;
+  int phase;
+  int i;
+
+  printf("\nPHASE         OPS     KBYTES  TIME(ms)     OPS/s       MB/s\n");
+  printf("======== ======== ========== ========= ========= ==========\n");
+
+  for (phase = 0; phase < FSTEST_NPHASES; phase++)
+    {
+      elapsed = 0;
+      nbytes  = 0;
+      nops    = 0;
+
+      for (i = 0; i < nworkers; i++)
+        {
+          FAR struct fstest_phase_s *stats = &ctx[i].phases[phase];
+
+          if (stats->elapsed > elapsed)
+            {
+              elapsed = stats->elapsed;
+            }
+
+          nbytes += stats->nbytes;
+          nops   += stats->nops;
+        }
+
+      if (elapsed == 0)
+        {
+          continue;
+        }
+
+      rate = nbytes * 1000000 / elapsed;
+      printf("%-8s %8lu %10lu %9lu %9lu %6lu.%03lu\n", phase_names[phase],
+             (unsigned long)nops, (unsigned long)(nbytes / 1024),
+             (unsigned long)(elapsed / 1000),
+             (unsigned long)((uint64_t)nops * 1000000 / elapsed),
+             (unsigned long)(rate >> 20),
+             (unsigned long)((rate & 0xfffff) * 1000 >> 20));
+    }
+}
+
+/****************************************************************************
+ * Name: fstest_worker
+ ****************************************************************************/
+
+static FAR void *fstest_worker(FAR void *arg)
+{
+  FAR struct fstest_ctx_s *ctx = (FAR struct fstest_ctx_s *)arg;
+  int i;
+
+  for (i = 0; i < ctx->loops; i++)
+    {
+      if (ctx->meta)
+        {
+          fstest_phase(ctx, FSTEST_PHASE_CREATE, fstest_fillphase);
+          fstest_phase(ctx, FSTEST_PHASE_STAT, fstest_statfiles);
+          fstest_phase(ctx, FSTEST_PHASE_UNLINK, fstest_delallfiles);
+        }
+      else
+        {
+          fstest_phase(ctx, FSTEST_PHASE_FILL, fstest_fillphase);
+          fstest_phase(ctx, FSTEST_PHASE_VERIFY, fstest_verifyfs);
+          fstest_phase(ctx, FSTEST_PHASE_DELETE, fstest_delfiles);
+          fstest_phase(ctx, FSTEST_PHASE_VERIFY, fstest_verifyfs);
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: fstest_starter
+ ****************************************************************************/
+
+static FAR void *fstest_starter(FAR void *arg)
+{
+  FAR struct fstest_ctx_s *ctx = (FAR struct fstest_ctx_s *)arg;
+
+  /* Wait until the barrier knows how many workers were created */
+
+  while (sem_wait(ctx->start) < 0);
+
+  return fstest_worker(ctx);
+}
+
+/****************************************************************************
+ * Name: fstest_parallel
+ *
+ * Description:
+ *   Run the loops in nworkers threads, the calling one included.  Each
+ *   worker has its own files, a share of the file structures of ctx, and
+ *   its own random sequence.  The metadata test creates, stats and
+ *   deletes small files instead.
+ *
+ ****************************************************************************/
+
+static int fstest_parallel(FAR struct fstest_ctx_s *ctx, int nworkers,
+                           int loops, bool meta)
+{
+  FAR struct fstest_ctx_s *workers;
+  pthread_barrier_t barrier;
+  pthread_attr_t attr;
+  sem_t start;
+  int ncreated = 1;
+  int ret = OK;
+  int i;
+
+  workers = calloc(nworkers, sizeof(struct fstest_ctx_s));
+  if (workers == NULL)
+    {
+      printf("ERROR: Failed to allocate %d workers\n", nworkers);
+      return ERROR;
+    }
+
+  for (i = 0; i < nworkers; i++)
+    {
+      FAR struct fstest_ctx_s *worker = &workers[i];
+
+      strlcpy(worker->mountdir, ctx->mountdir, sizeof(worker->mountdir));
+      snprintf(worker->prefix, sizeof(worker->prefix), "%02d", i);
+
+      worker->max_file = ctx->max_file;
+      if (meta && worker->max_file > FSTEST_META_MAXFILE)
+        {
+          worker->max_file = FSTEST_META_MAXFILE;
+        }
+
+      worker->max_open = ctx->max_open / nworkers;
+      if (worker->max_open < 1)
+        {
+          worker->max_open = 1;
+        }
+
+      worker->seed    = 0x93846 + i;
+      worker->loops   = loops;
+      worker->meta    = meta;
+      worker->barrier = &barrier;
+      worker->start   = &start;
+
+      worker->fileimage = calloc(worker->max_file, 1);
+      worker->files = calloc(sizeof(struct fstest_filedesc_s),
+                             worker->max_open);
+      if (worker->fileimage == NULL || worker->files == NULL)
+        {
+          printf("ERROR: Failed to allocate worker %d\n", i);
+          nworkers = i + 1;
+          ret = ERROR;
+          goto out;
+        }
+    }
+
+  printf("\n=== %s TEST, %d WORKERS, %d FILES EACH =========\n",
+         meta ? "METADATA" : "DATA", nworkers, workers[0].max_open);
+
+  /* The calling thread is worker 0, the others wait on start until the
+   * barrier is set up for the threads actually created.
+   */
+
+  sem_init(&start, 0, 0);
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_TESTING_FSTEST_STACKSIZE);
+
+  for (i = 1; i < nworkers; i++)
+    {
+      if (pthread_create(&workers[i].thread, &attr, fstest_starter,
+                         &workers[i]) != 0)
+        {
+          printf("ERROR: Failed to create worker %d\n", i);
+          ret = ERROR;
+          break;
+        }
+
+      ncreated++;
+    }
+
+  pthread_barrier_init(&barrier, NULL, ncreated);
+
+  for (i = 1; i < ncreated; i++)
+    {
+      sem_post(&start);
+    }
+
+  fstest_worker(&workers[0]);
+
+  for (i = 1; i < ncreated; i++)
+    {
+      pthread_join(workers[i].thread, NULL);
+    }
+
+  pthread_barrier_destroy(&barrier);
+  pthread_attr_destroy(&attr);
+  sem_destroy(&start);
+
+  for (i = 0; i < ncreated; i++)
+    {
+      if (workers[i].result < 0)
+        {
+          printf("ERROR: Worker %d failed: %d\n", i, workers[i].result);
+          ret = ERROR;
+        }
+    }
+
+  fstest_showrates(workers, ncreated);
+
+out:
+  for (i = 0; i < nworkers; i++)
+    {
+      if (workers[i].files != NULL)
+        {
+          fstest_delallfiles(&workers[i]);
+        }
+
+      free(workers[i].fileimage);
+      free(workers[i].files);
+    }
+
+  free(workers);
+  return ret;
+}
+
 /****************************************************************************
  * Show help Message
  ****************************************************************************/
@@ -953,6 +1380,10 @@ static void show_useage(void)
          CONFIG_TESTING_FSTEST_MAXOPEN);
   printf("-s    size of every file e.g. [%d]\n",
          CONFIG_TESTING_FSTEST_MAXFILE);
+  printf("-t    num of parallel workers, each with its own files\n"
+         "      and a share of the open files, up to %d\n",
+         FSTEST_MAXTHREADS);
+  printf("-M    metadata test: create, stat and delete small files\n");
 }
 
 /****************************************************************************
@@ -971,6 +1402,8 @@ int main(int argc, FAR char *argv[])
   int ret;
   int loop_num;
   int option;
+  int nworkers = 1;
+  bool meta = false;
 
   tests_ok = tests_err = 0;
 
@@ -985,7 +1418,7 @@ int main(int argc, FAR char *argv[])
 
   /* Seed the random number generated */
 
-  srand(0x93846);
+  ctx->seed = 0x93846;
   loop_num = CONFIG_TESTING_FSTEST_NLOOPS;
   ctx->max_file = CONFIG_TESTING_FSTEST_MAXFILE;
   ctx->max_open = CONFIG_TESTING_FSTEST_MAXOPEN;
@@ -994,7 +1427,7 @@ int main(int argc, FAR char *argv[])
 
   /* Opt Parse */
 
-  while ((option = getopt(argc, argv, ":m:hn:o:s:")) != -1)
+  while ((option = getopt(argc, argv, ":m:hn:o:s:t:M")) != -1)
     {
       switch (option)
         {
@@ -1014,6 +1447,12 @@ int main(int argc, FAR char *argv[])
           case 's':
             ctx->max_file = atoi(optarg);
             break;
+          case 't':
+            nworkers = atoi(optarg);
+            break;
+          case 'M':
+            meta = true;
+            break;
           case ':':
             printf("Error: Missing required argument\n");
             free(ctx);
@@ -1030,6 +1469,30 @@ int main(int argc, FAR char *argv[])
       strlcat(ctx->mountdir, "/", sizeof(ctx->mountdir));
     }
 
+  if (nworkers < 1 || nworkers > FSTEST_MAXTHREADS)
+    {
+      printf("Error: Workers must be 1 to %d\n", FSTEST_MAXTHREADS);
+      free(ctx);
+      exit(1);
+    }
+
+  if (nworkers > 1 || meta)
+    {
+      ret = fstest_parallel(ctx, nworkers, loop_num > 0 ? loop_num : 1,
+                            meta);
+      if (ret < 0)
+        {
+          tests_err += 1;
+        }
+      else
+        {
+          tests_ok += 1;
+        }
+
+      free(ctx);
+      goto out;
+    }
+
   ctx->fileimage = calloc(ctx->max_file, 1);
   if (ctx->fileimage == NULL)
     {
@@ -1067,7 +1530,7 @@ int main(int argc, FAR char *argv[])
        */
 
       printf("\n=== FILLING %u =============================\n", i);
-      fstest_fillfs(ctx);
+      fstest_phase(ctx, FSTEST_PHASE_FILL, fstest_fillphase);
       printf("Filled file system\n");
       printf("  Number of files: %d\n", ctx->nfiles);
       printf("  Number deleted:  %d\n", ctx->ndeleted);
@@ -1083,7 +1546,7 @@ int main(int argc, FAR char *argv[])
 
       /* Verify all files written to FLASH */
 
-      ret = fstest_verifyfs(ctx);
+      ret = fstest_phase(ctx, FSTEST_PHASE_VERIFY, fstest_verifyfs);
       if (ret < 0)
         {
           printf("ERROR: Failed to verify files\n");
@@ -1104,7 +1567,7 @@ int main(int argc, FAR char *argv[])
       /* Delete some files */
 
       printf("\n=== DELETING %u ============================\n", i);
-      ret = fstest_delfiles(ctx);
+      ret = fstest_phase(ctx, FSTEST_PHASE_DELETE, fstest_delfiles);
       if (ret < 0)
         {
           tests_err += 1;
@@ -1133,7 +1596,7 @@ int main(int argc, FAR char *argv[])
 
       /* Verify all files written to FLASH */
 
-      ret = fstest_verifyfs(ctx);
+      ret = fstest_phase(ctx, FSTEST_PHASE_VERIFY, fstest_verifyfs);
       if (ret < 0)
         {
           tests_err += 1;
@@ -1178,8 +1641,9 @@ int main(int argc, FAR char *argv[])
       ret = fstest_gc(ctx, buf.f_bfree);
       UNUSED(ret);
 
-      /* Show memory usage */
+      /* Show the throughput and memory usage */
 
+      fstest_showrates(ctx, 1);
       fstest_loopmemusage(ctx);
       fflush(stdout);
     }
@@ -1193,6 +1657,7 @@ int main(int argc, FAR char *argv[])
   free(ctx->files);
   free(ctx);
 
+out:
   printf("File system tests done... OK: %d, FAILED: %d\n", tests_ok,
                                                            tests_err);
 
@@ -23,6 +23,7 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <nuttx/clock.h>
 #include <stdlib.h>
 #include <debug.h>
 #include <stdio.h>
@@ -31,6 +32,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <pthread.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -39,6 +44,23 @@
 #define MEMSTRESS_PREFIX "MemoryStress:"
 #define DEBUG_MAGIC 0xaa
 
+/* Profiling mode: default trace length and node count, latency histogram
+ * with HIST_SUB buckets per power of two timer ticks, size classes from
+ * "up to 16 bytes" doubling to "more than 16KiB", and the number of
+ * fragmentation samples taken during the single thread run.
+ */
+
+#define PROFILE_DEFAULT_OPS 10000
+#define PROFILE_DEFAULT_NODES 256
+#define PROFILE_DEFAULT_MAXSIZE 4096
+#define PROFILE_MAX_NODES 65536
+#define PROFILE_SEED 0x5eed1234
+
+#define HIST_SUB 4
+#define HIST_BUCKETS ((32 - 1) * HIST_SUB)
+#define PROFILE_CLASSES 12
+#define PROFILE_FRAG_SAMPLES 16
+
 #define OPTARG_TO_VALUE(value, type) \
   do \
   { \
@@ -95,6 +117,58 @@ struct memorystress_node_s
   size_t size;
 };
 
+enum memorystress_traceop_e
+{
+  MEMORY_STRESS_TRACE_MALLOC,
+  MEMORY_STRESS_TRACE_ALIGNED,
+  MEMORY_STRESS_TRACE_REALLOC,
+  MEMORY_STRESS_TRACE_FREE
+};
+
+/* Latencies are recorded per kind of operation and size class */
+
+enum memorystress_latency_e
+{
+  MEMORY_STRESS_LAT_ALLOC,
+  MEMORY_STRESS_LAT_REALLOC,
+  MEMORY_STRESS_LAT_FREE,
+  MEMORY_STRESS_LAT_NUM
+};
+
+struct memorystress_traceop_s
+{
+  uint32_t slot;
+  uint32_t size;
+  uint32_t align;
+  uint8_t type;
+};
+
+struct memorystress_hist_s
+{
+  uint32_t buckets[HIST_BUCKETS];
+  uint32_t count;
+  uint32_t max;
+};
+
+struct memorystress_frag_s
+{
+  size_t index;
+  size_t uordblks;
+  size_t fordblks;
+  size_t mxordblk;
+};
+
+struct memorystress_profile_s
+{
+  FAR struct memorystress_context_s *context;
+  FAR struct memorystress_node_s *nodes;
+  FAR struct memorystress_hist_s *hist;
+  pthread_t thread;
+  size_t nfailed;
+  size_t nskipped;
+  bool sample;
+};
+
 struct memorystress_context_s
 {
   FAR struct memorystress_node_s *node_array;
@@ -104,6 +178,15 @@ struct memorystress_context_s
   uint32_t sleep_us;
   size_t nthreads;
   bool debug;
+
+  /* Profiling mode */
+
+  FAR struct memorystress_traceop_s *trace;
+  size_t tracelen;
+  pthread_barrier_t barrier;
+  struct memorystress_frag_s frag[PROFILE_FRAG_SAMPLES];
+  size_t nfrag;
+  bool profile;
 };
 
 /****************************************************************************
@@ -126,6 +209,19 @@ static void show_usage(FAR const char *progname)
   printf("  -x [nthreads] Enable multi-thread stress testing. \n");
   printf("  -d [debug mode] Helps to localize the problem situation,"
          "there is a lot of information output in this mode.\n");
+  printf("\nProfiling mode: %s -p [-f <trace>] [-c <ops>]"
+         " [-m <max allocsize>] [-n <node length>] [-x <nthreads>]\n",
+         progname);
+  printf("  -p Measure the allocator instead of checking it: latency per\n"
+         "     size class, fragmentation, and scalability from 1 to\n"
+         "     nthreads threads, each replaying the trace.\n");
+  printf("  -f <trace> Replay a trace file, one operation per line:\n"
+         "     m <node> <size>          malloc\n"
+         "     a <node> <size> <align>  aligned_alloc\n"
+         "     r <node> <size>          realloc\n"
+         "     f <node>                 free\n"
+         "     Without -f a synthetic trace of <ops> operations [%d] is\n"
+         "     generated from a fixed seed.\n", PROFILE_DEFAULT_OPS);
   exit(EXIT_FAILURE);
 }
 
@@ -371,6 +467,741 @@ static FAR void *debug_realloc(FAR void *ptr, size_t new_size)
   return ptr;
 }
 
+/****************************************************************************
+ * Name: memorystress_addtrace
+ ****************************************************************************/
+
+static int memorystress_addtrace(FAR struct memorystress_context_s *context,
+                                 FAR size_t *capacity, uint8_t type,
+                                 uint32_t slot, uint32_t size,
+                                 uint32_t align)
+{
+  FAR struct memorystress_traceop_s *op;
+
+  if (context->tracelen == *capacity)
+    {
+      size_t newcap = *capacity ? *capacity * 2 : 256;
+
+      op = realloc(context->trace, newcap * sizeof(*op));
+      if (op == NULL)
+        {
+          syslog(LOG_ERR, MEMSTRESS_PREFIX "Malloc Trace Failed\n");
+          return -ENOMEM;
+        }
+
+      context->trace = op;
+      *capacity = newcap;
+    }
+
+  op = &context->trace[context->tracelen++];
+  op->type = type;
+  op->slot = slot;
+  op->size = size;
+  op->align = align;
+
+  if (slot >= context->config->nodelen)
+    {
+      context->config->nodelen = slot + 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: memorystress_loadtrace
+ *
+ * Description:
+ *   Read a recorded allocation trace.  The nodes name the live blocks, so
+ *   a trace can be captured from any allocator log by numbering them.
+ *
+ ****************************************************************************/
+
+static int memorystress_loadtrace(FAR struct memorystress_context_s *context,
+                                  FAR const char *path)
+{
+  size_t capacity = 0;
+  unsigned long slot;
+  unsigned long size;
+  unsigned long align;
+  char line[80];
+  FAR FILE *fp;
+  int lineno = 0;
+  int ret = 0;
+  uint8_t type;
+  char cmd;
+  int n;
+
+  fp = fopen(path, "r");
+  if (fp == NULL)
+    {
+      syslog(LOG_ERR, MEMSTRESS_PREFIX "Open %s Failed: %d\n", path, errno);
+      return -errno;
+    }
+
+  while (ret == 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+      lineno++;
+      size = 0;
+      align = 0;
+      n = sscanf(line, " %c %lu %lu %lu", &cmd, &slot, &size, &align);
+      if (n <= 0 || cmd == '#')
+        {
+          continue;
+        }
+
+      switch (cmd)
+        {
+          case 'm':
+            type = MEMORY_STRESS_TRACE_MALLOC;
+            n -= 3;
+            break;
+          case 'a':
+            type = MEMORY_STRESS_TRACE_ALIGNED;
+            n = (align == 0 || (align & (align - 1)) != 0) ? -1 : n - 4;
+            break;
+          case 'r':
+            type = MEMORY_STRESS_TRACE_REALLOC;
+            n -= 3;
+            break;
+          case 'f':
+            type = MEMORY_STRESS_TRACE_FREE;
+            n -= 2;
+            break;
+          default:
+            n = -1;
+            break;
+        }
+
+      if (n < 0 || slot >= PROFILE_MAX_NODES || size > UINT32_MAX)
+        {
+          syslog(LOG_ERR, MEMSTRESS_PREFIX "%s:%d: Bad Trace Line\n",
+                 path, lineno);
+          ret = -EINVAL;
+          break;
+        }
+
+      ret = memorystress_addtrace(context, &capacity, type, slot, size,
+                                  align);
+    }
+
+  fclose(fp);
+
+  if (ret == 0 && context->tracelen == 0)
+    {
+      syslog(LOG_ERR, MEMSTRESS_PREFIX "%s: Empty Trace\n", path);
+      ret = -EINVAL;
+    }
+
+  if (ret < 0)
+    {
+      free(context->trace);
+      context->trace = NULL;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: memorystress_gentrace
+ *
+ * Description:
+ *   Generate a trace with the operation mix of memorystress_iter.  The
+ *   sizes are log-uniform, most blocks are small as in real programs, and
+ *   the seed is fixed so that heap configurations can be compared.
+ *
+ ****************************************************************************/
+
+static int memorystress_gentrace(FAR struct memorystress_context_s *context,
+                                 size_t nops)
+{
+  size_t nodelen = context->config->nodelen;
+  size_t maxsize = context->config->max_allocsize;
+  uint32_t seed = PROFILE_SEED;
+  size_t capacity = 0;
+  FAR bool *used;
+  uint32_t slot;
+  uint32_t size;
+  int maxbits = 0;
+  int ret = 0;
+  size_t i;
+
+  used = zalloc(nodelen * sizeof(bool));
+  if (used == NULL)
+    {
+      syslog(LOG_ERR, MEMSTRESS_PREFIX "Malloc Trace Failed\n");
+      return -ENOMEM;
+    }
+
+  while (maxbits < 31 && ((size_t)1 << maxbits) < maxsize)
+    {
+      maxbits++;
+    }
+
+  for (i = 0; ret == 0 && i < nops; i++)
+    {
+      slot = randnum(nodelen, &seed);
+      size = 1 << randnum(maxbits + 1, &seed);
+      size = randnum(size < maxsize ? size : maxsize, &seed) + 1;
+
+      if (!used[slot])
+        {
+          if (randnum(4, &seed) == 0)
+            {
+              ret = memorystress_addtrace(context, &capacity,
+                                          MEMORY_STRESS_TRACE_ALIGNED,
+                                          slot, size,
+                                          1 << (randnum(4, &seed) + 2));
+            }
+          else
+            {
+              ret = memorystress_addtrace(context, &capacity,
+                                          MEMORY_STRESS_TRACE_MALLOC,
+                                          slot, size, 0);
+            }
+
+          used[slot] = true;
+        }
+      else if (randnum(4, &seed) == 0)
+        {
+          ret = memorystress_addtrace(context, &capacity,
+                                      MEMORY_STRESS_TRACE_REALLOC,
+                                      slot, size, 0);
+        }
+      else
+        {
+          ret = memorystress_addtrace(context, &capacity,
+                                      MEMORY_STRESS_TRACE_FREE,
+                                      slot, 0, 0);
+          used[slot] = false;
+        }
+    }
+
+  free(used);
+  if (ret < 0)
+    {
+      free(context->trace);
+      context->trace = NULL;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: hist_bucket
+ *
+ * Description:
+ *   Log-linear buckets: exact below 2 * HIST_SUB, then HIST_SUB buckets
+ *   for each power of two, so a bucket is at most 1 / HIST_SUB too wide.
+ *
+ ****************************************************************************/
+
+static int hist_bucket(uint32_t ticks)
+{
+  int shift = 0;
+
+  while ((ticks >> shift) >= 2 * HIST_SUB)
+    {
+      shift++;
+    }
+
+  if (shift == 0)
+    {
+      return (int)ticks;
+    }
+
+  return (shift + 1) * HIST_SUB + (int)((ticks >> shift) & (HIST_SUB - 1));
+}
+
+/****************************************************************************
+ * Name: hist_bucket_max
+ ****************************************************************************/
+
+static uint32_t hist_bucket_max(int bucket)
+{
+  int shift;
+
+  if (bucket < 2 * HIST_SUB)
+    {
+      return bucket;
+    }
+
+  shift = bucket / HIST_SUB - 1;
+  return (uint32_t)(((uint64_t)(HIST_SUB + bucket % HIST_SUB + 1) << shift)
+                    - 1);
+}
+
+/****************************************************************************
+ * Name: hist_percentile
+ ****************************************************************************/
+
+static uint32_t hist_percentile(FAR const struct memorystress_hist_s *hist,
+                                int percent)
+{
+  uint64_t target;
+  uint64_t seen = 0;
+  uint32_t value;
+  int i;
+
+  target = ((uint64_t)hist->count * percent + 99) / 100;
+  for (i = 0; i < HIST_BUCKETS; i++)
+    {
+      seen += hist->buckets[i];
+      if (seen >= target)
+        {
+          value = hist_bucket_max(i);
+          return value < hist->max ? value : hist->max;
+        }
+    }
+
+  return hist->max;
+}
+
+/****************************************************************************
+ * Name: size_class
+ ****************************************************************************/
+
+static int size_class(size_t size)
+{
+  int cls = 0;
+
+  while (cls < PROFILE_CLASSES - 1 && ((size_t)16 << cls) < size)
+    {
+      cls++;
+    }
+
+  return cls;
+}
+
+/****************************************************************************
+ * Name: ticks_to_ns
+ ****************************************************************************/
+
+static uint64_t ticks_to_ns(clock_t ticks)
+{
+  struct timespec ts;
+
+  perf_convert(ticks, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: memorystress_record
+ ****************************************************************************/
+
+static void memorystress_record(FAR struct memorystress_profile_s *prof,
+                                int latency, size_t size, clock_t ticks)
+{
+  FAR struct memorystress_hist_s *hist;
+
+  /* perf_gettime() deltas only exceed the 32-bit histogram with a 64-bit
+   * clock_t (CONFIG_SYSTEM_TIME64), a 32-bit one wraps instead.
+   */
+
+  if (ticks > UINT32_MAX)
+    {
+      ticks = UINT32_MAX;
+    }
+
+  hist = &prof->hist[latency * PROFILE_CLASSES + size_class(size)];
+  hist->buckets[hist_bucket(ticks)]++;
+  hist->count++;
+  if (ticks > hist->max)
+    {
+      hist->max = ticks;
+    }
+}
+
+/****************************************************************************
+ * Name: memorystress_sample
+ *
+ * Description:
+ *   Record how fragmented the heap is: the largest free block against the
+ *   total free memory.  mallinfo() walks the heap, so it is only called
+ *   outside of the timed operations of the single thread run.
+ *
+ ****************************************************************************/
+
+static void memorystress_sample(FAR struct memorystress_context_s *context,
+                                size_t index)
+{
+  FAR struct memorystress_frag_s *frag;
+  struct mallinfo info;
+
+  if (context->nfrag == PROFILE_FRAG_SAMPLES)
+    {
+      return;
+    }
+
+  info = mallinfo();
+  frag = &context->frag[context->nfrag++];
+  frag->index = index;
+  frag->uordblks = info.uordblks;
+  frag->fordblks = info.fordblks;
+  frag->mxordblk = info.mxordblk;
+}
+
+/****************************************************************************
+ * Name: memorystress_replay
+ ****************************************************************************/
+
+static FAR void *memorystress_replay(FAR void *arg)
+{
+  FAR struct memorystress_profile_s *prof;
+  FAR struct memorystress_context_s *context;
+  FAR struct memorystress_traceop_s *op;
+  FAR struct memorystress_node_s *node;
+  FAR struct memorystress_func_s *func;
+  FAR void *ptr;
+  size_t interval;
+  clock_t start;
+  clock_t ticks;
+  size_t i;
+
+  prof = (FAR struct memorystress_profile_s *)arg;
+  context = prof->context;
+  func = context->config->func;
+  interval = context->tracelen / PROFILE_FRAG_SAMPLES;
+  if (interval == 0)
+    {
+      interval = 1;
+    }
+
+  pthread_barrier_wait(&context->barrier);
+
+  for (i = 0; i < context->tracelen; i++)
+    {
+      op = &context->trace[i];
+      node = &prof->nodes[op->slot];
+
+      if (prof->sample && i % interval == interval - 1)
+        {
+          memorystress_sample(context, i + 1);
+        }
+
+      /* Operations that do not match the state of the node, as after a
+       * failed allocation, are skipped.
+       */
+
+      if (op->type == MEMORY_STRESS_TRACE_FREE ? node->buf == NULL :
+          op->type != MEMORY_STRESS_TRACE_REALLOC && node->buf != NULL)
+        {
+          prof->nskipped++;
+          continue;
+        }
+
+      switch (op->type)
+        {
+          case MEMORY_STRESS_TRACE_MALLOC:
+            start = perf_gettime();
+            ptr = func->malloc(op->size);
+            ticks = perf_gettime() - start;
+            memorystress_record(prof, MEMORY_STRESS_LAT_ALLOC, op->size,
+                                ticks);
+            break;
+          case MEMORY_STRESS_TRACE_ALIGNED:
+            start = perf_gettime();
+            ptr = func->aligned_alloc(op->align, op->size);
+            ticks = perf_gettime() - start;
+            memorystress_record(prof, MEMORY_STRESS_LAT_ALLOC, op->size,
+                                ticks);
+            break;
+          case MEMORY_STRESS_TRACE_REALLOC:
+            start = perf_gettime();
+            ptr = func->realloc(node->buf, op->size);
+            ticks = perf_gettime() - start;
+            memorystress_record(prof, MEMORY_STRESS_LAT_REALLOC, op->size,
+                                ticks);
+            break;
+          default:
+            start = perf_gettime();
+            func->freefunc(node->buf);
+            ticks = perf_gettime() - start;
+            memorystress_record(prof, MEMORY_STRESS_LAT_FREE, node->size,
+                                ticks);
+            node->buf = NULL;
+            continue;
+        }
+
+      /* A failed realloc keeps the old block */
+
+      if (ptr == NULL)
+        {
+          prof->nfailed++;
+          continue;
+        }
+
+      node->buf = ptr;
+      node->size = op->size;
+    }
+
+  for (i = 0; i < context->config->nodelen; i++)
+    {
+      func->freefunc(prof->nodes[i].buf);
+      prof->nodes[i].buf = NULL;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: memorystress_show_latency
+ ****************************************************************************/
+
+static void memorystress_show_latency(FAR struct memorystress_profile_s
+                                      *profs, size_t nthreads)
+{
+  static const FAR char *const names[MEMORY_STRESS_LAT_NUM] =
+    {
+      "alloc", "realloc", "free"
+    };
+
+  struct memorystress_hist_s hist;
+  char size[16];
+  int latency;
+  int cls;
+  size_t i;
+  int j;
+
+  printf("\nLatency with %zu thread(s), ns:\n", nthreads);
+  printf("%-8s %8s %8s %8s %8s %8s %8s\n",
+         "op", "size", "count", "p50", "p90", "p99", "max");
+
+  for (latency = 0; latency < MEMORY_STRESS_LAT_NUM; latency++)
+    {
+      for (cls = 0; cls < PROFILE_CLASSES; cls++)
+        {
+          memset(&hist, 0, sizeof(hist));
+          for (i = 0; i < nthreads; i++)
+            {
+              FAR struct memorystress_hist_s *from;
+
+              from = &profs[i].hist[latency * PROFILE_CLASSES + cls];
+              for (j = 0; j < HIST_BUCKETS; j++)
+                {
+                  hist.buckets[j] += from->buckets[j];
+                }
+
+              hist.count += from->count;
+              if (from->max > hist.max)
+                {
+                  hist.max = from->max;
+                }
+            }
+
+          if (hist.count == 0)
+            {
+              continue;
+            }
+
+          snprintf(size, sizeof(size), "%s%zu",
+                   cls == PROFILE_CLASSES - 1 ? ">" : "<=",
+                   (size_t)16 << (cls == PROFILE_CLASSES - 1 ?
+                                  cls - 1 : cls));
+          printf("%-8s %8s %8" PRIu32 " %8" PRIu64 " %8" PRIu64
+                 " %8" PRIu64 " %8" PRIu64 "\n",
+                 names[latency], size, hist.count,
+                 ticks_to_ns(hist_percentile(&hist, 50)),
+                 ticks_to_ns(hist_percentile(&hist, 90)),
+                 ticks_to_ns(hist_percentile(&hist, 99)),
+                 ticks_to_ns(hist.max));
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: memorystress_show_frag
+ ****************************************************************************/
+
+static void memorystress_show_frag(FAR struct memorystress_context_s
+                                   *context)
+{
+  FAR struct memorystress_frag_s *frag;
+  size_t worst = 0;
+  size_t percent;
+  size_t i;
+
+  printf("\nFragmentation, 100 - largest free / total free:\n");
+  printf("%8s %10s %10s %10s %5s\n",
+         "op", "used", "free", "largest", "frag");
+
+  for (i = 0; i < context->nfrag; i++)
+    {
+      frag = &context->frag[i];
+      percent = frag->fordblks ?
+                100 - frag->mxordblk * 100 / frag->fordblks : 0;
+      if (percent > worst)
+        {
+          worst = percent;
+        }
+
+      printf("%8zu %10zu %10zu %10zu %4zu%%\n", frag->index,
+             frag->uordblks, frag->fordblks, frag->mxordblk, percent);
+    }
+
+  printf("Worst fragmentation %zu%%\n", worst);
+}
+
+/****************************************************************************
+ * Name: memorystress_run
+ *
+ * Description:
+ *   Replay the trace in nthreads threads at once, each with its own nodes,
+ *   and return the wall time in timer ticks, or 0 on failure.
+ *
+ ****************************************************************************/
+
+static clock_t memorystress_run(FAR struct memorystress_context_s *context,
+                                FAR struct memorystress_profile_s *profs,
+                                size_t nthreads)
+{
+  clock_t start;
+  size_t i;
+
+  for (i = 0; i < nthreads; i++)
+    {
+      memset(profs[i].hist, 0, MEMORY_STRESS_LAT_NUM * PROFILE_CLASSES *
+                               sizeof(struct memorystress_hist_s));
+      profs[i].nfailed = 0;
+      profs[i].nskipped = 0;
+      profs[i].sample = nthreads == 1;
+    }
+
+  context->nfrag = 0;
+  pthread_barrier_init(&context->barrier, NULL, nthreads + 1);
+
+  for (i = 0; i < nthreads; i++)
+    {
+      if (pthread_create(&profs[i].thread, NULL, memorystress_replay,
+                         &profs[i]) != 0)
+        {
+          /* The barrier can't be released anymore */
+
+          syslog(LOG_ERR, MEMSTRESS_PREFIX "Failed to create thread\n");
+          exit(EXIT_FAILURE);
+        }
+    }
+
+  pthread_barrier_wait(&context->barrier);
+  start = perf_gettime();
+
+  for (i = 0; i < nthreads; i++)
+    {
+      pthread_join(profs[i].thread, NULL);
+    }
+
+  start = perf_gettime() - start;
+  pthread_barrier_destroy(&context->barrier);
+  return start > 0 ? start : 1;
+}
+
+/****************************************************************************
+ * Name: memorystress_profile
+ *
+ * Description:
+ *   Replay the trace with 1, 2, 4 ... nthreads threads.  The latencies are
+ *   shown for the single thread run and the largest one, the
+ *   fragmentation for the single thread run.
+ *
+ ****************************************************************************/
+
+static int memorystress_profile(FAR struct memorystress_context_s *context)
+{
+  FAR struct memorystress_profile_s *profs;
+  uint64_t base = 0;
+  uint64_t rate;
+  uint64_t ns;
+  size_t nfailed;
+  size_t nskipped;
+  size_t nthreads;
+  size_t i;
+  int ret = 0;
+
+  profs = zalloc(context->nthreads * sizeof(*profs));
+  if (profs == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < context->nthreads; i++)
+    {
+      profs[i].context = context;
+      profs[i].nodes = zalloc(context->config->nodelen *
+                              sizeof(struct memorystress_node_s));
+      profs[i].hist = malloc(MEMORY_STRESS_LAT_NUM * PROFILE_CLASSES *
+                             sizeof(struct memorystress_hist_s));
+      if (profs[i].nodes == NULL || profs[i].hist == NULL)
+        {
+          syslog(LOG_ERR, MEMSTRESS_PREFIX "Malloc Profile Failed\n");
+          ret = -ENOMEM;
+          goto out;
+        }
+    }
+
+  printf("Profiling %zu operations on %zu nodes\n",
+         context->tracelen, context->config->nodelen);
+  printf("\n%8s %12s %8s %8s %8s\n",
+         "threads", "ops/s", "speedup", "failed", "skipped");
+
+  for (nthreads = 1; ; nthreads *= 2)
+    {
+      if (nthreads > context->nthreads)
+        {
+          nthreads = context->nthreads;
+        }
+
+      ns = ticks_to_ns(memorystress_run(context, profs, nthreads));
+      rate = (uint64_t)context->tracelen * nthreads * 1000000000 /
+             (ns ? ns : 1);
+      if (base == 0)
+        {
+          base = rate ? rate : 1;
+        }
+
+      nfailed = 0;
+      nskipped = 0;
+      for (i = 0; i < nthreads; i++)
+        {
+          nfailed += profs[i].nfailed;
+          nskipped += profs[i].nskipped;
+        }
+
+      printf("%8zu %12" PRIu64 " %5" PRIu64 ".%02" PRIu64 "x %8zu %8zu\n",
+             nthreads, rate, rate / base, rate * 100 / base % 100,
+             nfailed, nskipped);
+
+      if (nthreads == 1)
+        {
+          memorystress_show_latency(profs, nthreads);
+          memorystress_show_frag(context);
+        }
+      else if (nthreads == context->nthreads)
+        {
+          memorystress_show_latency(profs, nthreads);
+        }
+
+      if (nthreads == context->nthreads)
+        {
+          break;
+        }
+
+      if (nthreads == 1 && context->nthreads > 1)
+        {
+          printf("\n%8s %12s %8s %8s %8s\n",
+                 "threads", "ops/s", "speedup", "failed", "skipped");
+        }
+    }
+
+out:
+  for (i = 0; i < context->nthreads; i++)
+    {
+      free(profs[i].nodes);
+      free(profs[i].hist);
+    }
+
+  free(profs);
+  return ret;
+}
+
 /****************************************************************************
  * Name: init
  ****************************************************************************/
@@ -380,6 +1211,8 @@ static void init(FAR struct memorystress_context_s *context, int argc,
 {
   FAR struct memorystress_config_s *config;
   FAR struct memorystress_func_s *func;
+  FAR const char *tracefile = NULL;
+  size_t nops = PROFILE_DEFAULT_OPS;
   int ch;
 
   memset(context, 0, sizeof(struct memorystress_context_s));
@@ -394,13 +1227,23 @@ static void init(FAR struct memorystress_context_s *context, int argc,
       exit(EXIT_FAILURE);
     }
 
-  while ((ch = getopt(argc, argv, "dm:n:t:x::")) != ERROR)
+  while ((ch = getopt(argc, argv, "c:df:m:n:pt:x::")) != ERROR)
     {
       switch (ch)
         {
+          case 'c':
+            OPTARG_TO_VALUE(nops, size_t);
+            break;
           case 'd':
             context->debug = true;
             break;
+          case 'f':
+            tracefile = optarg;
+            context->profile = true;
+            break;
+          case 'p':
+            context->profile = true;
+            break;
           case 'm':
             OPTARG_TO_VALUE(config->max_allocsize, size_t);
             break;
@@ -419,8 +1262,39 @@ static void init(FAR struct memorystress_context_s *context, int argc,
         }
     }
 
-  if (config->max_allocsize == 0 || config->nodelen == 0 ||
-      context->sleep_us == 0)
+  if (context->profile)
+    {
+      if (config->max_allocsize == 0)
+        {
+          config->max_allocsize = PROFILE_DEFAULT_MAXSIZE;
+        }
+
+      if (config->nodelen == 0)
+        {
+          config->nodelen = PROFILE_DEFAULT_NODES;
+        }
+
+      if (context->nthreads == 0 || nops == 0)
+        {
+          free(config);
+          free(func);
+          show_usage(argv[0]);
+        }
+
+      /* A trace may use more nodes than requested */
+
+      context->config = config;
+      if ((tracefile != NULL ?
+           memorystress_loadtrace(context, tracefile) :
+           memorystress_gentrace(context, nops)) < 0)
+        {
+          free(config);
+          free(func);
+          exit(EXIT_FAILURE);
+        }
+    }
+  else if (config->max_allocsize == 0 || config->nodelen == 0 ||
+           context->sleep_us == 0)
     {
       free(config);
       free(func);
@@ -447,6 +1321,15 @@ static void init(FAR struct memorystress_context_s *context, int argc,
   config->func = func;
   context->config = config;
 
+  /* The profiling mode replays the trace with nodes and threads of its
+   * own.
+   */
+
+  if (context->profile)
+    {
+      return;
+    }
+
   /* init node array */
 
   context->node_array = zalloc(config->nodelen *
@@ -503,6 +1386,20 @@ int main(int argc, FAR char *argv[])
   int i;
 
   init(&context, argc, argv);
+  if (context.profile)
+    {
+      i = memorystress_profile(&context);
+
+      /* Nothing gives the heap back at exit in a flat build, and a leak
+       * would show up in the next heap comparison.
+       */
+
+      free(context.trace);
+      free(context.config->func);
+      free(context.config);
+      return i < 0 ? EXIT_FAILURE : 0;
+    }
+
   syslog(LOG_INFO, MEMSTRESS_PREFIX "testing...\n");
   for (i = 0; i < context.nthreads; i++)
     {
@@ -39,6 +39,8 @@
  *
  * - Refactoring for NuttX code style.
  * - Test result output has been modified to display total MB written.
+ * - Latency histograms, a random/mixed test with several worker threads
+ *   and CSV output.
  */
 
 /****************************************************************************
@@ -47,10 +49,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <nuttx/clock.h>
@@ -60,6 +64,15 @@
  ****************************************************************************/
 
 #define BUFFER_ALIGN CONFIG_TESTING_SD_MEM_ALIGN_BYTES
+
+/* Latency histogram: HIST_SUB buckets per power of two microseconds, so a
+ * percentile is reported within 1 / HIST_SUB of its value.
+ */
+
+#define HIST_SUB_BITS 3
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((32 - HIST_SUB_BITS + 1) * HIST_SUB)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -70,9 +83,42 @@ typedef struct sdb_config
   int run_duration;
   bool synchronized;
   bool aligned;
+  bool verify;
+  bool random;
+  bool csv;
+  int depth;
+  int write_percent;
   size_t total_blocks_written;
 } sdb_config_t;
 
+typedef struct sdb_hist
+{
+  uint32_t buckets[HIST_BUCKETS];
+  uint32_t count;
+  uint64_t max_us;
+} sdb_hist_t;
+
+/* One worker of the mixed test, each one keeps one request outstanding */
+
+typedef struct sdb_worker
+{
+  pthread_t thread;
+  const sdb_config_t *cfg;
+  const struct timespec *start;
+  int fd;
+  int block_size;
+  uint8_t *block;
+  uint32_t seed;
+  size_t next_block;
+  size_t first_block;
+  size_t num_blocks;
+  size_t reads;
+  size_t writes;
+  size_t errors;
+  sdb_hist_t read_hist;
+  sdb_hist_t write_hist;
+} sdb_worker_t;
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -96,6 +142,14 @@ static const bool default_keep_test = false;
 static const bool default_fsync = false;
 static const bool default_verify = true;
 static const bool default_aligned = false;
+static const bool default_random = false;
+static const bool default_csv = false;
+
+static const size_t max_depth = 16;
+static const size_t min_depth = 1;
+static const size_t default_depth = 1;
+
+static const int default_write_percent = 50;
 
 /****************************************************************************
  * Private Function Prototypes
@@ -105,6 +159,8 @@ static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
                        int block_size);
 static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
                      int block_size);
+static int mixed_test(int fd, sdb_config_t *cfg, uint8_t *block,
+                      int block_size);
 
 static uint64_t time_fsync_us(int fd);
 static struct timespec get_abs_time(void);
@@ -112,7 +168,14 @@ static uint64_t get_elapsed_time_us(const struct timespec *start);
 static uint64_t time_fsync_us(int fd);
 static float ts_to_kb(uint64_t bytes, uint64_t elapsed);
 static float block_count_to_mb(size_t blocks, size_t block_size);
+static void hist_add(sdb_hist_t *hist, uint64_t us);
+static void hist_merge(sdb_hist_t *to, const sdb_hist_t *from);
+static uint64_t hist_percentile(const sdb_hist_t *hist, int percent);
+static void print_latency(const sdb_config_t *cfg, const char *test,
+                          int run, const char *op, uint64_t bytes,
+                          uint64_t elapsed, const sdb_hist_t *hist);
 static const char *print_bool(const bool value);
+static uint8_t *alloc_block(const sdb_config_t *cfg, size_t size);
 static void usage(void);
 
 /****************************************************************************
@@ -163,6 +226,141 @@ static const char *print_bool(const bool value)
   return value ? "true" : "false";
 }
 
+static uint8_t *alloc_block(const sdb_config_t *cfg, size_t size)
+{
+  if (cfg->aligned)
+    {
+      return (uint8_t *)memalign(BUFFER_ALIGN, size);
+    }
+
+  return (uint8_t *)malloc(size);
+}
+
+static int hist_bucket(uint64_t us)
+{
+  int shift = 0;
+
+  if (us > UINT32_MAX)
+    {
+      us = UINT32_MAX;
+    }
+
+  while ((us >> shift) >= 2 * HIST_SUB)
+    {
+      shift++;
+    }
+
+  if (shift == 0)
+    {
+      return (int)us;
+    }
+
+  return (shift + 1) * HIST_SUB + (int)((us >> shift) & (HIST_SUB - 1));
+}
+
+static uint64_t hist_bucket_max(int bucket)
+{
+  int shift;
+
+  if (bucket < 2 * HIST_SUB)
+    {
+      return bucket;
+    }
+
+  shift = bucket / HIST_SUB - 1;
+  return ((uint64_t)(HIST_SUB + bucket % HIST_SUB + 1) << shift) - 1;
+}
+
+static void hist_add(sdb_hist_t *hist, uint64_t us)
+{
+  hist->buckets[hist_bucket(us)]++;
+  hist->count++;
+
+  if (us > hist->max_us)
+    {
+      hist->max_us = us;
+    }
+}
+
+static void hist_merge(sdb_hist_t *to, const sdb_hist_t *from)
+{
+  for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+      to->buckets[i] += from->buckets[i];
+    }
+
+  to->count += from->count;
+
+  if (from->max_us > to->max_us)
+    {
+      to->max_us = from->max_us;
+    }
+}
+
+/* The upper bound of the bucket holding the percentile */
+
+static uint64_t hist_percentile(const sdb_hist_t *hist, int percent)
+{
+  uint64_t target;
+  uint64_t seen = 0;
+  uint64_t value;
+
+  if (hist->count == 0)
+    {
+      return 0;
+    }
+
+  target = ((uint64_t)hist->count * percent + 99) / 100;
+
+  for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+      seen += hist->buckets[i];
+      if (seen >= target && seen > 0)
+        {
+          value = hist_bucket_max(i);
+          return value < hist->max_us ? value : hist->max_us;
+        }
+    }
+
+  return hist->max_us;
+}
+
+/* Print the latencies of one kind of operation, or a CSV row with the
+ * throughput as well.  run is 0 for the total of all runs.
+ */
+
+static void print_latency(const sdb_config_t *cfg, const char *test,
+                          int run, const char *op, uint64_t bytes,
+                          uint64_t elapsed, const sdb_hist_t *hist)
+{
+  if (cfg->csv)
+    {
+      if (run > 0)
+        {
+          printf("%s,%d,", test, run);
+        }
+      else
+        {
+          printf("%s,avg,", test);
+        }
+
+      printf("%s,%llu,%llu,%.1f,%lu,%llu,%llu,%llu\n", op,
+             (unsigned long long)bytes, (unsigned long long)elapsed,
+             elapsed ? ts_to_kb(bytes, elapsed) : 0.f,
+             (unsigned long)hist->count,
+             (unsigned long long)hist_percentile(hist, 50),
+             (unsigned long long)hist_percentile(hist, 99),
+             (unsigned long long)hist->max_us);
+    }
+  else if (hist->count > 0)
+    {
+      printf("          %-5s %8lu ops, p50: %4.3f ms, p99: %4.3f ms, "
+             "max: %4.3f ms\n", op, (unsigned long)hist->count,
+             hist_percentile(hist, 50) / 1e3,
+             hist_percentile(hist, 99) / 1e3, hist->max_us / 1e3);
+    }
+}
+
 static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
                        int block_size)
 {
@@ -177,9 +375,22 @@ static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
   uint64_t total_elapsed = 0.;
   size_t total_blocks = 0;
   size_t *blocknumber = (size_t *)(void *)&block[0];
+  sdb_hist_t *hist;
+
+  /* This run and all runs, of the writes and of the fsync calls */
 
-  printf("\n");
-  printf("Testing Sequential Write Speed...\n");
+  hist = (sdb_hist_t *)calloc(4, sizeof(sdb_hist_t));
+  if (!hist)
+    {
+      printf("Failed to allocate histograms\n");
+      return;
+    }
+
+  if (!cfg->csv)
+    {
+      printf("\n");
+      printf("Testing Sequential Write Speed...\n");
+    }
 
   cfg->total_blocks_written = 0;
 
@@ -189,6 +400,7 @@ static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
       num_blocks = 0;
       max_write_time = 0;
       fsync_time = 0;
+      memset(hist, 0, 2 * sizeof(sdb_hist_t));
 
       while (get_elapsed_time_us(&start) < cfg->run_duration)
         {
@@ -196,6 +408,7 @@ static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
           write_start = get_abs_time();
           written = write(fd, block, block_size);
           write_time = get_elapsed_time_us(&write_start);
+          hist_add(&hist[0], write_time);
 
           if (write_time > max_write_time)
             {
@@ -205,12 +418,15 @@ static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
           if ((int)written != block_size)
             {
               printf("Write error: %d\n", errno);
+              free(hist);
               return;
             }
 
           if (cfg->synchronized)
             {
-              fsync_time += time_fsync_us(fd);
+              write_time = time_fsync_us(fd);
+              hist_add(&hist[1], write_time);
+              fsync_time += write_time;
             }
 
           ++num_blocks;
@@ -223,24 +439,46 @@ static void write_test(int fd, sdb_config_t *cfg, uint8_t *block,
 
       if (!cfg->synchronized)
         {
-          fsync_time += time_fsync_us(fd);
+          write_time = time_fsync_us(fd);
+          hist_add(&hist[1], write_time);
+          fsync_time += write_time;
         }
 
       elapsed = get_elapsed_time_us(&start);
-      printf("  Run %2i: %8.1f KB/s, max write time: %4.3f ms (%.1f KB/s), "
-             "fsync: %4.3f ms\n", run + 1,
-             ts_to_kb(block_size * num_blocks, elapsed),
-             max_write_time / 1.e3,
-             ts_to_kb(block_size, max_write_time), fsync_time / 1e3);
+
+      if (!cfg->csv)
+        {
+          printf("  Run %2i: %8.1f KB/s, max write time: %4.3f ms "
+                 "(%.1f KB/s), fsync: %4.3f ms\n", run + 1,
+                 ts_to_kb(block_size * num_blocks, elapsed),
+                 max_write_time / 1.e3,
+                 ts_to_kb(block_size, max_write_time), fsync_time / 1e3);
+        }
+
+      print_latency(cfg, "seqwrite", run + 1, "write",
+                    (uint64_t)block_size * num_blocks, elapsed, &hist[0]);
+      print_latency(cfg, "seqwrite", run + 1, "fsync", 0, 0, &hist[1]);
+      hist_merge(&hist[2], &hist[0]);
+      hist_merge(&hist[3], &hist[1]);
 
       total_elapsed += elapsed;
       total_blocks += num_blocks;
     }
 
   cfg->total_blocks_written = total_blocks;
-  printf("  Avg   : %8.1f KB/s, %3.3f MB written.\n",
-         ts_to_kb(block_size * total_blocks, total_elapsed),
-         block_count_to_mb(total_blocks, block_size));
+
+  if (!cfg->csv)
+    {
+      printf("  Avg   : %8.1f KB/s, %3.3f MB written.\n",
+             ts_to_kb(block_size * total_blocks, total_elapsed),
+             block_count_to_mb(total_blocks, block_size));
+    }
+
+  print_latency(cfg, "seqwrite", 0, "write",
+                (uint64_t)block_size * total_blocks, total_elapsed,
+                &hist[2]);
+  print_latency(cfg, "seqwrite", 0, "fsync", 0, 0, &hist[3]);
+  free(hist);
 }
 
 static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
@@ -256,22 +494,24 @@ static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
   uint64_t elapsed;
   struct timespec read_start;
   size_t nread;
+  sdb_hist_t *hist;
 
-  printf("\n");
-  printf("Testing Sequential Read Speed...\n");
-
-  if (cfg->aligned)
-    {
-      read_block = (uint8_t *)memalign(BUFFER_ALIGN, block_size);
-    }
-  else
+  if (!cfg->csv)
     {
-      read_block = (uint8_t *)malloc(block_size);
+      printf("\n");
+      printf("Testing Sequential Read Speed...\n");
     }
 
-  if (!read_block)
+  read_block = alloc_block(cfg, block_size);
+
+  /* This run and all runs */
+
+  hist = (sdb_hist_t *)calloc(2, sizeof(sdb_hist_t));
+  if (!read_block || !hist)
     {
       printf("Failed to allocate memory block\n");
+      free(read_block);
+      free(hist);
       return -1;
     }
 
@@ -284,6 +524,7 @@ static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
       start = get_abs_time();
       num_blocks = 0;
       max_read_time = 0;
+      memset(hist, 0, sizeof(sdb_hist_t));
 
       while (get_elapsed_time_us(&start) < cfg->run_duration
              && total_blocks + num_blocks < cfg->total_blocks_written)
@@ -291,6 +532,7 @@ static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
           read_start = get_abs_time();
           nread = read(fd, read_block, block_size);
           read_time = get_elapsed_time_us(&read_start);
+          hist_add(&hist[0], read_time);
 
           if (read_time > max_read_time)
             {
@@ -301,6 +543,7 @@ static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
             {
               printf("Read error\n");
               free(read_block);
+              free(hist);
               return -1;
             }
 
@@ -329,30 +572,314 @@ static int read_test(int fd, sdb_config_t *cfg, uint8_t *block,
 
       if (num_blocks)
         {
-          printf("  Run %2i: %8.1f KB/s, max read/verify time: %3.4f ms "
-                 "(%.1f KB/s)\n", run + 1,
-                 ts_to_kb(block_size * num_blocks, elapsed),
-                 max_read_time / 1e3,
-                 ts_to_kb(block_size, max_read_time));
+          if (!cfg->csv)
+            {
+              printf("  Run %2i: %8.1f KB/s, max read/verify time: "
+                     "%3.4f ms (%.1f KB/s)\n", run + 1,
+                     ts_to_kb(block_size * num_blocks, elapsed),
+                     max_read_time / 1e3,
+                     ts_to_kb(block_size, max_read_time));
+            }
+
+          print_latency(cfg, "seqread", run + 1, "read",
+                        (uint64_t)block_size * num_blocks, elapsed,
+                        &hist[0]);
+          hist_merge(&hist[1], &hist[0]);
 
           total_elapsed += elapsed;
           total_blocks += num_blocks;
         }
     }
 
-  printf("  Avg   : %8.1f KB/s, %3.3f MB and verified\n",
-         ts_to_kb(block_size * total_blocks, total_elapsed),
-         block_count_to_mb(total_blocks, block_size));
+  if (!cfg->csv)
+    {
+      printf("  Avg   : %8.1f KB/s, %3.3f MB and verified\n",
+             ts_to_kb(block_size * total_blocks, total_elapsed),
+             block_count_to_mb(total_blocks, block_size));
+    }
+
+  print_latency(cfg, "seqread", 0, "read",
+                (uint64_t)block_size * total_blocks, total_elapsed,
+                &hist[1]);
 
   free(read_block);
+  free(hist);
   return 0;
 }
 
+/* xorshift32, rand() is not thread safe and rand_r() is optional */
+
+static uint32_t worker_rand(sdb_worker_t *worker)
+{
+  uint32_t x = worker->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  worker->seed = x;
+
+  return x;
+}
+
+static void *mixed_worker(void *arg)
+{
+  sdb_worker_t *worker = (sdb_worker_t *)arg;
+  const sdb_config_t *cfg = worker->cfg;
+  uint8_t *read_block = worker->block + worker->block_size;
+  size_t *blocknumber = (size_t *)(void *)&worker->block[0];
+  size_t *readnumber = (size_t *)(void *)&read_block[0];
+  struct timespec op_start;
+  uint64_t op_time;
+  ssize_t ret;
+  size_t blk;
+  bool is_write;
+
+  while (get_elapsed_time_us(worker->start) < cfg->run_duration)
+    {
+      if (cfg->random)
+        {
+          blk = worker_rand(worker) % cfg->total_blocks_written;
+        }
+      else
+        {
+          blk = worker->first_block + worker->next_block;
+          worker->next_block = (worker->next_block + 1) %
+                               worker->num_blocks;
+        }
+
+      is_write = (int)(worker_rand(worker) % 100) < cfg->write_percent;
+      op_start = get_abs_time();
+
+      if (is_write)
+        {
+          *blocknumber = blk;
+          ret = pwrite(worker->fd, worker->block, worker->block_size,
+                       (off_t)blk * worker->block_size);
+          if (ret == worker->block_size && cfg->synchronized)
+            {
+              fsync(worker->fd);
+            }
+        }
+      else
+        {
+          ret = pread(worker->fd, read_block, worker->block_size,
+                      (off_t)blk * worker->block_size);
+        }
+
+      op_time = get_elapsed_time_us(&op_start);
+
+      if (ret != worker->block_size)
+        {
+          worker->errors++;
+          break;
+        }
+
+      if (is_write)
+        {
+          hist_add(&worker->write_hist, op_time);
+          worker->writes++;
+        }
+      else
+        {
+          hist_add(&worker->read_hist, op_time);
+          worker->reads++;
+
+          if (cfg->verify && *readnumber != blk)
+            {
+              worker->errors++;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/* Reads and writes at random or striped offsets of the file written by
+ * write_test(), from cfg->depth workers so that many requests are
+ * outstanding.  Only the block number of a read block is verified.
+ */
+
+static int mixed_test(int fd, sdb_config_t *cfg, uint8_t *block,
+                      int block_size)
+{
+  const char *test = cfg->random ? "random" : "mixed";
+  sdb_worker_t *workers;
+  sdb_hist_t *hist;
+  struct timespec start;
+  uint64_t elapsed;
+  uint64_t total_elapsed = 0;
+  size_t total_reads = 0;
+  size_t total_writes = 0;
+  size_t reads;
+  size_t writes;
+  size_t errors = 0;
+  size_t num_blocks = cfg->total_blocks_written;
+  int nthreads;
+  int ret = 0;
+  int i;
+
+  if (num_blocks < (size_t)cfg->depth)
+    {
+      printf("Not enough blocks written for %d workers\n", cfg->depth);
+      return -1;
+    }
+
+  if (!cfg->csv)
+    {
+      printf("\n");
+      printf("Testing %s Read/Write (%d%% writes, %d outstanding)...\n",
+             cfg->random ? "Random" : "Sequential", cfg->write_percent,
+             cfg->depth);
+    }
+
+  /* This run and all runs, of the reads and of the writes */
+
+  hist = (sdb_hist_t *)calloc(4, sizeof(sdb_hist_t));
+  workers = (sdb_worker_t *)calloc(cfg->depth, sizeof(sdb_worker_t));
+  if (!hist || !workers)
+    {
+      printf("Failed to allocate workers\n");
+      free(hist);
+      free(workers);
+      return -1;
+    }
+
+  for (i = 0; i < cfg->depth; i++)
+    {
+      sdb_worker_t *worker = &workers[i];
+
+      /* A block to write followed by a block to read into */
+
+      worker->block = alloc_block(cfg, 2 * block_size);
+      if (!worker->block)
+        {
+          printf("Failed to allocate memory block\n");
+          ret = -1;
+          goto out;
+        }
+
+      memcpy(worker->block, block, block_size);
+      worker->cfg         = cfg;
+      worker->start       = &start;
+      worker->fd          = fd;
+      worker->block_size  = block_size;
+      worker->seed        = 0x9e3779b9u * (i + 1);
+      worker->first_block = num_blocks * i / cfg->depth;
+      worker->num_blocks  = num_blocks * (i + 1) / cfg->depth -
+                            worker->first_block;
+    }
+
+  for (int run = 0; run < cfg->num_runs; ++run)
+    {
+      for (i = 0; i < cfg->depth; i++)
+        {
+          workers[i].reads  = 0;
+          workers[i].writes = 0;
+          memset(&workers[i].read_hist, 0, sizeof(sdb_hist_t));
+          memset(&workers[i].write_hist, 0, sizeof(sdb_hist_t));
+        }
+
+      /* The calling thread is the first worker */
+
+      start = get_abs_time();
+
+      for (nthreads = 1; nthreads < cfg->depth; nthreads++)
+        {
+          if (pthread_create(&workers[nthreads].thread, NULL,
+                             mixed_worker, &workers[nthreads]) != 0)
+            {
+              printf("Failed to create worker %d\n", nthreads);
+              ret = -1;
+              break;
+            }
+        }
+
+      mixed_worker(&workers[0]);
+
+      for (i = 1; i < nthreads; i++)
+        {
+          pthread_join(workers[i].thread, NULL);
+        }
+
+      elapsed = get_elapsed_time_us(&start);
+
+      if (ret < 0)
+        {
+          goto out;
+        }
+
+      memset(hist, 0, 2 * sizeof(sdb_hist_t));
+      reads = 0;
+      writes = 0;
+
+      for (i = 0; i < cfg->depth; i++)
+        {
+          hist_merge(&hist[0], &workers[i].read_hist);
+          hist_merge(&hist[1], &workers[i].write_hist);
+          reads  += workers[i].reads;
+          writes += workers[i].writes;
+        }
+
+      if (!cfg->csv)
+        {
+          printf("  Run %2i: %8.1f KB/s read, %8.1f KB/s write, "
+                 "%8.1f IOPS\n", run + 1,
+                 ts_to_kb((uint64_t)block_size * reads, elapsed),
+                 ts_to_kb((uint64_t)block_size * writes, elapsed),
+                 (reads + writes) / (elapsed / 1e6));
+        }
+
+      print_latency(cfg, test, run + 1, "read",
+                    (uint64_t)block_size * reads, elapsed, &hist[0]);
+      print_latency(cfg, test, run + 1, "write",
+                    (uint64_t)block_size * writes, elapsed, &hist[1]);
+      hist_merge(&hist[2], &hist[0]);
+      hist_merge(&hist[3], &hist[1]);
+
+      total_elapsed += elapsed;
+      total_reads += reads;
+      total_writes += writes;
+    }
+
+  if (!cfg->csv)
+    {
+      printf("  Avg   : %8.1f KB/s read, %8.1f KB/s write, "
+             "%8.1f IOPS\n",
+             ts_to_kb((uint64_t)block_size * total_reads, total_elapsed),
+             ts_to_kb((uint64_t)block_size * total_writes, total_elapsed),
+             (total_reads + total_writes) / (total_elapsed / 1e6));
+    }
+
+  print_latency(cfg, test, 0, "read",
+                (uint64_t)block_size * total_reads, total_elapsed,
+                &hist[2]);
+  print_latency(cfg, test, 0, "write",
+                (uint64_t)block_size * total_writes, total_elapsed,
+                &hist[3]);
+
+out:
+  for (i = 0; i < cfg->depth; i++)
+    {
+      errors += workers[i].errors;
+      free(workers[i].block);
+    }
+
+  if (errors)
+    {
+      printf("  %zu I/O or verify errors\n", errors);
+      ret = -1;
+    }
+
+  free(workers);
+  free(hist);
+  return ret;
+}
+
 static void usage(void)
 {
   printf("Test the speed of an SD card or mount point\n");
   printf(CONFIG_TESTING_SD_BENCH_PROGNAME
-         ": [-b] [-r] [-d] [-k] [-s] [-a] [-v]\n");
+         ": [-b] [-r] [-d] [-k] [-s] [-a] [-v] [-q] [-R] [-w] [-c]\n");
   printf("  -b   Block size per write (%zu-%zu), default %zu\n",
          min_block, max_block, default_block);
   printf("  -r   Number of runs (%zu-%zu), default %zu\n",
@@ -368,6 +895,18 @@ static void usage(void)
          print_bool(default_aligned));
   printf("  -v   Verify data and block number, default %s\n",
          print_bool(default_verify));
+  printf("  -q   Outstanding requests of the mixed test, one worker\n"
+         "       thread each (%zu-%zu), default %zu\n",
+         min_depth, max_depth, default_depth);
+  printf("  -R   Random offsets in the mixed test, default %s\n",
+         print_bool(default_random));
+  printf("  -w   Percentage of writes in the mixed test (0-100),\n"
+         "       default %d\n", default_write_percent);
+  printf("  -c   Print the results as CSV, default %s\n",
+         print_bool(default_csv));
+  printf("  The mixed test runs after the sequential tests when any of\n"
+         "  -q, -R or -w is given.  With -s its write latency includes\n"
+         "  the fsync.\n");
 }
 
 /****************************************************************************
@@ -379,6 +918,7 @@ int main(int argc, char *argv[])
   size_t block_size = default_block;
   bool verify = default_verify;
   bool keep = default_keep_test;
+  bool mixed = false;
   int ch;
   int bench_fd;
   sdb_config_t cfg;
@@ -388,8 +928,12 @@ int main(int argc, char *argv[])
   cfg.num_runs = default_runs;
   cfg.run_duration = default_duration;
   cfg.aligned = default_aligned;
+  cfg.random = default_random;
+  cfg.csv = default_csv;
+  cfg.depth = default_depth;
+  cfg.write_percent = default_write_percent;
 
-  while ((ch = getopt(argc, argv, "b:r:d:ksav")) != EOF)
+  while ((ch = getopt(argc, argv, "b:r:d:ksavq:Rw:c")) != EOF)
     {
       switch (ch)
         {
@@ -421,6 +965,25 @@ int main(int argc, char *argv[])
           verify = !default_verify;
           break;
 
+        case 'q':
+          cfg.depth = strtol(optarg, NULL, 0);
+          mixed = true;
+          break;
+
+        case 'R':
+          cfg.random = !default_random;
+          mixed = true;
+          break;
+
+        case 'w':
+          cfg.write_percent = strtol(optarg, NULL, 0);
+          mixed = true;
+          break;
+
+        case 'c':
+          cfg.csv = !default_csv;
+          break;
+
         default:
           usage();
           return -1;
@@ -449,9 +1012,24 @@ int main(int argc, char *argv[])
       exit(EXIT_FAILURE);
     }
 
+  if (cfg.depth > max_depth || cfg.depth < min_depth)
+    {
+      printf("Depth outside of allowable range.\n");
+      usage();
+      exit(EXIT_FAILURE);
+    }
+
+  if (cfg.write_percent > 100 || cfg.write_percent < 0)
+    {
+      printf("Write percentage outside of allowable range.\n");
+      usage();
+      exit(EXIT_FAILURE);
+    }
+
+  cfg.verify = verify;
   cfg.run_duration *= 1000;
-  bench_fd = open(BENCHMARK_FILE,
-                  O_CREAT | (verify ? O_RDWR : O_WRONLY) | O_TRUNC);
+  bench_fd = open(BENCHMARK_FILE, O_CREAT | O_TRUNC |
+                  (verify || mixed ? O_RDWR : O_WRONLY));
 
   if (bench_fd < 0)
     {
@@ -460,14 +1038,7 @@ int main(int argc, char *argv[])
       exit(EXIT_FAILURE);
     }
 
-  if (cfg.aligned)
-    {
-      block = (uint8_t *)memalign(BUFFER_ALIGN, block_size);
-    }
-  else
-    {
-      block = (uint8_t *)malloc(block_size);
-    }
+  block = alloc_block(&cfg, block_size);
 
   if (!block)
     {
@@ -481,8 +1052,16 @@ int main(int argc, char *argv[])
       block[j] = (uint8_t)j;
     }
 
-  printf("Using block size = %zu bytes, sync = %s\n", block_size,
-         print_bool(cfg.synchronized));
+  if (cfg.csv)
+    {
+      printf("test,run,op,bytes,elapsed_us,kbps,ops,p50_us,p99_us,"
+             "max_us\n");
+    }
+  else
+    {
+      printf("Using block size = %zu bytes, sync = %s\n", block_size,
+             print_bool(cfg.synchronized));
+    }
 
   write_test(bench_fd, &cfg, block, block_size);
 
@@ -493,6 +1072,11 @@ int main(int argc, char *argv[])
       read_test(bench_fd, &cfg, block, block_size);
     }
 
+  if (mixed)
+    {
+      mixed_test(bench_fd, &cfg, block, block_size);
+    }
+
   free(block);
   close(bench_fd);
 